@@ -5,11 +5,17 @@
 * Created: 06/30/03
 *
 * History:
+*    10/18/26
+*       With RANDLOGO off, 'D' lists the frame using 'zvgDsm.c'.
+*
+*       The logo is a scene node, scaled and moved by its transform, see
+*       'zvgScene.c'.
 *
 * (c) Copyright 2002-2004, Zektor, LLC.  All Rights Reserved.
 *****************************************************************************/
 #include	<stdio.h>
 #include	<stdlib.h>
+#include	<string.h>
 
 #if defined(WIN32)
 	#include <windows.h>
@@ -29,15 +35,14 @@
 #include	"zvgEnc.h"
 #include	"timer.h"
 #include	"zvgFrame.h"
+#include	"zvgScene.h"
 
 #define	RANDLOGO					// let the DEMO logo randomly drift, else move it with keyboard
 
 // If manually moved logo, then allow a dump of the ZVG buffer using the zvg disassembler.
 
 #ifndef RANDLOGO
-uchar			ZvgDsmBfr[4096];
-extern void zvgResetDsm( void);
-extern void	zvgDsm( uchar *bfr, uint size);
+#include	"zvgDsm.h"
 #endif
 
 // Starting with a print out of the file 64x48.txt I drew the ZEKTOR logo
@@ -134,14 +139,15 @@ int ZektorLogo[] =
 
 int main( void)
 {
-	uint	err, ii;
+	uint	err;
 	char	cc;
 	int	xOffset, yOffset;						// offsets for logo
 	int	xSpeed, ySpeed;						// direction and speed values
-	int	xStart, yStart, xEnd, yEnd;		// calculated vector values
 	int	xLogo, yLogo;							// some temp values
 	int	xMinCo, xMaxCo, yMinCo, yMaxCo;	// edge color counters
 	uint	borderFlag;
+	ZvgNode_s	*logo;						// the logo, drawn at LOGO_SCALE
+	ZvgLayerXform_s	logoScale;
 
 	err = zvgFrameOpen();						// initialize everything
 
@@ -154,6 +160,24 @@ int main( void)
 
 	zvgBanner( ZvgSpeeds, &ZvgID);
 
+	// the logo is scaled by its transform, and moved each frame
+
+	err = zvgSceneAdd( &logo, NULL);
+
+	if (!err)
+		err = zvgSceneSetVectors( logo, ZektorLogo, sizeof( ZektorLogo) / sizeof( *ZektorLogo) / 4);
+
+	if (err)
+	{	zvgError( err);
+		zvgFrameClose();
+		exit( 0);
+	}
+
+	memset( &logoScale, 0, sizeof( logoScale));
+	logoScale.xx = LOGO_SCALE_X * LAYER_ONE;
+	logoScale.yy = LOGO_SCALE_Y * LAYER_ONE;
+	zvgSceneSetXform( logo, &logoScale);
+
 	// initialize the logo position to the center of the screen
 
 	xOffset = 0;
@@ -284,19 +308,8 @@ int main( void)
 		xLogo = xOffset / 256;					
 		yLogo = yOffset / 256;
 
-		for (ii = 0; ii < sizeof( ZektorLogo) / sizeof( *ZektorLogo); ii += 4)
-		{
-			// draw properly scaled and offset logo
-
-			xStart =	ZektorLogo[ii] * LOGO_SCALE_X + xLogo;
-			yStart =	ZektorLogo[ii+1] * LOGO_SCALE_Y + yLogo;
-			xEnd = ZektorLogo[ii+2] * LOGO_SCALE_X + xLogo;
-			yEnd = ZektorLogo[ii+3] * LOGO_SCALE_Y + yLogo;
-
-			// send vector info to ZVG drivers
-
-			zvgFrameVector( xStart, yStart, xEnd, yEnd);
-		}
+		zvgSceneSetPos( logo, xLogo, yLogo);
+		zvgSceneDraw( logo, NULL);
 
 #ifndef RANDLOGO
 
@@ -355,16 +368,9 @@ int main( void)
 
 			case 'd':
 			case 'D':
-
-
-				// loop through buffer sending bytes to the ZVG
-
-				for (ii = 0; ii < ZvgIO.dmaCurCount; ii++)
-					ZvgDsmBfr[ii] = _farpeekb( ZvgIO.dmaMemSel, ZvgIO.dmaCurPMode + ii);
-
-
 				zvgResetDsm();				// reset the DSM since the zcCENTER command is not seen by it
-				zvgDsm( ZvgDsmBfr, ZvgIO.dmaCurCount);
+				zvgDsm( ZvgIO.dmaCurP, ZvgIO.dmaCurCount);
+
 				break;
 			}
 #endif
@@ -387,6 +393,7 @@ int main( void)
 
 	// if loop exited, return to DOS
 
+	zvgSceneRemove( logo);
 	zvgFrameClose();		// fix up all the ZVG stuff
 	return (0);
 }
@@ -0,0 +1,49 @@
+#ifndef _ZVGBOARD_H_
+#define _ZVGBOARD_H_
+/*****************************************************************************
+* Header file for ZVGBOARD.C, driving several ZVGs from one process.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	ZVG_BOARDS		4				// most ZVGs one process can drive
+#define	BOARD_SYNC_MS	50				// longest a board waits for the rest of its group
+
+// Counters of the boards sent together, see 'zvgBoardGetStats()'
+
+typedef struct ZVGBOARDSTATS_S
+{	ulong			presents;			// times the group was sent together
+	ulong			timeouts;			// times it went without a board that was late
+	long long int	skewNs;				// first to last board ready, last time
+	long long int	maxSkewNs;			// worst of 'skewNs'
+} ZvgBoardStats_s;
+
+// Board the calling thread is working on, the index into the per board
+// globals ('ZvgIO', 'ZvgENC', 'ZvgMon' ...).  Every thread starts on board 0.
+
+extern __thread uint	ZvgCurBoard;
+
+extern uint zvgBoardSelect( uint board);
+extern char *zvgBoardEnv( void);
+extern bool zvgBoardPortUsed( uint portAdr, const char *dev);
+extern void zvgBoardOpened( bool open);
+extern void zvgBoardSync( uint mask);
+extern void zvgBoardWait( void);
+extern uint zvgBoardSendAll( uint mask);
+extern void zvgBoardGetStats( ZvgBoardStats_s *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
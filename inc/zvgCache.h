@@ -0,0 +1,50 @@
+#ifndef _ZVGCACHE_H_
+#define _ZVGCACHE_H_
+/*****************************************************************************
+* Header file for ZVGCACHE.C, the cache of the ZVG's device information.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGPORT_H_
+#include	"zvgPort.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	CACHE_MAGIC		0x43475A56		// "VZGC", start of a cache file
+#define	CACHE_VERSION	1
+#define	CACHE_NAME_SZ	256				// longest cache file name
+#define	CACHE_DIR		"zvg"			// directory in '$XDG_CACHE_HOME' or '~/.cache'
+
+// What is kept in a port's cache file.  The monitor settings and speeds
+// are only used if the ZVG still returns the same 'id'.
+
+typedef struct ZVGCACHE_S
+{	uint		magic;					// CACHE_MAGIC
+	uint		version;				// CACHE_VERSION
+	uint		size;					// size of this structure
+	ZvgID_s		id;						// see 'zvgReadDeviceID()'
+	ZvgMon_s	mon;					// see 'zvgReadMonitorInfo()'
+	ZvgSpeeds_a	speeds;					// see 'zvgReadSpeedInfo()'
+} ZvgCache_s;
+
+extern uint zvgCacheName( char *name);
+extern uint zvgCacheLoad( ZvgCache_s *cache);
+extern uint zvgCacheSave( const ZvgID_s *id, const ZvgMon_s *mon, ZvgSpeeds_a speeds);
+extern void zvgCacheClear( void);
+extern bool zvgCacheSameID( const ZvgID_s *id1, const ZvgID_s *id2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef _ZVGCAP_H_
+#define _ZVGCAP_H_
+/*****************************************************************************
+* Header file for ZVGCAP.C, frame capture and replay files.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	CAP_MAGIC		"ZVGCAP1"		// start of a capture file
+#define	CAP_IDX_MAGIC	"ZVGIDX1"		// start of an index file
+#define	CAP_REC_MAGIC	0x4D52465A		// "ZFRM", start of each frame record
+#define	CAP_VERSION		1
+#define	CAP_IDX_EXT		".idx"			// added to the capture name for the index
+#define	CAP_NAME_SZ		256				// longest capture file name
+
+// A capture is two files, both only ever appended to.  The capture file
+// holds a header, then one record per frame: a 'ZvgCapRec_s' followed by
+// the bytes sent.  The index file holds a header, then one 'ZvgCapIdx_s'
+// per frame.  Values are stored in the byte order of the machine that made
+// the capture.
+
+typedef struct ZVGCAPHDR_S
+{	char			magic[8];			// CAP_MAGIC or CAP_IDX_MAGIC
+	uint			version;			// CAP_VERSION
+	uint			hdrSize;			// size of this header
+	long long int	startNs;			// wall clock time capture started, ns since 1970
+	uint			envMonitor;			// monitor flags in use, MONF_xxx
+	uint			reserved;
+} ZvgCapHdr_s;
+
+typedef struct ZVGCAPREC_S
+{	uint			magic;				// CAP_REC_MAGIC
+	uint			frame;				// frame number, starting at 0
+	long long int	timeNs;				// time frame was sent, from start of capture
+	uint			count;				// bytes sent
+	uint			vectors;			// vectors given to the encoder for the frame
+	uint			encFlags;			// encoder flags, ENCF_xxx
+	uint			reserved;
+} ZvgCapRec_s;
+
+typedef struct ZVGCAPIDX_S
+{	long long int	offset;				// position of frame's 'ZvgCapRec_s'
+	long long int	timeNs;				// time frame was sent, from start of capture
+	uint			count;				// bytes sent
+	uint			frame;				// frame number
+} ZvgCapIdx_s;
+
+// Encoder counters kept with the next frame captured
+
+typedef struct ZVGCAPSTATS_S
+{	uint	vectors;					// vectors given to the encoder
+	uint	encFlags;					// encoder flags
+} ZvgCapStats_s;
+
+// A capture file opened for replay
+
+typedef struct ZVGCAPFILE_S
+{	uchar			*dataP;				// capture file, mapped
+	ulong			dataSize;
+	ZvgCapIdx_s		*idxP;				// frame index, mapped or built
+	uint			frames;				// frames in index
+	bool			idxMapped;			// index was mapped from the index file
+	ulong			idxSize;			// bytes mapped from the index file
+	ZvgCapHdr_s		*hdrP;				// capture header
+} ZvgCapFile_s;
+
+// A frame read from a capture
+
+typedef struct ZVGCAPFRAME_S
+{	uchar			*mem;				// bytes sent, points into the mapped file
+	uint			count;
+	uint			frame;
+	long long int	timeNs;
+	uint			vectors;
+	uint			encFlags;
+} ZvgCapFrame_s;
+
+extern uint zvgCapStart( const char *name);
+extern void zvgCapStop( void);
+extern void zvgCapSetStats( const ZvgCapStats_s *stats);
+extern uint zvgCapFrame( uchar *mem, uint count);
+
+extern uint zvgCapOpen( ZvgCapFile_s *cf, const char *name);
+extern void zvgCapClose( ZvgCapFile_s *cf);
+extern uint zvgCapGetFrame( ZvgCapFile_s *cf, uint idx, ZvgCapFrame_s *frm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
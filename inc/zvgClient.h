@@ -0,0 +1,60 @@
+#ifndef _ZVGCLIENT_H_
+#define _ZVGCLIENT_H_
+/*****************************************************************************
+* Header file for ZVGCLIENT.C, drawing through the 'zvgd' frame server.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGENC_H_
+#include	"zvgEnc.h"
+#endif
+
+#ifndef _ZVGPORT_H_
+#include	"zvgPort.h"
+#endif
+
+#ifndef _ZVGD_H_
+#include	"zvgd.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The same aliases as 'zvgFrame.h', the encoder writes into the ring
+
+#define	zvgClientSetColor( newcolor) \
+			zvgEncSetColor( newcolor)
+
+#define	zvgClientSetRGB24( red, green, blue) \
+			zvgEncSetRGB24( red, green, blue)
+
+#define	zvgClientSetRGB16( red, green, blue) \
+			zvgEncSetRGB16( red, green, blue)
+
+#define	zvgClientSetRGB15( red, green, blue) \
+			zvgEncSetRGB15( red, green, blue)
+
+#define	zvgClientSetClipWin( xMin, yMin, xMax, yMax) \
+			zvgEncSetClipWin( xMin, yMin, xMax, yMax)
+
+extern uint zvgClientOpen( uint board, uint prio, uint flags);
+extern void zvgClientClose( void);
+extern uint zvgClientVector( int xStart, int yStart, int xEnd, int yEnd);
+extern uint zvgClientSend( void);
+extern uint zvgClientPoll( void);
+extern int zvgClientFd( void);
+extern bool zvgClientFocus( void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef _ZVGCTL_H_
+#define _ZVGCTL_H_
+/*****************************************************************************
+* Header file for ZVGCTL.C, the queue of control commands sent with frames.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGPORT_H_
+#include	"zvgPort.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	CTL_QUEUE_SZ	64				// most commands waiting for the next frame
+
+// The ZVG's monitor registers, for 'zvgCtlSet()'
+
+enum ctlReg
+{	crZShift,							// zcZSHIFT, 'ZvgMon.zShift'
+	crOShoot,							// zcOSHOOT, 'ZvgMon.oShoot'
+	crJump,								// zcJUMP, 'ZvgMon.jumpFactor'
+	crSettle,							// zcSETTLE, 'ZvgMon.settle'
+	crPointI,							// zcPOINT_I, 'ZvgMon.point_i'
+	crMinI,								// zcMIN_I, 'ZvgMon.min_i'
+	crMaxI,								// zcMAX_I, 'ZvgMon.max_i'
+	crScale,							// zcSCALE, 'ZvgMon.scale'
+	CTL_REGS
+};
+
+// Control command counters, see 'zvgCtlGetStats()'
+
+typedef struct ZVGCTLSTATS_S
+{	ulong			sets;				// calls to 'zvgCtlSet()'
+	ulong			sent;				// register writes sent
+	ulong			coalesced;			// writes replaced by a later one before being sent
+	ulong			redundant;			// writes not sent, the ZVG already had the value
+	ulong			cmds;				// other commands sent
+	ulong			deferred;			// frames that had no room for the commands waiting
+} ZvgCtlStats_s;
+
+extern uint zvgCtlSet( uint reg, uint value);
+extern uint zvgCtlGet( uint reg);
+extern uint zvgCtlCmd( uint cmd);
+extern void zvgCtlSync( void);
+extern uint zvgCtlFlush( void);
+extern void zvgCtlReset( void);
+extern uint zvgCtlResend( uchar *bfr, const ZvgMon_s *mon);
+extern void zvgCtlGetStats( ZvgCtlStats_s *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
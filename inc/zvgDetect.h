@@ -0,0 +1,56 @@
+#ifndef _ZVGDETECT_H_
+#define _ZVGDETECT_H_
+/*****************************************************************************
+* Header file for ZVGDETECT.C, finding the port the ZVG is connected to.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGTRANS_H_
+#include	"zvgTrans.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	DETECT_MAX_PORTS	8			// most ports looked at
+#define	DETECT_NAME_SZ		16			// longest port name, "parportN"
+#define	DETECT_DEV_SZ		64			// longest device name, "/dev/parportN"
+#define	DETECT_ID_MS		100			// time allowed for a port to give its device ID
+#define	DETECT_WAIT_MS		300			// longest the probes are waited for
+
+// What a probe found on a port, best last
+
+enum detectResult
+{	drNone,								// nothing, or the port couldn't be probed
+	drEcp,								// an ECP port, but no ZVG ID
+	drZvg								// a ZVG answered with its device ID
+};
+
+// A port that may have a ZVG on it
+
+typedef struct ZVGDETECT_S
+{	char			name[DETECT_NAME_SZ];	// name given by the kernel, "parportN"
+	char			dev[DETECT_DEV_SZ];		// ppdev device, "" if none
+	uint			portAdr;				// base address, 0 if not known
+	uint			result;					// drXXX
+	uint			err;					// why the probe found nothing
+	long long int	probeNs;				// time the probe took
+} ZvgDetect_s;
+
+extern uint zvgDetectList( ZvgDetect_s *ports, uint maxPorts, uint *count);
+extern void zvgDetectProbe( ZvgDetect_s *ports, uint count);
+extern uint zvgDetect( char *trSpec, uint *portAdr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
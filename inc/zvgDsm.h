@@ -0,0 +1,87 @@
+#ifndef _ZVGDSM_H_
+#define _ZVGDSM_H_
+/*****************************************************************************
+* Header file for ZVGDSM.C, the ZVG command stream disassembler.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdio.h>
+
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGEMU_H_
+#include	"zvgEmu.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	DSM_LINE_SZ		128				// longest line of a listing
+
+// Classes of commands, for the cost breakdown
+
+enum dsmClass
+{	dcVec90,							// vector, horizontal or vertical
+	dcVec45,							// vector, 45 degrees
+	dcVecRatio,							// vector, any other angle
+	dcPointRel,							// point, relative to the beam
+	dcPointAbs,							// point, at a position
+	dcNop,								// zcNOP
+	dcCenter,							// zcCENTER
+	dcSetting,							// other extended commands
+	dcReserved,							// not a ZVG command
+	DSM_CLASSES
+};
+
+// Where the bytes of a command stream go.  Distances are along the long
+// axis, as in 'ZvgEncStats_s'.
+
+typedef struct ZVGDSMCOST_S
+{	ulong	bytes;						// bytes disassembled
+	ulong	frames;						// zcCENTER commands seen
+	ulong	cmds[DSM_CLASSES];			// commands, by class
+	ulong	cmdBytes[DSM_CLASSES];		// bytes, by class
+	ulong	shortCmds;					// vectors and relative points in the short form
+	ulong	absCmds;					// commands giving a position
+	ulong	absBytes;					// bytes spent on positions
+	ulong	absWasted;					// positions that were already the beam's
+	ulong	colorCmds;					// commands giving a color
+	ulong	colorBytes;					// bytes spent on colors
+	ulong	colorWasted;				// colors that were already the beam's
+	ulong	drawUnits;					// length of vectors drawn
+	ulong	jumps;						// moves with the beam off
+	ulong	jumpUnits;					// distance moved with the beam off
+} ZvgDsmCost_s;
+
+// Disassembler state, kept from one buffer to the next
+
+typedef struct ZVGDSM_S
+{	int				xPos, yPos;			// beam position
+	uint			color;				// current color
+	ulong			offset;				// offset of the next byte in the stream
+	uchar			part[EMU_MAX_CMD];	// start of a command cut off by the end of a buffer
+	uint			partLen;
+	ZvgDsmCost_s	cost;
+} ZvgDsm_s;
+
+extern void zvgDsmReset( ZvgDsm_s *dsm);
+extern void zvgDsmRun( ZvgDsm_s *dsm, const uchar *bfr, uint count, FILE *fp);
+extern void zvgDsmFormat( const ZvgEmuCmd_s *cmd, const uchar *bfr, ulong offset, int xPos,
+		int yPos, char *line);
+extern void zvgDsmAddCost( ZvgDsmCost_s *total, const ZvgDsmCost_s *cost);
+extern void zvgDsmPrintCost( const ZvgDsmCost_s *cost, FILE *fp);
+
+extern void zvgResetDsm( void);
+extern void zvgDsm( uchar *bfr, uint size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef _ZVGEMU_H_
+#define _ZVGEMU_H_
+/*****************************************************************************
+* Header file for ZVGEMU.C, the ZVG command stream emulator.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGPORT_H_
+#include	"zvgPort.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	EMU_LOOKAHEAD	9				// bytes the ZVG must hold before it runs a command
+#define	EMU_MAX_CMD		9				// longest ZVG command
+#define	EMU_QUEUE_SZ	64				// size of the emulator's command buffer
+
+// Visible area mapped onto the raster
+
+#define	EMU_X_MIN		(-512)
+#define	EMU_X_MAX		511
+#define	EMU_Y_MIN		(-384)
+#define	EMU_Y_MAX		383
+
+// Define the kinds of decoded commands, for 'ZvgEmuCmd_s.kind'
+
+enum emuKind
+{	ekVector,							// draw a vector
+	ekPoint,							// draw a point, relative or absolute
+	ekExtended,							// zcNOP .. zcCENTER
+	ekReserved							// not a ZVG command
+};
+
+// Define flags for 'ZvgEmuCfg_s.flags'
+
+#define	EMUF_CLEAR		0x01			// clear the raster at the start of each frame
+
+// A decoded ZVG command.  For vectors and relative points, 'dx' and 'dy'
+// are the signed offsets from the starting position.
+
+typedef struct ZVGEMUCMD_S
+{	uchar	op;							// command byte
+	uchar	kind;						// ekXXX kind of command
+	uchar	size;						// bytes used by command
+	uchar	arg;						// argument of zcZSHIFT .. zcSCALE
+	bool	hasColor;					// 'color' was given
+	bool	hasXY;						// 'xx' and 'yy' were given
+	bool	hasRatio;					// 'ratio' was given
+	uint	color;						// 5-6-5 color
+	int		xx, yy;						// absolute position
+	uint	len;						// length of the long axis
+	uint	ratio;						// short axis / long axis, 16 bit fraction
+	int		dx, dy;						// offset to end point
+} ZvgEmuCmd_s;
+
+// Timing model and raster settings.  All times are in nanoseconds.  The
+// model is an approximation, good for comparing two command streams, not
+// for predicting the exact refresh rate of a given monitor.
+
+typedef struct ZVGEMUCFG_S
+{	uint	usPerInch;					// drawing speed, from the speed table
+	uint	unitsPerInch;				// ZVG units in an inch of screen
+	uint	cmdNs;						// time to decode any command
+	uint	jumpNs;						// time per unit of jump per jump factor step
+	uint	settleNs;					// time per step of the settle setting
+	uint	pointNs;					// time per step of the point intensity
+	uint	width;						// raster size, 0 for no raster
+	uint	height;
+	uint	flags;						// EMUF_xxx flags
+} ZvgEmuCfg_s;
+
+// Counters, kept for the frame being drawn and the last frame finished.
+// A frame ends when a zcCENTER command is run.
+
+typedef struct ZVGEMUSTATS_S
+{	uint			bytes;				// bytes run
+	uint			cmds;				// commands run
+	uint			vectors;			// vectors drawn
+	uint			points;				// points drawn
+	uint			jumps;				// beam off moves
+	uint			colors;				// commands that carried a color
+	uint			badCmds;			// reserved commands seen
+	ulong			drawUnits;			// total length of vectors drawn
+	ulong			jumpUnits;			// total length of jumps
+	long long int	drawNs;				// time spent drawing, by the model
+} ZvgEmuStats_s;
+
+// Emulator state
+
+typedef struct ZVGEMU_S
+{	ZvgEmuCfg_s		cfg;
+	uchar			queue[EMU_QUEUE_SZ];	// bytes waiting to be run
+	uint			qHead;
+	uint			qCount;
+	int				xPos, yPos;			// beam position
+	uint			color;				// current color
+	ZvgMon_s		mon;				// current monitor settings
+	ZvgMon_s		eeMon;				// monitor settings held in the EEPROM
+	uint			blinks;				// zcBLINK commands run
+	uint			frames;				// frames finished
+	bool			clearPend;			// raster is cleared by the next draw
+	uchar			reply[ZVG_MAX_BFRSZ];	// reply to zcREAD_MON or zcREAD_SPD
+	uint			replyLen;
+	ZvgEmuStats_s	cur;				// frame being drawn
+	ZvgEmuStats_s	last;				// last frame finished
+	uchar			*raster;			// RGB raster, 3 bytes per pixel
+} ZvgEmu_s;
+
+extern void zvgEmuDefaults( ZvgEmuCfg_s *cfg);
+extern uint zvgEmuOpen( ZvgEmu_s *emu, const ZvgEmuCfg_s *cfg);
+extern void zvgEmuClose( ZvgEmu_s *emu);
+extern void zvgEmuReset( ZvgEmu_s *emu);
+extern uint zvgEmuDecode( const uchar *bfr, uint count, ZvgEmuCmd_s *cmd);
+extern void zvgEmuFeed( ZvgEmu_s *emu, const uchar *mem, uint count);
+extern void zvgEmuClearRaster( ZvgEmu_s *emu);
+extern uint zvgEmuSavePPM( ZvgEmu_s *emu, const char *name);
+extern long long int zvgEmuEstimate( const ZvgEmuCfg_s *cfg, const ZvgMon_s *mon,
+		const ZvgEmuStats_s *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,6 +8,14 @@
 * Last Updated: 05/21/03
 *
 * History:
+*    10/18/26
+*       Added the encoder counters, 'ZvgEncStats_s'.
+*
+*       'ZvgENC' is now the current board's, see 'zvgBoard.c'.
+*
+*       Added 'zvgEncForget()', ENCF_NOPOS and the start of the first move
+*       after it, 'xFirst' and 'yFirst'.
+*
 *    06/30/03
 *       Add ENCF_BW flag for B&W monitors.
 *
@@ -17,6 +25,10 @@
 #include	"zstddef.h"
 #endif
 
+#ifndef _ZVGBOARD_H_
+#include	"zvgBoard.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -72,6 +84,32 @@ extern "C" {
 
 #define	SK_COLOR		0x0000		// Color of spot used in the spotkiller killer (0=Invisible)
 
+// Commands are counted by form, the command byte shifted right by
+// ENC_FORM_SHIFT, which drops the direction bits.  The form of a count
+// can be tested with the 'zbXXX' bits, e.g. '(form << ENC_FORM_SHIFT) & zbSHORT'.
+// A form with neither zbRATIO nor zbHZVT set is a 45 degree command,
+// 'zbABS' without 'zbVECTOR' is an absolute point.
+
+#define	ENC_FORM_SHIFT	2
+#define	ENC_FORMS		(256 >> ENC_FORM_SHIFT)
+
+// Encoder counters, cleared by 'zvgEncClearStats()'.  Vectors not encoded
+// as either a vector or a point were rejected by the clip window.
+
+typedef struct ZVGENCSTATS_S
+{	uint	vectors;					// vectors given to 'zvgEnc()'
+	uint	drawn;						// vectors encoded as vectors
+	uint	points;						// vectors encoded as points
+	uint	clipped;					// vectors cut by the clip window, but still encoded
+	uint	skDots;						// spotkill dots
+	uint	padBytes;					// NOPs added to flush the ZVG's buffer
+	uint	drawUnits;					// length of the vectors, along the long axis
+	uint	jumpUnits;					// distance moved with the beam off, along the long axis
+	uint	jumps;						// moves with the beam off
+
+	uint	cmds[ENC_FORMS];			// commands encoded, by form
+} ZvgEncStats_s;
+
 typedef struct ZVGENC_S
 {
 	// Variables used for encoding vectors
@@ -97,6 +135,15 @@ typedef struct ZVGENC_S
 	int		yMinSpot;
 	int		xMaxSpot;
 	int		yMaxSpot;
+
+	// start of the first vector or point after 'zvgEncForget()'
+
+	int		xFirst;
+	int		yFirst;
+
+	// counters
+
+	ZvgEncStats_s	stats;
 } ZvgEnc_s;
 
 // Define flags for 'ZvgEnc.encFlags'
@@ -106,17 +153,25 @@ typedef struct ZVGENC_S
 #define	ENCF_SPOTKILL	0x04			// if set, handle the spot killer
 #define	ENCF_BW			0x08			// if set, mix colors down to B&W
 #define	ENCF_NOOVS		0x10			// if set, no overscanning is allow (1024x768 max clip)
+#define	ENCF_NOPOS		0x20			// set by 'zvgEncForget()', position unknown until the next move
+
+#define	ENC_NO_COLOR	0xFFFFFFFF		// never a ZVG color, the next color is always sent
 
 // Maximum number of bytes used by one ZVG vector command
 
 #define	zENC_CMD_SIZE	9				// Max number of bytes needed to encode one command
+#define	zENC_EOF_SIZE	9				// bytes added by 'zvgEncEOF()', a center and 8 NOPs
+
+extern ZvgEnc_s	ZvgBoardENC[ZVG_BOARDS];	// Encoder information structure of each ZVG
 
-extern ZvgEnc_s	ZvgENC;				// Encoder information structure
+#define	ZvgENC		(ZvgBoardENC[ZvgCurBoard])	// the current board's, see 'zvgBoard.c'
 
 extern void zvgEncReset( void);
 extern void zvgEncSetPtr( uchar *zvgBfr);
 extern uint zvgEncSize( void);
 extern void zvgEncClearBfr( void);
+extern void zvgEncClearStats( void);
+extern void zvgEncForget( void);
 extern void zvgEncCenter( void);
 extern void zvgEncSOF( void);
 extern void zvgEncEOF( void);
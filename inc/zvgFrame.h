@@ -7,6 +7,15 @@
 * Created:      05/20/03
 *
 * History:
+*    10/18/26
+*       Added 'zvgFrameGetStats()'.  Added the draw time estimate and late
+*       frames to the counters.
+*
+*       Added 'zvgFrameOpenAsync()' and 'zvgFrameOpenWait()'.
+*
+*       'ZvgSpeeds', 'ZvgMon' and 'ZvgID' are now the current board's, see
+*       'zvgBoard.c'.
+*
 *    07/30/03
 *       Added "TIMER.H" to file.
 *
@@ -55,15 +64,57 @@ extern "C" {
 #define	zvgFrameSetClipNoOverscan() \
 			zvgEncSetClipNoOverscan()
 
+// Frame counters, for the last frame sent, and totals since 'zvgFrameOpen()'
+// or 'zvgFrameClearStats()'.  In the totals 'maxStallNs' is the longest
+// stall seen.  In real-time mode, 'sendNs', 'fulls' and 'maxStallNs' of the
+// last frame are from the frame before it, the last one finished.
+
+#define	FRAME_ENC_SAMPLE	16				// one 'zvgFrameVector()' in this many is timed
+
+typedef struct ZVGFRAMESTATS_S
+{	ulong			frames;				// frames sent
+	ulong			vectors;			// vectors given to 'zvgFrameVector()'
+	ulong			drawn;				// vectors sent as vectors
+	ulong			points;				// vectors sent as points
+	ulong			clipped;			// vectors cut by the clip window, but still sent
+	ulong			rejected;			// vectors outside the clip window, nothing sent
+	ulong			cmds[ENC_FORMS];	// commands sent, by form, see 'zvgEnc.h'
+	ulong			bytes;				// bytes sent
+	ulong			padBytes;			// NOPs added to flush the ZVG's buffer
+	ulong			skDots;				// spotkill dots
+	ulong			drawUnits;			// length of the vectors sent, along the long axis
+	ulong			jumpUnits;			// distance moved with the beam off, along the long axis
+	ulong			jumps;				// moves with the beam off
+	long long int	drawNs;				// time the ZVG takes to draw, see 'zvgEmuEstimate()'
+	ulong			missed;				// frames sent more than half a frame late
+
+	long long int	encodeNs;			// time in 'zvgFrameVector()', estimated from samples
+	long long int	sendNs;				// time sending, see 'zvgRtGetStats()'
+	ulong			fulls;				// times 'zvgEcpPutc()' found the FIFO full
+	long long int	maxStallNs;			// longest wait on a full FIFO
+	ulong			dropped;			// frames dropped while the link was down, see 'zvgLink.h'
+} ZvgFrameStats_s;
+
 // Prototypes
-extern ZvgSpeeds_a	ZvgSpeeds;
-extern ZvgMon_s		ZvgMon;
-extern ZvgID_s			ZvgID;
+extern ZvgSpeeds_a	ZvgBoardSpeeds[ZVG_BOARDS];
+extern ZvgMon_s		ZvgBoardMon[ZVG_BOARDS];
+extern ZvgID_s			ZvgBoardID[ZVG_BOARDS];
+
+// The current board's, see 'zvgBoard.c'
+
+#define	ZvgSpeeds		(ZvgBoardSpeeds[ZvgCurBoard])
+#define	ZvgMon			(ZvgBoardMon[ZvgCurBoard])
+#define	ZvgID			(ZvgBoardID[ZvgCurBoard])
 
 extern uint zvgFrameOpen( void);
+extern uint zvgFrameOpenAsync( void);
+extern uint zvgFrameOpenWait( bool wait);
+
 extern void zvgFrameClose( void);
 extern uint zvgFrameVector( uint xStart, uint yStart, uint xEnd, uint yEnd);
 extern uint zvgFrameSend(void);
+extern void zvgFrameGetStats( ZvgFrameStats_s *last, ZvgFrameStats_s *total);
+extern void zvgFrameClearStats( void);
 
 #ifdef __cplusplus
 }
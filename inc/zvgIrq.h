@@ -0,0 +1,51 @@
+#ifndef _ZVGIRQ_H_
+#define _ZVGIRQ_H_
+/*****************************************************************************
+* Header file for ZVGIRQ.C, sleeping on the port's interrupt.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	IRQ_DEV_SZ		64				// longest ppdev device name
+#define	IRQ_SLEEP_MS	2				// longest sleep waiting for one interrupt
+#define	IRQ_MISS_MAX	8				// interrupts missed in a row before giving up on them
+
+// Interrupt a wait can sleep on, for 'zvgIrqWait()'
+
+#define	IRQ_NONE		0				// none, the wait polls
+#define	IRQ_FIFO		1				// FIFO has room, the ECP service interrupt
+#define	IRQ_DATA		2				// ZVG has data, nFault (nPeriphRequest) going low
+
+// State of the interrupt waits, see 'zvgIrqGetStatus()'
+
+typedef struct ZVGIRQSTATUS_S
+{	bool			on;					// long waits sleep on the interrupt
+	int				irq;				// port's IRQ, -1 if it has none or isn't known
+	int				err;				// errno, why the interrupt isn't used
+	char			dev[IRQ_DEV_SZ];	// ppdev device taking the interrupts, "" if none
+	ulong			sleeps;				// sleeps on the interrupt
+	ulong			wakes;				// sleeps ended by the interrupt
+	ulong			misses;				// sleeps that timed out with the port ready
+} ZvgIrqStatus_s;
+
+extern void zvgIrqOpen( uint portAdr);
+extern void zvgIrqClose( void);
+extern uint zvgIrqWait( uint irq, uint port, uchar mask, uchar testVal, bool equal,
+		long long int ns);
+extern void zvgIrqGetStatus( ZvgIrqStatus_s *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef _ZVGLAYER_H_
+#define _ZVGLAYER_H_
+/*****************************************************************************
+* Header file for ZVGLAYER.C, layers composited into each frame.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	LAYER_MAX		16				// layers per board
+#define	LAYER_NAME_SZ	32				// longest name, with its terminator
+#define	LAYER_BFR_SZ	4096			// first buffer given to a layer, grown as needed
+#define	LAYER_ONE		0x10000			// 1.0 in the transform's fixed point
+
+// Flags for 'zvgLayerOpen()' and 'zvgLayerSetFlags()'
+
+#define	LAYERF_STATIC	0x01			// encoded once, then sent from the cache until dirty
+#define	LAYERF_HIDDEN	0x02			// not sent, a static layer keeps its cache
+
+// Transform from the layer's coordinates to the screen's, in 16.16 fixed
+// point:
+//
+//    x' = (x * xx + y * xy) / LAYER_ONE + dx
+//    y' = (x * yx + y * yy) / LAYER_ONE + dy
+
+typedef struct ZVGLAYERXFORM_S
+{	int				xx, xy, dx;
+	int				yx, yy, dy;
+} ZvgLayerXform_s;
+
+// Counters of the last frame, see 'zvgLayerGetStats()'
+
+typedef struct ZVGLAYERSTATS_S
+{	uint			layers;				// layers sent
+	uint			cached;				// of those, static layers sent from the cache
+	uint			encoded;			// bytes encoded into layers
+	uint			sent;				// bytes sent from layers, cached ones included
+	uint			jumpUnits;			// distance moved between layers, in the order sent
+	uint			zJumpUnits;			// the same, had they been sent in z order as opened
+	uint			dropped;			// layers left out, the frame had no room for them
+} ZvgLayerStats_s;
+
+typedef struct ZVGLAYER_S	ZvgLayer_s;	// a layer, see 'zvgLayerOpen()'
+
+extern uint zvgLayerOpen( ZvgLayer_s **layerP, const char *name, int zz, uint flags);
+extern void zvgLayerClose( ZvgLayer_s *layer);
+extern ZvgLayer_s *zvgLayerFind( const char *name);
+
+extern void zvgLayerSetClipWin( ZvgLayer_s *layer, int xMin, int yMin, int xMax, int yMax);
+extern void zvgLayerSetClipOverscan( ZvgLayer_s *layer);
+extern void zvgLayerSetXform( ZvgLayer_s *layer, const ZvgLayerXform_s *xform);
+extern void zvgLayerSetZ( ZvgLayer_s *layer, int zz);
+extern void zvgLayerSetFlags( ZvgLayer_s *layer, uint flags);
+extern void zvgLayerDirty( ZvgLayer_s *layer);
+
+extern bool zvgLayerBegin( ZvgLayer_s *layer);
+extern void zvgLayerEnd( void);
+extern bool zvgLayerActive( void);
+extern uint zvgLayerVector( int xStart, int yStart, int xEnd, int yEnd);
+extern uint zvgLayerFlush( void);
+extern void zvgLayerGetStats( ZvgLayerStats_s *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
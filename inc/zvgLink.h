@@ -0,0 +1,57 @@
+#ifndef _ZVGLINK_H_
+#define _ZVGLINK_H_
+/*****************************************************************************
+* Header file for ZVGLINK.C, recovery of a lost link to the ZVG.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGPORT_H_
+#include	"zvgPort.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	LINK_RETRY_MIN_MS	20			// wait before the first try at renegotiating
+#define	LINK_RETRY_MAX_MS	1000		// longest wait between tries
+#define	LINK_STALL_MS		300			// FIFO stall taken as a lost link, while recovering is on
+
+// Link counters, see 'zvgLinkGetStats()'
+
+typedef struct ZVGLINKSTATS_S
+{	ulong			losses;				// times the link was lost
+	ulong			recoveries;			// times it was brought back
+	ulong			tries;				// tries at renegotiating
+	ulong			dropped;			// frames dropped while the link was down
+	uint			down;				// 1 while the link is down
+	uint			lastErr;			// error that lost the link last
+	long long int	downNs;				// length of the current outage, or the last
+	long long int	maxDownNs;			// longest outage
+	long long int	totalDownNs;		// time down, outages that ended
+} ZvgLinkStats_s;
+
+extern void zvgLinkConfig( bool on);
+extern void zvgLinkSetMonitor( const ZvgMon_s *mon);
+extern bool zvgLinkIsError( uint err);
+extern uint zvgLinkLost( uint err);
+extern void zvgLinkStop( void);
+extern void zvgLinkGetStats( ZvgLinkStats_s *stats);
+extern void zvgLinkClearStats( void);
+
+// True while the link is down, and frames are being dropped
+
+#define	zvgLinkDown()		(__atomic_load_n( &ZvgIO.linkDown, __ATOMIC_ACQUIRE) != 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef _ZVGNET_H_
+#define _ZVGNET_H_
+/*****************************************************************************
+* Header file for ZVGNET.C, streaming frames to a ZVG on another machine.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGPORT_H_
+#include	"zvgPort.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	NET_MAGIC		0x5A564E31		// "ZVN1", start of each packet, and the version
+#define	NET_PORT		7430			// port used if none is given
+#define	NET_PAYLOAD_SZ	1200			// most coded bytes in a packet, fits an ethernet MTU over UDP
+#define	NET_FRAME_MAX	MEM_BFR_SZ		// largest frame, larger buffers are sent as several
+#define	NET_CODE_SZ		(NET_FRAME_MAX + NET_FRAME_MAX / 128 + 16)	// largest coded frame
+#define	NET_HIST		8				// frames kept by each side to code against
+#define	NET_MATCH_MIN	6				// shortest run copied from the reference frame
+#define	NET_ADDR_SZ		128				// longest address, "[udp:]host:port"
+#define	NET_RETRY_MS	250				// time between tries at connecting again
+#define	NET_TIMEOUT_MS	100				// longest a connection or send may take
+
+// Packet types
+
+enum netPkt
+{	npFrame,							// sender -> receiver, part of a frame
+	npAck,								// receiver -> sender, a frame was decoded and sent on
+	npNak								// receiver -> sender, a frame couldn't be decoded
+};
+
+// Flags for 'ZvgNetPkt_s.flags'
+
+#define	NETF_RAW		0x01			// frame is sent as is, not coded against another
+#define	NETF_START		0x02			// sender has no frame acknowledged yet, the receiver starts over
+
+// Each packet starts with this header, in network byte order.  A frame is
+// coded, then sent as one or more npFrame packets, each holding up to
+// NET_PAYLOAD_SZ bytes of the coded frame.
+
+typedef struct ZVGNETPKT_S
+{	long long int	sentNs;				// sender's time the frame was sent, echoed in npAck
+	long long int	latNs;				// npFrame: last end to end latency measured by the sender,
+										//   npAck: time the receiver held the frame
+	uint	magic;						// NET_MAGIC
+	uint	seq;						// frame number
+	uint	ref;						// frame coded against, unless NETF_RAW
+	uint	size;						// bytes in the frame, once decoded
+	uint	sum;						// checksum of the frame, once decoded
+	uint	coded;						// bytes in the coded frame
+	uint	offset;						// where the payload goes in the coded frame
+	ushort	len;						// bytes of payload following the header
+	uchar	type;						// npXXX
+	uchar	flags;						// NETF_xxx
+} ZvgNetPkt_s;
+
+// Counters, see 'zvgNetGetStats()' and 'zvgNetRecvStats()'
+
+typedef struct ZVGNETSTATS_S
+{	ulong			frames;				// frames sent, or received and sent on
+	ulong			rawFrames;			// of those, frames sent as is
+	ulong			acks;				// frames acknowledged
+	ulong			lost;				// frames lost or that couldn't be decoded, receiver only
+	ulong			resyncs;			// times the sender had to start over
+	ulong			dropped;			// frames dropped without a connection, sender only
+	ulong			drops;				// times the connection was lost, sender only
+	unsigned long long	bytes;			// bytes in the frames
+	unsigned long long	wire;			// bytes sent or received, headers included
+	long long int	latNs;				// last end to end latency
+	long long int	maxLatNs;			// longest
+	long long int	sumLatNs;			// total of those measured, for the mean
+	ulong			latCount;			// latencies measured
+} ZvgNetStats_s;
+
+typedef struct ZVGNETRX_S	ZvgNetRx_s;	// receiving end, see 'zvgNetListen()'
+
+extern void zvgNetGetStats( ZvgNetStats_s *stats);
+
+extern uint zvgNetListen( ZvgNetRx_s **rxP, const char *addr);
+extern void zvgNetClose( ZvgNetRx_s *rx);
+extern uint zvgNetRecv( ZvgNetRx_s *rx, uchar **mem, uint *count, int ms);
+extern void zvgNetDone( ZvgNetRx_s *rx);
+extern void zvgNetRecvStats( ZvgNetRx_s *rx, ZvgNetStats_s *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,6 +15,22 @@
 #include	"zstddef.h"
 #endif
 
+#ifndef _ZVGBOARD_H_
+#include	"zvgBoard.h"
+#endif
+
+#ifndef _ZVGIRQ_H_
+#include	"zvgIrq.h"
+#endif
+
+#ifndef _ZVGRT_H_
+#include	"zvgRt.h"
+#endif
+
+#ifndef _ZVGTRANS_H_
+#include	"zvgTrans.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -114,6 +130,21 @@ extern "C" {
 #define	EMODE_ECP				0x10
 #define	EMODE_REQID_ECP		0x14
 
+// Policies used by the handshake waits, see 'zvgSetWaitPolicy()'
+
+#define	WAIT_SPIN				0			// poll only, lowest latency
+#define	WAIT_BALANCED			1			// poll, then short sleeps (default)
+#define	WAIT_POWER				2			// poll briefly, then longer sleeps
+#define	WAIT_IRQ				3			// poll, then sleep on the port's interrupt, see 'zvgIrq.c'
+
+#define	WAIT_BALANCED_SPIN		200		// us to poll before sleeping
+#define	WAIT_BALANCED_SLEEP		50			// longest sleep in us
+#define	WAIT_POWER_SPIN			20			// us to poll before sleeping
+#define	WAIT_POWER_SLEEP		1000		// longest sleep in us
+#define	WAIT_IRQ_SPIN			20			// us to poll before sleeping on the interrupt
+#define	WAIT_MIN_SLEEP			5000LL	// first sleep in ns
+#define	WAIT_POLLS				8			// register reads between timer reads
+
 // Value returned in case of a timeout
 
 #define	ZVG_TIMEOUT				((uint)-1)
@@ -152,7 +183,37 @@ enum portErrCode
 	errZvgRomNE,				// flash data did not match ROM packet
 	errZvgRomTI,				// flash timeout during write
 	errUnknownID,				// unknown ID string returned from request ID
-	errNotRoot					// Linux requires port driver to run as root
+	errNotRoot,					// Linux requires port driver to run as root
+	errEnvRT,					// real-time priority given in environment is invalid
+	errEnvCPU,					// CPU given in environment is invalid
+	errEnvWait,					// wait policy given in environment is invalid
+	errEnvTrans,				// transport given in environment is invalid
+	errTransOpen,				// could not open transport device or file
+	errEmuSave,					// emulator image could not be saved
+	errCapOpen,					// capture file could not be opened or created
+	errCapWrite,				// capture file could not be written
+	errCapBad,					// file is not a capture file
+	errCapRange,				// frame not in capture
+	errTraceOpen,				// trace file could not be written
+	errShmOpen,					// stats segment could not be created or opened
+	errShmBad,					// segment is not a ZVG stats segment, or another version
+	errShmBusy,					// stats segment is being written, and never finished
+	errCacheOpen,				// device info cache file could not be read or written
+	errCacheBad,				// file is not a device info cache file
+	errOpenBusy,				// 'zvgFrameOpenAsync()' is still reading from the ZVG
+	errLinkDown,				// link to the ZVG was lost, and is being recovered
+	errEnvLink,					// bad link recovery value in 'ZVGPORT='
+	errReadPending,				// readback asked for hasn't come back yet
+	errCtlBad,					// control command or register not known
+	errBoardBad,				// board number not valid, or board not open
+	errServConnect,				// could not connect to 'zvgd'
+	errServRefused,				// 'zvgd' refused the client
+	errServLost,				// connection to 'zvgd' lost
+	errNetAddr,					// 'net' address not valid, or not found
+	errNetConnect,				// could not connect to, or listen on, the 'net' address
+	errLayerName,				// layer name empty, too long, or already used
+	errLayerFull,				// board has all the layers it may have
+	errShmInUse					// stats segment name is used by a program that is running
 };
 // This structure reflects the structure inside the ZVG firmware. Note that DJGPP does not
 // pack structures by default, but the data inside the ZVG is packed.
@@ -201,6 +262,15 @@ typedef struct ZVGID_S
 	uint	vESB;						// vtg error status bits
 } ZvgID_s;
 
+// Hook used to route port I/O somewhere other than the hardware, see
+// 'inportb()' and 'outportb()'
+
+typedef struct ZVGIOHOOK_S
+{	uchar	(*in)( uint port);
+	void	(*out)( uint port, uchar data);
+	bool	(*irq)( long long int ns);		// sleep until the port interrupts, NULL if it can't
+} ZvgIoHook_s;
+
 typedef struct ZVGIO_S
 {
 	// These are initialized by caller's arguments
@@ -224,6 +294,29 @@ typedef struct ZVGIO_S
 	uchar		ecpDcrState;			// Current state of the DCR register
 
 	uint		ecpFlags;				// Flags to keep track of various ECP states
+	uint		ecpBurst;				// bytes written each time the FIFO is empty, 0 = check every byte
+
+	// Transport used to reach the ZVG
+
+	const ZvgTransport_s	*trOps;		// port operations, NULL until chosen
+	const char	*trArg;					// argument given after ':', or NULL
+	void		*trData;				// transport's private data
+	char		trSpec[TR_SPEC_SZ];		// transport spec, "name:arg"
+	const ZvgIoHook_s	*ioHookP;	// port I/O hook, NULL to use the hardware
+
+	// Handshake wait policy
+
+	long long int	waitSpinNs;		// time to poll before sleeping
+	long long int	waitSleepNs;	// longest sleep between polls, 0 = never sleep
+	bool			waitSet;		// set once a policy has been chosen
+	bool			waitIrq;		// sleep on the port's interrupt, WAIT_IRQ
+
+	// Interrupt waits, see 'zvgIrq.c'
+
+	ZvgIrqStatus_s	irqStatus;		// state and counters
+	int				irqFd;			// ppdev device taking the port's interrupts
+	bool			irqOpen;		// 'irqFd' is open
+	uint			irqMissRun;		// interrupts missed in a row
 
 	// DMA variables
 
@@ -236,6 +329,58 @@ typedef struct ZVGIO_S
 	uchar		*dmaCurP;				// Pointer to current buffer
 	uint		dmaCurCount;			// Count of characters in current DMA buffer
 
+	// Real-time sender variables
+
+	struct ZVGRT_S	*rtP;			// sender thread, NULL if not running
+	ZvgRtStatus_s	rtStatus;		// state of the real-time mode
+	ZvgRtStats_s	rtStats;		// send timing
+	long long int	rtStallNs;		// longest stall in the buffer being sent
+	uint			rtFulls;		// times the FIFO was found full in the buffer being sent
+	long long int	rtPostNs;		// time the buffer being sent was handed over, 0 if not known
+	int				rtEventFd;		// signalled as each buffer finishes, see 'zvgRtEventFd()'
+	bool			rtEventOpen;	// 'rtEventFd' is open
+	ZvgFeedback_s	rtFeedback;		// last buffer finished, see 'zvgRtGetFeedback()'
+	bool			rtFeedOn;		// buffers are fed back, not so for the NOPs sent on opening
+
+	// Frame capture
+
+	struct ZVGCAP_S	*capP;			// capture being written, NULL if none
+
+	// Event trace
+
+	bool		traceEnv;				// trace was started by 'ZVGPORT=', stopped on close
+
+	// Shared memory stats segment
+
+	struct ZVGSHMPUB_S	*shmP;		// segment being published, NULL if none
+
+	// Frames streamed by the 'net' transport, see 'zvgNet.c'
+
+	struct ZVGNET_S	*netP;			// sending end, NULL if not open
+
+	// Device info cache
+
+	bool		cacheOff;				// don't use the cache, set by the caller or 'N' in 'ZVGPORT='
+
+	bool		cacheUsed;				// monitor settings and speeds came from the cache
+
+	// Link recovery
+
+	struct ZVGLINK_S	*linkP;		// recovery thread, NULL until the link is first lost
+	int			linkDown;				// set while the link is down, see 'zvgLinkDown()'
+	bool		linkOff;				// don't recover, set by 'zvgLinkConfig()' or 'L0'
+	bool		linkArmed;				// set once the ZVG has been opened
+	bool		dmaDropped;				// last buffer given to 'zvgDmaSendSwap()' was dropped
+	ulong		linkDropped;			// buffers dropped while the link was down
+
+	const ZvgMon_s	*linkMon;		// monitor settings sent after recovering, NULL if none
+
+	// Reading from the ZVG between frames
+
+	uint		rbWant;					// RB_xxx asked for, not yet sent, see 'zvgReadback.c'
+	uint		rbOut;					// RB_MON or RB_SPD sent with a frame, reply not yet read
+	long long int	rbPeriodNs;		// time between periodic reads, 0 if none
+
 	// Miscellaneous buffer used to communicate with the ZVG
 
 	uchar		mBfr[ZVG_MAX_BFRSZ];
@@ -247,6 +392,10 @@ typedef struct ZVGIO_S
 #define	ECPF_ECP			0x01			// if set, indicates we're in ECP mode
 #define	ECPF_NIBBLE		0x02			// if set, indicates we're in reverse NIBBLE mode
 
+// Size of the FIFO found on most ECP ports, the largest burst allowed
+
+#define	ECP_FIFO_SZ		16
+
 
 // Define flags for 'ZVgIO.envMonitor'
 
@@ -264,13 +413,22 @@ typedef struct ZVGIO_S
 
 // prototypes
 
-extern ZvgIO_s	ZvgIO;					// Structure used to communicate with ZVG
+extern ZvgIO_s	ZvgBoardIO[ZVG_BOARDS];	// Structure used to communicate with each ZVG
+
+#define	ZvgIO		(ZvgBoardIO[ZvgCurBoard])	// the current board's, see 'zvgBoard.c'
+
 
 extern void zvgBanner( ZvgSpeeds_a speeds, ZvgID_s *id);
+extern void zvgRtBanner( void);
+extern void zvgIrqBanner( void);
+
 extern void zvgError( uint err);
 extern uint zvgInit( void);
 extern void zvgClose( void);
 extern uint zvgDetectECP( uint portAdr);
+extern void zvgSetWaitPolicy( uint policy);
+extern void zvgSetWaitTimes( uint spinUs, uint sleepUs);
+extern void zvgSetBurst( uint size);
 extern uint zvgSppPutc( uchar cc);
 extern uint zvgSppPutMem( uchar *ss, uint len);
 extern uint zvgGetMem( uchar *ss, uint bfrLen, uint *aReadLen);
@@ -284,6 +442,9 @@ extern uint zvgGetDeviceID( uchar *ss, uint idLen, uint *aReadLen);
 extern uint zvgReadDeviceID( ZvgID_s *devID);
 extern uint zvgReadMonitorInfo( ZvgMon_s *mon);
 extern uint zvgReadSpeedInfo( ZvgSpeeds_a speeds);
+extern uint zvgGetMonitorReply( ZvgMon_s *mon);
+extern uint zvgGetSpeedReply( ZvgSpeeds_a speeds);
+
 
 
 
@@ -291,6 +452,8 @@ extern uint zvgReadSpeedInfo( ZvgSpeeds_a speeds);
 extern void zvgGetPortInfo( uint *aPORT, uint *aMON);
 
 
+extern uint zvgDmaStart( uchar *mem, uint count);
+extern uint zvgDmaWait( void);
 extern uint zvgDmaSend( void);
 extern uint zvgDmaSendSwap( void);
 extern uint zvgDmaSendPrev( void);
@@ -298,9 +461,9 @@ extern uint zvgDmaPutc( uchar cc);
 extern uint zvgDmaPutMem( uchar *mem, uint len);
 extern void zvgDmaClearBfr( void);
 
-// Linux Port Macros , using sys/io.h
-#define inportb(PortAddress)		inb(PortAddress)
-#define outportb(PortAddress,Data)	outb(Data,PortAddress)
+// Linux Port Macros , using sys/io.h, unless port I/O is hooked
+#define inportb(PortAddress)		(ZvgIO.ioHookP != NULL ? ZvgIO.ioHookP->in(PortAddress) : inb(PortAddress))
+#define outportb(PortAddress,Data)	(ZvgIO.ioHookP != NULL ? ZvgIO.ioHookP->out(PortAddress,Data) : outb(Data,PortAddress))
 
 #ifdef __cplusplus
 }
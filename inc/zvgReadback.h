@@ -0,0 +1,68 @@
+#ifndef _ZVGREADBACK_H_
+#define _ZVGREADBACK_H_
+/*****************************************************************************
+* Header file for ZVGREADBACK.C, reading from the ZVG between frames.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGPORT_H_
+#include	"zvgPort.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	RB_WAIT_MS		20				// longest a frame waits for a reply that isn't in yet
+#define	RB_LATE_MS		1000			// longest a reply is looked for, over the frames after
+
+// What can be read, for 'zvgReadbackStart()' and 'ZvgReadback_s.what'
+
+#define	RB_ID			0x01			// device ID, with the error status bits
+#define	RB_MON			0x02			// monitor settings
+#define	RB_SPD			0x04			// speed table
+#define	RB_ALL			(RB_ID | RB_MON | RB_SPD)
+
+// A finished read
+
+typedef struct ZVGREADBACK_S
+{	uint			what;				// RB_ID, RB_MON or RB_SPD
+	uint			err;				// errOk, or why the read failed
+	long long int	askNs;				// time 'zvgReadbackStart()' asked for it
+	long long int	doneNs;				// time the reply was read
+	long long int	waitNs;				// time frames were held waiting for the reply
+	ZvgID_s			id;					// RB_ID
+	ZvgMon_s		mon;				// RB_MON
+	ZvgSpeeds_a		speeds;				// RB_SPD
+} ZvgReadback_s;
+
+// Called with each finished read, from the thread sending frames
+
+typedef void (*ZvgReadbackFunc_t)( const ZvgReadback_s *rb, void *arg);
+
+extern void zvgReadbackStart( uint what);
+extern uint zvgReadbackPoll( uint what, ZvgReadback_s *rb);
+extern void zvgReadbackSetCallback( ZvgReadbackFunc_t func, void *arg);
+extern void zvgReadbackPeriod( uint what, uint periodMs);
+extern uint zvgReadbackFrame( void);
+extern uint zvgReadbackDrain( void);
+extern void zvgReadbackCancel( uint err);
+extern void zvgReadbackStop( void);
+
+// True if 'zvgReadbackFrame()' has anything to do
+
+#define	zvgReadbackActive()	(ZvgIO.rbOut != 0 || ZvgIO.rbPeriodNs != 0 \
+									|| __atomic_load_n( &ZvgIO.rbWant, __ATOMIC_ACQUIRE) != 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
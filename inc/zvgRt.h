@@ -0,0 +1,88 @@
+#ifndef _ZVGRT_H_
+#define _ZVGRT_H_
+/*****************************************************************************
+* Header file for ZVGRT.C, the real-time sender thread.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	RT_PRIO_MAX		99				// highest SCHED_FIFO priority accepted
+#define	RT_NO_CPU		(-1)			// don't pin the sender thread to a CPU
+
+// Define flags for 'ZvgRtStatus_s.flags'
+
+#define	RTF_REQUESTED	0x01			// real-time mode was asked for
+#define	RTF_THREAD		0x02			// sender thread is running
+#define	RTF_FIFO		0x04			// sender thread is running at SCHED_FIFO
+#define	RTF_PINNED		0x08			// sender thread is pinned to 'cpu'
+#define	RTF_MLOCKALL	0x10			// all process memory is locked
+#define	RTF_BFRLOCK		0x20			// only the frame buffers are locked
+
+// Current state of the real-time mode, and the reason any part of it
+// could not be setup.  The 'Err' fields hold an 'errno' value, 0 if no error.
+
+typedef struct ZVGRTSTATUS_S
+{	uint	flags;					// RTF_xxx flags
+	int		prio;					// requested SCHED_FIFO priority
+	int		cpu;					// requested CPU, or RT_NO_CPU
+	int		lockErr;				// errno returned by 'mlockall()'
+	int		schedErr;				// errno returned when setting SCHED_FIFO
+	int		cpuErr;					// errno returned when setting CPU affinity
+} ZvgRtStatus_s;
+
+// Send timing, all times are in nanoseconds.  These are kept whether or not
+// the real-time mode is active, so the two modes can be compared.
+
+typedef struct ZVGRTSTATS_S
+{	uint			frames;			// number of buffers sent
+	long long int	lastSendNs;		// time to send the last buffer
+	long long int	maxSendNs;		// worst time to send a buffer
+	long long int	lastStallNs;	// longest FIFO full stall in the last buffer
+	long long int	maxStallNs;		// longest FIFO full stall seen
+	uint			lastFulls;		// times the FIFO was found full in the last buffer
+	ulong			fulls;			// times the FIFO was found full, in all buffers
+} ZvgRtStats_s;
+
+// What happened to the last buffer, see 'zvgRtGetFeedback()'.  Times are
+// from 'tmrReadTimer()', in nanoseconds.
+
+typedef struct ZVGFEEDBACK_S
+{	ulong			seq;			// buffers finished since the ZVG was opened, this one included
+	long long int	postNs;			// time it was handed to 'zvgDmaSendSwap()'
+	long long int	startNs;		// time sending started
+	long long int	endNs;			// time the last byte went into the FIFO
+	long long int	deadlineNs;		// one frame period after 'postNs'
+	uint			bytes;			// bytes in the buffer
+	uint			err;			// error sending, errLinkDown if it was dropped
+	uint			missed;			// 1 if it finished after 'deadlineNs'
+} ZvgFeedback_s;
+
+extern void zvgRtConfig( int prio, int cpu);
+extern void zvgRtStart( void);
+extern void zvgRtStop( void);
+extern uchar *zvgRtAlloc( uint size);
+extern void zvgRtFree( uchar *bfr, uint size);
+extern uint zvgRtPost( uchar *mem, uint count);
+extern uint zvgRtWait( void);
+extern void zvgRtGetStatus( ZvgRtStatus_s *status);
+extern void zvgRtGetStats( ZvgRtStats_s *stats);
+extern int zvgRtEventFd( void);
+extern uint zvgRtGetFeedback( ZvgFeedback_s *fb);
+extern void zvgRtDone( long long int startNs, uint bytes, uint err);
+extern void zvgRtCloseEvents( void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef _ZVGSCENE_H_
+#define _ZVGSCENE_H_
+/*****************************************************************************
+* Header file for ZVGSCENE.C, a retained tree of objects drawn each frame.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGLAYER_H_
+#include	"zvgLayer.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	SCENE_INHERIT	0xFFFFFFFF		// node color, draw with the parent's
+
+// A box, empty when 'xMin' is larger than 'xMax'
+
+typedef struct ZVGSCENEBOX_S
+{	int				xMin, yMin;
+	int				xMax, yMax;
+} ZvgSceneBox_s;
+
+// Counters of one 'zvgSceneDraw()'
+
+typedef struct ZVGSCENESTATS_S
+{	uint			nodes;				// nodes visited
+	uint			culled;				// nodes not drawn, outside the cull window, subtrees included
+	uint			vectors;			// vectors given to 'zvgFrameVector()'
+	uint			culledVectors;		// vectors not given, outside the cull window
+	uint			updated;			// nodes whose transform to the screen was worked out again
+	uint			transformed;		// vectors transformed again
+} ZvgSceneStats_s;
+
+typedef struct ZVGNODE_S	ZvgNode_s;	// an object in a scene, see 'zvgSceneAdd()'
+
+extern uint zvgSceneAdd( ZvgNode_s **nodeP, ZvgNode_s *parent);
+extern void zvgSceneRemove( ZvgNode_s *node);
+
+extern uint zvgSceneSetVectors( ZvgNode_s *node, const int *vectors, uint count);
+extern void zvgSceneSetXform( ZvgNode_s *node, const ZvgLayerXform_s *xform);
+extern void zvgSceneSetPos( ZvgNode_s *node, int xx, int yy);
+extern void zvgSceneSetColor( ZvgNode_s *node, uint color);
+extern void zvgSceneShow( ZvgNode_s *node, bool show);
+extern void zvgSceneSetCullWin( ZvgNode_s *node, int xMin, int yMin, int xMax, int yMax);
+
+extern void zvgSceneUpdate( ZvgNode_s *root);
+extern void zvgSceneGetBounds( ZvgNode_s *node, ZvgSceneBox_s *box);
+extern uint zvgSceneDraw( ZvgNode_s *root, ZvgSceneStats_s *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef _ZVGSHM_H_
+#define _ZVGSHM_H_
+/*****************************************************************************
+* Header file for ZVGSHM.C, the shared memory stats segment.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifndef _ZVGFRAME_H_
+#include	"zvgFrame.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	SHM_MAGIC		0x53475A56		// "VZGS", start of a stats segment
+#define	SHM_VERSION		2
+#define	SHM_DEF_NAME	"/zvg"			// segment used if 'S' is given no name
+#define	SHM_NAME_SZ		64				// longest segment name
+#define	SHM_PROG_SZ		32				// longest program name kept
+#define	SHM_HISTORY		512				// frames kept in the history, a power of two
+#define	SHM_TRIES		1000			// reads tried before giving up on a busy segment
+
+// One frame in the history.  Times are in microseconds.
+
+typedef struct ZVGSHMFRAME_S
+{	long long int	sentNs;				// time sent, CLOCK_MONOTONIC
+	uint			bytes;				// bytes sent
+	uint			vectors;			// vectors given to 'zvgFrameVector()'
+	uint			drawUs;				// estimated draw time
+	uint			encodeUs;			// time encoding
+	uint			sendUs;				// time sending
+	uint			stallUs;			// longest wait on a full FIFO
+	uint			fulls;				// times the FIFO was found full
+	uint			missed;				// 1 if the frame was sent late
+} ZvgShmFrame_s;
+
+// The segment.  Everything after 'seq' is written under the sequence lock:
+// 'seq' is odd while the writer is updating the segment, and a reader's
+// copy is only good if 'seq' was even and unchanged across the copy.
+
+typedef struct ZVGSHM_S
+{	uint			magic;				// SHM_MAGIC
+	uint			version;			// SHM_VERSION
+	uint			size;				// size of this structure
+	int				pid;				// process writing the segment
+	char			prog[SHM_PROG_SZ];	// name of that process
+	char			trSpec[TR_SPEC_SZ];	// transport in use
+	uint			envMonitor;			// monitor flags in use, MONF_xxx
+	uint			seq;				// sequence lock
+
+	long long int	updateNs;			// time of the last update, CLOCK_MONOTONIC
+	long long int	frameNs;			// frame period, from 'tmrSetFrameRate()'
+	uint			fps100;				// frames per second over the last second, times 100
+	uint			linkDown;			// 1 while the link to the ZVG is down, see 'zvgLink.h'
+
+	ZvgFrameStats_s	last;				// see 'zvgFrameGetStats()'
+	ZvgFrameStats_s	total;
+	ulong			head;				// frames written to 'hist[]', the next goes at 'head % SHM_HISTORY'
+	ZvgShmFrame_s	hist[SHM_HISTORY];
+} ZvgShm_s;
+
+extern uint zvgShmStart( const char *name);
+extern void zvgShmStop( void);
+extern void zvgShmPublish( const ZvgFrameStats_s *last, const ZvgFrameStats_s *total);
+
+extern uint zvgShmAttach( const char *name, const ZvgShm_s **shmP);
+extern void zvgShmDetach( const ZvgShm_s *shm);
+extern uint zvgShmRead( const ZvgShm_s *shm, ZvgShm_s *copy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef _ZVGSIM_H_
+#define _ZVGSIM_H_
+/*****************************************************************************
+* Header file for ZVGSIM.C, the ECP port and ZVG simulator.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	SIM_PORT		0x378			// port address used if none given
+#define	SIM_FIFO_SZ		16				// size of the simulated ECP FIFO
+
+// Faults that can be injected, for 'ZvgSimCfg_s.faults' and 'zvgSimFault()'
+
+#define	SIMF_STALL		0x01			// ZVG stops taking data, lines stay up
+#define	SIMF_XFLAG		0x02			// ZVG drops XFlag, and refuses ECP mode
+#define	SIMF_CABLE		0x04			// cable pulled, all status lines go low
+
+// Simulator settings
+
+typedef struct ZVGSIMCFG_S
+{	uint	drainRate;				// bytes per second taken from the FIFO, 0 = at once
+	uint	nibbleDelayUs;			// delay before each nibble mode handshake reply
+	uint	faults;					// SIMF_xxx faults to inject
+	uint	faultAfter;				// bytes taken from the FIFO before faults start
+} ZvgSimCfg_s;
+
+// Simulator counters
+
+typedef struct ZVGSIMSTATS_S
+{	uint	bytes;					// bytes taken from the FIFO by the ZVG
+	uint	lost;					// bytes thrown away by a FIFO reset or overrun
+	uint	fullReads;				// reads of the ECR that found the FIFO full
+	uint	negotiations;			// IEEE-1284 negotiations
+	uint	nibbleBytes;			// bytes returned in the nibble mode
+	uint	sppBytes;				// bytes strobed in the compatibility mode
+	uint	irqs;					// interrupts raised, see 'ZvgIoHook_s.irq'
+} ZvgSimStats_s;
+
+extern void zvgSimConfig( ZvgSimCfg_s *cfg);
+extern void zvgSimFault( uint faults);
+extern void zvgSimGetStats( ZvgSimStats_s *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
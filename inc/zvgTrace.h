@@ -0,0 +1,97 @@
+#ifndef _ZVGTRACE_H_
+#define _ZVGTRACE_H_
+/*****************************************************************************
+* Header file for ZVGTRACE.C, the trace event recorder.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	TRACE_DEF_EVENTS	65536			// events kept per thread, if none given
+#define	TRACE_NAME_SZ		256				// longest trace file name
+#define	TRACE_THREAD_SZ		32				// longest thread name
+
+// Events that are traced
+
+enum traceEvent
+{	teEncode,							// frame being encoded, first vector to 'zvgFrameSend()'
+	teFrameSend,						// 'zvgFrameSend()'
+	teSend,								// a buffer being sent, 'zvgDmaStart()'
+	teStall,							// waiting on a full ECP FIFO
+	teWaitFrame,						// 'tmrWaitForFrame()'
+	teReadID,							// 'zvgReadDeviceID()'
+	teReadMon,							// 'zvgReadMonitorInfo()'
+	teReadSpd,							// 'zvgReadSpeedInfo()'
+	teEcpMode,							// 'zvgSetEcpMode()'
+	teSppMode,							// 'zvgSetSppMode()'
+	teCompat,							// port forced back to compatibility mode
+	teLinkLost,							// link to the ZVG lost, see 'zvgLink.c'
+	teRecover,							// a try at recovering the link
+	teReadback,							// reading a reply between frames, see 'zvgReadback.c'
+	teIrq,								// sleeping on the port's interrupt, see 'zvgIrq.c'
+
+	TRACE_EVENTS
+};
+
+// Phase of an event, as used by the Chrome trace format
+
+#define	TRACE_BEGIN		'B'
+#define	TRACE_END		'E'
+#define	TRACE_MARK		'i'
+
+// A recorded event
+
+typedef struct ZVGTRACEEV_S
+{	long long int	ns;					// time of event, from 'tmrReadTimer()'
+	uint			arg;				// argument, depends on the event
+	uchar			event;				// teXXX event
+	uchar			phase;				// TRACE_xxx phase
+} ZvgTraceEv_s;
+
+// Events are recorded by these macros.  They cost a test of 'ZvgTraceOn'
+// while tracing is off, and nothing at all if built with ZVG_NO_TRACE.
+
+#ifdef ZVG_NO_TRACE
+
+#define	zvgTraceOn()					0
+#define	zvgTraceBegin( ev, arg)			do { } while (0)
+#define	zvgTraceEnd( ev, arg)			do { } while (0)
+#define	zvgTraceMark( ev, arg)			do { } while (0)
+
+#else
+
+#define	zvgTraceOn()					(ZvgTraceOn)
+
+#define	zvgTraceBegin( ev, arg) \
+	do { if (ZvgTraceOn) zvgTraceEvent( (ev), TRACE_BEGIN, (arg)); } while (0)
+
+#define	zvgTraceEnd( ev, arg) \
+	do { if (ZvgTraceOn) zvgTraceEvent( (ev), TRACE_END, (arg)); } while (0)
+
+#define	zvgTraceMark( ev, arg) \
+	do { if (ZvgTraceOn) zvgTraceEvent( (ev), TRACE_MARK, (arg)); } while (0)
+
+#endif
+
+extern int	ZvgTraceOn;					// set while events are being recorded
+
+extern uint zvgTraceStart( uint events, const char *name);
+extern void zvgTraceStop( void);
+extern uint zvgTraceDump( const char *name);
+extern void zvgTraceName( const char *name);
+extern void zvgTraceEvent( uint event, uint phase, uint arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef _ZVGTRANS_H_
+#define _ZVGTRANS_H_
+/*****************************************************************************
+* Header file for ZVGTRANS.C, the transports used to talk to the ZVG.
+*
+* Created: 10/18/26
+*
+* History:
+*
+* 10/18/26 Added the simulator transport, and the default replies.
+* 10/18/26 Added the emulator transport.
+* 10/18/26 Added the network transport.
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	TR_SPEC_SZ		128			// longest transport spec, "name:arg"
+#define	TR_MEM_INIT		65536			// starting size of the memory sink
+#define	TR_MEM_MAX		(16*1024*1024)	// memory sink stops capturing at this size
+
+// Each transport supplies the port operations below.  The ECP state flags
+// in 'ZvgIO.ecpFlags' must be kept up to date by the transport, since the
+// upper layers use them to decide when to change modes.
+
+typedef struct ZVGTRANSPORT_S
+{	const char	*name;						// name used in 'ZVGPORT=' (T attribute)
+
+	uint	(*open)( uint portAdr, const char *arg);
+	void	(*close)( void);
+	void	(*reset)( void);				// drop to compatibility mode, no handshake
+	uint	(*setEcpMode)( void);
+	void	(*setSppMode)( void);
+	uint	(*ecpPutMem)( uchar *mem, uint memSize);
+	uint	(*sppPutc)( uchar cc);
+	uint	(*getMem)( uchar *ss, uint bfrLen, uint *aReadLen);
+	uint	(*getDeviceID)( uchar *ss, uint idLen, uint *aReadLen);
+	uint	(*isDataAvail)( uint aTime);
+} ZvgTransport_s;
+
+extern const ZvgTransport_s	ZvgTrDirect;	// port I/O, needs root (zvgPort.c)
+extern const ZvgTransport_s	ZvgTrPpdev;		// Linux ppdev driver (zvgPpdev.c)
+extern const ZvgTransport_s	ZvgTrNull;		// discards everything
+extern const ZvgTransport_s	ZvgTrMem;		// captures into memory
+extern const ZvgTransport_s	ZvgTrFile;		// writes to a file
+extern const ZvgTransport_s	ZvgTrSim;		// direct I/O to the simulator (zvgSim.c)
+extern const ZvgTransport_s	ZvgTrEmu;		// runs the emulator (zvgEmu.c)
+extern const ZvgTransport_s	ZvgTrNet;		// streams frames over the network (zvgNet.c)
+
+// Default replies to the ID, READ_MON and READ_SPD requests when there is
+// no ZVG
+
+extern const char	TrDefaultID[];
+extern const uchar	TrDefaultMon[];
+extern const uchar	TrDefaultSpd[];
+
+extern uint zvgSetTransport( const char *spec);
+extern void zvgTrGetMem( uchar **bfr, uint *count);
+extern void zvgTrClearMem( void);
+extern struct ZVGEMU_S *zvgTrGetEmu( void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
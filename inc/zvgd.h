@@ -0,0 +1,71 @@
+#ifndef _ZVGD_H_
+#define _ZVGD_H_
+/*****************************************************************************
+* Protocol between the 'zvgd' frame server and its clients, see 'zvgd.c'
+* and 'zvgClient.c'.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _ZSTDDEF_H_
+#include	"zstddef.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define	ZVGD_VERSION	1
+#define	ZVGD_SOCKET		"/run/zvgd.sock"	// socket used if 'ZVGD_SOCKET=' isn't set
+#define	ZVGD_SOCKET_SZ	108				// longest socket path, 'sun_path'
+#define	ZVGD_GROUP		"zvg"			// group given the socket, if there is one
+#define	ZVGD_CLIENTS	16				// most clients connected at once
+#define	ZVGD_SLOTS		3				// frame buffers in a client's ring
+#define	ZVGD_SLOT_SZ	16384			// size of each, two fit in a DMA buffer
+#define	ZVGD_RING_HDR	4096			// ring header, the slots follow it
+#define	ZVGD_RING_MAGIC	0x52475A56		// "VZGR", start of a ring
+
+// Client flags, for 'ZvgdMsg_s.flags' in zmHello
+
+#define	ZVGDF_OVERLAY	0x01			// drawn over the foreground client, never takes it over
+
+// Messages, each one is sent as a packet of its own
+
+enum zvgdMsg
+{	zmHello,							// client -> zvgd, first message, asks for a ring
+	zmWelcome,							// zvgd -> client, the ring is passed with it
+	zmSubmit,							// client -> zvgd, a slot holds a frame to show
+	zmTaken,							// zvgd -> client, the oldest frame submitted is being shown
+	zmFree,								// zvgd -> client, a slot may be filled again
+	zmFocus								// zvgd -> client, the client was brought to, or sent from, the front
+};
+
+typedef struct ZVGDMSG_S
+{	uint	type;						// zmXXX
+	uint	version;					// ZVGD_VERSION, zmHello and zmWelcome
+	uint	board;						// board to draw on, zmHello
+	uint	prio;						// priority, the highest is in the foreground, zmHello
+	uint	flags;						// ZVGDF_xxx in zmHello, ENCF_xxx to encode with in zmWelcome
+	uint	slot;						// zmSubmit, zmTaken, zmFree
+	uint	bytes;						// bytes in the slot in zmSubmit, size of a slot in zmWelcome
+	uint	slots;						// slots in the ring, zmWelcome
+	uint	err;						// errOk, or why the client was refused, zmWelcome
+	uint	focus;						// 1 if the client is being drawn, zmWelcome and zmFocus
+} ZvgdMsg_s;
+
+// Start of a ring, written by 'zvgd'.  Slot N starts at ZVGD_RING_HDR + N * 'slotSize'.
+
+typedef struct ZVGDRING_S
+{	uint	magic;						// ZVGD_RING_MAGIC
+	uint	version;					// ZVGD_VERSION
+	uint	slots;
+	uint	slotSize;
+} ZvgdRing_s;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
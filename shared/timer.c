@@ -6,12 +6,21 @@
 *
 * History:
 *
+* 261018 'tmrWaitForFrame()' is recorded when tracing, see 'zvgTrace.c'.
+*
+* 261018 Fixed 'ticksPerMs', ticks are nanoseconds so 'tmrTestMillis()' was
+*        timing microseconds.
+*
+* 261018 Read CLOCK_MONOTONIC instead of the process CPU time, which runs
+*        faster than real time once the driver has a sender thread.
+*
 * 100623 Updated by Steve Johnson for Windows
 *
 * (c) Copyright 2002-2010, Zektor, LLC.  All Rights Reserved.
 *****************************************************************************/
 #include	<time.h> //SCJ: for LINUX equivalent of Windows HRT.
 #include	"timer.h"
+#include	"zvgTrace.h"
 
 static long long int	frameZeroTime, ticksInFrame, ticksPerMs, frequency;
 static unsigned int		frameCount = 0;
@@ -21,9 +30,9 @@ static unsigned int		frameCount = 0;
  ******************************************************/
 int tmrInit(void)
 {
-	// LINUX timer is in nanoseconds (1/1000 ms)
+	// LINUX timer is in nanoseconds (1/1000000 ms)
 
-	ticksPerMs = (long long int)1000;	 // ticks per millisecond
+	ticksPerMs = (long long int)1000000;	 // ticks per millisecond
 	frequency  = (long long int)1000000000; // ticks per second
 
 	return 1;
@@ -41,7 +50,7 @@ long long int tmrReadTimer(void)
 	long long int thetime;
 	struct timespec time_now;
 
-	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time_now);
+	clock_gettime(CLOCK_MONOTONIC, &time_now);
 
 	thetime = (long long int)((time_now.tv_sec * frequency) + (time_now.tv_nsec));
 
@@ -120,9 +129,12 @@ unsigned int tmrWaitForFrame(void)
 {
 	unsigned int	frames = 0;
 
+	zvgTraceBegin( teWaitFrame, 0);
+
 	while ((frames = tmrNumberFramesSkipped()) == 0)
 		;
 
+	zvgTraceEnd( teWaitFrame, frames);
 	return (frames);
 }
 
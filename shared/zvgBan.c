@@ -7,10 +7,17 @@
 * Created: 06/30/03
 *
 * History:
+*    10/18/26
+*       Say when the monitor settings and speed came from the cache.
+*
+*       Say if the waits sleep on the port's interrupt, see 'zvgIrq.c'.
 *
 * (c) Copyright 2002-2004, Zektor, LLC.  All Rights Reserved.
 *****************************************************************************/
+#include	<errno.h>
 #include	<stdio.h>
+
+#include	<string.h>
 #include	"zvgPort.h"
 
 // Decode the 16 bit version number returned from the ZVG.
@@ -44,7 +51,11 @@ void zvgBanner( ZvgSpeeds_a speeds, ZvgID_s *id)
 
 	// print banner
 
-	fprintf( stdout, "\nZVG found on PORT=%03X, ", port);
+	if (ZvgIO.trOps == &ZvgTrDirect)
+		fprintf( stdout, "\nZVG found on PORT=%03X, ", port);
+
+	else
+		fprintf( stdout, "\nZVG found using '%s', ", ZvgIO.trSpec);
 
 	//if (dmaMode != 0)
 	//	fprintf( stdout, "DMA=%u, DMA Mode=%u, IRQ=%u.", dma, dmaMode, irq);
@@ -99,5 +110,92 @@ void zvgBanner( ZvgSpeeds_a speeds, ZvgID_s *id)
 
 	fprintf( stdout, "\n   Speed:          %uus per inch", monSpeed);
 
+	if (ZvgIO.cacheUsed)
+		fputs( "\n   (Settings and speed read from the cache, see 'zvgCache.c')", stdout);
+
+	zvgRtBanner();
+	zvgIrqBanner();
 	fflush( stdout);
 }
+
+/*****************************************************************************
+* Print the state of the real-time mode, and why any part of it isn't
+* active.  Prints nothing if real-time mode wasn't requested.
+*****************************************************************************/
+void zvgRtBanner( void)
+{
+	ZvgRtStatus_s	rt;
+
+	zvgRtGetStatus( &rt);
+
+	if (!(rt.flags & RTF_REQUESTED))
+		return;
+
+	fputs( "\n\nReal-time Mode:", stdout);
+
+	if (!(rt.flags & RTF_THREAD))
+	{	fputs( "\n   Sender thread:  Could not be started, sending from caller", stdout);
+		return;
+	}
+
+	fputs( "\n   Sender thread:  ", stdout);
+
+	if (rt.flags & RTF_FIFO)
+		fprintf( stdout, "SCHED_FIFO priority %d", rt.prio);
+
+	else if (rt.prio > 0)
+		fprintf( stdout, "Normal priority, SCHED_FIFO %d refused (%s)", rt.prio, strerror( rt.schedErr));
+
+	else
+		fputs( "Normal priority", stdout);
+
+	fputs( "\n   CPU:            ", stdout);
+
+	if (rt.flags & RTF_PINNED)
+		fprintf( stdout, "Pinned to CPU %d", rt.cpu);
+
+	else if (rt.cpu != RT_NO_CPU)
+		fprintf( stdout, "Not pinned, CPU %d refused (%s)", rt.cpu, strerror( rt.cpuErr));
+
+	else
+		fputs( "Not pinned", stdout);
+
+	fputs( "\n   Memory:         ", stdout);
+
+	if (rt.flags & RTF_MLOCKALL)
+		fputs( "All memory locked", stdout);
+
+	else if (rt.flags & RTF_BFRLOCK)
+		fprintf( stdout, "Frame buffers locked, mlockall refused (%s)", strerror( rt.lockErr));
+
+	else
+		fprintf( stdout, "Not locked (%s)", strerror( rt.lockErr));
+}
+
+/*****************************************************************************
+* Print whether the waits sleep on the port's interrupt, and why not if
+* they don't.  Prints nothing unless the WAIT_IRQ policy was chosen.
+*****************************************************************************/
+void zvgIrqBanner( void)
+{
+	ZvgIrqStatus_s	irq;
+
+	if (!ZvgIO.waitIrq)
+		return;
+
+	zvgIrqGetStatus( &irq);
+
+	fputs( "\n\nInterrupt Waits:\n   Interrupt:      ", stdout);
+
+	if (irq.on && irq.dev[0] == '\0')
+		fputs( "Simulated port", stdout);
+
+	else if (irq.on)
+		fprintf( stdout, "IRQ %d through %s", irq.irq, irq.dev);
+
+	else if (irq.err == EOPNOTSUPP)
+		fputs( "Not used by this transport, polling", stdout);
+
+	else
+		fprintf( stdout, "Not used, polling (%s)", strerror( irq.err));
+}
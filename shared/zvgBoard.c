@@ -0,0 +1,336 @@
+/*****************************************************************************
+* Driving several ZVGs from one process.
+*
+* The driver keeps its state in globals, 'ZvgIO', 'ZvgENC', 'ZvgMon' and so
+* on, which allowed only one ZVG.  Each of them is now an array with one
+* entry per board, and the names are macros that pick the entry of the
+* board the calling thread has selected with 'zvgBoardSelect()', kept in
+* 'ZvgCurBoard'.  Every thread starts on board 0, so a program that drives
+* one ZVG is unchanged.  The state private to a module (the frame counters,
+* the control queue, the readbacks) is kept per board the same way.  The
+* threads the driver starts for a board (sender, link recovery, open) work
+* on that board.
+*
+* Board 0 is setup from 'ZVGPORT=', board N from 'ZVGPORTN='.  A board
+* without a port or transport looks for its ZVG, passing over the ports of
+* the boards already open.
+*
+* A program can give each board a thread of its own, which encodes and
+* sends its frames, so the boards are driven in parallel.  'zvgBoardSync()'
+* puts the boards in a group, and each one's 'zvgFrameSend()' then waits
+* for the rest of the group before sending, so the frames go out together
+* and the displays stay in step.  A board that isn't ready within
+* BOARD_SYNC_MS is left behind for that frame.  A program driving every
+* board from one thread can use 'zvgBoardSendAll()' instead, which only
+* sends in parallel if the boards have sender threads ('R' or 'C').
+*
+* All boards share the timer, so times from any of them can be compared.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<pthread.h>
+#include	<errno.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<time.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgFrame.h"
+#include	"zvgBoard.h"
+
+__thread uint				ZvgCurBoard;	// board the thread is working on
+
+static pthread_mutex_t		BoardLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t		BoardCond = PTHREAD_COND_INITIALIZER;	// signalled when the group is let go
+static uint					BoardOpen;		// bit per board that is open
+static uint					BoardGroup;		// boards sent together, see 'zvgBoardSync()'
+static uint					BoardReady;		// boards of the group waiting to send
+static uint					BoardGen;		// bumped each time the group is let go
+static long long int		BoardFirstNs;	// time the first board of the group was ready
+static ZvgBoardStats_s		BoardStats;
+static __thread bool		BoardAll;		// in 'zvgBoardSendAll()', don't wait for the group
+
+/*****************************************************************************
+* Select the board the calling thread works on.  Every call after this,
+* from this thread, goes to that board.
+*
+* Called with:
+*    board = 0 to ZVG_BOARDS-1.
+*
+* Returns:
+*    errOk, or errBoardBad if there is no such board.
+*****************************************************************************/
+uint zvgBoardSelect( uint board)
+{
+	if (board >= ZVG_BOARDS)
+		return (errBoardBad);
+
+	ZvgCurBoard = board;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Return the environment variable that sets up the current board,
+* 'ZVGPORT=' for board 0, 'ZVGPORTN=' for board N.
+*
+* Returns:
+*    Its value, or NULL if it isn't set.
+*****************************************************************************/
+char *zvgBoardEnv( void)
+{
+	char	name[sizeof( "ZVGPORT") + 10];		// room for any 'uint'
+
+	if (ZvgCurBoard == 0)
+		return (getenv( "ZVGPORT"));
+
+	snprintf( name, sizeof( name), "ZVGPORT%u", ZvgCurBoard);
+	return (getenv( name));
+}
+
+/*****************************************************************************
+* Check if a port is used by another board that is open.  Used by
+* 'zvgDetect()' to pass over the ports that have been taken.
+*
+* Called with:
+*    portAdr = Port address, 0 if not known.
+*    dev     = ppdev device, NULL or "" if none.
+*****************************************************************************/
+bool zvgBoardPortUsed( uint portAdr, const char *dev)
+{
+	const char	*arg;
+	uint		board;
+	bool		used;
+
+	used = zFalse;
+
+	pthread_mutex_lock( &BoardLock);
+
+	for (board = 0; board < ZVG_BOARDS && !used; board++)
+	{
+		if (board == ZvgCurBoard || !(BoardOpen & (1 << board)))
+			continue;
+
+		arg = strchr( ZvgBoardIO[board].trSpec, ':');
+
+		if (portAdr != 0 && ZvgBoardIO[board].ecpPort == portAdr)
+			used = zTrue;
+
+		else if (dev != NULL && dev[0] != '\0' && arg != NULL && strcmp( arg + 1, dev) == 0)
+			used = zTrue;
+	}
+
+	pthread_mutex_unlock( &BoardLock);
+	return (used);
+}
+
+/*****************************************************************************
+* Let the group go, called with the lock held.
+*
+* Called with:
+*    late = zTrue if a board wasn't ready in time.
+*****************************************************************************/
+static void boardRelease( bool late)
+{
+	BoardStats.presents++;
+	BoardStats.skewNs = tmrReadTimer() - BoardFirstNs;
+
+	if (late)
+		BoardStats.timeouts++;
+
+	else if (BoardStats.skewNs > BoardStats.maxSkewNs)
+		BoardStats.maxSkewNs = BoardStats.skewNs;
+
+	BoardReady = 0;
+	BoardGen++;
+	pthread_cond_broadcast( &BoardCond);
+}
+
+/*****************************************************************************
+* Let the group go if the boards waiting are all it has left, after a board
+* has been closed or taken out of it.  Called with the lock held.
+*****************************************************************************/
+static void boardCheck( void)
+{
+	uint	group;
+
+	group = BoardGroup & BoardOpen;
+
+	if (BoardReady != 0 && (BoardReady & group) == group)
+		boardRelease( zFalse);
+}
+
+/*****************************************************************************
+* Note that the current board has been opened or closed.  Called by
+* 'zvgInit()' and 'zvgClose()'.  Only open boards are waited for.
+*****************************************************************************/
+void zvgBoardOpened( bool open)
+{
+	pthread_mutex_lock( &BoardLock);
+
+	if (open)
+		BoardOpen |= 1 << ZvgCurBoard;
+
+	else
+	{	BoardOpen &= ~(1 << ZvgCurBoard);
+		BoardReady &= ~(1 << ZvgCurBoard);
+		boardCheck();
+	}
+
+	pthread_mutex_unlock( &BoardLock);
+}
+
+/*****************************************************************************
+* Send the frames of some boards together.
+*
+* Once set, the 'zvgFrameSend()' of each board in the group waits until
+* every open board of the group is ready to send.  Each board must be sent
+* from its own thread.
+*
+* Called with:
+*    mask = Bit per board, 0 to send each board on its own again.
+*****************************************************************************/
+void zvgBoardSync( uint mask)
+{
+	pthread_mutex_lock( &BoardLock);
+	BoardGroup = mask & ((1 << ZVG_BOARDS) - 1);
+	BoardReady &= BoardGroup;
+	memset( &BoardStats, 0, sizeof( BoardStats));
+	boardCheck();
+	pthread_mutex_unlock( &BoardLock);
+}
+
+/*****************************************************************************
+* Wait for the rest of the group before sending.  Called by
+* 'zvgDmaSendSwap()' once the previous buffer has been sent, so the group
+* starts sending at the same time.
+*
+* Returns at once if the current board isn't in a group.  If the group
+* isn't ready within BOARD_SYNC_MS, the boards that are go without it.
+*****************************************************************************/
+void zvgBoardWait( void)
+{
+	struct timespec	ts;
+	uint			bit, group, gen;
+
+	bit = 1 << ZvgCurBoard;
+
+	if (BoardAll || !(__atomic_load_n( &BoardGroup, __ATOMIC_RELAXED) & bit))
+		return;
+
+	pthread_mutex_lock( &BoardLock);
+	group = BoardGroup & BoardOpen;
+
+	if (!(group & bit))
+	{	pthread_mutex_unlock( &BoardLock);
+		return;
+	}
+
+	if (BoardReady == 0)
+		BoardFirstNs = tmrReadTimer();
+
+	BoardReady |= bit;
+
+	if ((BoardReady & group) == group)
+	{	boardRelease( zFalse);
+		pthread_mutex_unlock( &BoardLock);
+		return;
+	}
+
+	clock_gettime( CLOCK_REALTIME, &ts);
+	ts.tv_nsec += BOARD_SYNC_MS * 1000000L;
+
+	if (ts.tv_nsec >= 1000000000L)
+	{	ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	gen = BoardGen;
+
+	while (BoardGen == gen)
+	{
+		if (pthread_cond_timedwait( &BoardCond, &BoardLock, &ts) == ETIMEDOUT)
+		{
+			if (BoardGen == gen)
+				boardRelease( zTrue);				// go without the late ones
+
+			break;
+		}
+	}
+
+	pthread_mutex_unlock( &BoardLock);
+}
+
+/*****************************************************************************
+* Send the frame of each board, from one thread.
+*
+* The frames are sent one after the other, so they only go out together if
+* the boards have sender threads.  Doesn't wait for the group set by
+* 'zvgBoardSync()'.  The board selected is left unchanged.
+*
+* Called with:
+*    mask = Bit per board to send.
+*
+* Returns:
+*    errOk, errBoardBad if a board isn't open, or the first error sending.
+*    Every open board is sent, even after an error.
+*****************************************************************************/
+uint zvgBoardSendAll( uint mask)
+{
+	long long int	firstNs, lastNs;
+	uint			open, cur, board, err, first;
+
+	open = __atomic_load_n( &BoardOpen, __ATOMIC_RELAXED);
+	first = (mask & ~open) ? errBoardBad : errOk;
+
+	cur = ZvgCurBoard;
+	firstNs = lastNs = 0;
+	BoardAll = zTrue;
+
+	for (board = 0; board < ZVG_BOARDS; board++)
+	{
+		if (!(mask & open & (1 << board)))
+			continue;
+
+		// the time from the first board to the last is the skew
+
+		lastNs = tmrReadTimer();
+
+		if (firstNs == 0)
+			firstNs = lastNs;
+
+		ZvgCurBoard = board;
+		err = zvgFrameSend();
+
+		if (err && !first)
+			first = err;
+	}
+
+	ZvgCurBoard = cur;
+	BoardAll = zFalse;
+
+	pthread_mutex_lock( &BoardLock);
+	BoardStats.presents++;
+	BoardStats.skewNs = lastNs - firstNs;
+
+	if (BoardStats.skewNs > BoardStats.maxSkewNs)
+		BoardStats.maxSkewNs = BoardStats.skewNs;
+
+	pthread_mutex_unlock( &BoardLock);
+	return (first);
+}
+
+/*****************************************************************************
+* Return the counters of the boards sent together, since 'zvgBoardSync()'
+* was last called.
+*****************************************************************************/
+void zvgBoardGetStats( ZvgBoardStats_s *stats)
+{
+	pthread_mutex_lock( &BoardLock);
+	*stats = BoardStats;
+	pthread_mutex_unlock( &BoardLock);
+}
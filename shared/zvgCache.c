@@ -0,0 +1,251 @@
+/*****************************************************************************
+* Cache of the ZVG's device information.
+*
+* Opening the ZVG reads its ID, monitor settings and speed table, and each
+* of the three is a turnaround of the port into reverse nibble mode, which
+* can wait for up to a second for the ZVG to answer.  The answers are
+* the same from one run to the next, so they are kept in a small file for
+* each port, and the next open reads only the ID.  If the ID is unchanged,
+* the monitor settings and speeds are taken from the file, otherwise they
+* are read from the ZVG and the file is written again.
+*
+* The files are kept in '$XDG_CACHE_HOME/zvg', or '~/.cache/zvg', named
+* after the transport, so each port has its own.  The 'N' attribute of
+* 'ZVGPORT=' turns the cache off.
+*
+* The monitor settings in the file are only what the ZVG had when it was
+* written.  'zvgCtlCmd()' removes it when the settings are saved, loaded or
+* reset, and the control commands never take settings from the file as the
+* ZVG's, see 'zvgCtl.c'.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<ctype.h>
+#include	<errno.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<sys/stat.h>
+
+#include	"zstddef.h"
+#include	"zvgPort.h"
+#include	"zvgCache.h"
+
+/*****************************************************************************
+* Make the name of the directory holding the cache files.
+*
+* Called with:
+*    dir = Buffer of CACHE_NAME_SZ characters for the name.
+*
+* Returns:
+*    errOk        - Name made.
+*    errCacheOpen - No home directory, or the name is too long.
+*****************************************************************************/
+static uint cacheDir( char *dir)
+{
+	const char	*base;
+	int			len;
+
+	base = getenv( "XDG_CACHE_HOME");
+
+	if (base != NULL && base[0] != '\0')
+		len = snprintf( dir, CACHE_NAME_SZ, "%s/%s", base, CACHE_DIR);
+
+	else
+	{	base = getenv( "HOME");
+
+		if (base == NULL || base[0] == '\0')
+			return (errCacheOpen);
+
+		len = snprintf( dir, CACHE_NAME_SZ, "%s/.cache/%s", base, CACHE_DIR);
+	}
+
+	if (len < 0 || len >= CACHE_NAME_SZ)
+		return (errCacheOpen);
+
+	return (errOk);
+}
+
+/*****************************************************************************
+* Make the name of the cache file of the port in use.
+*
+* The file is named after the transport spec, with the port address added
+* for direct I/O.  Characters that don't belong in a file name are changed
+* to '_'.
+*
+* Called with:
+*    name = Buffer of CACHE_NAME_SZ characters for the name.
+*
+* Returns:
+*    errOk        - Name made.
+*    errCacheOpen - No home directory, no transport chosen, or the name is
+*                   too long.
+*****************************************************************************/
+uint zvgCacheName( char *name)
+{
+	char	port[TR_SPEC_SZ+16], *pp;
+	uint	err;
+	int		len;
+
+	if (ZvgIO.trOps == NULL)
+		return (errCacheOpen);
+
+	err = cacheDir( name);
+
+	if (err)
+		return (err);
+
+	if (ZvgIO.trOps == &ZvgTrDirect)
+		sprintf( port, "%s-%03X", ZvgIO.trSpec, ZvgIO.ecpPort);
+
+	else
+		strcpy( port, ZvgIO.trSpec);
+
+	for (pp = port; *pp != '\0'; pp++)
+	{
+		if (!isalnum( (uchar)*pp) && *pp != '-' && *pp != '.')
+			*pp = '_';
+	}
+
+	len = strlen( name);
+
+	if (snprintf( name + len, CACHE_NAME_SZ - len, "/%s", port) >= CACHE_NAME_SZ - len)
+		return (errCacheOpen);
+
+	return (errOk);
+}
+
+/*****************************************************************************
+* Read the cache file of the port in use.
+*
+* Called with:
+*    cache = Filled in with the file.
+*
+* Returns:
+*    errOk        - File read.
+*    errCacheOpen - No file.
+*    errCacheBad  - File is not a cache file, or is from another version.
+*****************************************************************************/
+uint zvgCacheLoad( ZvgCache_s *cache)
+{
+	char	name[CACHE_NAME_SZ];
+	FILE	*fp;
+	size_t	len;
+	uint	err;
+
+	err = zvgCacheName( name);
+
+	if (err)
+		return (err);
+
+	fp = fopen( name, "rb");
+
+	if (fp == NULL)
+		return (errCacheOpen);
+
+	len = fread( cache, 1, sizeof( *cache), fp);
+	fclose( fp);
+
+	if (len != sizeof( *cache) || cache->magic != CACHE_MAGIC
+			|| cache->version != CACHE_VERSION || cache->size != sizeof( *cache))
+		return (errCacheBad);
+
+	return (errOk);
+}
+
+/*****************************************************************************
+* Write the cache file of the port in use.
+*
+* The file is written under a temporary name and renamed, so a program
+* opening the ZVG at the same time never reads half a file.
+*
+* Called with:
+*    id     = ID read from the ZVG.
+*    mon    = Monitor settings read from the ZVG.
+*    speeds = Speed table read from the ZVG.
+*
+* Returns:
+*    errOk        - File written.
+*    errCacheOpen - File could not be written.
+*****************************************************************************/
+uint zvgCacheSave( const ZvgID_s *id, const ZvgMon_s *mon, ZvgSpeeds_a speeds)
+{
+	ZvgCache_s	cache;
+	char		name[CACHE_NAME_SZ], temp[CACHE_NAME_SZ+16];
+	char		*pp;
+	FILE		*fp;
+	size_t		len;
+	uint		err;
+
+	err = zvgCacheName( name);
+
+	if (err)
+		return (err);
+
+	// make the directory, and '.cache' above it if need be
+
+	pp = strrchr( name, '/');
+	*pp = '\0';
+
+	if (mkdir( name, 0755) != 0 && errno == ENOENT)
+	{	*strrchr( name, '/') = '\0';
+		mkdir( name, 0755);
+		name[strlen( name)] = '/';
+		mkdir( name, 0755);
+	}
+
+	*pp = '/';
+
+	memset( &cache, 0, sizeof( cache));
+	cache.magic = CACHE_MAGIC;
+	cache.version = CACHE_VERSION;
+	cache.size = sizeof( cache);
+	cache.id = *id;
+	cache.mon = *mon;
+	memcpy( cache.speeds, speeds, sizeof( cache.speeds));
+
+	sprintf( temp, "%s.%d", name, (int)getpid());
+	fp = fopen( temp, "wb");
+
+	if (fp == NULL)
+		return (errCacheOpen);
+
+	len = fwrite( &cache, 1, sizeof( cache), fp);
+
+	if (fclose( fp) != 0 || len != sizeof( cache) || rename( temp, name) != 0)
+	{	remove( temp);
+		return (errCacheOpen);
+	}
+
+	return (errOk);
+}
+
+/*****************************************************************************
+* Remove the cache file of the port in use, so the next open reads
+* everything from the ZVG.  Called after the monitor settings are changed.
+*****************************************************************************/
+void zvgCacheClear( void)
+{
+	char	name[CACHE_NAME_SZ];
+
+	if (zvgCacheName( name) == errOk)
+		remove( name);
+}
+
+/*****************************************************************************
+* Compare two ZVG IDs.
+*
+* Returns:
+*    zTrue if the IDs are the same.
+*****************************************************************************/
+bool zvgCacheSameID( const ZvgID_s *id1, const ZvgID_s *id2)
+{
+	return (strcmp( id1->mfg, id2->mfg) == 0 && strcmp( id1->cmd, id2->cmd) == 0
+			&& strcmp( id1->mdl, id2->mdl) == 0 && id1->model == id2->model
+			&& id1->fVer == id2->fVer && id1->bVer == id2->bVer && id1->vVer == id2->vVer
+			&& id1->sws == id2->sws && id1->fESB == id2->fESB && id1->vESB == id2->vESB);
+}
@@ -0,0 +1,462 @@
+/*****************************************************************************
+* Frame capture and replay files.
+*
+* While a capture is running, every buffer sent by 'zvgDmaSendSwap()' is
+* appended to the capture file, along with the time it was sent and the
+* encoder counters for the frame, and an entry is appended to the index
+* file.  Both files are flushed after each frame, so a capture cut short by
+* a crash can still be played back up to the last frame written.
+*
+* For replay, the capture file is mapped into memory, and the index file is
+* mapped over an array of 'ZvgCapIdx_s', so any frame can be reached at
+* once without reading the frames before it.  If the index file is missing
+* or damaged, the index is rebuilt by walking the frame records.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<fcntl.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<time.h>
+#include	<unistd.h>
+#include	<sys/mman.h>
+#include	<sys/stat.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgCap.h"
+
+// State of a capture being written
+
+typedef struct ZVGCAP_S
+{	FILE			*fp;				// capture file
+	FILE			*idxFp;				// index file
+	long long int	offset;				// size of capture file
+	uint			frame;				// next frame number
+	bool			started;			// set once first frame is captured
+	long long int	startNs;			// monotonic time of the first frame
+	ZvgCapStats_s	stats;				// counters for the next frame
+} ZvgCap_s;
+
+/*****************************************************************************
+* Fill in a file header.
+*****************************************************************************/
+static void capHeader( ZvgCapHdr_s *hdr, const char *magic)
+{
+	struct timespec	ts;
+
+	memset( hdr, 0, sizeof( ZvgCapHdr_s));
+	strcpy( hdr->magic, magic);
+	hdr->version = CAP_VERSION;
+	hdr->hdrSize = sizeof( ZvgCapHdr_s);
+
+	clock_gettime( CLOCK_REALTIME, &ts);
+	hdr->startNs = (long long int)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	hdr->envMonitor = ZvgIO.envMonitor;
+}
+
+/*****************************************************************************
+* Start capturing the frames sent to the ZVG.
+*
+* The capture file is created (replacing any file of the same name), and
+* the index is written to the same name with CAP_IDX_EXT added.
+*
+* Called with:
+*    name = Name of capture file.
+*
+* Returns:
+*    errOk      - Capture started.
+*    errCapOpen - Capture or index file could not be created.
+*    errMemory  - Out of memory.
+*****************************************************************************/
+uint zvgCapStart( const char *name)
+{
+	ZvgCap_s	*cap;
+	ZvgCapHdr_s	hdr;
+	char		idxName[CAP_NAME_SZ + sizeof( CAP_IDX_EXT)];
+
+	zvgCapStop();
+
+	if (strlen( name) >= CAP_NAME_SZ)
+		return (errCapOpen);
+
+	strcpy( idxName, name);
+	strcat( idxName, CAP_IDX_EXT);
+
+	cap = (ZvgCap_s *)calloc( 1, sizeof( ZvgCap_s));
+
+	if (cap == NULL)
+		return (errMemory);
+
+	cap->fp = fopen( name, "wb");
+	cap->idxFp = fopen( idxName, "wb");
+
+	if (cap->fp == NULL || cap->idxFp == NULL)
+	{
+		if (cap->fp != NULL)
+			fclose( cap->fp);
+
+		if (cap->idxFp != NULL)
+			fclose( cap->idxFp);
+
+		free( cap);
+		return (errCapOpen);
+	}
+
+	// write both headers
+
+	capHeader( &hdr, CAP_MAGIC);
+	fwrite( &hdr, sizeof( hdr), 1, cap->fp);
+	cap->offset = sizeof( hdr);
+
+	capHeader( &hdr, CAP_IDX_MAGIC);
+	fwrite( &hdr, sizeof( hdr), 1, cap->idxFp);
+
+	if (fflush( cap->fp) != 0 || fflush( cap->idxFp) != 0)
+	{	fclose( cap->fp);
+		fclose( cap->idxFp);
+		free( cap);
+		return (errCapOpen);
+	}
+
+	ZvgIO.capP = cap;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Stop capturing, and close the capture files.  May be called when no
+* capture is running.
+*****************************************************************************/
+void zvgCapStop( void)
+{
+	ZvgCap_s	*cap;
+
+	cap = ZvgIO.capP;
+
+	if (cap == NULL)
+		return;
+
+	ZvgIO.capP = NULL;
+	fclose( cap->fp);
+	fclose( cap->idxFp);
+	free( cap);
+}
+
+/*****************************************************************************
+* Give the encoder counters to be kept with the next frame captured.
+*
+* Called by the frame layer just before the frame is sent.  Does nothing if
+* no capture is running.
+*****************************************************************************/
+void zvgCapSetStats( const ZvgCapStats_s *stats)
+{
+	if (ZvgIO.capP != NULL)
+		ZvgIO.capP->stats = *stats;
+}
+
+/*****************************************************************************
+* Append a frame to the capture.
+*
+* If the frame can't be written, the capture is stopped, so a full disk
+* never stops frames from being sent.
+*
+* Called with:
+*    mem   = Bytes being sent.
+*    count = Number of bytes.
+*
+* Returns:
+*    errOk       - Frame captured, or no capture running.
+*    errCapWrite - Frame could not be written, capture stopped.
+*****************************************************************************/
+uint zvgCapFrame( uchar *mem, uint count)
+{
+	ZvgCap_s		*cap;
+	ZvgCapRec_s		rec;
+	ZvgCapIdx_s		idx;
+	long long int	now;
+
+	cap = ZvgIO.capP;
+
+	if (cap == NULL)
+		return (errOk);
+
+	now = tmrReadTimer();
+
+	if (!cap->started)
+	{	cap->startNs = now;
+		cap->started = zTrue;
+	}
+
+	memset( &rec, 0, sizeof( rec));
+	rec.magic = CAP_REC_MAGIC;
+	rec.frame = cap->frame;
+	rec.timeNs = now - cap->startNs;
+	rec.count = count;
+	rec.vectors = cap->stats.vectors;
+	rec.encFlags = cap->stats.encFlags;
+
+	memset( &idx, 0, sizeof( idx));
+	idx.offset = cap->offset;
+	idx.timeNs = rec.timeNs;
+	idx.count = count;
+	idx.frame = cap->frame;
+
+	// write the frame before its index entry, so the index never points
+	// past the end of the capture
+
+	if (fwrite( &rec, sizeof( rec), 1, cap->fp) != 1
+			|| fwrite( mem, 1, count, cap->fp) != count
+			|| fflush( cap->fp) != 0
+			|| fwrite( &idx, sizeof( idx), 1, cap->idxFp) != 1
+			|| fflush( cap->idxFp) != 0)
+	{	zvgCapStop();
+		return (errCapWrite);
+	}
+
+	cap->offset += sizeof( rec) + count;
+	cap->frame++;
+	memset( &cap->stats, 0, sizeof( cap->stats));
+	return (errOk);
+}
+
+/*****************************************************************************
+* Map a whole file into memory, read only.
+*
+* Returns:
+*    Start of the mapped file, or NULL if it could not be opened or mapped.
+*****************************************************************************/
+static uchar *mapFile( const char *name, ulong *size)
+{
+	struct stat	st;
+	void		*mp;
+	int			fd;
+
+	fd = open( name, O_RDONLY);
+
+	if (fd < 0)
+		return (NULL);
+
+	if (fstat( fd, &st) < 0 || st.st_size == 0)
+	{	close( fd);
+		return (NULL);
+	}
+
+	mp = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close( fd);
+
+	if (mp == MAP_FAILED)
+		return (NULL);
+
+	*size = st.st_size;
+	return ((uchar *)mp);
+}
+
+/*****************************************************************************
+* Check a file header.
+*****************************************************************************/
+static bool goodHeader( uchar *mp, ulong size, const char *magic)
+{
+	ZvgCapHdr_s	*hdr;
+
+	if (size < sizeof( ZvgCapHdr_s))
+		return (zFalse);
+
+	hdr = (ZvgCapHdr_s *)mp;
+
+	if (strncmp( hdr->magic, magic, sizeof( hdr->magic)) != 0)
+		return (zFalse);
+
+	return (hdr->version == CAP_VERSION && hdr->hdrSize == sizeof( ZvgCapHdr_s));
+}
+
+/*****************************************************************************
+* Copy a frame record out of the capture file.  Records follow each other
+* with no padding, so they can't be read in place.
+*****************************************************************************/
+static void getRecord( ZvgCapFile_s *cf, long long int offset, ZvgCapRec_s *rec)
+{
+	memcpy( rec, cf->dataP + offset, sizeof( ZvgCapRec_s));
+}
+
+/*****************************************************************************
+* Check that a frame record lies wholly inside the capture file.
+*****************************************************************************/
+static bool goodRecord( ZvgCapFile_s *cf, long long int offset)
+{
+	ZvgCapRec_s	rec;
+
+	if (offset < (long long int)sizeof( ZvgCapHdr_s)
+			|| (ulong)offset + sizeof( ZvgCapRec_s) > cf->dataSize)
+		return (zFalse);
+
+	getRecord( cf, offset, &rec);
+
+	if (rec.magic != CAP_REC_MAGIC)
+		return (zFalse);
+
+	return ((ulong)offset + sizeof( ZvgCapRec_s) + rec.count <= cf->dataSize);
+}
+
+/*****************************************************************************
+* Build the index by walking the frame records of the capture file.
+*****************************************************************************/
+static uint buildIndex( ZvgCapFile_s *cf)
+{
+	ZvgCapRec_s		rec;
+	ZvgCapIdx_s		*newP;
+	long long int	offset;
+	uint			size;
+
+	cf->idxP = NULL;
+	cf->frames = 0;
+	size = 0;
+	offset = sizeof( ZvgCapHdr_s);
+
+	while (goodRecord( cf, offset))
+	{
+		if (cf->frames == size)
+		{	size = size ? size * 2 : 1024;
+			newP = (ZvgCapIdx_s *)realloc( cf->idxP, size * sizeof( ZvgCapIdx_s));
+
+			if (newP == NULL)
+			{	free( cf->idxP);
+				cf->idxP = NULL;
+				return (errMemory);
+			}
+			cf->idxP = newP;
+		}
+
+		getRecord( cf, offset, &rec);
+		cf->idxP[cf->frames].offset = offset;
+		cf->idxP[cf->frames].timeNs = rec.timeNs;
+		cf->idxP[cf->frames].count = rec.count;
+		cf->idxP[cf->frames].frame = rec.frame;
+		cf->frames++;
+
+		offset += sizeof( ZvgCapRec_s) + rec.count;
+	}
+	return (errOk);
+}
+
+/*****************************************************************************
+* Open a capture for replay.
+*
+* Called with:
+*    cf   = Set to the opened capture.
+*    name = Name of capture file.  The index is read from the same name
+*           with CAP_IDX_EXT added.
+*
+* Returns:
+*    errOk      - Capture opened, 'cf->frames' frames are available.
+*    errCapOpen - Capture file could not be opened.
+*    errCapBad  - Not a capture file.
+*    errMemory  - Out of memory while rebuilding the index.
+*****************************************************************************/
+uint zvgCapOpen( ZvgCapFile_s *cf, const char *name)
+{
+	char	idxName[CAP_NAME_SZ + sizeof( CAP_IDX_EXT)];
+	uchar	*idxMap;
+	uint	ii, err;
+
+	memset( cf, 0, sizeof( ZvgCapFile_s));
+
+	if (strlen( name) >= CAP_NAME_SZ)
+		return (errCapOpen);
+
+	cf->dataP = mapFile( name, &cf->dataSize);
+
+	if (cf->dataP == NULL)
+		return (errCapOpen);
+
+	if (!goodHeader( cf->dataP, cf->dataSize, CAP_MAGIC))
+	{	zvgCapClose( cf);
+		return (errCapBad);
+	}
+
+	cf->hdrP = (ZvgCapHdr_s *)cf->dataP;
+	madvise( cf->dataP, cf->dataSize, MADV_SEQUENTIAL);
+
+	// use the index file if it's there and sound
+
+	strcpy( idxName, name);
+	strcat( idxName, CAP_IDX_EXT);
+	idxMap = mapFile( idxName, &cf->idxSize);
+
+	if (idxMap != NULL && goodHeader( idxMap, cf->idxSize, CAP_IDX_MAGIC))
+	{	cf->idxP = (ZvgCapIdx_s *)(idxMap + sizeof( ZvgCapHdr_s));
+		cf->idxMapped = zTrue;
+		cf->frames = (cf->idxSize - sizeof( ZvgCapHdr_s)) / sizeof( ZvgCapIdx_s);
+
+		// drop entries for frames that never made it to the capture file
+
+		for (ii = 0; ii < cf->frames; ii++)
+			if (!goodRecord( cf, cf->idxP[ii].offset))
+				break;
+
+		cf->frames = ii;
+		return (errOk);
+	}
+
+	if (idxMap != NULL)
+		munmap( idxMap, cf->idxSize);
+
+	cf->idxSize = 0;
+	err = buildIndex( cf);
+
+	if (err)
+		zvgCapClose( cf);
+
+	return (err);
+}
+
+/*****************************************************************************
+* Close a capture opened for replay.
+*****************************************************************************/
+void zvgCapClose( ZvgCapFile_s *cf)
+{
+	if (cf->idxMapped)
+		munmap( (uchar *)cf->idxP - sizeof( ZvgCapHdr_s), cf->idxSize);
+
+	else
+		free( cf->idxP);
+
+	if (cf->dataP != NULL)
+		munmap( cf->dataP, cf->dataSize);
+
+	memset( cf, 0, sizeof( ZvgCapFile_s));
+}
+
+/*****************************************************************************
+* Return a frame of a capture.
+*
+* Called with:
+*    cf  = Capture opened by 'zvgCapOpen()'.
+*    idx = Frame wanted, 0 to 'cf->frames' - 1.
+*    frm = Set to the frame.  The bytes are not copied, they stay valid
+*          until the capture is closed.
+*
+* Returns:
+*    errOk       - Frame returned.
+*    errCapRange - No such frame.
+*****************************************************************************/
+uint zvgCapGetFrame( ZvgCapFile_s *cf, uint idx, ZvgCapFrame_s *frm)
+{
+	ZvgCapRec_s	rec;
+
+	if (idx >= cf->frames)
+		return (errCapRange);
+
+	getRecord( cf, cf->idxP[idx].offset, &rec);
+	frm->mem = cf->dataP + cf->idxP[idx].offset + sizeof( ZvgCapRec_s);
+	frm->count = rec.count;
+	frm->frame = rec.frame;
+	frm->timeNs = rec.timeNs;
+	frm->vectors = rec.vectors;
+	frm->encFlags = rec.encFlags;
+	return (errOk);
+}
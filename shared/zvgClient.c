@@ -0,0 +1,387 @@
+/*****************************************************************************
+* Drawing through the 'zvgd' frame server.
+*
+* A program using these routines doesn't open the port, and doesn't need
+* root.  'zvgd' owns the ZVGs, and gives each client a ring of ZVGD_SLOTS
+* frame buffers in shared memory, a memfd passed over its socket.  Vectors
+* are encoded straight into a slot of the ring, and only the slot number
+* goes over the socket when the frame is sent, the frame itself is never
+* copied.
+*
+* A client has at most one frame waiting to be shown.  'zvgClientSend()'
+* returns once the frame before it has been taken, so the client is paced
+* by the display, as with 'zvgFrameSend()'.  Frames are taken whether the
+* client is being drawn or not, so it has one ready when it's brought to
+* the front.  'zvgClientFocus()' says if it is being drawn.
+*
+* The encoder is setup for the monitor 'zvgd' drives.  Each frame starts
+* with a center command so it doesn't depend on what was drawn before it,
+* 'zvgd' adds the end of frame padding and the spotkill dots.
+*
+* The socket is 'ZVGD_SOCKET=', or ZVGD_SOCKET if that isn't set.  A
+* process has one connection.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<errno.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<sys/mman.h>
+#include	<sys/socket.h>
+#include	<sys/un.h>
+
+#include	"zstddef.h"
+#include	"zvgClient.h"
+
+#define	CLIENT_SPARE	(zENC_CMD_SIZE * 4)	// room a vector may need at the end of a slot
+
+// State of the connection
+
+typedef struct ZVGCLIENT_S
+{	int			fd;						// socket to 'zvgd', -1 if not connected
+	uchar		*ring;					// ring mapped, NULL if none
+	size_t		ringSize;
+	uint		slots;
+	uint		slotSize;
+	uint		owned;					// bit per slot the client may fill
+	uint		waiting;				// frames submitted, not yet taken
+	uint		cur;					// slot being filled
+	bool		focus;					// being drawn
+} ZvgClient_s;
+
+static ZvgClient_s	Client = { .fd = -1 };
+
+/*****************************************************************************
+* Start filling the first free slot, from the center of the screen.
+*****************************************************************************/
+static void clientStart( void)
+{
+	for (Client.cur = 0; Client.cur < Client.slots; Client.cur++)
+	{
+		if (Client.owned & (1 << Client.cur))
+			break;
+	}
+
+	zvgEncSetPtr( Client.ring + ZVGD_RING_HDR + Client.cur * Client.slotSize);
+	zvgEncCenter();
+	zvgEncClearStats();
+}
+
+/*****************************************************************************
+* Drop the connection, after it was lost or closed.
+*****************************************************************************/
+static void clientDrop( void)
+{
+	if (Client.ring != NULL)
+	{	munmap( Client.ring, Client.ringSize);
+		Client.ring = NULL;
+	}
+
+	if (Client.fd >= 0)
+	{	close( Client.fd);
+		Client.fd = -1;
+	}
+}
+
+/*****************************************************************************
+* Read one message from 'zvgd', and act on it.
+*
+* Called with:
+*    wait = zTrue to wait for one, else return at once if none is waiting.
+*    got  = Set if a message was read.
+*
+* Returns:
+*    errOk, or errServLost if the connection was lost.
+*****************************************************************************/
+static uint clientRecv( bool wait, bool *got)
+{
+	ZvgdMsg_s	msg;
+	ssize_t		len;
+
+	*got = zFalse;
+
+	do
+		len = recv( Client.fd, &msg, sizeof( msg), wait ? 0 : MSG_DONTWAIT);
+	while (len < 0 && errno == EINTR);
+
+	if (len < 0 && !wait && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return (errOk);
+
+	if (len != sizeof( msg))
+	{	clientDrop();
+		return (errServLost);
+	}
+
+	*got = zTrue;
+
+	switch (msg.type)
+	{
+	case zmTaken:
+		if (Client.waiting > 0)
+			Client.waiting--;
+		break;
+
+	case zmFree:
+		if (msg.slot < Client.slots)
+			Client.owned |= 1 << msg.slot;
+		break;
+
+	case zmFocus:
+		Client.focus = msg.focus != 0;
+		break;
+	}
+	return (errOk);
+}
+
+/*****************************************************************************
+* Connect to 'zvgd', and get a ring to draw into.
+*
+* Called with:
+*    board = Board to draw on.
+*    prio  = Priority, the client with the highest one is drawn, and clients
+*            with the same one take the front in the order they connected.
+*    flags = ZVGDF_OVERLAY to be drawn over whichever client is in front.
+*
+* Returns:
+*    errOk, errServConnect if 'zvgd' can't be reached, errServRefused if it
+*    refused the client, or errServLost.
+*****************************************************************************/
+uint zvgClientOpen( uint board, uint prio, uint flags)
+{
+	struct sockaddr_un	sa;
+	struct msghdr		mh;
+	struct iovec		iov;
+	struct cmsghdr		*cm;
+	ZvgdMsg_s			msg;
+	const ZvgdRing_s	*hdr;
+	const char			*path;
+	int					memFd;
+	ssize_t				len;
+
+	union
+	{	struct cmsghdr	align;
+		char			buf[CMSG_SPACE( sizeof( int))];
+	} ctl;
+
+	zvgClientClose();
+
+	path = getenv( "ZVGD_SOCKET");
+
+	if (path == NULL || path[0] == '\0')
+		path = ZVGD_SOCKET;
+
+	if (strlen( path) >= sizeof( sa.sun_path))
+		return (errServConnect);
+
+	memset( &sa, 0, sizeof( sa));
+	sa.sun_family = AF_UNIX;
+	strcpy( sa.sun_path, path);
+
+	Client.fd = socket( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+	if (Client.fd < 0)
+		return (errServConnect);
+
+	if (connect( Client.fd, (struct sockaddr *)&sa, sizeof( sa)) < 0)
+	{	clientDrop();
+		return (errServConnect);
+	}
+
+	// ask for a ring
+
+	memset( &msg, 0, sizeof( msg));
+	msg.type = zmHello;
+	msg.version = ZVGD_VERSION;
+	msg.board = board;
+	msg.prio = prio;
+	msg.flags = flags;
+
+	if (send( Client.fd, &msg, sizeof( msg), MSG_NOSIGNAL) != sizeof( msg))
+	{	clientDrop();
+		return (errServLost);
+	}
+
+	// the ring comes with the welcome
+
+	memset( &mh, 0, sizeof( mh));
+	iov.iov_base = &msg;
+	iov.iov_len = sizeof( msg);
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = ctl.buf;
+	mh.msg_controllen = sizeof( ctl.buf);
+
+	do
+		len = recvmsg( Client.fd, &mh, MSG_CMSG_CLOEXEC);
+	while (len < 0 && errno == EINTR);
+
+	cm = CMSG_FIRSTHDR( &mh);
+	memFd = -1;
+
+	if (cm != NULL && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS)
+		memcpy( &memFd, CMSG_DATA( cm), sizeof( int));
+
+	if (len != sizeof( msg) || msg.type != zmWelcome)
+	{	if (memFd >= 0)
+			close( memFd);
+
+		clientDrop();
+		return (errServLost);
+	}
+
+	if (msg.err || msg.version != ZVGD_VERSION || memFd < 0
+			|| msg.slots == 0 || msg.slots > ZVGD_SLOTS || msg.bytes <= CLIENT_SPARE)
+	{	if (memFd >= 0)
+			close( memFd);
+
+		clientDrop();
+		return (errServRefused);
+	}
+
+	Client.slots = msg.slots;
+	Client.slotSize = msg.bytes;
+	Client.ringSize = ZVGD_RING_HDR + (size_t)msg.slots * msg.bytes;
+	Client.ring = (uchar *)mmap( NULL, Client.ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+	close( memFd);
+
+	if (Client.ring == MAP_FAILED)
+	{	Client.ring = NULL;
+		clientDrop();
+		return (errServRefused);
+	}
+
+	hdr = (const ZvgdRing_s *)Client.ring;
+
+	if (hdr->magic != ZVGD_RING_MAGIC || hdr->slots != Client.slots || hdr->slotSize != Client.slotSize)
+	{	clientDrop();
+		return (errServRefused);
+	}
+
+	// encode for the monitor 'zvgd' drives
+
+	zvgEncReset();
+	ZvgENC.encFlags = msg.flags;
+
+	if (msg.flags & ENCF_NOOVS)
+		zvgEncSetClipNoOverscan();
+
+	Client.owned = (1 << Client.slots) - 1;
+	Client.waiting = 0;
+	Client.focus = msg.focus != 0;
+	clientStart();
+	return (errOk);
+}
+
+/*****************************************************************************
+* Disconnect from 'zvgd'.  If the client was in front, the next one takes
+* its place.  May be called more than once.
+*****************************************************************************/
+void zvgClientClose( void)
+{
+	clientDrop();
+}
+
+/*****************************************************************************
+* Encode a vector into the frame being built.
+*
+* Returns:
+*    errOk, errBfrFull if the frame's slot is full, or errServLost if not
+*    connected.
+*****************************************************************************/
+uint zvgClientVector( int xStart, int yStart, int xEnd, int yEnd)
+{
+	if (Client.ring == NULL)
+		return (errServLost);
+
+	if (zvgEncSize() + CLIENT_SPARE > Client.slotSize)
+		return (errBfrFull);
+
+	zvgEnc( xStart, yStart, xEnd, yEnd);
+	return (errOk);
+}
+
+/*****************************************************************************
+* Hand the frame built to 'zvgd', and start the next one.
+*
+* Returns once the frame before it has been taken, and a slot is free.
+*
+* Returns:
+*    errOk, or errServLost if the connection was lost.
+*****************************************************************************/
+uint zvgClientSend( void)
+{
+	ZvgdMsg_s	msg;
+	uint		err;
+	bool		got;
+
+	if (Client.ring == NULL)
+		return (errServLost);
+
+	memset( &msg, 0, sizeof( msg));
+	msg.type = zmSubmit;
+	msg.slot = Client.cur;
+	msg.bytes = zvgEncSize();
+
+	if (send( Client.fd, &msg, sizeof( msg), MSG_NOSIGNAL) != sizeof( msg))
+	{	clientDrop();
+		return (errServLost);
+	}
+
+	Client.owned &= ~(1 << Client.cur);
+	Client.waiting++;
+
+	// at most one frame waits to be shown
+
+	while (Client.waiting > 1 || Client.owned == 0)
+	{	err = clientRecv( zTrue, &got);
+
+		if (err)
+			return (err);
+	}
+
+	clientStart();
+	return (errOk);
+}
+
+/*****************************************************************************
+* Act on any messages from 'zvgd' without waiting, for a client that polls
+* 'zvgClientFd()' itself, or wants 'zvgClientFocus()' to be up to date.
+*
+* Returns:
+*    errOk, or errServLost if the connection was lost.
+*****************************************************************************/
+uint zvgClientPoll( void)
+{
+	uint	err;
+	bool	got;
+
+	if (Client.ring == NULL)
+		return (errServLost);
+
+	do
+		err = clientRecv( zFalse, &got);
+	while (!err && got);
+
+	return (err);
+}
+
+/*****************************************************************************
+* Return the socket to 'zvgd', readable when there are messages to act on,
+* or -1 if not connected.
+*****************************************************************************/
+int zvgClientFd( void)
+{
+	return (Client.fd);
+}
+
+/*****************************************************************************
+* Return zTrue if the client is being drawn, as of the last message read.
+*****************************************************************************/
+bool zvgClientFocus( void)
+{
+	return (Client.focus);
+}
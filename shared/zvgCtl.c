@@ -0,0 +1,330 @@
+/*****************************************************************************
+* Queue of control commands sent with frames.
+*
+* The monitor registers (Z-shift, overshoot, jump, settle, intensities and
+* scale) used to be set by putting the command straight into the frame
+* being built with 'zvgDmaPutc()'.  Every change was sent, even several to
+* the same register in one frame, or one setting the value the ZVG already
+* had.
+*
+* 'zvgCtlSet()' keeps the new value instead, and 'zvgFrameSend()' sends the
+* registers changed since the last frame after the frame's last vector, so
+* a command never lands in the middle of a vector's bytes.  Only the last
+* value given to a register is sent, and only if it differs from the one
+* the ZVG has, which is kept in 'ZvgMon'.  'ZvgMon' is only changed once
+* the commands are in the frame; ones that don't fit wait for the next.
+*
+* Other commands, saving to the EEPROM for instance, are given to
+* 'zvgCtlCmd()' and sent in order.  Register changes given before one are
+* sent before it, so a save saves them.  Loading from the EEPROM or
+* resetting to the defaults leaves the ZVG's registers unknown, until
+* 'zvgCtlSync()' says 'ZvgMon' has been read again.  Saving, loading or
+* resetting also removes the port's cache file, whose settings would be out
+* of date, see 'zvgCache.c'.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<pthread.h>
+#include	<stddef.h>
+#include	<string.h>
+
+#include	"zstddef.h"
+#include	"zvgCmds.h"
+#include	"zvgFrame.h"
+#include	"zvgCache.h"
+#include	"zvgCtl.h"
+
+// Command and 'ZvgMon' field of each register
+
+typedef struct CTLREG_S
+{	uchar		cmd;
+	uchar		offset;					// offset of the field in 'ZvgMon_s'
+} CtlReg_s;
+
+static const CtlReg_s	CtlRegs[CTL_REGS] =
+{	{ zcZSHIFT,		offsetof( ZvgMon_s, zShift) },
+	{ zcOSHOOT,		offsetof( ZvgMon_s, oShoot) },
+	{ zcJUMP,		offsetof( ZvgMon_s, jumpFactor) },
+	{ zcSETTLE,		offsetof( ZvgMon_s, settle) },
+	{ zcPOINT_I,	offsetof( ZvgMon_s, point_i) },
+	{ zcMIN_I,		offsetof( ZvgMon_s, min_i) },
+	{ zcMAX_I,		offsetof( ZvgMon_s, max_i) },
+	{ zcSCALE,		offsetof( ZvgMon_s, scale) }
+};
+
+#define	ctlMon( reg)	(((uchar *)&ZvgMon)[CtlRegs[reg].offset])
+
+// Queue of each board, one lock for all of them
+
+typedef struct CTLBOARD_S
+{	uchar			value[CTL_REGS];		// value to send
+	uint			dirty;					// bit per register with a value to send
+	uchar			queued[CTL_REGS];		// value in 'queue[]', 'ZvgMon' once sent
+	uint			queuedBits;				// bit per register in 'queue[]'
+	bool			unknown;				// 'ZvgMon' may not hold the ZVG's registers
+	uint			live;					// bit per register sent since the ZVG was opened
+	uchar			queue[CTL_QUEUE_SZ];	// commands to send, in order
+	uint			count;					// bytes in 'queue[]'
+	ZvgCtlStats_s	stats;
+} CtlBoard_s;
+
+static pthread_mutex_t	CtlLock = PTHREAD_MUTEX_INITIALIZER;
+static CtlBoard_s		CtlBoards[ZVG_BOARDS];
+
+#define	Ctl		(CtlBoards[ZvgCurBoard])		// the current board's
+
+/*****************************************************************************
+* Move the registers waiting to be sent into the ordered queue.  Called with
+* the lock held.
+*
+* Returns:
+*    errOk, or errBfrFull if the queue is full.
+*****************************************************************************/
+static uint ctlQueueRegs( void)
+{
+	uint	reg;
+
+	for (reg = 0; reg < CTL_REGS; reg++)
+	{
+		if (!(Ctl.dirty & (1 << reg)))
+			continue;
+
+		if (Ctl.count + 2 > CTL_QUEUE_SZ)
+			return (errBfrFull);
+
+		Ctl.queue[Ctl.count++] = CtlRegs[reg].cmd;
+		Ctl.queue[Ctl.count++] = Ctl.value[reg];
+		Ctl.dirty &= ~(1 << reg);
+		Ctl.queued[reg] = Ctl.value[reg];
+		Ctl.queuedBits |= 1 << reg;
+		Ctl.stats.sent++;
+	}
+	return (errOk);
+}
+
+/*****************************************************************************
+* Return the value the ZVG has for a register, or will have once the queue
+* is sent.  Called with the lock held.
+*****************************************************************************/
+static uint ctlCurrent( uint reg)
+{
+	if (Ctl.queuedBits & (1 << reg))
+		return (Ctl.queued[reg]);
+
+	return (ctlMon( reg));
+}
+
+/*****************************************************************************
+* Set one of the ZVG's monitor registers, with the next frame sent.
+*
+* Called with:
+*    reg   = crXXX register.
+*    value = New value, 0-255.
+*
+* Returns:
+*    errOk, or errCtlBad if the register or value isn't valid.
+*****************************************************************************/
+uint zvgCtlSet( uint reg, uint value)
+{
+	if (reg >= CTL_REGS || value > 0xFF)
+		return (errCtlBad);
+
+	pthread_mutex_lock( &CtlLock);
+	Ctl.stats.sets++;
+
+	if (Ctl.dirty & (1 << reg))
+	{	Ctl.stats.coalesced++;					// replaces a value not yet sent
+		Ctl.dirty &= ~(1 << reg);
+	}
+
+	if (!Ctl.unknown && ctlCurrent( reg) == value)
+		Ctl.stats.redundant++;					// the ZVG has it already
+
+	else
+	{	Ctl.value[reg] = value;
+		Ctl.dirty |= 1 << reg;
+	}
+
+	pthread_mutex_unlock( &CtlLock);
+	return (errOk);
+}
+
+/*****************************************************************************
+* Return the value a register will have once the next frame is sent.
+*****************************************************************************/
+uint zvgCtlGet( uint reg)
+{
+	uint	value;
+
+	if (reg >= CTL_REGS)
+		return (0);
+
+	pthread_mutex_lock( &CtlLock);
+	value = (Ctl.dirty & (1 << reg)) ? Ctl.value[reg] : ctlCurrent( reg);
+	pthread_mutex_unlock( &CtlLock);
+	return (value);
+}
+
+/*****************************************************************************
+* Send a command other than a register setting with the next frame.
+*
+* Called with:
+*    cmd = zcSAVE_EE, zcLOAD_EE, zcRESET_MON, zcBLINK or zcCENTER.
+*
+* Returns:
+*    errOk, errCtlBad if the command isn't one of these, or errBfrFull if
+*    too many are waiting.
+*****************************************************************************/
+uint zvgCtlCmd( uint cmd)
+{
+	uint	err;
+
+	if (cmd != zcSAVE_EE && cmd != zcLOAD_EE && cmd != zcRESET_MON
+			&& cmd != zcBLINK && cmd != zcCENTER)
+		return (errCtlBad);
+
+	pthread_mutex_lock( &CtlLock);
+
+	// registers changed before the command go first
+
+	err = ctlQueueRegs();
+
+	if (!err && Ctl.count >= CTL_QUEUE_SZ)
+		err = errBfrFull;
+
+	if (!err)
+	{	Ctl.queue[Ctl.count++] = cmd;
+		Ctl.stats.cmds++;
+
+		if (cmd == zcLOAD_EE || cmd == zcRESET_MON)
+			Ctl.unknown = zTrue;					// registers changed by the ZVG
+	}
+
+	pthread_mutex_unlock( &CtlLock);
+
+	// the next open reads the settings from the ZVG
+
+	if (!err && (cmd == zcSAVE_EE || cmd == zcLOAD_EE || cmd == zcRESET_MON))
+		zvgCacheClear();
+
+	return (err);
+}
+
+/*****************************************************************************
+* Say that 'ZvgMon' holds the ZVG's registers again, after reading them
+* with 'zvgReadMonitorInfo()'.  Until then, after zcLOAD_EE or zcRESET_MON,
+* every setting is sent.
+*****************************************************************************/
+void zvgCtlSync( void)
+{
+	pthread_mutex_lock( &CtlLock);
+	Ctl.unknown = zFalse;
+	pthread_mutex_unlock( &CtlLock);
+}
+
+/*****************************************************************************
+* Put the waiting commands into the frame being sent.  Called by
+* 'zvgFrameSend()' after the frame's last vector.
+*
+* The commands go in whole or not at all.  If the frame has no room for
+* them, and the end of frame after them, they are kept, in order, for the
+* next frame, and 'ZvgMon' is left as it was.  The frame still goes out.
+*
+* Returns:
+*    errCode
+*****************************************************************************/
+uint zvgCtlFlush( void)
+{
+	uint	err, reg;
+
+	err = errOk;
+
+	pthread_mutex_lock( &CtlLock);
+	ctlQueueRegs();								// any that don't fit go with the next frame
+
+	if (Ctl.count > 0)
+	{
+		if (ZvgIO.dmaCurCount + Ctl.count + zENC_EOF_SIZE > MEM_BFR_SZ)
+			Ctl.stats.deferred++;
+
+		else if ((err = zvgDmaPutMem( Ctl.queue, Ctl.count)) == errOk)
+		{	for (reg = 0; reg < CTL_REGS; reg++)
+			{
+				if (Ctl.queuedBits & (1 << reg))
+					ctlMon( reg) = Ctl.queued[reg];
+			}
+
+			Ctl.live |= Ctl.queuedBits;
+			Ctl.queuedBits = 0;
+			Ctl.count = 0;
+		}
+	}
+
+	pthread_mutex_unlock( &CtlLock);
+	return (err);
+}
+
+/*****************************************************************************
+* Forget the commands waiting, and clear the counters.  Called when the ZVG
+* is opened.  The registers are unknown until 'ZvgMon' has been read, and
+* 'zvgCtlSync()' called.
+*****************************************************************************/
+void zvgCtlReset( void)
+{
+	pthread_mutex_lock( &CtlLock);
+	Ctl.dirty = 0;
+	Ctl.queuedBits = 0;
+	Ctl.live = 0;
+	Ctl.count = 0;
+	Ctl.unknown = zTrue;
+	memset( &Ctl.stats, 0, sizeof( Ctl.stats));
+	pthread_mutex_unlock( &CtlLock);
+}
+
+/*****************************************************************************
+* Make the commands setting the ZVG's registers to 'mon' again, for link
+* recovery, see 'zvgLink.c'.
+*
+* Settings read from the ZVG are all sent.  Settings taken from the device
+* info cache may not be the ZVG's, so only the registers sent since the ZVG
+* was opened are, the others are left to the ZVG.
+*
+* Called with:
+*    bfr = Filled in with the commands, room for CTL_REGS * 2 bytes.
+*    mon = Monitor settings to send.
+*
+* Returns:
+*    Bytes put in 'bfr', 0 if none.
+*****************************************************************************/
+uint zvgCtlResend( uchar *bfr, const ZvgMon_s *mon)
+{
+	uint	regs, reg, count;
+
+	pthread_mutex_lock( &CtlLock);
+	regs = ZvgIO.cacheUsed ? Ctl.live : (1 << CTL_REGS) - 1;
+	pthread_mutex_unlock( &CtlLock);
+
+	count = 0;
+
+	for (reg = 0; reg < CTL_REGS; reg++)
+	{
+		if (regs & (1 << reg))
+		{	bfr[count++] = CtlRegs[reg].cmd;
+			bfr[count++] = ((const uchar *)mon)[CtlRegs[reg].offset];
+		}
+	}
+	return (count);
+}
+
+/*****************************************************************************
+* Return the control command counters, since the ZVG was opened.
+*****************************************************************************/
+void zvgCtlGetStats( ZvgCtlStats_s *stats)
+{
+	pthread_mutex_lock( &CtlLock);
+	*stats = Ctl.stats;
+	pthread_mutex_unlock( &CtlLock);
+}
@@ -0,0 +1,518 @@
+/*****************************************************************************
+* Find the port the ZVG is connected to.
+*
+* Used when neither a port address nor a transport is given, so a new
+* machine works without setting 'ZVGPORT='.  The parallel ports are listed
+* from '/sys/class/parport' and '/proc/ioports', and all of them are
+* probed at once, each by its own thread:
+*
+*    - If the port has a ppdev device, the port is claimed and asked for
+*      its IEEE-1284 device ID, with a short timeout.  A ZVG answers with
+*      "MFG:Zektor".
+*
+*    - Otherwise, if we have port I/O access, the port's ECR is checked the
+*      way 'zvgDetectECP()' does, which finds an ECP port but can't tell
+*      what is plugged into it.
+*
+* Ports used by another board that is open are passed over.
+*
+* The port where a ZVG answered is chosen.  If none did, but exactly one
+* ECP port was found, that one is chosen, and opening it will report why
+* the ZVG didn't answer.  A probe that hangs (a port held by another
+* driver, say) is given up on after DETECT_WAIT_MS.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<dirent.h>
+#include	<errno.h>
+#include	<fcntl.h>
+#include	<pthread.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<time.h>
+#include	<unistd.h>
+#include	<sys/io.h>
+#include	<sys/ioctl.h>
+#include	<sys/time.h>
+#include	<linux/parport.h>
+#include	<linux/ppdev.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgDetect.h"
+
+#define	DETECT_SYSFS	"/sys/class/parport"
+#define	DETECT_PROCSYS	"/proc/sys/dev/parport"
+#define	DETECT_IOPORTS	"/proc/ioports"
+#define	DETECT_MFG		"MFG:Zektor"		// start of the ZVG's device ID
+
+// A run of probes.  Threads that are given up on still hold a reference,
+// and the last one out frees it.
+
+typedef struct DETECTRUN_S
+{	pthread_mutex_t	lock;
+	pthread_cond_t	cond;					// signalled as each probe finishes
+	uint			left;					// probes not yet finished
+	uint			refs;					// threads still running, plus the caller
+	bool			direct;					// port I/O can be used
+	uint			board;					// board looking, see 'zvgBoard.c'
+	bool			done[DETECT_MAX_PORTS];	// probe finished
+	ZvgDetect_s		ports[DETECT_MAX_PORTS];
+} DetectRun_s;
+
+typedef struct DETECTARG_S
+{	DetectRun_s		*run;
+	uint			idx;					// port being probed
+} DetectArg_s;
+
+/*****************************************************************************
+* Find a port in the list by name, adding it if it isn't there.
+*
+* Returns:
+*    The port, or NULL if the list is full.
+*****************************************************************************/
+static ZvgDetect_s *detectAdd( ZvgDetect_s *ports, uint maxPorts, uint *count, const char *name)
+{
+	ZvgDetect_s	*port;
+	uint		ii;
+
+	for (ii = 0; ii < *count; ii++)
+	{
+		if (strcmp( ports[ii].name, name) == 0)
+			return (ports + ii);
+	}
+
+	if (*count >= maxPorts || strlen( name) >= DETECT_NAME_SZ)
+		return (NULL);
+
+	port = ports + (*count)++;
+	memset( port, 0, sizeof( *port));
+	strcpy( port->name, name);
+	return (port);
+}
+
+/*****************************************************************************
+* Sort ports by their number, so "parport0" is tried before "parport1".
+*****************************************************************************/
+static int detectCmp( const void *p1, const void *p2)
+{
+	ulong	n1, n2;
+
+	n1 = strtoul( ((const ZvgDetect_s *)p1)->name + 7, NULL, 10);
+	n2 = strtoul( ((const ZvgDetect_s *)p2)->name + 7, NULL, 10);
+	return (n1 < n2 ? -1 : n1 > n2);
+}
+
+/*****************************************************************************
+* List the parallel ports the kernel knows about.
+*
+* Ports are taken from '/sys/class/parport', with their base addresses
+* from '/proc/sys/dev/parport'.  '/proc/ioports' adds the base address of
+* any port still without one (it reads as 0 unless we're root), and any
+* port not in sysfs.
+*
+* Called with:
+*    ports    = Filled in with the ports found.
+*    maxPorts = Most ports to list.
+*    count    = Set to the number of ports found.
+*
+* Returns:
+*    errOk     - Ports listed.
+*    errNoPort - No parallel ports found.
+*****************************************************************************/
+uint zvgDetectList( ZvgDetect_s *ports, uint maxPorts, uint *count)
+{
+	ZvgDetect_s		*port;
+	DIR				*dir;
+	struct dirent	*ent;
+	FILE			*fp;
+	char			path[256], line[256], name[DETECT_NAME_SZ];
+	uint			start, end, ii;
+
+	*count = 0;
+
+	// ports the parport driver has
+
+	dir = opendir( DETECT_SYSFS);
+
+	if (dir != NULL)
+	{
+		while ((ent = readdir( dir)) != NULL)
+		{
+			if (strncmp( ent->d_name, "parport", 7) != 0)
+				continue;
+
+			port = detectAdd( ports, maxPorts, count, ent->d_name);
+
+			if (port == NULL)
+				continue;
+
+			snprintf( path, sizeof( path), "%s/%s/base-addr", DETECT_PROCSYS, port->name);
+			fp = fopen( path, "r");
+
+			if (fp != NULL)
+			{
+				if (fscanf( fp, "%u", &start) == 1)
+					port->portAdr = start;
+
+				fclose( fp);
+			}
+		}
+		closedir( dir);
+	}
+
+	// I/O ranges claimed by a parport, the first one given is the base
+
+	fp = fopen( DETECT_IOPORTS, "r");
+
+	if (fp != NULL)
+	{
+		while (fgets( line, sizeof( line), fp) != NULL)
+		{
+			if (sscanf( line, " %x-%x : %15s", &start, &end, name) != 3
+					|| strncmp( name, "parport", 7) != 0 || start == 0)
+				continue;
+
+			port = detectAdd( ports, maxPorts, count, name);
+
+			if (port != NULL && port->portAdr == 0)
+				port->portAdr = start;
+		}
+		fclose( fp);
+	}
+
+	// add the ppdev device of each port, if there is one
+
+	for (ii = 0; ii < *count; ii++)
+	{	snprintf( ports[ii].dev, DETECT_DEV_SZ, "/dev/%s", ports[ii].name);
+
+		if (access( ports[ii].dev, F_OK) != 0)
+			ports[ii].dev[0] = '\0';
+	}
+
+	qsort( ports, *count, sizeof( *ports), detectCmp);
+	return (*count > 0 ? errOk : errNoPort);
+}
+
+/*****************************************************************************
+* Probe a port through its ppdev device, asking for the device ID.
+*
+* Returns:
+*    errOk        - A ZVG answered.
+*    errTransOpen - The device could not be opened or claimed.
+*    errEcpNoData - Nothing answered.
+*    errUnknownID - Something other than a ZVG answered.
+*****************************************************************************/
+static uint detectPpdev( ZvgDetect_s *port)
+{
+	uchar			bfr[ZVG_MAX_BFRSZ+1];
+	struct timeval	tv;
+	ssize_t			count;
+	int				fd, mode, modes;
+	uint			err;
+
+	fd = open( port->dev, O_RDWR);
+
+	if (fd < 0)
+		return (errTransOpen);
+
+	ioctl( fd, PPEXCL);
+
+	if (ioctl( fd, PPCLAIM) < 0)
+	{	close( fd);
+		return (errTransOpen);
+	}
+
+	tv.tv_sec = 0;
+	tv.tv_usec = DETECT_ID_MS * 1000;
+	ioctl( fd, PPSETTIME, &tv);
+
+	if (ioctl( fd, PPGETMODES, &modes) == 0 && (modes & PARPORT_MODE_ECP))
+		port->result = drEcp;
+
+	// ask for the device ID
+
+	err = errEcpNoData;
+	mode = IEEE1284_MODE_NIBBLE | IEEE1284_DEVICEID;
+
+	if (ioctl( fd, PPNEGOT, &mode) == 0 && ioctl( fd, PPSETMODE, &mode) == 0)
+	{
+		do
+			count = read( fd, bfr, ZVG_MAX_BFRSZ);
+		while (count < 0 && errno == EINTR);
+
+		// the ID starts with a two byte length
+
+		if (count > 2)
+		{	bfr[count] = '\0';
+			err = errUnknownID;
+
+			if (strncmp( (char *)bfr + 2, DETECT_MFG, strlen( DETECT_MFG)) == 0)
+			{	port->result = drZvg;
+				err = errOk;
+			}
+		}
+	}
+
+	mode = IEEE1284_MODE_COMPAT;
+	ioctl( fd, PPNEGOT, &mode);
+	ioctl( fd, PPSETMODE, &mode);
+	ioctl( fd, PPRELEASE);
+	close( fd);
+	return (err);
+}
+
+/*****************************************************************************
+* Probe a port through port I/O, looking for an ECP.  The same checks as
+* 'zvgDetectECP()', but the ECR is put back as it was found.
+*
+* Returns:
+*    errOk     - An ECP was found.
+*    errNotEcp - No ECP at the port's address.
+*****************************************************************************/
+static uint detectDirect( ZvgDetect_s *port)
+{
+	uint	ecr;
+	uchar	val;
+
+	ecr = port->portAdr + ECP_ecr;
+	val = inb( ecr);
+
+	// Check that the full bit is off, and the empty bit is set
+
+	if ((val & (ECR_full | ECR_empty)) != ECR_empty)
+		return (errNotEcp);
+
+	// verify that we cannot change the empty bit to a zero
+
+	outb( 0x34, ecr);
+
+	if (inb( ecr) != 0x35)
+	{	outb( val, ecr);
+		return (errNotEcp);
+	}
+
+	outb( val, ecr);
+	port->result = drEcp;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Thread probing one port.
+*****************************************************************************/
+static void *detectThread( void *arg)
+{
+	DetectArg_s		*da;
+	DetectRun_s		*run;
+	ZvgDetect_s		port;
+	long long int	start;
+
+	da = (DetectArg_s *)arg;
+	run = da->run;
+	ZvgCurBoard = run->board;
+
+	pthread_mutex_lock( &run->lock);
+	port = run->ports[da->idx];
+	pthread_mutex_unlock( &run->lock);
+
+	// probe a copy, the caller may have given up on us
+
+	start = tmrReadTimer();
+	port.err = errNoPort;
+
+	if (port.dev[0] != '\0')
+		port.err = detectPpdev( &port);
+
+	if ((port.dev[0] == '\0' || port.err == errTransOpen) && run->direct && port.portAdr != 0)
+		port.err = detectDirect( &port);
+
+	port.probeNs = tmrReadTimer() - start;
+
+	pthread_mutex_lock( &run->lock);
+	run->ports[da->idx] = port;
+	run->done[da->idx] = zTrue;
+	run->left--;
+	pthread_cond_broadcast( &run->cond);
+
+	if (--run->refs == 0)
+	{	pthread_mutex_unlock( &run->lock);
+		pthread_cond_destroy( &run->cond);
+		pthread_mutex_destroy( &run->lock);
+		free( run);
+	}
+	else
+		pthread_mutex_unlock( &run->lock);
+
+	free( da);
+	return (NULL);
+}
+
+/*****************************************************************************
+* Probe ports, all at once.
+*
+* Sets 'result', 'err' and 'probeNs' of each port.  A port whose probe
+* doesn't finish within DETECT_WAIT_MS is left as drNone, errEcpTimeout.
+*
+* Called with:
+*    ports = Ports to probe, from 'zvgDetectList()'.
+*    count = Number of ports.
+*****************************************************************************/
+void zvgDetectProbe( ZvgDetect_s *ports, uint count)
+{
+	DetectRun_s		*run;
+	DetectArg_s		*da;
+	pthread_t		thread;
+	struct timespec	ts;
+	uint			ii;
+
+	if (count > DETECT_MAX_PORTS)
+		count = DETECT_MAX_PORTS;
+
+	for (ii = 0; ii < count; ii++)
+	{	ports[ii].result = drNone;
+		ports[ii].err = errEcpTimeout;
+		ports[ii].probeNs = 0;
+	}
+
+	run = (DetectRun_s *)calloc( 1, sizeof( DetectRun_s));
+
+	if (run == NULL)
+		return;
+
+	tmrInit();
+	pthread_mutex_init( &run->lock, NULL);
+	pthread_cond_init( &run->cond, NULL);
+	memcpy( run->ports, ports, count * sizeof( *ports));
+	run->refs = 1;
+	run->board = ZvgCurBoard;
+
+	// port I/O access is given to threads started after this
+
+	run->direct = ZvgIO.ioHookP == NULL && iopl( 3) == 0;
+
+	pthread_mutex_lock( &run->lock);
+
+	for (ii = 0; ii < count; ii++)
+	{	da = (DetectArg_s *)malloc( sizeof( DetectArg_s));
+
+		if (da == NULL)
+			break;
+
+		da->run = run;
+		da->idx = ii;
+
+		if (pthread_create( &thread, NULL, detectThread, da) != 0)
+		{	free( da);
+			break;
+		}
+
+		pthread_detach( thread);
+		run->left++;
+		run->refs++;
+	}
+
+	// wait for the probes, but not forever
+
+	clock_gettime( CLOCK_REALTIME, &ts);
+	ts.tv_sec += DETECT_WAIT_MS / 1000;
+	ts.tv_nsec += (DETECT_WAIT_MS % 1000) * 1000000L;
+
+	if (ts.tv_nsec >= 1000000000L)
+	{	ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	while (run->left > 0)
+	{
+		if (pthread_cond_timedwait( &run->cond, &run->lock, &ts) == ETIMEDOUT)
+			break;
+	}
+
+	// take the results of the probes that finished
+
+	for (ii = 0; ii < count; ii++)
+	{
+		if (run->done[ii])
+			ports[ii] = run->ports[ii];
+	}
+
+	if (--run->refs == 0)
+	{	pthread_mutex_unlock( &run->lock);
+		pthread_cond_destroy( &run->cond);
+		pthread_mutex_destroy( &run->lock);
+		free( run);
+	}
+	else
+		pthread_mutex_unlock( &run->lock);
+}
+
+/*****************************************************************************
+* Find the port the ZVG is connected to.
+*
+* Direct port I/O is used if we have access to the ports, ppdev otherwise.
+*
+* Called with:
+*    trSpec  = Set to the transport to use, TR_SPEC_SZ characters.
+*    portAdr = Set to the port address, for direct port I/O.
+*
+* Returns:
+*    errOk     - Port found.
+*    errNoPort - No port with a ZVG, and not just one ECP port, found.
+*****************************************************************************/
+uint zvgDetect( char *trSpec, uint *portAdr)
+{
+	ZvgDetect_s		ports[DETECT_MAX_PORTS], *found;
+	uint			count, kept, ecps, ii;
+	uint			err;
+
+	err = zvgDetectList( ports, DETECT_MAX_PORTS, &count);
+
+	if (err)
+		return (err);
+
+	// pass over the ports of the other boards that are open
+
+	for (ii = kept = 0; ii < count; ii++)
+	{
+		if (!zvgBoardPortUsed( ports[ii].portAdr, ports[ii].dev))
+			ports[kept++] = ports[ii];
+	}
+
+	count = kept;
+	zvgDetectProbe( ports, count);
+
+	// a ZVG that answered, or failing that the only ECP port
+
+	found = NULL;
+	ecps = 0;
+
+	for (ii = 0; ii < count && (found == NULL || found->result != drZvg); ii++)
+	{
+		if (ports[ii].result == drZvg)
+			found = ports + ii;
+
+		else if (ports[ii].result == drEcp && ecps++ == 0)
+			found = ports + ii;
+	}
+
+	if (found == NULL || (found->result == drEcp && ecps > 1))
+		return (errNoPort);
+
+	if (found->portAdr != 0 && ZvgIO.ioHookP == NULL && iopl( 3) == 0)
+	{	strcpy( trSpec, ZvgTrDirect.name);
+		*portAdr = found->portAdr;
+	}
+
+	else if (found->dev[0] != '\0')
+		snprintf( trSpec, TR_SPEC_SZ, "%s:%s", ZvgTrPpdev.name, found->dev);
+
+	else
+		return (errNoPort);
+
+	return (errOk);
+}
@@ -0,0 +1,399 @@
+/*****************************************************************************
+* ZVG command stream disassembler.
+*
+* Lists a command stream as readable commands: the bytes of each command,
+* the position, length, angle and color it gives, and where it leaves the
+* beam.  Commands are decoded by 'zvgEmuDecode()', so the disassembler and
+* the emulator always agree on what a stream means.
+*
+* While disassembling, the bytes are added up by class of command, along
+* with what is spent on positions and colors, how much of that repeats what
+* the ZVG already has, and how far the beam moves blanked.  With no listing
+* asked for, nothing is formatted, so thousands of frames can be costed
+* quickly.
+*
+* The beam position and color carry from one buffer to the next, as does a
+* command cut off by the end of a buffer.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+
+#include	"zstddef.h"
+#include	"zvgCmds.h"
+#include	"zvgEmu.h"
+#include	"zvgDsm.h"
+
+#define	DSM_HEX_W		(EMU_MAX_CMD * 3)	// width of the bytes in a listing
+
+// Names of the command classes, for the cost breakdown
+
+static const char	*DsmClassNames[DSM_CLASSES] =
+{	"vector 90",
+	"vector 45",
+	"vector ratio",
+	"point relative",
+	"point absolute",
+	"NOP",
+	"CENTER",
+	"settings",
+	"reserved"
+};
+
+// Names of the extended commands, zcNOP to zcCENTER
+
+static const char	*DsmExtNames[] =
+{	"NOP", "BLINK", "ZSHIFT", "OSHOOT", "JUMP", "SETTLE", "POINT_I", "MIN_I",
+	"MAX_I", "SCALE", "SAVE_EE", "LOAD_EE", "READ_MON", "RESET_MON", "READ_SPD",
+	"CENTER"
+};
+
+// State used by 'zvgResetDsm()' and 'zvgDsm()'
+
+static ZvgDsm_s		DsmState = { .color = zINIT_COLOR };
+
+/*****************************************************************************
+* Return the length of a move along its long axis.
+*****************************************************************************/
+static uint longAxis( int dx, int dy)
+{
+	dx = abs( dx);
+	dy = abs( dy);
+	return ((uint)(dx > dy ? dx : dy));
+}
+
+/*****************************************************************************
+* Return the class of a decoded command.
+*****************************************************************************/
+static uint dsmClass( const ZvgEmuCmd_s *cmd)
+{
+	switch (cmd->kind)
+	{
+	case ekVector:
+		if (cmd->op & zbRATIO)
+			return (dcVecRatio);
+
+		return ((cmd->op & zbHZVT) ? dcVec90 : dcVec45);
+
+	case ekPoint:
+		return (cmd->hasXY ? dcPointAbs : dcPointRel);
+
+	case ekExtended:
+		if (cmd->op == zcNOP)
+			return (dcNop);
+
+		return (cmd->op == zcCENTER ? dcCenter : dcSetting);
+	}
+	return (dcReserved);
+}
+
+/*****************************************************************************
+* Put the disassembler in the ZVG's power up state: beam centered, default
+* color, counters cleared.
+*****************************************************************************/
+void zvgDsmReset( ZvgDsm_s *dsm)
+{
+	memset( dsm, 0, sizeof( ZvgDsm_s));
+	dsm->color = zINIT_COLOR;
+}
+
+/*****************************************************************************
+* Format one command as a line of a listing, without a newline.
+*
+* Called with:
+*    cmd    = Decoded command.
+*    bfr    = Bytes of the command.
+*    offset = Offset of the command in the stream.
+*    xPos   = Beam position before the command.
+*    yPos
+*    line   = Filled in, must hold DSM_LINE_SZ characters.
+*****************************************************************************/
+void zvgDsmFormat( const ZvgEmuCmd_s *cmd, const uchar *bfr, ulong offset, int xPos,
+		int yPos, char *line)
+{
+	char	*pp, *end;
+	uint	ii;
+
+	end = line + DSM_LINE_SZ;
+	pp = line + snprintf( line, DSM_LINE_SZ, "%8lu ", offset);
+
+	for (ii = 0; ii < cmd->size; ii++)
+		pp += snprintf( pp, end - pp, " %02X", bfr[ii]);
+
+	for (ii = cmd->size * 3; ii < DSM_HEX_W; ii++)
+		*pp++ = ' ';
+
+	switch (cmd->kind)
+	{
+	case ekExtended:
+		pp += snprintf( pp, end - pp, "  %s", DsmExtNames[cmd->op - zcNOP]);
+
+		if (cmd->size == 2)
+			snprintf( pp, end - pp, " %u", cmd->arg);
+
+		return;
+
+	case ekReserved:
+		snprintf( pp, end - pp, "  ??? %02X", cmd->op);
+		return;
+	}
+
+	// vectors and points
+
+	pp += snprintf( pp, end - pp, "  %-6s", cmd->kind == ekVector ? "VECTOR" : "POINT");
+
+	if (cmd->hasColor)
+		pp += snprintf( pp, end - pp, " color=%04X", cmd->color);
+
+	if (cmd->hasXY)
+	{	xPos = cmd->xx;
+		yPos = cmd->yy;
+		pp += snprintf( pp, end - pp, " at %d,%d", xPos, yPos);
+	}
+
+	if (cmd->kind == ekPoint && cmd->hasXY)
+		return;
+
+	if (cmd->hasRatio)
+		pp += snprintf( pp, end - pp, " ratio=%.4f", cmd->ratio / 65536.0);
+
+	else
+		pp += snprintf( pp, end - pp, " %s", (cmd->op & zbHZVT) ? "90" : "45");
+
+	snprintf( pp, end - pp, " len=%u%s by %d,%d to %d,%d", cmd->len,
+			(cmd->op & zbSHORT) ? " short" : "", cmd->dx, cmd->dy, xPos + cmd->dx, yPos + cmd->dy);
+}
+
+/*****************************************************************************
+* Move the beam with the beam off, counting the travel.
+*****************************************************************************/
+static void dsmJump( ZvgDsm_s *dsm, int xx, int yy)
+{
+	dsm->cost.jumps++;
+	dsm->cost.jumpUnits += longAxis( xx - dsm->xPos, yy - dsm->yPos);
+	dsm->xPos = xx;
+	dsm->yPos = yy;
+}
+
+/*****************************************************************************
+* Cost, list and run one command.
+*****************************************************************************/
+static void dsmCmd( ZvgDsm_s *dsm, const ZvgEmuCmd_s *cmd, const uchar *bfr, FILE *fp)
+{
+	ZvgDsmCost_s	*cost;
+	char			line[DSM_LINE_SZ];
+	uint			cls;
+
+	if (fp != NULL)
+	{	zvgDsmFormat( cmd, bfr, dsm->offset, dsm->xPos, dsm->yPos, line);
+		fputs( line, fp);
+		fputc( '\n', fp);
+	}
+
+	cost = &dsm->cost;
+	cls = dsmClass( cmd);
+	cost->cmds[cls]++;
+	cost->cmdBytes[cls] += cmd->size;
+	dsm->offset += cmd->size;
+
+	if (cmd->hasColor)
+	{	cost->colorCmds++;
+		cost->colorBytes += 2;
+
+		if (cmd->color == dsm->color)
+			cost->colorWasted++;
+
+		dsm->color = cmd->color;
+	}
+
+	if (cmd->hasXY)
+	{	cost->absCmds++;
+		cost->absBytes += 3;
+
+		if (cmd->xx == dsm->xPos && cmd->yy == dsm->yPos)
+			cost->absWasted++;
+	}
+
+	switch (cls)
+	{
+	case dcCenter:
+		cost->frames++;
+		dsmJump( dsm, 0, 0);
+		break;
+
+	case dcPointAbs:
+		dsmJump( dsm, cmd->xx, cmd->yy);
+		break;
+
+	case dcPointRel:
+		if (cmd->op & zbSHORT)
+			cost->shortCmds++;
+
+		dsmJump( dsm, dsm->xPos + cmd->dx, dsm->yPos + cmd->dy);
+		break;
+
+	case dcVec90:
+	case dcVec45:
+	case dcVecRatio:
+		if (cmd->op & zbSHORT)
+			cost->shortCmds++;
+
+		if (cmd->hasXY)
+			dsmJump( dsm, cmd->xx, cmd->yy);
+
+		cost->drawUnits += longAxis( cmd->dx, cmd->dy);
+		dsm->xPos += cmd->dx;
+		dsm->yPos += cmd->dy;
+		break;
+	}
+}
+
+/*****************************************************************************
+* Disassemble a buffer.
+*
+* A command cut off by the end of the buffer is kept, and finished by the
+* start of the next buffer.
+*
+* Called with:
+*    dsm   = Disassembler.
+*    bfr   = Bytes of the command stream.
+*    count = Number of bytes.
+*    fp    = Listing is written here, NULL to only count the cost.
+*****************************************************************************/
+void zvgDsmRun( ZvgDsm_s *dsm, const uchar *bfr, uint count, FILE *fp)
+{
+	ZvgEmuCmd_s	cmd;
+	uint		size;
+
+	dsm->cost.bytes += count;
+
+	// finish a command left from the last buffer
+
+	while (dsm->partLen > 0 && count > 0)
+	{	dsm->part[dsm->partLen++] = *bfr++;
+		count--;
+
+		if (zvgEmuDecode( dsm->part, dsm->partLen, &cmd) != 0)
+		{	dsmCmd( dsm, &cmd, dsm->part, fp);
+			dsm->partLen = 0;
+		}
+	}
+
+	while (count > 0)
+	{	size = zvgEmuDecode( bfr, count, &cmd);
+
+		if (size == 0)
+		{	memcpy( dsm->part, bfr, count);		// keep it for the next buffer
+			dsm->partLen = count;
+			return;
+		}
+
+		dsmCmd( dsm, &cmd, bfr, fp);
+		bfr += size;
+		count -= size;
+	}
+}
+
+/*****************************************************************************
+* Add one cost breakdown to another.
+*****************************************************************************/
+void zvgDsmAddCost( ZvgDsmCost_s *total, const ZvgDsmCost_s *cost)
+{
+	uint	ii;
+
+	total->bytes += cost->bytes;
+	total->frames += cost->frames;
+
+	for (ii = 0; ii < DSM_CLASSES; ii++)
+	{	total->cmds[ii] += cost->cmds[ii];
+		total->cmdBytes[ii] += cost->cmdBytes[ii];
+	}
+
+	total->shortCmds += cost->shortCmds;
+	total->absCmds += cost->absCmds;
+	total->absBytes += cost->absBytes;
+	total->absWasted += cost->absWasted;
+	total->colorCmds += cost->colorCmds;
+	total->colorBytes += cost->colorBytes;
+	total->colorWasted += cost->colorWasted;
+	total->drawUnits += cost->drawUnits;
+	total->jumps += cost->jumps;
+	total->jumpUnits += cost->jumpUnits;
+}
+
+/*****************************************************************************
+* Return 'part' as a percentage of 'whole'.
+*****************************************************************************/
+static double percent( ulong part, ulong whole)
+{
+	return (whole != 0 ? part * 100.0 / whole : 0.0);
+}
+
+/*****************************************************************************
+* Print a cost breakdown.
+*****************************************************************************/
+void zvgDsmPrintCost( const ZvgDsmCost_s *cost, FILE *fp)
+{
+	ulong	cmds, vecs;
+	uint	ii;
+
+	fprintf( fp, "%-16s %10s %12s %7s %9s\n", "class", "commands", "bytes", "bytes%", "bytes/cmd");
+	cmds = 0;
+
+	for (ii = 0; ii < DSM_CLASSES; ii++)
+	{	cmds += cost->cmds[ii];
+
+		if (cost->cmds[ii] == 0)
+			continue;
+
+		fprintf( fp, "%-16s %10lu %12lu %6.1f%% %9.2f\n", DsmClassNames[ii], cost->cmds[ii],
+				cost->cmdBytes[ii], percent( cost->cmdBytes[ii], cost->bytes),
+				(double)cost->cmdBytes[ii] / cost->cmds[ii]);
+	}
+	fprintf( fp, "%-16s %10lu %12lu\n\n", "total", cmds, cost->bytes);
+
+	vecs = cost->cmds[dcVec90] + cost->cmds[dcVec45] + cost->cmds[dcVecRatio] + cost->cmds[dcPointRel];
+
+	fprintf( fp, "short form:   %lu of %lu relative commands (%.1f%%)\n", cost->shortCmds, vecs,
+			percent( cost->shortCmds, vecs));
+
+	fprintf( fp, "positions:    %lu commands, %lu bytes (%.1f%%), %lu already at the position\n",
+			cost->absCmds, cost->absBytes, percent( cost->absBytes, cost->bytes), cost->absWasted);
+
+	fprintf( fp, "colors:       %lu commands, %lu bytes (%.1f%%), %lu unchanged\n",
+			cost->colorCmds, cost->colorBytes, percent( cost->colorBytes, cost->bytes),
+			cost->colorWasted);
+
+	fprintf( fp, "drawn:        %lu units\n", cost->drawUnits);
+
+	fprintf( fp, "blank travel: %lu units in %lu jumps (%.1f per jump, %.1f%% of all travel)\n",
+			cost->jumpUnits, cost->jumps, cost->jumps != 0 ? (double)cost->jumpUnits / cost->jumps : 0.0,
+			percent( cost->jumpUnits, cost->jumpUnits + cost->drawUnits));
+
+	if (cost->frames != 0)
+		fprintf( fp, "frames:       %lu, %.1f bytes per frame\n", cost->frames,
+				(double)cost->bytes / cost->frames);
+}
+
+/*****************************************************************************
+* Reset the disassembler used by 'zvgDsm()'.  The beam is centered, as it
+* is after the zcCENTER ending a frame.
+*****************************************************************************/
+void zvgResetDsm( void)
+{
+	zvgDsmReset( &DsmState);
+}
+
+/*****************************************************************************
+* List a buffer of ZVG commands on 'stdout'.
+*****************************************************************************/
+void zvgDsm( uchar *bfr, uint size)
+{
+	zvgDsmRun( &DsmState, bfr, size, stdout);
+	fflush( stdout);
+}
@@ -0,0 +1,741 @@
+/*****************************************************************************
+* ZVG command stream emulator.
+*
+* Runs a ZVG command stream the way the ZVG firmware does, without a ZVG.
+* The emulator keeps the beam position, color and monitor settings, times
+* each command using a simple model of the monitor, and draws the beam path
+* into an RGB raster that can be saved as a PPM file.  This makes it possible
+* to check the output of the encoder, and to compare the draw time of two
+* command streams, with no monitor attached.
+*
+* Like the ZVG, a command is not run until EMU_LOOKAHEAD bytes are waiting,
+* so the last commands of a frame are only run once the NOPs added by
+* 'zvgEncEOF()' arrive, and those NOPs wait for the next frame.
+*
+* The timing model:
+*
+*    vector = length * usPerInch / unitsPerInch
+*    jump   = the larger of (settle * settleNs) and
+*             (distance * jumpFactor * jumpNs)
+*    point  = jump to the point + point_i * pointNs
+*
+* plus 'cmdNs' for every command.  A jump is made before every vector that
+* gives its own starting position, and before every point.  'settle',
+* 'jumpFactor' and 'point_i' are the current monitor settings, so changes
+* sent with zcSETTLE, zcJUMP and zcPOINT_I show up in the draw time.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+
+#include	"zstddef.h"
+#include	"zvgCmds.h"
+#include	"zvgPort.h"
+#include	"zvgTrans.h"
+#include	"zvgEmu.h"
+
+// Default timing model
+
+#define	EMU_UNITS_INCH	64				// ZVG units in an inch of a 19" monitor
+#define	EMU_CMD_NS		1000			// time to decode a command
+#define	EMU_JUMP_NS		2				// jump time per unit per jump factor step
+#define	EMU_SETTLE_NS	1000			// settle time per step
+#define	EMU_POINT_NS	100				// point dwell per step of intensity
+#define	EMU_WIDTH		640				// default raster size
+#define	EMU_HEIGHT		480
+
+/*****************************************************************************
+* Fill in the default emulator settings.
+*
+* The drawing speed is the fastest entry of the default speed table, the
+* raster is 640x480.
+*****************************************************************************/
+void zvgEmuDefaults( ZvgEmuCfg_s *cfg)
+{
+	cfg->usPerInch = TrDefaultSpd[0];
+	cfg->unitsPerInch = EMU_UNITS_INCH;
+	cfg->cmdNs = EMU_CMD_NS;
+	cfg->jumpNs = EMU_JUMP_NS;
+	cfg->settleNs = EMU_SETTLE_NS;
+	cfg->pointNs = EMU_POINT_NS;
+	cfg->width = EMU_WIDTH;
+	cfg->height = EMU_HEIGHT;
+	cfg->flags = EMUF_CLEAR;
+}
+
+/*****************************************************************************
+* Load monitor settings from the packed form used by the ZVG firmware.
+*****************************************************************************/
+static void unpackMon( ZvgMon_s *mon, const uchar *bfr)
+{
+	mon->point_i = bfr[0];
+	mon->zShift = bfr[1];
+	mon->oShoot = bfr[2];
+	mon->jumpFactor = bfr[3];
+	mon->settle = bfr[4];
+	mon->min_i = bfr[5];
+	mon->max_i = bfr[6];
+	mon->scale = bfr[7];
+	mon->flags = bfr[8];
+	mon->cksum = bfr[9] + ((ushort)bfr[10] << 8);
+}
+
+/*****************************************************************************
+* Pack monitor settings into the form sent by the ZVG firmware.
+*****************************************************************************/
+static void packMon( uchar *bfr, const ZvgMon_s *mon)
+{
+	bfr[0] = mon->point_i;
+	bfr[1] = mon->zShift;
+	bfr[2] = mon->oShoot;
+	bfr[3] = mon->jumpFactor;
+	bfr[4] = mon->settle;
+	bfr[5] = mon->min_i;
+	bfr[6] = mon->max_i;
+	bfr[7] = mon->scale;
+	bfr[8] = mon->flags;
+	bfr[9] = (uchar)mon->cksum;
+	bfr[10] = (uchar)(mon->cksum >> 8);
+}
+
+/*****************************************************************************
+* Start up an emulator.
+*
+* Called with:
+*    emu = Emulator to start.
+*    cfg = Settings to use, NULL for the defaults.
+*
+* Returns:
+*    errOk     - Emulator ready.
+*    errMemory - No memory for the raster.
+*****************************************************************************/
+uint zvgEmuOpen( ZvgEmu_s *emu, const ZvgEmuCfg_s *cfg)
+{
+	memset( emu, 0, sizeof( ZvgEmu_s));
+
+	if (cfg != NULL)
+		emu->cfg = *cfg;
+
+	else
+		zvgEmuDefaults( &emu->cfg);
+
+	if (emu->cfg.unitsPerInch == 0)
+		emu->cfg.unitsPerInch = EMU_UNITS_INCH;
+
+	if (emu->cfg.width > 0 && emu->cfg.height > 0)
+	{	emu->raster = (uchar *)calloc( emu->cfg.width * emu->cfg.height, 3);
+
+		if (emu->raster == NULL)
+			return (errMemory);
+	}
+
+	unpackMon( &emu->eeMon, TrDefaultMon);
+	zvgEmuReset( emu);
+	return (errOk);
+}
+
+/*****************************************************************************
+* Release the raster of an emulator, may be called more than once.
+*****************************************************************************/
+void zvgEmuClose( ZvgEmu_s *emu)
+{
+	free( emu->raster);
+	emu->raster = NULL;
+}
+
+/*****************************************************************************
+* Put the emulator in its power up state.
+*
+* The command buffer and counters are cleared, the beam is centered, and
+* the monitor settings are loaded from the emulated EEPROM.  The raster is
+* left alone.
+*****************************************************************************/
+void zvgEmuReset( ZvgEmu_s *emu)
+{
+	emu->qHead = 0;
+	emu->qCount = 0;
+	emu->xPos = 0;
+	emu->yPos = 0;
+	emu->color = zINIT_COLOR;
+	emu->mon = emu->eeMon;
+	emu->blinks = 0;
+	emu->frames = 0;
+	emu->clearPend = zFalse;
+	emu->replyLen = 0;
+	memset( &emu->cur, 0, sizeof( ZvgEmuStats_s));
+	memset( &emu->last, 0, sizeof( ZvgEmuStats_s));
+}
+
+/*****************************************************************************
+* Decode one ZVG command.
+*
+* Nothing is run, so this can be used to walk through any command stream.
+*
+* Called with:
+*    bfr   = Start of command.
+*    count = Bytes available at 'bfr'.
+*    cmd   = Set to the decoded command.
+*
+* Returns:
+*    Bytes used by the command, or 0 if 'count' does not hold all of it.
+*****************************************************************************/
+uint zvgEmuDecode( const uchar *bfr, uint count, ZvgEmuCmd_s *cmd)
+{
+	uint	op, size, ii, xLen, yLen, shortLen;
+
+	if (count == 0)
+		return (0);
+
+	memset( cmd, 0, sizeof( ZvgEmuCmd_s));
+	op = bfr[0];
+	cmd->op = op;
+
+	// extended commands, zcZSHIFT to zcSCALE take a one byte argument
+
+	if (op >= zcEXTENDED && op <= zcCENTER)
+	{	cmd->kind = ekExtended;
+		size = (op >= zcZSHIFT && op <= zcSCALE) ? 2 : 1;
+
+		if (count < size)
+			return (0);
+
+		if (size == 2)
+			cmd->arg = bfr[1];
+
+		cmd->size = size;
+		return (size);
+	}
+
+	// work out the size of the command
+
+	if ((op & (zbABS | zbVECTOR)) == zbABS)
+	{
+		// absolute points have no length, the short form is reserved
+
+		if (op & zbSHORT)
+		{	cmd->kind = ekReserved;
+			cmd->size = 1;
+			return (1);
+		}
+
+		cmd->kind = ekPoint;
+
+		if (op & 0x0F)
+			cmd->kind = ekReserved;		// lower bits must be zero
+
+		size = 1 + ((op & zbCOLOR) ? 2 : 0) + 3;
+	}
+	else
+	{	cmd->kind = (op & zbVECTOR) ? ekVector : ekPoint;
+		size = 1 + ((op & zbCOLOR) ? 2 : 0) + ((op & zbABS) ? 3 : 0);
+
+		if (op & zbRATIO)
+			size += (op & zbSHORT) ? 2 : 3;
+
+		else
+			size += (op & zbSHORT) ? 1 : 2;
+	}
+
+	if (count < size)
+		return (0);
+
+	cmd->size = size;
+	ii = 1;
+
+	// color, MSB first
+
+	if (op & zbCOLOR)
+	{	cmd->hasColor = zTrue;
+		cmd->color = ((uint)bfr[ii] << 8) | bfr[ii + 1];
+		ii += 2;
+	}
+
+	// 12 bit signed X and Y
+
+	if (op & zbABS)
+	{	cmd->hasXY = zTrue;
+		cmd->xx = (int)(((uint)(bfr[ii + 1] & 0xF0) << 4) | bfr[ii]);
+		cmd->yy = (int)(((uint)(bfr[ii + 1] & 0x0F) << 8) | bfr[ii + 2]);
+
+		if (cmd->xx & 0x800)
+			cmd->xx -= 0x1000;
+
+		if (cmd->yy & 0x800)
+			cmd->yy -= 0x1000;
+
+		ii += 3;
+	}
+
+	if ((op & (zbABS | zbVECTOR)) == zbABS)
+		return (size);						// absolute point, done
+
+	// length, and ratio if given
+
+	if (op & zbRATIO)
+	{	cmd->hasRatio = zTrue;
+
+		if (op & zbSHORT)
+		{	cmd->ratio = (uint)bfr[ii] << 8;
+			cmd->len = bfr[ii + 1];
+		}
+		else
+		{	cmd->ratio = ((uint)bfr[ii] << 8) | (bfr[ii + 1] & 0xF0);
+			cmd->len = ((uint)(bfr[ii + 1] & 0x0F) << 8) | bfr[ii + 2];
+		}
+
+		// round the short axis to the nearest unit, as the encoder floors
+		// the ratio
+
+		shortLen = (uint)(((ulong)cmd->len * cmd->ratio + 0x8000) >> 16);
+
+		if (op & zbYLEN)
+		{	xLen = shortLen;
+			yLen = cmd->len;
+		}
+		else
+		{	xLen = cmd->len;
+			yLen = shortLen;
+		}
+		cmd->dx = (op & 0x02) ? -(int)xLen : (int)xLen;
+		cmd->dy = (op & 0x01) ? -(int)yLen : (int)yLen;
+	}
+	else
+	{
+		if (op & zbSHORT)
+			cmd->len = bfr[ii];
+
+		else
+			cmd->len = ((uint)(bfr[ii] & 0x0F) << 8) | bfr[ii + 1];
+
+		// horizontal, vertical or 45 degrees
+
+		if ((op & (zbHZVT | zbVERT)) == zbHZVT)
+			cmd->dx = (op & 0x01) ? -(int)cmd->len : (int)cmd->len;
+
+		else if (op & zbHZVT)
+			cmd->dy = (op & 0x01) ? -(int)cmd->len : (int)cmd->len;
+
+		else
+		{	cmd->dx = (op & 0x02) ? -(int)cmd->len : (int)cmd->len;
+			cmd->dy = (op & 0x01) ? -(int)cmd->len : (int)cmd->len;
+		}
+	}
+	return (size);
+}
+
+/*****************************************************************************
+* Clear the raster to black.
+*****************************************************************************/
+void zvgEmuClearRaster( ZvgEmu_s *emu)
+{
+	if (emu->raster != NULL)
+		memset( emu->raster, 0, emu->cfg.width * emu->cfg.height * 3);
+
+	emu->clearPend = zFalse;
+}
+
+/*****************************************************************************
+* Map a ZVG position to raster coordinates.  The result may be outside of
+* the raster.
+*****************************************************************************/
+static void toRaster( ZvgEmu_s *emu, int xx, int yy, int *px, int *py)
+{
+	*px = (int)(((long)(xx - EMU_X_MIN) * (long)emu->cfg.width) / (EMU_X_MAX - EMU_X_MIN + 1));
+	*py = (int)(((long)(EMU_Y_MAX - yy) * (long)emu->cfg.height) / (EMU_Y_MAX - EMU_Y_MIN + 1));
+}
+
+/*****************************************************************************
+* Plot one raster pixel, keeping the brightest value of each gun.
+*****************************************************************************/
+static void plot( ZvgEmu_s *emu, int px, int py, const uchar *rgb)
+{
+	uchar	*pp;
+
+	if (px < 0 || py < 0 || px >= (int)emu->cfg.width || py >= (int)emu->cfg.height)
+		return;
+
+	pp = emu->raster + ((uint)py * emu->cfg.width + (uint)px) * 3;
+
+	if (rgb[0] > pp[0])
+		pp[0] = rgb[0];
+
+	if (rgb[1] > pp[1])
+		pp[1] = rgb[1];
+
+	if (rgb[2] > pp[2])
+		pp[2] = rgb[2];
+}
+
+/*****************************************************************************
+* Convert the current 5-6-5 color to 8 bit RGB.
+*****************************************************************************/
+static void toRGB( uint color, uchar *rgb)
+{
+	rgb[0] = (uchar)((((color >> 11) & 0x1F) * 255) / 31);
+	rgb[1] = (uchar)((((color >> 5) & 0x3F) * 255) / 63);
+	rgb[2] = (uchar)(((color & 0x1F) * 255) / 31);
+}
+
+/*****************************************************************************
+* Draw the beam path from one position to another into the raster.
+*****************************************************************************/
+static void drawLine( ZvgEmu_s *emu, int x0, int y0, int x1, int y1)
+{
+	uchar	rgb[3];
+	int		dx, dy, sx, sy, err, e2;
+
+	if (emu->raster == NULL)
+		return;
+
+	if (emu->clearPend)
+		zvgEmuClearRaster( emu);
+
+	toRGB( emu->color, rgb);
+	toRaster( emu, x0, y0, &x0, &y0);
+	toRaster( emu, x1, y1, &x1, &y1);
+
+	dx = abs( x1 - x0);
+	dy = -abs( y1 - y0);
+	sx = x0 < x1 ? 1 : -1;
+	sy = y0 < y1 ? 1 : -1;
+	err = dx + dy;
+
+	while (1)
+	{	plot( emu, x0, y0, rgb);
+
+		if (x0 == x1 && y0 == y1)
+			break;
+
+		e2 = 2 * err;
+
+		if (e2 >= dy)
+		{	err += dy;
+			x0 += sx;
+		}
+
+		if (e2 <= dx)
+		{	err += dx;
+			y0 += sy;
+		}
+	}
+}
+
+/*****************************************************************************
+* Return the length of a move, to the nearest unit.
+*****************************************************************************/
+static uint distance( int dx, int dy)
+{
+	ulong	sq, rr, bit;
+
+	sq = (ulong)((long)dx * dx + (long)dy * dy);
+
+	// integer square root, one bit at a time
+
+	rr = 0;
+	bit = 1UL << 30;
+
+	while (bit > sq)
+		bit >>= 2;
+
+	while (bit != 0)
+	{
+		if (sq >= rr + bit)
+		{	sq -= rr + bit;
+			rr = (rr >> 1) + bit;
+		}
+		else
+			rr >>= 1;
+
+		bit >>= 2;
+	}
+
+	// round up if nearer the next unit
+
+	if (sq > rr)
+		rr++;
+
+	return ((uint)rr);
+}
+
+/*****************************************************************************
+* Move the beam, with the beam off, to a new position.
+*****************************************************************************/
+static void jump( ZvgEmu_s *emu, int xx, int yy)
+{
+	long long int	jumpNs, settleNs;
+	uint			dist;
+
+	dist = distance( xx - emu->xPos, yy - emu->yPos);
+	jumpNs = (long long int)dist * emu->mon.jumpFactor * emu->cfg.jumpNs;
+	settleNs = (long long int)emu->mon.settle * emu->cfg.settleNs;
+
+	emu->cur.drawNs += jumpNs > settleNs ? jumpNs : settleNs;
+	emu->cur.jumpUnits += dist;
+	emu->cur.jumps++;
+	emu->xPos = xx;
+	emu->yPos = yy;
+}
+
+/*****************************************************************************
+* End the current frame.
+*****************************************************************************/
+static void endFrame( ZvgEmu_s *emu)
+{
+	emu->last = emu->cur;
+	memset( &emu->cur, 0, sizeof( ZvgEmuStats_s));
+	emu->frames++;
+
+	if (emu->cfg.flags & EMUF_CLEAR)
+		emu->clearPend = zTrue;
+}
+
+/*****************************************************************************
+* Run an extended command.
+*****************************************************************************/
+static void runExtended( ZvgEmu_s *emu, ZvgEmuCmd_s *cmd)
+{
+	switch (cmd->op)
+	{
+	case zcBLINK:
+		emu->blinks++;
+		break;
+
+	case zcZSHIFT:
+		emu->mon.zShift = cmd->arg;
+		break;
+
+	case zcOSHOOT:
+		emu->mon.oShoot = cmd->arg;
+		break;
+
+	case zcJUMP:
+		emu->mon.jumpFactor = cmd->arg;
+		break;
+
+	case zcSETTLE:
+		emu->mon.settle = cmd->arg;
+		break;
+
+	case zcPOINT_I:
+		emu->mon.point_i = cmd->arg;
+		break;
+
+	case zcMIN_I:
+		emu->mon.min_i = cmd->arg;
+		break;
+
+	case zcMAX_I:
+		emu->mon.max_i = cmd->arg;
+		break;
+
+	case zcSCALE:
+		emu->mon.scale = cmd->arg;
+		break;
+
+	case zcSAVE_EE:
+		emu->eeMon = emu->mon;
+		break;
+
+	case zcLOAD_EE:
+		emu->mon = emu->eeMon;
+		break;
+
+	case zcRESET_MON:
+		unpackMon( &emu->mon, TrDefaultMon);
+		break;
+
+	case zcREAD_MON:
+		packMon( emu->reply, &emu->mon);
+		emu->replyLen = ZVG_MON_SIZE;
+		break;
+
+	case zcREAD_SPD:
+		memcpy( emu->reply, TrDefaultSpd, 4);
+		emu->replyLen = 4;
+		break;
+
+	case zcCENTER:
+		jump( emu, 0, 0);
+		emu->color = zINIT_COLOR;
+		endFrame( emu);
+		break;
+
+	default:									// zcNOP
+		break;
+	}
+}
+
+/*****************************************************************************
+* Run one decoded command.
+*****************************************************************************/
+static void runCmd( ZvgEmu_s *emu, ZvgEmuCmd_s *cmd)
+{
+	int		xEnd, yEnd;
+	uint	dist;
+
+	emu->cur.bytes += cmd->size;
+	emu->cur.cmds++;
+	emu->cur.drawNs += emu->cfg.cmdNs;
+
+	if (cmd->kind == ekExtended)
+	{	runExtended( emu, cmd);
+		return;
+	}
+
+	if (cmd->kind == ekReserved)
+	{	emu->cur.badCmds++;
+		return;
+	}
+
+	if (cmd->hasColor)
+	{	emu->color = cmd->color;
+		emu->cur.colors++;
+	}
+
+	if (cmd->kind == ekPoint)
+	{
+		if (cmd->hasXY)
+			jump( emu, cmd->xx, cmd->yy);
+
+		else
+			jump( emu, emu->xPos + cmd->dx, emu->yPos + cmd->dy);
+
+		emu->cur.drawNs += (long long int)emu->mon.point_i * emu->cfg.pointNs;
+		emu->cur.points++;
+		drawLine( emu, emu->xPos, emu->yPos, emu->xPos, emu->yPos);
+		return;
+	}
+
+	// vector, jump to the start if one is given
+
+	if (cmd->hasXY)
+		jump( emu, cmd->xx, cmd->yy);
+
+	xEnd = emu->xPos + cmd->dx;
+	yEnd = emu->yPos + cmd->dy;
+	dist = distance( cmd->dx, cmd->dy);
+
+	emu->cur.drawNs += ((long long int)dist * emu->cfg.usPerInch * 1000) / emu->cfg.unitsPerInch;
+	emu->cur.drawUnits += dist;
+	emu->cur.vectors++;
+	drawLine( emu, emu->xPos, emu->yPos, xEnd, yEnd);
+	emu->xPos = xEnd;
+	emu->yPos = yEnd;
+}
+
+/*****************************************************************************
+* Send bytes to the emulator.
+*
+* Commands are run as soon as EMU_LOOKAHEAD bytes are waiting, the rest are
+* held until more bytes are sent.
+*
+* Called with:
+*    emu   = Emulator.
+*    mem   = Bytes to send.
+*    count = Number of bytes.
+*****************************************************************************/
+void zvgEmuFeed( ZvgEmu_s *emu, const uchar *mem, uint count)
+{
+	ZvgEmuCmd_s	cmd;
+	uint		room, size;
+
+	while (count > 0)
+	{
+		// move waiting bytes to the front, and fill up the buffer
+
+		if (emu->qHead > 0)
+		{	memmove( emu->queue, emu->queue + emu->qHead, emu->qCount);
+			emu->qHead = 0;
+		}
+
+		room = EMU_QUEUE_SZ - emu->qCount;
+
+		if (room > count)
+			room = count;
+
+		memcpy( emu->queue + emu->qCount, mem, room);
+		emu->qCount += room;
+		mem += room;
+		count -= room;
+
+		// run commands while the look ahead is full
+
+		while (emu->qCount >= EMU_LOOKAHEAD)
+		{	size = zvgEmuDecode( emu->queue + emu->qHead, emu->qCount, &cmd);
+			runCmd( emu, &cmd);
+			emu->qHead += size;
+			emu->qCount -= size;
+		}
+	}
+}
+
+/*****************************************************************************
+* Estimate the draw time of a frame from its counters, without running it.
+*
+* Used where only totals are known, such as the encoder's counters.  Each
+* jump is taken as the longer of the settle time and the average jump, so
+* the estimate is a little short when jump lengths vary widely.
+*
+* Called with:
+*    cfg   = Timing model.
+*    mon   = Monitor settings, for 'settle', 'jumpFactor' and 'point_i'.
+*    stats = Counters of the frame, 'bytes', 'colors', 'badCmds' and
+*            'drawNs' are not used.
+*
+* Returns:
+*    Draw time, in nanoseconds.
+*****************************************************************************/
+long long int zvgEmuEstimate( const ZvgEmuCfg_s *cfg, const ZvgMon_s *mon,
+		const ZvgEmuStats_s *stats)
+{
+	long long int	drawNs, jumpNs, settleNs;
+	uint			unitsPerInch;
+
+	unitsPerInch = cfg->unitsPerInch != 0 ? cfg->unitsPerInch : EMU_UNITS_INCH;
+
+	drawNs = (long long int)stats->cmds * cfg->cmdNs;
+	drawNs += ((long long int)stats->drawUnits * cfg->usPerInch * 1000) / unitsPerInch;
+	drawNs += (long long int)stats->points * mon->point_i * cfg->pointNs;
+
+	jumpNs = (long long int)stats->jumpUnits * mon->jumpFactor * cfg->jumpNs;
+	settleNs = (long long int)stats->jumps * mon->settle * cfg->settleNs;
+
+	drawNs += jumpNs > settleNs ? jumpNs : settleNs;
+	return (drawNs);
+}
+
+/*****************************************************************************
+* Save the raster as a binary PPM file.
+*
+* Returns:
+*    errOk      - File written.
+*    errEmuSave - No raster, or the file could not be written.
+*****************************************************************************/
+uint zvgEmuSavePPM( ZvgEmu_s *emu, const char *name)
+{
+	FILE	*fp;
+	uint	size;
+	bool	ok;
+
+	if (emu->raster == NULL)
+		return (errEmuSave);
+
+	fp = fopen( name, "wb");
+
+	if (fp == NULL)
+		return (errEmuSave);
+
+	size = emu->cfg.width * emu->cfg.height * 3;
+	fprintf( fp, "P6\n%u %u\n255\n", emu->cfg.width, emu->cfg.height);
+	ok = fwrite( emu->raster, 1, size, fp) == size;
+
+	if (fclose( fp) != 0)
+		ok = zFalse;
+
+	return (ok ? errOk : errEmuSave);
+}
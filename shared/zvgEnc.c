@@ -5,6 +5,16 @@
 * Created: 11/06/02
 *
 * History:
+*   10/18/26
+*      Count vectors, clipping, points, spotkill dots, padding, jumps and
+*      commands by form, in 'ZvgENC.stats'.  Count the length of vectors
+*      and the number of jumps, for the draw time estimate.
+*
+*      The encoder state is kept per board, see 'zvgBoard.c'.
+*
+*      Added 'zvgEncForget()', for commands encoded to be sent after any
+*      others, see 'zvgLayer.c'.
+*
 *   07/02/03
 *      Moved spot kill logic here.  Added 'zvgSOF()' to allow start a frame
 *      with spot kill dots if needed.  Changed the spotkill algorith one
@@ -35,6 +45,7 @@
 * (c) Copyright 2002-2004, Zektor, LLC.  All Rights Reserved.
 *****************************************************************************/
 #include	<stdlib.h>
+#include	<string.h>
 //#include	<emu.h>
 #include	"zstddef.h"
 #include	"zvgCmds.h"
@@ -43,6 +54,10 @@
 
 // Defines for sending command bytes to buffer
 
+#define	sendCmd( cmd) \
+	ZvgENC.stats.cmds[(cmd) >> ENC_FORM_SHIFT]++, \
+	ZvgENC.encBfr[ZvgENC.encCount++] = (uchar)(cmd)
+
 #define	sendColor( color) \
 	ZvgENC.encBfr[ZvgENC.encCount++] = (uchar)(color >> 8), \
 	ZvgENC.encBfr[ZvgENC.encCount++] = (uchar)color
@@ -80,7 +95,7 @@
 	   if (yy > ZvgENC.yMaxSpot) ZvgENC.yMaxSpot = yy; \
 	}
 
-ZvgEnc_s		ZvgENC;					// Encoder information structure
+ZvgEnc_s		ZvgBoardENC[ZVG_BOARDS];	// Encoder information structure of each board
 
 /*****************************************************************************
 * This routine does one iteration of line clipping and is part of the
@@ -221,6 +236,31 @@ void zvgEncReset( void)
 	ZvgENC.yMinSpot = 0;
 	ZvgENC.xMaxSpot = 0;
 	ZvgENC.yMaxSpot = 0;
+
+	zvgEncClearStats();
+}
+
+/*****************************************************************************
+* Clear the encoder counters.  Called by the frame routines after each frame.
+*****************************************************************************/
+void zvgEncClearStats( void)
+{
+	memset( &ZvgENC.stats, 0, sizeof( ZvgEncStats_s));
+}
+
+/*****************************************************************************
+* Forget the trace position and the color the ZVG is using.
+*
+* The next vector or point is sent with its start position and its color,
+* so the commands encoded from here on may be sent after any others.  The
+* move to its start isn't counted as a jump, since where it moves from is
+* only known when the commands are sent.  The start is kept in
+* 'ZvgENC.xFirst' and 'ZvgENC.yFirst'.  See 'zvgLayer.c'.
+*****************************************************************************/
+void zvgEncForget( void)
+{
+	ZvgENC.encFlags |= ENCF_NOPOS;
+	ZvgENC.zColor = ENC_NO_COLOR;
 }
 
 /*****************************************************************************
@@ -281,6 +321,8 @@ void	zvgEncEOF( void)
 	// command buffer.  Add 8 NOPs to end of frame so that last few vectors
 	// are processed for this frame.
 
+	ZvgENC.stats.padBytes += 8;
+
 	ZvgENC.encBfr[ZvgENC.encCount++] = zcNOP;
 	ZvgENC.encBfr[ZvgENC.encCount++] = zcNOP;
 	ZvgENC.encBfr[ZvgENC.encCount++] = zcNOP;
@@ -487,12 +529,26 @@ static void _zvgEncPoint_( int xStart, int yStart, uint color)
 		yLen = yStart - ZvgENC.yPos;	// get length of Y axis
 	}
 
+	// a point is a move with the beam off, unless the position is unknown,
+	// see 'zvgEncForget()', then it is sent where it is
+
+	if (ZvgENC.encFlags & ENCF_NOPOS)
+	{	ZvgENC.encFlags &= ~ENCF_NOPOS;
+		ZvgENC.xFirst = xStart;
+		ZvgENC.yFirst = yStart;
+		zvgCmd |= zbABS;
+	}
+	else
+	{	ZvgENC.stats.jumpUnits += xLen > yLen ? xLen : yLen;
+		ZvgENC.stats.jumps++;
+	}
+
 	// Check if NOT a 45 or 90 degree jump.  If it is a 45 or 90
 	// degree angle from current position, or distance is less
 	// than 128 points, then fall through to send relative command,
 	// otherwise send an absolute position commmand and return.
 
-	if (xLen != 0 && yLen != 0 && xLen != yLen)
+	if (!(zvgCmd & zbABS) && xLen != 0 && yLen != 0 && xLen != yLen)
 	{
 		// if jump is not 45 or 90 degree, then check length
 		// start by finding largest length
@@ -509,21 +565,21 @@ static void _zvgEncPoint_( int xStart, int yStart, uint color)
 		// to digest
 
 		if (len > 127)
-		{
 			zvgCmd |= zbABS;				// indicate absolute positioning
+	}
 
-			ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd;
+	if (zvgCmd & zbABS)
+	{	sendCmd( zvgCmd);
 
-			if (zvgCmd & zbCOLOR)
-				sendColor( color);
+		if (zvgCmd & zbCOLOR)
+			sendColor( color);
 
-			sendXY( xStart, yStart);	// send POINT position
+		sendXY( xStart, yStart);		// send POINT position
 
-			ZvgENC.xPos = xStart;		// save new position
-			ZvgENC.yPos = yStart;
-			ZvgENC.zColor = color;		// update color
-			return;							// done sending point, return
-		}
+		ZvgENC.xPos = xStart;			// save new position
+		ZvgENC.yPos = yStart;
+		ZvgENC.zColor = color;			// update color
+		return;								// done sending point, return
 	}
 
 	// If not absolute, draw a point relative to last end position
@@ -539,7 +595,7 @@ static void _zvgEncPoint_( int xStart, int yStart, uint color)
 
 		// send ZVG command, and direction
 
-		ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | (xSign << 1) | ySign;
+		sendCmd( zvgCmd | (xSign << 1) | ySign);
 
 		if (zvgCmd & zbCOLOR)
 			sendColor( color);
@@ -566,7 +622,7 @@ static void _zvgEncPoint_( int xStart, int yStart, uint color)
 
 		// send command
 
-		ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | zbHZVT | xSign;
+		sendCmd( zvgCmd | zbHZVT | xSign);
 
 		// send color if needed
 
@@ -593,7 +649,7 @@ static void _zvgEncPoint_( int xStart, int yStart, uint color)
 
 		// send command
 
-		ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | zbHZVT | zbVERT | ySign;
+		sendCmd( zvgCmd | zbHZVT | zbVERT | ySign);
 
 		// send color if needed
 
@@ -626,7 +682,7 @@ static void _zvgEncPoint_( int xStart, int yStart, uint color)
 
 			// send command
 
-			ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | (xSign << 1) | ySign;
+			sendCmd( zvgCmd | (xSign << 1) | ySign);
 
 			// calculate integer ratio
 
@@ -657,7 +713,7 @@ static void _zvgEncPoint_( int xStart, int yStart, uint color)
 
 			// send command
 
-			ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | zbYLEN | (xSign << 1) | ySign;
+			sendCmd( zvgCmd | zbYLEN | (xSign << 1) | ySign);
 
 			// calculate ratio
 
@@ -702,6 +758,8 @@ static void _zvgEncPoint_( int xStart, int yStart, uint color)
 *****************************************************************************/
 static void zvgEncPointSK( int xStart, int yStart, uint color)
 {
+	ZvgENC.stats.points++;
+
 	// do spotkill check if needed
 
 	if (ZvgENC.encFlags & ENCF_SPOTKILL)
@@ -767,8 +825,10 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 	uint	xSign, ySign, vRatio;
 	uint	zvgCmd;
 	int	diff;
+	int	xOrg, yOrg;
 
 	ZvgENC.vecCount++;						// count number of vectors
+	ZvgENC.stats.vectors++;
 
 	// check for axis flips
 
@@ -782,6 +842,11 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 		yEnd = ~yEnd;
 	}
 
+	// keep the length before clipping, to count clipped vectors
+
+	xOrg = xEnd - xStart;
+	yOrg = yEnd - yStart;
+
 	// Check if NOT a point, vertical or horizontal line, then
 	// clip the line the old fashion way.
 
@@ -807,7 +872,11 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 		if (yStart > ZvgENC.yMaxClip)
 			return;								// do nothing if outside window
 
-		// encode data point
+		// encode data point, it may have been a vector clipped to a point
+
+		if (xOrg != 0 || yOrg != 0)
+			ZvgENC.stats.clipped++;
+
 		zvgEncPointSK( xStart, yStart, ZvgENC.encColor);
 		return;
 	}
@@ -824,7 +893,7 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 	// Check to see if start of this vector is same as current trace position
 	// (if start point is the same a previous, then it does not need to be clipped)
 
-	if (xStart != ZvgENC.xPos || yStart != ZvgENC.yPos)
+	if (xStart != ZvgENC.xPos || yStart != ZvgENC.yPos || (ZvgENC.encFlags & ENCF_NOPOS))
 		zvgCmd |= zbABS;						// if not, the starting points must be sent
 
 	// get direction of X and Y axis, and their respective lengths
@@ -913,7 +982,8 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 		// check if vector clipped to a point, if so, encode point
 
 		if (xLen == 0)
-		{	zvgEncPointSK( xStart, yStart, ZvgENC.encColor);
+		{	ZvgENC.stats.clipped++;
+			zvgEncPointSK( xStart, yStart, ZvgENC.encColor);
 			return;						// done sending point, return
 		}
 
@@ -931,7 +1001,7 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 
 		// send command
 
-		ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | zbHZVT | xSign;
+		sendCmd( zvgCmd | zbHZVT | xSign);
 
 		// send color if needed
 
@@ -1018,7 +1088,8 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 		// check if vector clipped to a point, if so, encode point
 
 		if (yLen == 0)
-		{	zvgEncPointSK( xStart, yStart, ZvgENC.encColor);
+		{	ZvgENC.stats.clipped++;
+			zvgEncPointSK( xStart, yStart, ZvgENC.encColor);
 			return;						// done sending point, return
 		}
 
@@ -1036,7 +1107,7 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 
 		// send command
 
-		ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | zbHZVT | zbVERT | ySign;
+		sendCmd( zvgCmd | zbHZVT | zbVERT | ySign);
 
 		// send color if needed
 
@@ -1078,7 +1149,7 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 
 		// send ZVG command, and direction
 
-		ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | (xSign << 1) | ySign;
+		sendCmd( zvgCmd | (xSign << 1) | ySign);
 
 		if (zvgCmd & zbCOLOR)
 			sendColor( ZvgENC.encColor);
@@ -1129,7 +1200,7 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 
 			// send command
 
-			ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | (xSign << 1) | ySign;
+			sendCmd( zvgCmd | (xSign << 1) | ySign);
 
 			// send color if needed
 		
@@ -1165,7 +1236,7 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 
 			// send command
 
-			ZvgENC.encBfr[ZvgENC.encCount++] = zvgCmd | zbYLEN | (xSign << 1) | ySign;
+			sendCmd( zvgCmd | zbYLEN | (xSign << 1) | ySign);
 
 			// send color if needed
 		
@@ -1186,6 +1257,29 @@ void zvgEnc( int xStart, int yStart, int xEnd, int yEnd)
 				sendRatioLen12( vRatio, yLen);
 		}
 	}
+	// count the vector, and the jump to its start
+
+	ZvgENC.stats.drawn++;
+
+	if (xEnd - xStart != xOrg || yEnd - yStart != yOrg)
+		ZvgENC.stats.clipped++;
+
+	xLen = abs( xEnd - xStart);
+	yLen = abs( yEnd - yStart);
+	ZvgENC.stats.drawUnits += xLen > yLen ? xLen : yLen;
+
+	if (ZvgENC.encFlags & ENCF_NOPOS)
+	{	ZvgENC.encFlags &= ~ENCF_NOPOS;
+		ZvgENC.xFirst = xStart;
+		ZvgENC.yFirst = yStart;
+	}
+	else if (zvgCmd & zbABS)
+	{	xLen = abs( xStart - ZvgENC.xPos);
+		yLen = abs( yStart - ZvgENC.yPos);
+		ZvgENC.stats.jumpUnits += xLen > yLen ? xLen : yLen;
+		ZvgENC.stats.jumps++;
+	}
+
 	ZvgENC.xPos = xEnd;						// new position is end of vector
 	ZvgENC.yPos = yEnd;
 	ZvgENC.zColor = ZvgENC.encColor;		// save new color
@@ -1227,6 +1321,7 @@ void	zvgEncSOF( void)
 		if (skFlag)
 		{	zvgEncPointFL( X_SK_MAXP, Y_SK_MINP, SK_COLOR);
 			zvgEncPointFL( X_SK_MINP, Y_SK_MAXP, SK_COLOR);
+			ZvgENC.stats.skDots += 2;
 		}
 
 		// Re-init deflection variables
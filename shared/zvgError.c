@@ -65,8 +65,10 @@ void zvgError( uint err)
 		break;
 
 	case errNoPort:
-		fputs( "No PORT address specified in the 'ZVGPORT=' environment variable!\n", stdout);
-		fputs( "     'ZVGPORT=' must include a 'Pxxx', port parameter.", stdout);
+		fputs( "No PORT address specified in the 'ZVGPORT=' environment variable, and\n", stdout);
+		fputs( "     no ZVG was found on the parallel ports. Give the port with a 'Pxxx'\n", stdout);
+		fputs( "     parameter in 'ZVGPORT=', or a transport with 'Tname'.", stdout);
+
 		break;
 
 	case errNotEcp:
@@ -169,6 +171,143 @@ void zvgError( uint err)
 		fputs( "Program must run as root to allow parallel port access!", stdout);
 		break;
 
+	case errEnvRT:
+		fputs( "Real-time priority given in 'ZVGPORT=' environment variable is invalid.\n", stdout);
+		fputs( "     Fix priority parameter 'Rxx' (0-99), in 'ZVGPORT='.", stdout);
+		break;
+
+	case errEnvCPU:
+		fputs( "CPU number given in 'ZVGPORT=' environment variable is invalid.\n", stdout);
+		fputs( "     Fix CPU parameter 'Cx', in 'ZVGPORT='.", stdout);
+		break;
+
+	case errEnvWait:
+		fputs( "Wait policy given in 'ZVGPORT=' environment variable is invalid.\n", stdout);
+		fputs( "     Fix wait parameter 'Wx' (0-3), in 'ZVGPORT='.", stdout);
+		break;
+
+	case errEnvTrans:
+		fputs( "Transport given in 'ZVGPORT=' environment variable is invalid.\n", stdout);
+		fputs( "     Fix transport parameter 'Tname[:arg]', in 'ZVGPORT='. Use one of\n", stdout);
+		fputs( "     direct, ppdev[:device], null, mem, file:path, sim or emu[:image].", stdout);
+		break;
+
+	case errTransOpen:
+		fputs( "Could not open the ZVG transport device or file. Verify it exists\n", stdout);
+		fputs( "     and that you have permission to read and write it.", stdout);
+		break;
+
+	case errEmuSave:
+		fputs( "Could not save the emulator image.", stdout);
+		break;
+
+	case errCapOpen:
+		fputs( "Could not open or create the capture file. Verify the name given\n", stdout);
+		fputs( "     by 'Fpath' in 'ZVGPORT=' and that you have permission to use it.", stdout);
+		break;
+
+	case errCapWrite:
+		fputs( "Could not write to the capture file, capture has been stopped.", stdout);
+		break;
+
+	case errCapBad:
+		fputs( "File is not a ZVG capture file, or was made by another version.", stdout);
+		break;
+
+	case errCapRange:
+		fputs( "Frame asked for is not in the capture file.", stdout);
+		break;
+
+	case errTraceOpen:
+		fputs( "Could not write the trace file. Verify the name given by 'Epath'\n", stdout);
+		fputs( "     in 'ZVGPORT=' and that you have permission to use it.", stdout);
+		break;
+
+	case errShmOpen:
+		fputs( "Could not create or open the shared memory stats segment. Verify the\n", stdout);
+		fputs( "     name given by 'Sname' in 'ZVGPORT=', and that it isn't in use.", stdout);
+		break;
+
+	case errShmBad:
+		fputs( "Shared memory segment is not a ZVG stats segment, or was made by\n", stdout);
+		fputs( "     another version of the ZVG drivers.", stdout);
+		break;
+
+	case errShmBusy:
+		fputs( "Shared memory stats segment is never finished being written, the\n", stdout);
+		fputs( "     program writing it may have stopped.", stdout);
+		break;
+
+	case errCacheOpen:
+		fputs( "Could not read or write the ZVG's device info cache file.", stdout);
+		break;
+
+	case errCacheBad:
+		fputs( "File is not a ZVG device info cache file, or was made by another\n", stdout);
+		fputs( "     version of the ZVG drivers.", stdout);
+		break;
+
+	case errOpenBusy:
+		fputs( "The ZVG is still being opened, see 'zvgFrameOpenAsync()'.", stdout);
+		break;
+
+	case errLinkDown:
+		fputs( "The link to the ZVG was lost, and is being recovered.", stdout);
+		break;
+
+	case errReadPending:
+		fputs( "The read asked of the ZVG hasn't come back yet, see 'zvgReadbackPoll()'.", stdout);
+		break;
+
+	case errCtlBad:
+		fputs( "Control command or register not known, see 'zvgCtl.h'.", stdout);
+		break;
+
+	case errBoardBad:
+		fputs( "Board number not valid, or board not open, see 'zvgBoard.h'.", stdout);
+		break;
+
+	case errServConnect:
+		fputs( "Could not connect to 'zvgd'. Check it is running, and the socket\n", stdout);
+		fputs( "     in 'ZVGD_SOCKET=' if one is given.", stdout);
+		break;
+
+	case errServRefused:
+		fputs( "'zvgd' refused the client, the board isn't open or it has too many.", stdout);
+		break;
+
+	case errServLost:
+		fputs( "The connection to 'zvgd' was lost.", stdout);
+		break;
+
+	case errNetAddr:
+		fputs( "The address given to the 'net' transport is invalid, or wasn't found.\n", stdout);
+		fputs( "     Use 'Tnet:[udp:]host[:port]' in 'ZVGPORT='.", stdout);
+		break;
+
+	case errNetConnect:
+		fputs( "Could not connect to the 'net' address, or listen on it. Check the\n", stdout);
+		fputs( "     receiver ('zvgRecv') is running.", stdout);
+		break;
+
+	case errLayerName:
+		fputs( "The layer name is empty, too long, or already used.", stdout);
+		break;
+
+	case errLayerFull:
+		fputs( "No more layers can be opened on this board.", stdout);
+		break;
+
+	case errShmInUse:
+		fputs( "Shared memory stats segment is in use by another program that is\n", stdout);
+		fputs( "     running. Give it another name with 'Sname' in 'ZVGPORT='.", stdout);
+		break;
+
+	case errEnvLink:
+		fputs( "Link recovery given in 'ZVGPORT=' environment variable is invalid.\n", stdout);
+		fputs( "     Fix link parameter 'Lx' (0 or 1), in 'ZVGPORT='.", stdout);
+		break;
+
 	case errUnknownID:
 		fputs( "Unrecognized version string returned from the ZVG. Verify the ECP\n", stdout);
 		fputs( "     at the port address given in the 'ZVGPORT=' environment variable\n", stdout);
@@ -5,6 +5,36 @@
 * Created:      05/20/03
 *
 * History:
+*    10/18/26
+*       Count the vectors in each frame, kept with the frame if it is
+*       captured, see 'zvgCap.c'.
+*
+*       Added 'zvgFrameGetStats()', the encoder and port counters of the
+*       last frame and totals.
+*
+*       Encoding a frame and 'zvgFrameSend()' are recorded when tracing,
+*       see 'zvgTrace.c'.
+*
+*       Estimate each frame's draw time, and count frames sent late.  The
+*       counters are published to the shared memory stats segment, if one
+*       is open, see 'zvgShm.c'.
+*
+*       The monitor settings and speed table are taken from the port's
+*       cache file when the ZVG's ID is unchanged, see 'zvgCache.c'.  Added
+*       'zvgFrameOpenAsync()', which reads from the ZVG in the background.
+*
+*       The monitor settings are sent again after a lost link is recovered,
+*       see 'zvgLink.c'.  Frames dropped while it was down are counted.
+*
+*       Control commands waiting in the queue are sent after each frame's
+*       last vector, see 'zvgCtl.c'.
+*
+*       The counters, encode buffer and open state are kept per board, see
+*       'zvgBoard.c'.
+*
+*       Vectors drawn while a layer is begun go to the layer, and the
+*       layers are sent after the frame's own vectors, see 'zvgLayer.c'.
+*
 *    07/02/03
 *       Moved spotkiller logic to zvgEnc.c. Added calls to 'zvgSOF()' to
 *       handle spotkiller.
@@ -33,23 +63,169 @@
 * (c) Copyright 2003-2004, Zektor, LLC.  All Rights Reserved.
 *****************************************************************************/
 
+#include	<pthread.h>
+#include	<stdint.h>
+#include	<string.h>
+
 #include	"zstddef.h"
 #include	"zvgPort.h"
 #include	"zvgEnc.h"
+#include	"zvgCache.h"
+#include	"zvgCap.h"
+#include	"zvgCtl.h"
+#include	"zvgEmu.h"
+#include	"zvgFrame.h"
+#include	"zvgLayer.h"
+#include	"zvgLink.h"
+#include	"zvgShm.h"
+#include	"zvgTrace.h"
 //#include	"zvgError.h"
 
 #define	MAME										// if set, indicate this compile is to be used with MAME
 
-// Allocate a small encode buffer used to buffer commands generated by the
-// ZVG encoder.
+// Keep track of status information returned from each ZVG
+
+ZvgSpeeds_a	ZvgBoardSpeeds[ZVG_BOARDS];
+ZvgMon_s	ZvgBoardMon[ZVG_BOARDS];
+ZvgID_s		ZvgBoardID[ZVG_BOARDS];
+
+// State of each board
+
+typedef struct FRAMEBOARD_S
+{
+	// Allocate a small encode buffer used to buffer commands generated by the
+	// ZVG encoder.
+
+	uchar			encodeBfr[zENC_CMD_SIZE*10];
+
+	// Counters of the last frame sent, and totals
+
+	ZvgFrameStats_s	last;
+	ZvgFrameStats_s	total;
+	long long int	encNs;			// encode time of the current frame
+	uint			calls;			// calls to 'zvgFrameVector()', for sampling
+	bool			traced;			// the encode of this frame is being traced
+	long long int	sentNs;			// time the last frame was sent, 0 if none
+	ZvgEmuCfg_s		model;			// timing model for the draw time estimate
+
+	// State of 'zvgFrameOpenAsync()'
+
+	pthread_t		openThread;
+	bool			openBusy;		// reads started, and not yet waited for
+	int				openDone;		// set by the thread when the reads are finished
+	uint			openErr;		// error returned by the reads
+} FrameBoard_s;
+
+static FrameBoard_s		FrameBoards[ZVG_BOARDS];
+
+#define	Frame		(FrameBoards[ZvgCurBoard])		// the current board's
+
+/*****************************************************************************
+* Read the ZVG's ID, monitor settings and speed table.
+*
+* If the port's cache file holds the same ID, the monitor settings and
+* speeds are taken from it, and only the ID is read.  Otherwise they are
+* read from the ZVG, and the cache file is written.  See 'zvgCache.c'.
+*
+* Returns:
+*    errCode
+*****************************************************************************/
+static uint frameReadInfo( void)
+{
+	ZvgCache_s	cache;
+	uint		err;
+
+	// control commands from before are forgotten, and 'ZvgMon' is unknown
+	// until read
+
+	zvgCtlReset();
+
+	// read IEEE version information data from ZVG
+
+	memset( &ZvgID, 0, sizeof( ZvgID));
+	err = zvgReadDeviceID( &ZvgID);
+
+	if (err)
+		return (err);
+
+	// use the cache if it's from the same ZVG.  Another program may have set
+	// the registers since the file was written, so the control commands
+	// don't take 'ZvgMon' as the ZVG's, and send every setting.
+
+	if (!ZvgIO.cacheOff && zvgCacheLoad( &cache) == errOk && zvgCacheSameID( &cache.id, &ZvgID))
+	{	ZvgMon = cache.mon;
+		memcpy( ZvgSpeeds, cache.speeds, sizeof( ZvgSpeeds));
+		ZvgIO.cacheUsed = zTrue;
+		return (errOk);
+	}
+
+	// read Monitor setup information from ZVG
+
+	err = zvgReadMonitorInfo( &ZvgMon);
+
+	// read Speed table information for ZVG
+
+	if (!err)
+		err = zvgReadSpeedInfo( ZvgSpeeds);
+
+	// a cache file that can't be written only costs time on the next open
+
+	if (!err && !ZvgIO.cacheOff)
+		zvgCacheSave( &ZvgID, &ZvgMon, ZvgSpeeds);
+
+	// control commands compare settings with 'ZvgMon' from now on
+
+	if (!err)
+		zvgCtlSync();
+
+	return (err);
+}
+
+/*****************************************************************************
+* Reset the ZVG encoder, and set it up for the monitor given in 'ZVGPORT='.
+*****************************************************************************/
+static void frameSetup( void)
+{
+	zvgEncReset();							// reset ZVG encoder
+	zvgEncSetPtr( Frame.encodeBfr);					// point to local encode buffer
+
+	// move monitor flags from environment variable to encoder flags
+
+	if (ZvgIO.envMonitor & MONF_FLIPX)
+		ZvgENC.encFlags |= ENCF_FLIPX;
 
-uchar			EncodeBfr[zENC_CMD_SIZE*10];
+	if (ZvgIO.envMonitor & MONF_FLIPY)
+		ZvgENC.encFlags |= ENCF_FLIPY;
 
-// Keep track of status information returned from the ZVG
+	if (ZvgIO.envMonitor & MONF_SPOTKILL)
+		ZvgENC.encFlags |= ENCF_SPOTKILL;
 
-ZvgSpeeds_a	ZvgSpeeds;
-ZvgMon_s	ZvgMon;
-ZvgID_s		ZvgID;
+	if (ZvgIO.envMonitor & MONF_BW)
+		ZvgENC.encFlags |= ENCF_BW;
+
+	if (ZvgIO.envMonitor & MONF_NOOVS)
+	{	ZvgENC.encFlags |= ENCF_NOOVS;
+		zvgEncSetClipNoOverscan();
+	}
+
+	// send these settings again if the link is lost and recovered
+
+	zvgLinkSetMonitor( &ZvgMon);
+	zvgFrameClearStats();
+}
+
+/*****************************************************************************
+* Setup the draw time estimate, once the speed table has been read.
+*****************************************************************************/
+static void frameModel( void)
+{
+	// estimate draw times at the fastest speed the ZVG reported
+
+	zvgEmuDefaults( &Frame.model);
+
+	if (ZvgSpeeds[0] != 0)
+		Frame.model.usPerInch = ZvgSpeeds[0];
+}
 
 /*****************************************************************************
 * Intialize the ZVG, setup DMA buffers, etc.
@@ -63,46 +239,76 @@ uint zvgFrameOpen( void)
 
 	// look for the ZVG
 
+	Frame.openErr = errOk;
 	err = zvgInit();
 
-	// read IEEE version information data from ZVG
+	// read the ZVG's ID, monitor setup and speed table
 
 	if (!err)
-		err = zvgReadDeviceID( &ZvgID);
+		err = frameReadInfo();
 
-	// read Monitor setup information from ZVG
+	// reset the ZVG encoder, point to encoder scratch buffer
 
 	if (!err)
-		err = zvgReadMonitorInfo( &ZvgMon);
+	{	frameSetup();
+		frameModel();
+	}
 
-	// read Speed table information for ZVG
+	if (err)
+		zvgClose();										// if any error occurred, fix everything
 
-	if (!err)
-		err = zvgReadSpeedInfo( ZvgSpeeds);
+	return (err);
+}
 
-	// reset the ZVG encoder, point to encoder scratch buffer
+/*****************************************************************************
+* Thread reading from the ZVG for 'zvgFrameOpenAsync()'.
+*****************************************************************************/
+static void *frameOpenThread( void *arg)
+{
+	ZvgCurBoard = (uint)(uintptr_t)arg;					// the board being opened
 
-	if (!err)
-	{	zvgEncReset();							// reset ZVG encoder
-		zvgEncSetPtr( EncodeBfr);					// point to local encode buffer
+	zvgTraceName( "zvg open");
+	Frame.openErr = frameReadInfo();
+	__atomic_store_n( &Frame.openDone, 1, __ATOMIC_RELEASE);
+	return (NULL);
+}
 
-		// move monitor flags from environment variable to encoder flags
+/*****************************************************************************
+* Intialize the ZVG, but read its ID, monitor settings and speed table in
+* the background.
+*
+* The port is opened and the encoder setup before returning, so the caller
+* can go on with its own startup, and encode the first frame, while the
+* reads finish.  Until 'zvgFrameOpenWait()' says the open is finished, only
+* 'zvgFrameVector()' and the encoder's calls may be used.  'zvgFrameSend()'
+* waits for the open to finish before sending.  'ZvgID', 'ZvgMon' and
+* 'ZvgSpeeds' are not valid until then.
+*
+* If a thread can't be started, everything is read before returning, as
+* 'zvgFrameOpen()' does.
+*
+* Returns:
+*    errCode
+*****************************************************************************/
+uint zvgFrameOpenAsync( void)
+{
+	uint	err;
 
-		if (ZvgIO.envMonitor & MONF_FLIPX)
-			ZvgENC.encFlags |= ENCF_FLIPX;
+	Frame.openErr = errOk;
+	err = zvgInit();
 
-		if (ZvgIO.envMonitor & MONF_FLIPY)
-			ZvgENC.encFlags |= ENCF_FLIPY;
+	if (!err)
+	{	frameSetup();
 
-		if (ZvgIO.envMonitor & MONF_SPOTKILL)
-			ZvgENC.encFlags |= ENCF_SPOTKILL;
+		Frame.openDone = 0;
+		Frame.openBusy = zTrue;
 
-		if (ZvgIO.envMonitor & MONF_BW)
-			ZvgENC.encFlags |= ENCF_BW;
+		if (pthread_create( &Frame.openThread, NULL, frameOpenThread, (void *)(uintptr_t)ZvgCurBoard) != 0)
+		{	Frame.openBusy = zFalse;
+			err = frameReadInfo();
 
-		if (ZvgIO.envMonitor & MONF_NOOVS)
-		{	ZvgENC.encFlags |= ENCF_NOOVS;
-			zvgEncSetClipNoOverscan();
+			if (!err)
+				frameModel();
 		}
 	}
 
@@ -112,14 +318,75 @@ uint zvgFrameOpen( void)
 	return (err);
 }
 
+/*****************************************************************************
+* Check on, or wait for, an open started by 'zvgFrameOpenAsync()'.
+*
+* If the reads failed, the ZVG is closed, as 'zvgFrameOpen()' would have.
+*
+* Called with:
+*    wait = zTrue to wait for the open to finish, zFalse to only check.
+*
+* Returns:
+*    errOk       - Open finished, or 'zvgFrameOpenAsync()' wasn't used.
+*    errOpenBusy - Not finished yet, and 'wait' was zFalse.
+*    Any other   - Error reading from the ZVG.
+*****************************************************************************/
+uint zvgFrameOpenWait( bool wait)
+{
+	if (!Frame.openBusy)
+		return (Frame.openErr);
+
+	if (!wait && !__atomic_load_n( &Frame.openDone, __ATOMIC_ACQUIRE))
+		return (errOpenBusy);
+
+	pthread_join( Frame.openThread, NULL);
+	Frame.openBusy = zFalse;
+
+	if (Frame.openErr)
+		zvgClose();
+
+	else
+		frameModel();
+
+	return (Frame.openErr);
+}
+
 /*****************************************************************************
 * Setup ZVG for buffered frame use.
 *****************************************************************************/
 void zvgFrameClose( void)
 {
+	// a failed open has already closed everything
+
+	if (zvgFrameOpenWait( zTrue) != errOk)
+		return;
+
 	zvgClose();											// restore everything but the timers
 }
 
+/*****************************************************************************
+* Encode a vector into the DMA buffer, or into the layer being drawn.
+*****************************************************************************/
+static uint frameEncode( int xStart, int yStart, int xEnd, int yEnd)
+{
+	uint	err;
+
+	if (zvgLayerActive())
+		return (zvgLayerVector( xStart, yStart, xEnd, yEnd));
+
+	zvgEnc( xStart, yStart, xEnd, yEnd);
+
+	// move encoded ZVG command into DMA buffer
+
+	err = zvgDmaPutMem( Frame.encodeBfr, zvgEncSize());
+
+	// clear the encode buffer
+
+	zvgEncClearBfr();
+
+	return (err);
+}
+
 /*****************************************************************************
 * Encode and Send a single vector to the DMA buffer.
 *
@@ -144,6 +411,9 @@ void zvgFrameClose( void)
 * The color of the vector must have been previously set by a call to one
 * of the set color routines.
 *
+* Between 'zvgLayerBegin()' and 'zvgLayerEnd()' the vector is drawn into
+* the layer instead, see 'zvgLayer.c'.
+*
 * Called with:
 *    xStart = Starting X position of vector.
 *    yStart = Starting Y position of vector.
@@ -153,34 +423,181 @@ void zvgFrameClose( void)
 *****************************************************************************/
 uint zvgFrameVector( uint xStart, uint yStart, uint xEnd, uint yEnd)
 {
-	uint	err;
+	uint			err;
+	long long int	start;
 
-	// Encoode vector into 'EncodeBfr[]'
+	// the first vector of a frame starts the encode span when tracing
 
-	zvgEnc( xStart, yStart, xEnd, yEnd);
+	if (zvgTraceOn() && !Frame.traced)
+	{	zvgTraceBegin( teEncode, 0);
+		Frame.traced = zTrue;
+	}
 
-	// move encoded ZVG command into DMA buffer
+	// Encoode vector, timing one call in FRAME_ENC_SAMPLE
 
-	err = zvgDmaPutMem( EncodeBfr, zvgEncSize());
+	if ((Frame.calls++ % FRAME_ENC_SAMPLE) == 0)
+	{	start = tmrReadTimer();
+		err = frameEncode( xStart, yStart, xEnd, yEnd);
+		Frame.encNs += (tmrReadTimer() - start) * FRAME_ENC_SAMPLE;
+	}
+	else
+		err = frameEncode( xStart, yStart, xEnd, yEnd);
 
-	// clear the encode buffer
+	return (err);
+}
 
-	zvgEncClearBfr();
+/*****************************************************************************
+* Move the encoder's counters for the frame being sent into 'Frame.last'.
+*****************************************************************************/
+static void frameCount( void)
+{
+	ZvgEncStats_s	*enc;
+	ZvgEmuStats_s	model;
+	long long int	now;
+	uint			ii;
 
-	return (err);
+	enc = &ZvgENC.stats;
+
+	Frame.last.frames = 1;
+	Frame.last.vectors = enc->vectors;
+	Frame.last.drawn = enc->drawn;
+	Frame.last.points = enc->points;
+	Frame.last.clipped = enc->clipped;
+	Frame.last.rejected = enc->vectors - enc->drawn - enc->points;
+
+	for (ii = 0; ii < ENC_FORMS; ii++)
+		Frame.last.cmds[ii] = enc->cmds[ii];
+
+	Frame.last.bytes = ZvgIO.dmaCurCount;
+	Frame.last.padBytes = enc->padBytes;
+	Frame.last.skDots = enc->skDots;
+	Frame.last.drawUnits = enc->drawUnits;
+	Frame.last.jumpUnits = enc->jumpUnits;
+	Frame.last.jumps = enc->jumps;
+	Frame.last.encodeNs = Frame.encNs;
+
+	// estimate the draw time, NOPs are commands too
+
+	memset( &model, 0, sizeof( model));
+	model.cmds = enc->padBytes;
+
+	for (ii = 0; ii < ENC_FORMS; ii++)
+		model.cmds += enc->cmds[ii];
+
+	model.points = enc->points + enc->skDots;
+	model.drawUnits = enc->drawUnits;
+	model.jumpUnits = enc->jumpUnits;
+	model.jumps = enc->jumps;
+	Frame.last.drawNs = zvgEmuEstimate( &Frame.model, &ZvgMon, &model);
+
+	// late if sent more than half a frame after it was due
+
+	now = tmrReadTimer();
+	Frame.last.missed = 0;
+
+	if (Frame.sentNs != 0 && tmrGetTicksInFrame() > 0
+			&& now - Frame.sentNs > tmrGetTicksInFrame() * 3 / 2)
+		Frame.last.missed = 1;
+
+	Frame.sentNs = now;
+
+	zvgEncClearStats();
+	Frame.encNs = 0;
+}
+
+/*****************************************************************************
+* Add the port's counters for the frame just sent, and add the frame to the
+* totals.
+*****************************************************************************/
+static void frameTotal( void)
+{
+	uint	ii;
+
+	Frame.last.sendNs = ZvgIO.rtStats.lastSendNs;
+	Frame.last.fulls = ZvgIO.rtStats.lastFulls;
+	Frame.last.maxStallNs = ZvgIO.rtStats.lastStallNs;
+	Frame.last.dropped = ZvgIO.dmaDropped;
+
+	Frame.total.frames++;
+	Frame.total.vectors += Frame.last.vectors;
+	Frame.total.drawn += Frame.last.drawn;
+	Frame.total.points += Frame.last.points;
+	Frame.total.clipped += Frame.last.clipped;
+	Frame.total.rejected += Frame.last.rejected;
+
+	for (ii = 0; ii < ENC_FORMS; ii++)
+		Frame.total.cmds[ii] += Frame.last.cmds[ii];
+
+	Frame.total.bytes += Frame.last.bytes;
+	Frame.total.padBytes += Frame.last.padBytes;
+	Frame.total.skDots += Frame.last.skDots;
+	Frame.total.drawUnits += Frame.last.drawUnits;
+	Frame.total.jumpUnits += Frame.last.jumpUnits;
+	Frame.total.jumps += Frame.last.jumps;
+	Frame.total.drawNs += Frame.last.drawNs;
+	Frame.total.missed += Frame.last.missed;
+	Frame.total.encodeNs += Frame.last.encodeNs;
+	Frame.total.sendNs += Frame.last.sendNs;
+	Frame.total.fulls += Frame.last.fulls;
+	Frame.total.dropped += Frame.last.dropped;
+
+	if (Frame.last.maxStallNs > Frame.total.maxStallNs)
+		Frame.total.maxStallNs = Frame.last.maxStallNs;
+}
+
+/*****************************************************************************
+* Return the counters of the last frame sent, and the totals.
+*
+* Called with:
+*    last  = Filled in with the last frame's counters, may be NULL.
+*    total = Filled in with the totals, may be NULL.
+*****************************************************************************/
+void zvgFrameGetStats( ZvgFrameStats_s *last, ZvgFrameStats_s *total)
+{
+	if (last != NULL)
+		*last = Frame.last;
+
+	if (total != NULL)
+		*total = Frame.total;
+}
+
+/*****************************************************************************
+* Clear the counters.  Counting starts again with the frame being drawn.
+*****************************************************************************/
+void zvgFrameClearStats( void)
+{
+	memset( &Frame.last, 0, sizeof( Frame.last));
+	memset( &Frame.total, 0, sizeof( Frame.total));
+	Frame.sentNs = 0;
 }
 
 /*****************************************************************************
 * Send the current buffer to the ZVG.
 *****************************************************************************/
-uint zvgFrameSend(void)
+static uint frameSend( void)
 {
-	uint	err;
+	uint			err;
+	ZvgCapStats_s	stats;
+
+	// the layers go after the vectors drawn straight to the frame
+
+	err = zvgLayerFlush();
+
+	if (err)
+		return (err);
+
+	// Send the control commands after the last vector, the end of frame
+	// padding pushes them through
+
+	err = zvgCtlFlush();
+
+	if (err)
+		return (err);
 
 	// Send End of Frame info. (Center Trace, pad ZVG buffer)
 	zvgEncEOF();
 
-	err = zvgDmaPutMem( EncodeBfr, zvgEncSize());
+	err = zvgDmaPutMem( Frame.encodeBfr, zvgEncSize());
 
 	if (err)
 		return (err);
@@ -190,6 +607,13 @@ uint zvgFrameSend(void)
 
 	zvgEncClearBfr();				// Clear the encode buffer
 
+	// hand the frame's counters to the capture, if one is running
+
+	frameCount();
+	stats.vectors = Frame.last.vectors;
+	stats.encFlags = ZvgENC.encFlags;
+	zvgCapSetStats( &stats);
+
 	// Start the DMA transfer of the encoded command in the DMA buffer to
 	// the ZVG.  SCJ: NEED TO DO A "PREV SWAP!", since the "current" buffer will
 	// have bupkis in it due to having no points in the frame!!!
@@ -206,11 +630,18 @@ uint zvgFrameSend(void)
 	if (err)
 		return (err);
 
+	frameTotal();
+
+	// publish the counters, for 'zvgTop'
+
+	if (ZvgIO.shmP != NULL)
+		zvgShmPublish( &Frame.last, &Frame.total);
+
 	// Start next buffer with spot kill stuff if needed
 
 	zvgEncSOF();
 
-	err = zvgDmaPutMem( EncodeBfr, zvgEncSize());
+	err = zvgDmaPutMem( Frame.encodeBfr, zvgEncSize());
 
 	if (err)
 		return (err);
@@ -218,3 +649,36 @@ uint zvgFrameSend(void)
 	zvgEncClearBfr();				// Clear the encode buffer
 	return (errOk);
 }
+
+/*****************************************************************************
+* Send the current buffer to the ZVG, see 'frameSend()' above.
+*
+* Ends the encode span of the frame, if it is being traced.
+*****************************************************************************/
+uint zvgFrameSend(void)
+{
+	uint	err;
+
+	// the first frame waits for 'zvgFrameOpenAsync()' to finish
+
+	if (Frame.openBusy)
+	{	err = zvgFrameOpenWait( zTrue);
+
+		if (err)
+			return (err);
+	}
+
+	// a layer left begun is ended, the frame's own encoder is counted
+
+	zvgLayerEnd();
+
+	if (Frame.traced)
+	{	zvgTraceEnd( teEncode, ZvgENC.stats.vectors);
+		Frame.traced = zFalse;
+	}
+
+	zvgTraceBegin( teFrameSend, 0);
+	err = frameSend();
+	zvgTraceEnd( teFrameSend, err);
+	return (err);
+}
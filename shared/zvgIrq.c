@@ -0,0 +1,311 @@
+/*****************************************************************************
+* Sleeping on the port's interrupt, the WAIT_IRQ policy ('W3').
+*
+* The other wait policies poll the port, spinning and then sleeping between
+* reads, so the thread sending frames keeps waking up while the ZVG draws
+* long vectors with the FIFO full.  On a low power cabinet PC that thread
+* competes with the game for the CPU.
+*
+* An ECP port can interrupt when its FIFO has room again (the service
+* interrupt, armed by clearing ECR_serviceIntr), or when nFault, the ZVG's
+* nPeriphRequest in the ECP mode, goes low (armed by clearing
+* ECR_nErrIntrEn).  A program can't take an interrupt itself, so the port's
+* ppdev device is opened and claimed as well.  ppdev counts the port's
+* interrupts, and 'poll()' on it returns once there has been one.
+*
+* Once they have polled for the balanced time, the FIFO full and data
+* available waits of the direct port I/O arm the interrupt and sleep on it.
+* The register is read again after waking, the interrupt only says it's
+* worth looking.  A sleep lasts at most IRQ_SLEEP_MS, so an interrupt that
+* never comes costs that much.  After IRQ_MISS_MAX sleeps in a row that
+* timed out with the port ready, the interrupt is given up on and the waits
+* poll again.
+*
+* The port needs an IRQ, given to parport_pc by 'irq=auto' or 'irq=N'.
+* Without one, or without its ppdev device, the balanced policy is used and
+* 'zvgBanner()' says why.  The 'sim' transport raises the interrupts of its
+* simulated port.  The ppdev transport doesn't use this, the kernel's ECP
+* writes already sleep on the interrupt if the port has one.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<sys/io.h>
+
+#include	<errno.h>
+#include	<fcntl.h>
+#include	<poll.h>
+#include	<stdio.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<sys/ioctl.h>
+#include	<linux/ppdev.h>
+
+#include	"zstddef.h"
+#include	"zvgPort.h"
+#include	"zvgDetect.h"
+#include	"zvgTrace.h"
+#include	"zvgIrq.h"
+
+#define	IRQ_PROCSYS		"/proc/sys/dev/parport"	// has the IRQ of each port
+
+/*****************************************************************************
+* Return the IRQ the kernel gave a port, -1 if it has none.
+*
+* Called with:
+*    name = Port name, "parportN".
+*****************************************************************************/
+static int irqOfPort( const char *name)
+{
+	FILE	*fp;
+	char	path[256];
+	int		irq;
+
+	irq = -1;
+	snprintf( path, sizeof( path), "%s/%s/irq", IRQ_PROCSYS, name);
+	fp = fopen( path, "r");
+
+	if (fp != NULL)
+	{
+		if (fscanf( fp, "%d", &irq) != 1)
+			irq = -1;
+
+		fclose( fp);
+	}
+	return (irq);
+}
+
+/*****************************************************************************
+* Set which of the port's interrupts are armed, forgetting any already
+* counted.
+*
+* Called with:
+*    irq = IRQ_FIFO, IRQ_DATA, or IRQ_NONE to disarm both.
+*****************************************************************************/
+static void irqArm( uint irq)
+{
+	uchar	ecr;
+	int		count;
+
+	if (irq != IRQ_NONE && ZvgIO.irqOpen)
+		ioctl( ZvgIO.irqFd, PPCLRIRQ, &count);
+
+	// keep the mode, a write that changes it resets the FIFO
+
+	ecr = inportb( ZvgIO.ecpEcr) & ~(ECR_nErrIntrEn | ECR_dmaEn | ECR_serviceIntr | ECR_full | ECR_empty);
+
+	if (irq == IRQ_FIFO)
+		ecr |= ECR_nErrIntrEn;
+
+	else if (irq == IRQ_DATA)
+		ecr |= ECR_serviceIntr;
+
+	else
+		ecr |= ECR_nErrIntrEn | ECR_serviceIntr;
+
+	outportb( ZvgIO.ecpEcr, ecr);
+}
+
+/*****************************************************************************
+* Sleep until the port interrupts, or 'ns' has passed.
+*
+* Returns:
+*    zTrue if the interrupt came.
+*****************************************************************************/
+static bool irqSleep( long long int ns)
+{
+	struct pollfd	pfd;
+	int				count;
+
+	if (ZvgIO.ioHookP != NULL)
+		return (ZvgIO.ioHookP->irq( ns));
+
+	pfd.fd = ZvgIO.irqFd;
+	pfd.events = POLLIN;
+
+	if (poll( &pfd, 1, (int)((ns + 999999LL) / 1000000LL)) <= 0)
+		return (zFalse);
+
+	ioctl( ZvgIO.irqFd, PPCLRIRQ, &count);
+	return (zTrue);
+}
+
+/*****************************************************************************
+* Start sleeping on the port's interrupt, if it has one.  Called by the
+* direct port I/O's open if the WAIT_IRQ policy is set, before the port's
+* registers are setup, as claiming the port through ppdev resets them.
+*
+* If the interrupt can't be used the waits poll, as with the balanced
+* policy, and 'ZvgIO.irqStatus.err' says why.
+*
+* Called with:
+*    portAdr = Base address of the port.
+*****************************************************************************/
+void zvgIrqOpen( uint portAdr)
+{
+	ZvgDetect_s		ports[DETECT_MAX_PORTS];
+	ZvgIrqStatus_s	*st;
+	uint			count, ii;
+	int				fd;
+
+	zvgIrqClose();
+
+	st = &ZvgIO.irqStatus;
+	memset( st, 0, sizeof( *st));
+	st->irq = -1;
+	ZvgIO.irqMissRun = 0;
+
+	// a hooked port raises its own interrupts, if it can
+
+	if (ZvgIO.ioHookP != NULL)
+	{
+		if (ZvgIO.ioHookP->irq == NULL)
+			st->err = EOPNOTSUPP;
+
+		else
+			st->on = zTrue;
+
+		return;
+	}
+
+	// find the ppdev device of the port
+
+	if (zvgDetectList( ports, DETECT_MAX_PORTS, &count) != errOk)
+		count = 0;
+
+	for (ii = 0; ii < count; ii++)
+	{
+		if (ports[ii].portAdr == portAdr && ports[ii].dev[0] != '\0')
+			break;
+	}
+
+	if (ii == count)
+	{	st->err = ENODEV;
+		return;
+	}
+
+	st->irq = irqOfPort( ports[ii].name);
+
+	if (st->irq < 0)
+	{	st->err = ENXIO;						// the port has no IRQ
+		return;
+	}
+
+	fd = open( ports[ii].dev, O_RDWR | O_CLOEXEC);
+
+	if (fd < 0)
+	{	st->err = errno;
+		return;
+	}
+
+	// the interrupts only reach ppdev while it has the port claimed
+
+	if (ioctl( fd, PPCLAIM) < 0)
+	{	st->err = errno;
+		close( fd);
+		return;
+	}
+
+	snprintf( st->dev, IRQ_DEV_SZ, "%s", ports[ii].dev);
+	ZvgIO.irqFd = fd;
+	ZvgIO.irqOpen = zTrue;
+	st->on = zTrue;
+}
+
+/*****************************************************************************
+* Stop sleeping on the port's interrupt, and release its ppdev device.  May
+* be called more than once.
+*****************************************************************************/
+void zvgIrqClose( void)
+{
+	ZvgIO.irqStatus.on = zFalse;
+
+	if (!ZvgIO.irqOpen)
+		return;
+
+	ioctl( ZvgIO.irqFd, PPRELEASE);
+	close( ZvgIO.irqFd);
+	ZvgIO.irqOpen = zFalse;
+}
+
+/*****************************************************************************
+* Sleep on the port's interrupt until a register matches (or doesn't match)
+* a given value.  Called by 'waitForPort()' once it has polled for a while.
+*
+* Sleeps once, for no more than IRQ_SLEEP_MS, so the caller can check its
+* timeout.  Doesn't sleep at all if the register matches once the
+* interrupt has been armed.
+*
+* Called with:
+*    irq     = IRQ_FIFO or IRQ_DATA, the interrupt the match raises.
+*    port    = Address of register to poll.
+*    mask    = Bitmask used to mask register before comparison.
+*    testVal = Masked value to compare against.
+*    equal   = If set, wait for a match, else wait for a mismatch.
+*    ns      = Longest time to sleep.
+*
+* Returns the value read from the register, or ZVG_TIMEOUT (-1) if it
+* still doesn't match.
+*****************************************************************************/
+uint zvgIrqWait( uint irq, uint port, uchar mask, uchar testVal, bool equal,
+		long long int ns)
+{
+	ZvgIrqStatus_s	*st;
+	uchar			readVal;
+	bool			woke;
+
+	st = &ZvgIO.irqStatus;
+	irqArm( irq);
+
+	// ready before the interrupt was armed?  Then there's nothing to sleep for
+
+	readVal = inportb( port);
+
+	if (((readVal & mask) == testVal) == equal)
+	{	irqArm( IRQ_NONE);
+		return (readVal);
+	}
+
+	if (ns > IRQ_SLEEP_MS * 1000000LL)
+		ns = IRQ_SLEEP_MS * 1000000LL;
+
+	zvgTraceBegin( teIrq, irq);
+	woke = irqSleep( ns);
+	zvgTraceEnd( teIrq, woke);
+
+	irqArm( IRQ_NONE);
+	readVal = inportb( port);
+	st->sleeps++;
+
+	if (woke)
+	{	st->wakes++;
+		ZvgIO.irqMissRun = 0;
+	}
+
+	// timed out, but the port was ready, the interrupt didn't reach us
+
+	else if (((readVal & mask) == testVal) == equal)
+	{	st->misses++;
+
+		if (++ZvgIO.irqMissRun >= IRQ_MISS_MAX)
+		{	st->on = zFalse;					// poll from now on
+			st->err = ETIMEDOUT;
+		}
+	}
+
+	if (((readVal & mask) == testVal) != equal)
+		return (ZVG_TIMEOUT);
+
+	return (readVal);
+}
+
+/*****************************************************************************
+* Return the state of the interrupt waits, and their counters since the
+* port was opened.
+*****************************************************************************/
+void zvgIrqGetStatus( ZvgIrqStatus_s *status)
+{
+	*status = ZvgIO.irqStatus;
+}
@@ -0,0 +1,613 @@
+/*****************************************************************************
+* Layers composited into each frame.
+*
+* A game drawing a playfield, a score and a debug overlay had one clip
+* window and one color for all of them, each part setting them back as it
+* went.  A layer has its own encoder, so its own clip window and color,
+* and a transform from its coordinates to the screen's, applied before
+* clipping.
+*
+* Vectors given to 'zvgFrameVector()' between 'zvgLayerBegin()' and
+* 'zvgLayerEnd()' are encoded into the layer's buffer, as are the colors
+* and clip window given to 'zvgFrameSetColor()' and the like.  The layers
+* are sent by 'zvgFrameSend()', after the vectors drawn straight to the
+* frame.  Each layer's commands start with an absolute position and a
+* color, see 'zvgEncForget()', so they can be sent after any others.
+*
+* A layer marked LAYERF_STATIC is encoded once, and its commands are sent
+* again each frame until it is made dirty, by 'zvgLayerDirty()' or by
+* changing its clip window or transform.  'zvgLayerBegin()' returns zFalse
+* while the cache is good, and the vectors given are then ignored, so the
+* caller can skip drawing.  A dirty layer is encoded again the next time
+* it's drawn, until then the old commands are sent.  Other layers are
+* drawn again for each frame, and a layer not drawn isn't sent.
+*
+* Layers are sent in z order, lowest first.  Layers with the same z may go
+* in any order, and each one sent is the one starting nearest to where the
+* last left the beam, which saves the jumps between them.  A game that
+* doesn't care gives them all the same z.
+*
+* A layer goes into the frame whole or not at all.  One that doesn't fit
+* in what's left of the frame, less its end of frame, is left out.
+*
+* Layers belong to the board that was current when they were opened, and
+* are drawn with that board current.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdlib.h>
+#include	<string.h>
+
+#include	"zstddef.h"
+#include	"zvgPort.h"
+#include	"zvgEnc.h"
+#include	"zvgLayer.h"
+
+#define	LAYER_SPARE		(zENC_CMD_SIZE * 4)	// room a vector may need at the end of the buffer
+
+// A layer
+
+struct ZVGLAYER_S
+{	char			name[LAYER_NAME_SZ];
+	uint			board;					// board opened on
+	int				zz;						// lowest sent first
+	uint			flags;					// LAYERF_xxx
+	bool			clipSet;				// 'xMin' to 'yMax' hold a clip window, else overscan
+	int				xMin, yMin, xMax, yMax;
+	ZvgLayerXform_s	xform;
+	bool			identity;				// 'xform' changes nothing
+	ZvgEnc_s		enc;					// the layer's encoder, its counters and where it left the beam
+	uchar			*bfr;					// commands encoded
+	uint			size;					// bytes allocated
+	uint			count;					// bytes of commands
+	uint			encFlags;				// encoder flags the commands were encoded with
+	bool			valid;					// a static layer's commands may be sent again
+	bool			dirty;					// a static layer is to be encoded again when drawn
+	bool			drawn;					// encoded since the last frame was sent
+	bool			skip;					// cache used, the vectors given are ignored
+};
+
+// Layers of each board
+
+typedef struct LAYERBOARD_S
+{	ZvgLayer_s		*layers[LAYER_MAX];		// in the order opened
+	uint			count;
+	ZvgLayer_s		*cur;					// layer being drawn, NULL if none
+	ZvgEnc_s		frameEnc;				// the frame's encoder, while a layer is drawn
+	ZvgLayerStats_s	stats;					// of the last frame
+} LayerBoard_s;
+
+static LayerBoard_s		LayerBoards[ZVG_BOARDS];
+
+#define	Layers		(LayerBoards[ZvgCurBoard])		// the current board's
+
+/*****************************************************************************
+* Return the distance the beam moves from 'xx', 'yy' to the start of a
+* layer, along the long axis, as the encoder counts jumps.
+*****************************************************************************/
+static uint layerDist( int xx, int yy, const ZvgLayer_s *layer)
+{
+	uint	xLen, yLen;
+
+	xLen = abs( layer->enc.xFirst - xx);
+	yLen = abs( layer->enc.yFirst - yy);
+	return (xLen > yLen ? xLen : yLen);
+}
+
+/*****************************************************************************
+* Return zTrue if a layer has commands to send with this frame.
+*
+* Called with:
+*    layer    = Layer to check.
+*    encFlags = The frame's encoder flags.
+*****************************************************************************/
+static bool layerReady( const ZvgLayer_s *layer, uint encFlags)
+{
+	if (layer->count == 0 || (layer->flags & LAYERF_HIDDEN))
+		return (zFalse);
+
+	if (layer->drawn)
+		return (zTrue);
+
+	return ((layer->flags & LAYERF_STATIC) && layer->valid && layer->encFlags == encFlags);
+}
+
+/*****************************************************************************
+* Send a layer's commands, and count them in the frame's encoder as if
+* they were encoded there.  The frame's encoder is left where the layer
+* leaves the beam.
+*
+* A layer that would cut into the room kept for the end of frame isn't
+* sent, as 'zvgDmaPutMem()' would cut it short, and is counted in
+* 'dropped'.
+*
+* Returns:
+*    errOk, or an error from 'zvgDmaPutMem()'.
+*****************************************************************************/
+static uint layerSend( ZvgLayer_s *layer)
+{
+	const ZvgEnc_s	*enc;
+	uint			err, dist, ii;
+
+	if (ZvgIO.dmaCurCount + layer->count + zENC_EOF_SIZE > MEM_BFR_SZ)
+	{	Layers.stats.dropped++;
+		return (errOk);
+	}
+
+	enc = &layer->enc;
+	err = zvgDmaPutMem( layer->bfr, layer->count);
+
+	if (err)
+		return (err);
+
+	// the jump to the layer's first command
+
+	dist = layerDist( ZvgENC.xPos, ZvgENC.yPos, layer);
+
+	if (dist != 0)
+	{	ZvgENC.stats.jumpUnits += dist;
+		ZvgENC.stats.jumps++;
+	}
+
+	Layers.stats.layers++;
+	Layers.stats.jumpUnits += dist;
+	Layers.stats.sent += layer->count;
+
+	if (!layer->drawn)
+		Layers.stats.cached++;
+
+	// the layer's counters
+
+	ZvgENC.stats.vectors += enc->stats.vectors;
+	ZvgENC.stats.drawn += enc->stats.drawn;
+	ZvgENC.stats.points += enc->stats.points;
+	ZvgENC.stats.clipped += enc->stats.clipped;
+	ZvgENC.stats.drawUnits += enc->stats.drawUnits;
+	ZvgENC.stats.jumpUnits += enc->stats.jumpUnits;
+	ZvgENC.stats.jumps += enc->stats.jumps;
+
+	for (ii = 0; ii < ENC_FORMS; ii++)
+		ZvgENC.stats.cmds[ii] += enc->stats.cmds[ii];
+
+	// the spotkiller sees the layer's vectors
+
+	ZvgENC.vecCount += enc->vecCount;
+
+	if (enc->xMinSpot < ZvgENC.xMinSpot)
+		ZvgENC.xMinSpot = enc->xMinSpot;
+
+	if (enc->xMaxSpot > ZvgENC.xMaxSpot)
+		ZvgENC.xMaxSpot = enc->xMaxSpot;
+
+	if (enc->yMinSpot < ZvgENC.yMinSpot)
+		ZvgENC.yMinSpot = enc->yMinSpot;
+
+	if (enc->yMaxSpot > ZvgENC.yMaxSpot)
+		ZvgENC.yMaxSpot = enc->yMaxSpot;
+
+	ZvgENC.xPos = enc->xPos;
+	ZvgENC.yPos = enc->yPos;
+	ZvgENC.zColor = enc->zColor;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Open a layer on the current board.
+*
+* The layer starts with the frame's color, no transform, and the clip
+* window at the edges of the overscan.
+*
+* Called with:
+*    layerP = Set to the layer.
+*    name   = Name, for 'zvgLayerFind()'.
+*    zz     = Z order, lowest sent first.
+*    flags  = LAYERF_xxx.
+*
+* Returns:
+*    errOk, errLayerName if the name is empty, too long or already used,
+*    errLayerFull if the board has LAYER_MAX layers, or errMemory.
+*****************************************************************************/
+uint zvgLayerOpen( ZvgLayer_s **layerP, const char *name, int zz, uint flags)
+{
+	ZvgLayer_s	*layer;
+
+	*layerP = NULL;
+
+	if (name == NULL || name[0] == '\0' || strlen( name) >= LAYER_NAME_SZ || zvgLayerFind( name) != NULL)
+		return (errLayerName);
+
+	if (Layers.count >= LAYER_MAX)
+		return (errLayerFull);
+
+	layer = (ZvgLayer_s *)calloc( 1, sizeof( ZvgLayer_s));
+
+	if (layer == NULL)
+		return (errMemory);
+
+	layer->bfr = (uchar *)malloc( LAYER_BFR_SZ);
+
+	if (layer->bfr == NULL)
+	{	free( layer);
+		return (errMemory);
+	}
+
+	strcpy( layer->name, name);
+	layer->board = ZvgCurBoard;
+	layer->zz = zz;
+	layer->flags = flags;
+	layer->size = LAYER_BFR_SZ;
+	layer->enc = Layers.cur != NULL ? Layers.frameEnc : ZvgENC;
+	zvgLayerSetXform( layer, NULL);
+
+	Layers.layers[Layers.count++] = layer;
+	*layerP = layer;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Close a layer, and free its buffer.  It isn't sent with the next frame.
+*****************************************************************************/
+void zvgLayerClose( ZvgLayer_s *layer)
+{
+	LayerBoard_s	*board;
+	uint			ii;
+
+	if (layer == NULL)
+		return;
+
+	board = &LayerBoards[layer->board];
+
+	if (board->cur == layer)
+	{	ZvgBoardENC[layer->board] = board->frameEnc;
+		board->cur = NULL;
+	}
+
+	for (ii = 0; ii < board->count; ii++)
+	{
+		if (board->layers[ii] == layer)
+		{	board->count--;
+			memmove( &board->layers[ii], &board->layers[ii + 1], (board->count - ii) * sizeof( ZvgLayer_s *));
+			break;
+		}
+	}
+
+	free( layer->bfr);
+	free( layer);
+}
+
+/*****************************************************************************
+* Return the current board's layer called 'name', or NULL if none.
+*****************************************************************************/
+ZvgLayer_s *zvgLayerFind( const char *name)
+{
+	uint	ii;
+
+	for (ii = 0; ii < Layers.count; ii++)
+	{
+		if (strcmp( Layers.layers[ii]->name, name) == 0)
+			return (Layers.layers[ii]);
+	}
+	return (NULL);
+}
+
+/*****************************************************************************
+* Set a layer's clip window, in screen coordinates, as 'zvgEncSetClipWin()'
+* does for the frame.  Used from the next 'zvgLayerBegin()'.
+*****************************************************************************/
+void zvgLayerSetClipWin( ZvgLayer_s *layer, int xMin, int yMin, int xMax, int yMax)
+{
+	layer->clipSet = zTrue;
+	layer->xMin = xMin;
+	layer->yMin = yMin;
+	layer->xMax = xMax;
+	layer->yMax = yMax;
+	layer->dirty = zTrue;
+}
+
+/*****************************************************************************
+* Open a layer's clip window to the edges of the overscan, or the screen if
+* the monitor doesn't allow overscan.  Used from the next 'zvgLayerBegin()'.
+*****************************************************************************/
+void zvgLayerSetClipOverscan( ZvgLayer_s *layer)
+{
+	layer->clipSet = zFalse;
+	layer->dirty = zTrue;
+}
+
+/*****************************************************************************
+* Set a layer's transform, NULL for none.  Used from the next vector.
+*****************************************************************************/
+void zvgLayerSetXform( ZvgLayer_s *layer, const ZvgLayerXform_s *xform)
+{
+	if (xform == NULL)
+	{	memset( &layer->xform, 0, sizeof( layer->xform));
+		layer->xform.xx = LAYER_ONE;
+		layer->xform.yy = LAYER_ONE;
+	}
+	else
+		layer->xform = *xform;
+
+	layer->identity = layer->xform.xx == LAYER_ONE && layer->xform.xy == 0 && layer->xform.dx == 0
+			&& layer->xform.yx == 0 && layer->xform.yy == LAYER_ONE && layer->xform.dy == 0;
+
+	layer->dirty = zTrue;
+}
+
+/*****************************************************************************
+* Set a layer's z order, lowest sent first.
+*****************************************************************************/
+void zvgLayerSetZ( ZvgLayer_s *layer, int zz)
+{
+	layer->zz = zz;
+}
+
+/*****************************************************************************
+* Set a layer's LAYERF_xxx flags.  Hiding a static layer keeps its cache.
+*****************************************************************************/
+void zvgLayerSetFlags( ZvgLayer_s *layer, uint flags)
+{
+	if (!(flags & LAYERF_STATIC))
+		layer->valid = zFalse;
+
+	layer->flags = flags;
+}
+
+/*****************************************************************************
+* Mark a static layer dirty, it is encoded again the next time it is drawn.
+* Until then its commands from before are sent.
+*****************************************************************************/
+void zvgLayerDirty( ZvgLayer_s *layer)
+{
+	layer->dirty = zTrue;
+}
+
+/*****************************************************************************
+* Start drawing a layer.  Until 'zvgLayerEnd()', 'zvgFrameVector()' draws
+* into the layer, and the color and clip window calls set the layer's.
+*
+* A layer drawn more than once in a frame keeps what was drawn before.  A
+* layer being drawn is ended first.
+*
+* Returns:
+*    zTrue if the layer is to be drawn, zFalse if it's static and its
+*    commands from before will be sent, or isn't on the current board.  The
+*    vectors given are then ignored.
+*****************************************************************************/
+bool zvgLayerBegin( ZvgLayer_s *layer)
+{
+	uint	encFlags;
+
+	zvgLayerEnd();
+
+	encFlags = ZvgENC.encFlags & ~ENCF_NOPOS;
+	Layers.frameEnc = ZvgENC;
+	Layers.cur = layer;
+	ZvgENC = layer->enc;
+	ZvgENC.encFlags = encFlags | (layer->enc.encFlags & ENCF_NOPOS);
+	ZvgENC.encBfr = layer->bfr;
+	ZvgENC.encCount = layer->count;
+
+	layer->skip = layer->board != ZvgCurBoard
+			|| ((layer->flags & LAYERF_STATIC) && layer->valid && !layer->dirty && layer->encFlags == encFlags);
+
+	if (layer->skip)
+		return (zFalse);
+
+	// a layer not yet drawn in this frame starts over
+
+	if (!layer->drawn)
+	{	if (layer->clipSet)
+			zvgEncSetClipWin( layer->xMin, layer->yMin, layer->xMax, layer->yMax);
+
+		else
+			zvgEncSetClipOverscan();
+
+		ZvgENC.vecCount = 0;
+		ZvgENC.xMinSpot = 0;
+		ZvgENC.yMinSpot = 0;
+		ZvgENC.xMaxSpot = 0;
+		ZvgENC.yMaxSpot = 0;
+		zvgEncClearStats();
+		zvgEncClearBfr();
+		zvgEncForget();
+
+		layer->count = 0;
+		layer->valid = zFalse;
+		layer->dirty = zFalse;
+		layer->drawn = zTrue;
+	}
+	return (zTrue);
+}
+
+/*****************************************************************************
+* Stop drawing a layer, 'zvgFrameVector()' draws straight to the frame
+* again, with the frame's color and clip window.
+*****************************************************************************/
+void zvgLayerEnd( void)
+{
+	ZvgLayer_s	*layer;
+
+	layer = Layers.cur;
+
+	if (layer == NULL)
+		return;
+
+	if (!layer->skip)
+		layer->count = zvgEncSize();
+
+	layer->enc = ZvgENC;
+	ZvgENC = Layers.frameEnc;
+	Layers.cur = NULL;
+}
+
+/*****************************************************************************
+* Return zTrue if a layer is being drawn on the current board.
+*****************************************************************************/
+bool zvgLayerActive( void)
+{
+	return (Layers.cur != NULL);
+}
+
+/*****************************************************************************
+* Transform and encode a vector into the layer being drawn.  Called by
+* 'zvgFrameVector()'.
+*
+* Returns:
+*    errOk, or errMemory if the layer's buffer couldn't grow.
+*****************************************************************************/
+uint zvgLayerVector( int xStart, int yStart, int xEnd, int yEnd)
+{
+	ZvgLayer_s				*layer;
+	const ZvgLayerXform_s	*xf;
+	uchar					*bfr;
+	int						xx, yy;
+
+	layer = Layers.cur;
+
+	if (layer->skip)
+		return (errOk);
+
+	if (!layer->identity)
+	{	xf = &layer->xform;
+
+		xx = xStart;
+		yy = yStart;
+		xStart = (int)(((long long)xx * xf->xx + (long long)yy * xf->xy + LAYER_ONE / 2) >> 16) + xf->dx;
+		yStart = (int)(((long long)xx * xf->yx + (long long)yy * xf->yy + LAYER_ONE / 2) >> 16) + xf->dy;
+
+		xx = xEnd;
+		yy = yEnd;
+		xEnd = (int)(((long long)xx * xf->xx + (long long)yy * xf->xy + LAYER_ONE / 2) >> 16) + xf->dx;
+		yEnd = (int)(((long long)xx * xf->yx + (long long)yy * xf->yy + LAYER_ONE / 2) >> 16) + xf->dy;
+	}
+
+	// grow the buffer, the encoder doesn't check for room
+
+	if (zvgEncSize() + LAYER_SPARE > layer->size)
+	{	bfr = (uchar *)realloc( layer->bfr, layer->size * 2);
+
+		if (bfr == NULL)
+			return (errMemory);
+
+		layer->bfr = bfr;
+		layer->size *= 2;
+		ZvgENC.encBfr = bfr;
+	}
+
+	zvgEnc( xStart, yStart, xEnd, yEnd);
+	return (errOk);
+}
+
+/*****************************************************************************
+* Send the current board's layers, after the vectors drawn straight to the
+* frame.  Called by 'zvgFrameSend()'.  A layer being drawn is ended first.
+*
+* Returns:
+*    errOk, or an error from 'zvgDmaPutMem()'.
+*****************************************************************************/
+uint zvgLayerFlush( void)
+{
+	ZvgLayer_s	*send[LAYER_MAX], *layer;
+	uint		count, encFlags, err, best, dist, ii, jj, kk;
+	int			xx, yy;
+
+	zvgLayerEnd();
+	memset( &Layers.stats, 0, sizeof( Layers.stats));
+	encFlags = ZvgENC.encFlags & ~ENCF_NOPOS;
+
+	// the layers to send, in z order then the order opened
+
+	count = 0;
+
+	for (ii = 0; ii < Layers.count; ii++)
+	{	layer = Layers.layers[ii];
+
+		if (!layerReady( layer, encFlags))
+			continue;
+
+		for (jj = count; jj > 0 && send[jj - 1]->zz > layer->zz; jj--)
+			send[jj] = send[jj - 1];
+
+		send[jj] = layer;
+		count++;
+	}
+
+	// the jumps in that order, for the counters
+
+	xx = ZvgENC.xPos;
+	yy = ZvgENC.yPos;
+
+	for (ii = 0; ii < count; ii++)
+	{	Layers.stats.zJumpUnits += layerDist( xx, yy, send[ii]);
+		xx = send[ii]->enc.xPos;
+		yy = send[ii]->enc.yPos;
+	}
+
+	// within each z, send the layer starting nearest the beam next
+
+	xx = ZvgENC.xPos;
+	yy = ZvgENC.yPos;
+
+	for (ii = 0; ii < count; ii++)
+	{	best = ii;
+		dist = layerDist( xx, yy, send[ii]);
+
+		for (jj = ii + 1; jj < count && send[jj]->zz == send[ii]->zz; jj++)
+		{
+			if (layerDist( xx, yy, send[jj]) < dist)
+			{	best = jj;
+				dist = layerDist( xx, yy, send[jj]);
+			}
+		}
+
+		layer = send[best];
+
+		for (kk = best; kk > ii; kk--)
+			send[kk] = send[kk - 1];
+
+		send[ii] = layer;
+		xx = layer->enc.xPos;
+		yy = layer->enc.yPos;
+	}
+
+	for (ii = 0; ii < count; ii++)
+	{	err = layerSend( send[ii]);
+
+		if (err)
+			return (err);
+	}
+
+	// static layers drawn are kept for the frames after, others start over
+
+	for (ii = 0; ii < Layers.count; ii++)
+	{	layer = Layers.layers[ii];
+
+		if (layer->drawn)
+		{	Layers.stats.encoded += layer->count;
+
+			if (layer->flags & LAYERF_STATIC)
+			{	layer->valid = zTrue;
+				layer->encFlags = encFlags;
+			}
+		}
+		else if (layer->valid && layer->encFlags != encFlags)
+			layer->valid = zFalse;
+
+		if (!(layer->flags & LAYERF_STATIC))
+			layer->count = 0;
+
+		layer->drawn = zFalse;
+	}
+	return (errOk);
+}
+
+/*****************************************************************************
+* Return the current board's layer counters for the last frame sent.
+*****************************************************************************/
+void zvgLayerGetStats( ZvgLayerStats_s *stats)
+{
+	*stats = Layers.stats;
+}
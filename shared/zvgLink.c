@@ -0,0 +1,342 @@
+/*****************************************************************************
+* Recovery of a lost link to the ZVG.
+*
+* A bumped cable or a ZVG that browns out shows up as 'errEcpToSpp' or
+* 'errEcpTimeout' while sending a frame, or as 'errEcpFailed' when ECP mode
+* can't be negotiated again.  Rather than hand the error back, and leave
+* the caller to give up, the link is marked down and a thread tries to
+* renegotiate ECP mode, waiting LINK_RETRY_MIN_MS before the first try and
+* twice as long after each failure, up to LINK_RETRY_MAX_MS.
+*
+* While the link is down 'zvgDmaSendSwap()' drops each frame and returns at
+* once, so the game loop keeps running at its own pace.  Nothing else
+* touches the port, calls that need the ZVG return 'errLinkDown'.  Once ECP
+* mode is back the monitor settings are sent again (a ZVG that lost power
+* has gone back to the ones in its EEPROM), the link is marked up, and the
+* next frame is sent as usual.  Settings taken from the device info cache
+* aren't sent, only ones set since opening, see 'zvgCtlResend()'.
+*
+* Recovering is on by default once the ZVG has been opened, a lost link
+* while opening is still an error.  It is turned off by 'zvgLinkConfig()'
+* or 'L0' in 'ZVGPORT='.  Outages are counted in 'zvgLinkGetStats()'.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<pthread.h>
+#include	<errno.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<time.h>
+
+#include	"zstddef.h"
+#include	"zvgCmds.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgCtl.h"
+#include	"zvgLink.h"
+#include	"zvgTrace.h"
+
+#define	LINK_PAD		8					// NOPs that push the settings through the look ahead
+
+typedef struct ZVGLINK_S
+{	pthread_t		thread;
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;					// signalled when the link is lost, or on quit
+	bool			quit;					// thread has been asked to exit
+	uint			board;					// board it recovers, see 'zvgBoard.c'
+	long long int	lostNs;					// time the link was lost
+	ZvgLinkStats_s	stats;
+} ZvgLink_s;
+
+/*****************************************************************************
+* Turn recovering a lost link on or off.
+*
+* Must be called before 'zvgFrameOpen()' or 'zvgInit()'. The 'L' attribute
+* of 'ZVGPORT=', if given, overrides this.
+*
+* Called with:
+*    on = zTrue to recover (the default), zFalse to return link errors.
+*****************************************************************************/
+void zvgLinkConfig( bool on)
+{
+	ZvgIO.linkOff = !on;
+}
+
+/*****************************************************************************
+* Give the monitor settings sent to the ZVG after the link is recovered.
+* 'zvgFrameOpen()' gives 'ZvgMon', so changes made to it (by 'zvgTweak')
+* are sent as well.
+*
+* Called with:
+*    mon = Monitor settings, NULL to send none.
+*****************************************************************************/
+void zvgLinkSetMonitor( const ZvgMon_s *mon)
+{
+	ZvgIO.linkMon = mon;
+}
+
+/*****************************************************************************
+* Check if an error is one that means the link was lost.
+*****************************************************************************/
+bool zvgLinkIsError( uint err)
+{
+	return (err == errEcpToSpp || err == errEcpTimeout || err == errEcpFailed);
+}
+
+/*****************************************************************************
+* Try to bring the link back.
+*
+* Renegotiates ECP mode, then sends the monitor settings.
+*
+* Returns:
+*    errCode
+*****************************************************************************/
+static uint linkTry( void)
+{
+	const ZvgMon_s	*mon;
+	uchar			bfr[CTL_REGS * 2 + LINK_PAD];
+	uint			count;
+	uint			err;
+
+	ZvgIO.trOps->reset();						// start from the compatibility mode
+	err = zvgSetEcpMode();
+
+	if (err)
+		return (err);
+
+	mon = ZvgIO.linkMon;
+
+	if (mon == NULL)
+		return (errOk);
+
+	count = zvgCtlResend( bfr, mon);
+
+	if (count == 0)
+		return (errOk);
+
+	memset( bfr + count, zcNOP, LINK_PAD);
+	count += LINK_PAD;
+
+	err = zvgEcpPutMem( bfr, count);
+
+	if (err)
+		ZvgIO.trOps->reset();
+
+	return (err);
+}
+
+/*****************************************************************************
+* Recovery thread.  Sleeps until the link is lost, then tries to bring it
+* back, backing off after each failure.
+*****************************************************************************/
+static void *linkThread( void *arg)
+{
+	ZvgLink_s		*lk;
+	struct timespec	ts;
+	long long int	retryNs, downNs;
+	uint			err;
+
+	lk = (ZvgLink_s *)arg;
+	ZvgCurBoard = lk->board;
+	zvgTraceName( "zvg link");
+
+	pthread_mutex_lock( &lk->lock);
+
+	while (!lk->quit)
+	{
+		if (!zvgLinkDown())
+		{	pthread_cond_wait( &lk->cond, &lk->lock);
+			continue;
+		}
+
+		retryNs = LINK_RETRY_MIN_MS * 1000000LL;
+
+		while (!lk->quit)
+		{
+			// wait before trying, a quit ends the wait
+
+			clock_gettime( CLOCK_REALTIME, &ts);
+			ts.tv_sec += retryNs / 1000000000LL;
+			ts.tv_nsec += retryNs % 1000000000LL;
+
+			if (ts.tv_nsec >= 1000000000L)
+			{	ts.tv_sec++;
+				ts.tv_nsec -= 1000000000L;
+			}
+
+			while (!lk->quit && pthread_cond_timedwait( &lk->cond, &lk->lock, &ts) != ETIMEDOUT)
+				;
+
+			if (lk->quit)
+				break;
+
+			// the port is ours while the link is down
+
+			lk->stats.tries++;
+			pthread_mutex_unlock( &lk->lock);
+
+			zvgTraceBegin( teRecover, (uint)lk->stats.tries);
+			err = linkTry();
+			zvgTraceEnd( teRecover, err);
+
+			pthread_mutex_lock( &lk->lock);
+
+			if (!err)
+			{	downNs = tmrReadTimer() - lk->lostNs;
+				lk->stats.recoveries++;
+				lk->stats.down = 0;
+				lk->stats.downNs = downNs;
+				lk->stats.totalDownNs += downNs;
+
+				if (downNs > lk->stats.maxDownNs)
+					lk->stats.maxDownNs = downNs;
+
+				__atomic_store_n( &ZvgIO.linkDown, 0, __ATOMIC_RELEASE);
+				break;
+			}
+
+			retryNs *= 2;
+
+			if (retryNs > LINK_RETRY_MAX_MS * 1000000LL)
+				retryNs = LINK_RETRY_MAX_MS * 1000000LL;
+		}
+	}
+
+	pthread_mutex_unlock( &lk->lock);
+	return (NULL);
+}
+
+/*****************************************************************************
+* Mark the link down, and start recovering it.
+*
+* Called by 'zvgDmaSendSwap()' when sending fails with a link error.  The
+* sender thread, if there is one, must be idle.
+*
+* Called with:
+*    err = Error that lost the link.
+*
+* Returns:
+*    errOk - Link is being recovered, the frame should be dropped.
+*    err   - Not recovering, the error should be returned.
+*****************************************************************************/
+uint zvgLinkLost( uint err)
+{
+	ZvgLink_s	*lk;
+
+	if (!ZvgIO.linkArmed || ZvgIO.linkOff || !zvgLinkIsError( err))
+		return (err);
+
+	lk = ZvgIO.linkP;
+
+	// the thread is started the first time the link is lost
+
+	if (lk == NULL)
+	{	lk = (ZvgLink_s *)calloc( 1, sizeof( ZvgLink_s));
+
+		if (lk == NULL)
+			return (err);
+
+		pthread_mutex_init( &lk->lock, NULL);
+		pthread_cond_init( &lk->cond, NULL);
+		lk->board = ZvgCurBoard;
+
+		if (pthread_create( &lk->thread, NULL, linkThread, lk) != 0)
+		{	pthread_cond_destroy( &lk->cond);
+			pthread_mutex_destroy( &lk->lock);
+			free( lk);
+			return (err);
+		}
+		ZvgIO.linkP = lk;
+	}
+
+	zvgTraceMark( teLinkLost, err);
+
+	pthread_mutex_lock( &lk->lock);
+	lk->lostNs = tmrReadTimer();
+	lk->stats.losses++;
+	lk->stats.down = 1;
+	lk->stats.lastErr = err;
+	__atomic_store_n( &ZvgIO.linkDown, 1, __ATOMIC_RELEASE);
+	pthread_cond_broadcast( &lk->cond);
+	pthread_mutex_unlock( &lk->lock);
+	return (errOk);
+}
+
+/*****************************************************************************
+* Stop the recovery thread.  Called by 'zvgClose()', the link is left down
+* if it wasn't recovered.
+*****************************************************************************/
+void zvgLinkStop( void)
+{
+	ZvgLink_s	*lk;
+
+	lk = ZvgIO.linkP;
+	ZvgIO.linkArmed = zFalse;
+
+	if (lk == NULL)
+		return;
+
+	pthread_mutex_lock( &lk->lock);
+	lk->quit = zTrue;
+	pthread_cond_broadcast( &lk->cond);
+	pthread_mutex_unlock( &lk->lock);
+
+	pthread_join( lk->thread, NULL);
+	pthread_cond_destroy( &lk->cond);
+	pthread_mutex_destroy( &lk->lock);
+	free( lk);
+	ZvgIO.linkP = NULL;
+}
+
+/*****************************************************************************
+* Return the link counters, since the ZVG was opened or
+* 'zvgLinkClearStats()'.  While the link is down, 'downNs' is the time it
+* has been down so far.
+*****************************************************************************/
+void zvgLinkGetStats( ZvgLinkStats_s *stats)
+{
+	ZvgLink_s	*lk;
+
+	lk = ZvgIO.linkP;
+
+	if (lk == NULL)
+	{	memset( stats, 0, sizeof( *stats));
+		stats->dropped = ZvgIO.linkDropped;
+		return;
+	}
+
+	pthread_mutex_lock( &lk->lock);
+	*stats = lk->stats;
+	stats->dropped = ZvgIO.linkDropped;
+
+	if (stats->down)
+		stats->downNs = tmrReadTimer() - lk->lostNs;
+
+	pthread_mutex_unlock( &lk->lock);
+}
+
+/*****************************************************************************
+* Clear the link counters, an outage in progress is still counted when it
+* ends.
+*****************************************************************************/
+void zvgLinkClearStats( void)
+{
+	ZvgLink_s	*lk;
+	uint		down;
+
+	lk = ZvgIO.linkP;
+	ZvgIO.linkDropped = 0;
+
+	if (lk == NULL)
+		return;
+
+	pthread_mutex_lock( &lk->lock);
+	down = lk->stats.down;
+
+	memset( &lk->stats, 0, sizeof( lk->stats));
+	lk->stats.down = down;
+	pthread_mutex_unlock( &lk->lock);
+}
@@ -0,0 +1,1384 @@
+/*****************************************************************************
+* Streaming frames to a ZVG on another machine.
+*
+* The 'net' transport sends each buffer the driver would write to the port
+* over TCP or UDP, so a game can run on a render box while the ZVG is in the
+* cabinet.  The 'zvgRecv' program, at the cabinet, passes the frames to its
+* own ZVG with 'zvgDmaPutMem()' and 'zvgDmaSendSwap()'.  Both ends must be
+* setup for the same monitor, the frames are sent as the sender encoded them.
+*
+*    ZVGPORT="M4 Tnet:cabinet:7430"      // TCP
+*    ZVGPORT="M4 Tnet:udp:cabinet:7430"  // UDP
+*
+* Successive frames are mostly the same, so each frame is coded against the
+* newest frame the receiver has acknowledged.  The coded frame is a list of
+* literal runs, and runs copied from the reference frame:
+*
+*    0x00-0x7F                = Literal, the next 1-128 bytes.
+*    0x80-0xFE, offset        = Copy NET_MATCH_MIN + 0-126 bytes from 'offset'
+*                               (2 bytes) in the reference frame.
+*    0xFF, length, offset     = Copy NET_MATCH_MIN + 127 + 'length' bytes,
+*                               'length' is 7 bits per byte, low bits first.
+*
+* A frame with no reference, or that doesn't get smaller, is sent as is.
+* The coded frame is split into packets of NET_PAYLOAD_SZ bytes, each with
+* a 'ZvgNetPkt_s' header.  Both ends keep the last NET_HIST frames, and the
+* checksum of each frame is checked once it is decoded.
+*
+* A frame missing a packet over UDP is never acknowledged, so later frames
+* are still coded against one the receiver has.  Once it has no frame
+* acknowledged within the last NET_HIST the sender sends frames as is.  If
+* the receiver can't decode a frame it says so, and the sender starts over
+* with frames sent as is, flagged NETF_START.
+*
+* The receiver must be there when the transport is opened.  If it goes away
+* later, frames are dropped and the connection is made again every
+* NET_RETRY_MS, so the game carries on while the receiver is restarted.  A
+* connection or send that takes longer than NET_TIMEOUT_MS is given up on.
+*
+* Each acknowledgement echoes the time the frame was sent, and says how long
+* the receiver held it before it was sent on.  The end to end latency is
+* half the round trip without the hold, plus the hold, so the clocks of the
+* two machines don't need to agree.  The sender passes it on in its next
+* frames, so both ends can report it, see 'zvgNetGetStats()' and
+* 'zvgNetRecvStats()'.
+*
+* The transport answers the ZVG's ID, monitor and speed requests as the
+* 'null' transport does.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _GNU_SOURCE
+#define	_GNU_SOURCE							// for 'accept4()'
+#endif
+
+#include	<endian.h>
+#include	<errno.h>
+#include	<fcntl.h>
+#include	<netdb.h>
+#include	<poll.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<time.h>
+#include	<unistd.h>
+#include	<sys/time.h>
+#include	<arpa/inet.h>
+#include	<netinet/in.h>
+#include	<netinet/tcp.h>
+#include	<sys/socket.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgTrans.h"
+#include	"zvgNet.h"
+
+#define	NET_HASH_BITS	12						// size of the table of runs in the reference frame
+#define	NET_PKT_MAX		(sizeof( ZvgNetPkt_s) + NET_PAYLOAD_SZ)
+#define	NET_FRAGS		((NET_CODE_SZ + NET_PAYLOAD_SZ - 1) / NET_PAYLOAD_SZ)	// most packets in a frame
+
+// A packet being read, TCP may deliver it in pieces.  The header is read
+// in place, the union keeps it aligned.
+
+typedef struct NETREAD_S
+{	union
+	{	ZvgNetPkt_s	pkt;
+		uchar		buf[NET_PKT_MAX];
+	} in;
+	uint	fill;
+} NetRead_s;
+
+// Frames kept to code against
+
+typedef struct NETHIST_S
+{	uint	seq[NET_HIST];
+	uint	size[NET_HIST];
+	bool	ok[NET_HIST];
+	uchar	frame[NET_HIST][NET_FRAME_MAX];
+} NetHist_s;
+
+// Sending end, the transport's state
+
+typedef struct ZVGNET_S
+{	int				fd;					// socket, -1 while not connected
+	bool			udp;
+	struct sockaddr_storage	addr;		// receiver
+	socklen_t		addrLen;
+	uint			seq;				// next frame to send
+	bool			acked;				// a frame has been acknowledged since starting over
+	uint			ackSeq;				// newest frame acknowledged
+	uint			resyncSeq;			// acknowledgements of frames before this are stale
+	long long int	tryNs;				// last try at connecting
+	NetRead_s		rd;					// acknowledgement being read
+	NetHist_s		hist;
+	ushort			hash[1 << NET_HASH_BITS];
+	uchar			code[NET_CODE_SZ];
+	uchar			out[NET_FRAGS * NET_PKT_MAX];
+	ZvgNetStats_s	stats;
+} ZvgNet_s;
+
+// Receiving end
+
+struct ZVGNETRX_S
+{	int				lsn;				// listening socket, TCP
+	int				fd;					// connection, or the UDP socket
+	bool			udp;
+	struct sockaddr_storage	peer;		// sender, UDP
+	socklen_t		peerLen;
+	NetRead_s		rd;
+
+	// frame being put together
+
+	bool			busy;
+	ZvgNetPkt_s		cur;				// header of its first packet
+	unsigned long long	got;			// bit per packet received
+	uint			gotCount;
+	long long int	startNs;			// first packet received
+	uchar			code[NET_CODE_SZ];
+
+	// frames decoded
+
+	bool			started;			// 'lastSeq' is valid
+	uint			lastSeq;			// newest frame decoded
+	NetHist_s		hist;
+
+	// frame handed out, acknowledged by 'zvgNetDone()'
+
+	bool			pending;
+	ZvgNetPkt_s		pend;
+	long long int	pendStartNs;
+
+	ZvgNetStats_s	stats;
+};
+
+/*****************************************************************************
+* Return the checksum of a frame, FNV-1a.
+*****************************************************************************/
+static uint netSum( const uchar *mem, uint count)
+{
+	uint	sum;
+
+	sum = 2166136261u;
+
+	while (count--)
+		sum = (sum ^ *mem++) * 16777619u;
+
+	return (sum);
+}
+
+/*****************************************************************************
+* Put a packet header into, or take it out of, network byte order.
+*****************************************************************************/
+static void netOrder( ZvgNetPkt_s *pkt, bool toNet)
+{
+	if (toNet)
+	{	pkt->sentNs = (long long int)htobe64( (unsigned long long)pkt->sentNs);
+		pkt->latNs = (long long int)htobe64( (unsigned long long)pkt->latNs);
+	}
+
+	else
+	{	pkt->sentNs = (long long int)be64toh( (unsigned long long)pkt->sentNs);
+		pkt->latNs = (long long int)be64toh( (unsigned long long)pkt->latNs);
+	}
+
+	// the same swap both ways
+
+	pkt->magic = htonl( pkt->magic);
+	pkt->seq = htonl( pkt->seq);
+	pkt->ref = htonl( pkt->ref);
+	pkt->size = htonl( pkt->size);
+	pkt->sum = htonl( pkt->sum);
+	pkt->coded = htonl( pkt->coded);
+	pkt->offset = htonl( pkt->offset);
+	pkt->len = htons( pkt->len);
+}
+
+/*****************************************************************************
+* Record a latency measured.
+*****************************************************************************/
+static void netLatency( ZvgNetStats_s *st, long long int ns)
+{
+	if (ns <= 0)
+		return;
+
+	st->latNs = ns;
+	st->sumLatNs += ns;
+	st->latCount++;
+
+	if (ns > st->maxLatNs)
+		st->maxLatNs = ns;
+}
+
+/*****************************************************************************
+* Split an address, "[udp:|tcp:][host:]port" or "[udp:|tcp:]host".
+*
+* Called with:
+*    spec = Address.
+*    udp  = Set if UDP was asked for.
+*    host = Set to the host, "" if none was given.
+*    port = Set to the port, NET_PORT if none was given.
+*
+* Returns:
+*    errOk, or errNetAddr.
+*****************************************************************************/
+static uint netSplit( const char *spec, bool *udp, char *host, char *port)
+{
+	const char	*pp;
+
+	*udp = zFalse;
+
+	if (strncmp( spec, "udp:", 4) == 0)
+	{	*udp = zTrue;
+		spec += 4;
+	}
+
+	else if (strncmp( spec, "tcp:", 4) == 0)
+		spec += 4;
+
+	if (strlen( spec) >= NET_ADDR_SZ)
+		return (errNetAddr);
+
+	// a port on its own?
+
+	if (spec[0] != '\0' && strspn( spec, "0123456789") == strlen( spec))
+	{	host[0] = '\0';
+		strcpy( port, spec);
+		return (errOk);
+	}
+
+	pp = strrchr( spec, ':');
+
+	if (pp == NULL)
+	{	strcpy( host, spec);
+		snprintf( port, NET_ADDR_SZ, "%u", NET_PORT);
+	}
+
+	else
+	{	memcpy( host, spec, pp - spec);
+		host[pp - spec] = '\0';
+		strcpy( port, pp + 1);
+	}
+
+	if (port[0] == '\0' || strspn( port, "0123456789") != strlen( port))
+		return (errNetAddr);
+
+	return (errOk);
+}
+
+/*****************************************************************************
+* Look up an address.
+*
+* Returns:
+*    errOk, or errNetAddr.
+*****************************************************************************/
+static uint netResolve( const char *spec, bool passive, bool *udp,
+		struct sockaddr_storage *sa, socklen_t *saLen)
+{
+	struct addrinfo	hints, *res;
+	char			host[NET_ADDR_SZ], port[NET_ADDR_SZ];
+	uint			err;
+
+	err = netSplit( spec, udp, host, port);
+
+	if (err)
+		return (err);
+
+	if (host[0] == '\0' && !passive)
+		return (errNetAddr);						// the sender needs a host
+
+	memset( &hints, 0, sizeof( hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = *udp ? SOCK_DGRAM : SOCK_STREAM;
+	hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+	if (getaddrinfo( host[0] != '\0' ? host : NULL, port, &hints, &res) != 0)
+		return (errNetAddr);
+
+	memcpy( sa, res->ai_addr, res->ai_addrlen);
+	*saLen = res->ai_addrlen;
+	freeaddrinfo( res);
+	return (errOk);
+}
+
+/*****************************************************************************
+* Receive without waiting, noting when the data arrived.
+*
+* The time is the kernel's, taken as the data came in, so a packet isn't
+* made late by being read late.  Needs SO_TIMESTAMPNS on the socket, it is
+* given on the realtime clock and moved to the monotonic one.
+*
+* Called with:
+*    from, fromLen = Set to the sender, may be NULL.
+*    atNs          = Set to the time the data arrived, may be NULL.
+*
+* Returns as 'recv()'.
+*****************************************************************************/
+static ssize_t netRecv( int fd, uchar *mem, uint count, struct sockaddr_storage *from,
+		socklen_t *fromLen, long long int *atNs)
+{
+	struct msghdr	mh;
+	struct iovec	iov;
+	struct cmsghdr	*cm;
+	struct timespec	ts, now;
+	ssize_t			len;
+
+	union
+	{	struct cmsghdr	align;
+		char			buf[CMSG_SPACE( sizeof( struct timespec))];
+	} ctl;
+
+	memset( &mh, 0, sizeof( mh));
+	iov.iov_base = mem;
+	iov.iov_len = count;
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_name = from;
+	mh.msg_namelen = from != NULL ? sizeof( *from) : 0;
+	mh.msg_control = ctl.buf;
+	mh.msg_controllen = sizeof( ctl.buf);
+
+	len = recvmsg( fd, &mh, MSG_DONTWAIT);
+
+	if (len < 0)
+		return (len);
+
+	if (fromLen != NULL)
+		*fromLen = mh.msg_namelen;
+
+	if (atNs == NULL)
+		return (len);
+
+	*atNs = tmrReadTimer();
+
+	for (cm = CMSG_FIRSTHDR( &mh); cm != NULL; cm = CMSG_NXTHDR( &mh, cm))
+	{
+		if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPNS)
+		{	memcpy( &ts, CMSG_DATA( cm), sizeof( ts));
+			clock_gettime( CLOCK_REALTIME, &now);
+			*atNs -= (now.tv_sec - ts.tv_sec) * 1000000000LL + now.tv_nsec - ts.tv_nsec;
+		}
+	}
+	return (len);
+}
+
+/*****************************************************************************
+* Read a packet without waiting.
+*
+* Called with:
+*    from, fromLen = Set to the sender, UDP.
+*    atNs          = Set to the time the packet arrived, may be NULL.
+*
+* Returns:
+*    1 if a packet was read, 0 if none is waiting, -1 if the connection was
+*    closed or failed.
+*****************************************************************************/
+static int netRead( int fd, bool udp, NetRead_s *rd, struct sockaddr_storage *from,
+		socklen_t *fromLen, long long int *atNs)
+{
+	ZvgNetPkt_s	*pkt;
+	uint		want;
+	ssize_t		len;
+
+	pkt = &rd->in.pkt;
+
+	// UDP, a packet is a datagram, anything not one of ours is skipped
+
+	while (udp)
+	{	len = netRecv( fd, rd->in.buf, NET_PKT_MAX, from, fromLen, atNs);
+
+		if (len < 0)
+			return ((errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR
+					|| errno == ECONNREFUSED) ? 0 : -1);
+
+		if ((size_t)len < sizeof( ZvgNetPkt_s))
+			continue;
+
+		netOrder( pkt, zFalse);
+
+		if (pkt->magic == NET_MAGIC && pkt->len <= NET_PAYLOAD_SZ && (size_t)len == sizeof( ZvgNetPkt_s) + pkt->len)
+			return (1);
+	}
+
+	// TCP, the header and then its payload
+
+	while (zTrue)
+	{	want = sizeof( ZvgNetPkt_s);
+
+		if (rd->fill >= want)
+			want += ntohs( pkt->len);
+
+		if (rd->fill == want)
+			break;
+
+		len = netRecv( fd, rd->in.buf + rd->fill, want - rd->fill, NULL, NULL, atNs);
+
+		if (len == 0)
+			return (-1);
+
+		if (len < 0)
+			return ((errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1);
+
+		rd->fill += len;
+
+		if (rd->fill == sizeof( ZvgNetPkt_s)
+				&& (ntohl( pkt->magic) != NET_MAGIC || ntohs( pkt->len) > NET_PAYLOAD_SZ))
+			return (-1);								// lost our place in the stream
+	}
+
+	rd->fill = 0;
+	netOrder( pkt, zFalse);
+	return (1);
+}
+
+/*****************************************************************************
+* Send a packet, or a run of them over TCP.
+*
+* Returns:
+*    zTrue if sent.
+*****************************************************************************/
+static bool netWrite( int fd, const uchar *mem, uint count, const struct sockaddr_storage *to, socklen_t toLen)
+{
+	ssize_t	len;
+
+	while (count > 0)
+	{	len = sendto( fd, mem, count, MSG_NOSIGNAL, (const struct sockaddr *)to, toLen);
+
+		if (len < 0 && errno == EINTR)
+			continue;
+
+		if (len < 0)
+			return (errno == ECONNREFUSED);				// UDP, nobody is listening yet
+
+		mem += len;
+		count -= len;
+	}
+	return (zTrue);
+}
+
+/*****************************************************************************
+* Hash the 4 bytes starting a run.
+*****************************************************************************/
+static uint netHash( const uchar *mem)
+{
+	uint	vv;
+
+	vv = mem[0] | (mem[1] << 8) | (mem[2] << 16) | ((uint)mem[3] << 24);
+	return ((vv * 2654435761u) >> (32 - NET_HASH_BITS));
+}
+
+/*****************************************************************************
+* Return the length of the run at 'ref + at' matching 'mem'.
+*****************************************************************************/
+static uint netMatch( const uchar *mem, uint count, const uchar *ref, uint refCount, uint at)
+{
+	uint	ii;
+
+	if (at >= refCount)
+		return (0);
+
+	if (count > refCount - at)
+		count = refCount - at;
+
+	for (ii = 0; ii < count && mem[ii] == ref[at + ii]; ii++)
+		;
+
+	return (ii);
+}
+
+/*****************************************************************************
+* Add literal runs to a coded frame.
+*
+* Returns the new end of the coded frame.
+*****************************************************************************/
+static uint netLiteral( uchar *code, uint op, const uchar *mem, uint count)
+{
+	uint	len;
+
+	while (count > 0)
+	{	len = count > 128 ? 128 : count;
+		code[op++] = len - 1;
+		memcpy( code + op, mem, len);
+		op += len;
+		mem += len;
+		count -= len;
+	}
+	return (op);
+}
+
+/*****************************************************************************
+* Code a frame against a reference frame.
+*
+* The run following the last one copied is tried first, as most of a frame
+* is the reference frame with a few changes.  Otherwise a run starting with
+* the same 4 bytes is looked for, which finds runs that have moved.
+*
+* Returns:
+*    The size of the coded frame, or 0 if it is no smaller than the frame.
+*****************************************************************************/
+static uint netCode( ZvgNet_s *net, const uchar *mem, uint count, const uchar *ref, uint refCount)
+{
+	uchar	*code;
+	uint	ii, lit, op, next, at, len, extra;
+
+	code = net->code;
+	memset( net->hash, 0, sizeof( net->hash));
+
+	for (ii = 0; ii + 4 <= refCount; ii++)
+		net->hash[netHash( ref + ii)] = ii + 1;
+
+	ii = 0;
+	lit = 0;
+	op = 0;
+	next = 0;
+
+	while (ii + NET_MATCH_MIN <= count)
+	{	at = next;
+		len = netMatch( mem + ii, count - ii, ref, refCount, at);
+
+		if (len < NET_MATCH_MIN && net->hash[netHash( mem + ii)] != 0)
+		{	at = net->hash[netHash( mem + ii)] - 1;
+			len = netMatch( mem + ii, count - ii, ref, refCount, at);
+		}
+
+		if (len < NET_MATCH_MIN)
+		{	ii++;
+			continue;
+		}
+
+		op = netLiteral( code, op, mem + lit, ii - lit);
+
+		if (len - NET_MATCH_MIN < 0x7F)
+			code[op++] = 0x80 | (len - NET_MATCH_MIN);
+
+		else
+		{	code[op++] = 0xFF;
+
+			for (extra = len - NET_MATCH_MIN - 0x7F; extra >= 0x80; extra >>= 7)
+				code[op++] = 0x80 | (extra & 0x7F);
+
+			code[op++] = extra;
+		}
+
+		code[op++] = at >> 8;
+		code[op++] = at & 0xFF;
+
+		ii += len;
+		lit = ii;
+		next = at + len;
+
+		if (op >= count)
+			return (0);
+	}
+
+	op = netLiteral( code, op, mem + lit, count - lit);
+	return (op < count ? op : 0);
+}
+
+/*****************************************************************************
+* Decode a frame coded against a reference frame.
+*
+* Returns:
+*    The size of the frame, or -1 if the coded frame is bad.
+*****************************************************************************/
+static int netDecode( const uchar *code, uint codeCount, const uchar *ref, uint refCount, uchar *mem)
+{
+	uint	ip, op, len, at, shift;
+	uchar	cc;
+
+	ip = 0;
+	op = 0;
+
+	while (ip < codeCount)
+	{	cc = code[ip++];
+
+		if (cc < 0x80)
+		{	len = cc + 1;
+
+			if (ip + len > codeCount || op + len > NET_FRAME_MAX)
+				return (-1);
+
+			memcpy( mem + op, code + ip, len);
+			ip += len;
+			op += len;
+			continue;
+		}
+
+		len = (cc & 0x7F) + NET_MATCH_MIN;
+
+		if (cc == 0xFF)
+		{
+			for (shift = 0; ; shift += 7)
+			{
+				if (ip >= codeCount || shift > 21)
+					return (-1);
+
+				cc = code[ip++];
+				len += (cc & 0x7F) << shift;
+
+				if (!(cc & 0x80))
+					break;
+			}
+		}
+
+		if (ip + 2 > codeCount)
+			return (-1);
+
+		at = (code[ip] << 8) | code[ip + 1];
+		ip += 2;
+
+		if (at + len > refCount || op + len > NET_FRAME_MAX)
+			return (-1);
+
+		memcpy( mem + op, ref + at, len);
+		op += len;
+	}
+	return (op);
+}
+
+/*****************************************************************************
+* Connect to the receiver, starting over.
+*
+* Returns:
+*    errOk, or errNetConnect.
+*****************************************************************************/
+static uint netConnect( ZvgNet_s *net)
+{
+	struct pollfd	pfd;
+	struct timeval	tv;
+	socklen_t		len;
+	int				on, err;
+
+	net->tryNs = tmrReadTimer();
+	net->fd = socket( net->addr.ss_family, (net->udp ? SOCK_DGRAM : SOCK_STREAM) | SOCK_CLOEXEC
+			| SOCK_NONBLOCK, 0);
+
+	if (net->fd < 0)
+		return (errNetConnect);
+
+	// a receiver that doesn't answer mustn't hold up the frames for long
+
+	err = 0;
+
+	if (connect( net->fd, (struct sockaddr *)&net->addr, net->addrLen) < 0)
+	{	err = errno;
+
+		if (err == EINPROGRESS)
+		{	pfd.fd = net->fd;
+			pfd.events = POLLOUT;
+			len = sizeof( err);
+
+			if (poll( &pfd, 1, NET_TIMEOUT_MS) != 1
+					|| getsockopt( net->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+				err = ETIMEDOUT;
+		}
+	}
+
+	if (err)
+	{	close( net->fd);
+		net->fd = -1;
+		return (errNetConnect);
+	}
+
+	fcntl( net->fd, F_SETFL, fcntl( net->fd, F_GETFL) & ~O_NONBLOCK);
+
+	on = 1;
+	setsockopt( net->fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof( on));	// for the latency
+
+	tv.tv_sec = 0;
+	tv.tv_usec = NET_TIMEOUT_MS * 1000;
+	setsockopt( net->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof( tv));
+
+	if (!net->udp)
+		setsockopt( net->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on));
+
+	net->acked = zFalse;
+	net->resyncSeq = net->seq;
+	net->rd.fill = 0;
+	memset( net->hist.ok, 0, sizeof( net->hist.ok));
+	return (errOk);
+}
+
+/*****************************************************************************
+* Read the receiver's acknowledgements, without waiting.
+*
+* Returns:
+*    zTrue, or zFalse if the connection was closed.
+*****************************************************************************/
+static bool netAcks( ZvgNet_s *net)
+{
+	ZvgNetPkt_s				*pkt;
+	struct sockaddr_storage	from;
+	socklen_t				fromLen;
+	long long int			rtt, atNs;
+	int						rc;
+
+	pkt = &net->rd.in.pkt;
+
+	while ((rc = netRead( net->fd, net->udp, &net->rd, &from, &fromLen, &atNs)) > 0)
+	{
+		// a frame the receiver couldn't decode, start over
+
+		if (pkt->type == npNak && (int)(pkt->seq - net->resyncSeq) >= 0)
+		{	net->acked = zFalse;
+			net->resyncSeq = net->seq;
+			net->stats.resyncs++;
+			continue;
+		}
+
+		if (pkt->type != npAck || (int)(pkt->seq - net->seq) >= 0)
+			continue;
+
+		net->stats.acks++;
+		rtt = atNs - pkt->sentNs;
+
+		if (rtt >= pkt->latNs)
+			netLatency( &net->stats, (rtt - pkt->latNs) / 2 + pkt->latNs);
+
+		// acknowledgements sent before starting over don't count
+
+		if ((int)(pkt->seq - net->resyncSeq) < 0)
+			continue;
+
+		if (!net->acked || (int)(pkt->seq - net->ackSeq) > 0)
+		{	net->acked = zTrue;
+			net->ackSeq = pkt->seq;
+		}
+	}
+
+	return (rc >= 0);
+}
+
+/*****************************************************************************
+* Drop the connection, after the receiver went away.
+*****************************************************************************/
+static void netDrop( ZvgNet_s *net)
+{
+	close( net->fd);
+	net->fd = -1;
+	net->stats.drops++;
+}
+
+/*****************************************************************************
+* Code and send a frame.
+*
+* While there is no connection the frame is dropped, and it is made again
+* no more often than every NET_RETRY_MS.
+*****************************************************************************/
+static void netFrame( ZvgNet_s *net, const uchar *mem, uint count)
+{
+	ZvgNetPkt_s		hdr, pkt;
+	const uchar		*code;
+	uint			slot, refSlot, coded, off, out, len;
+
+	if (net->fd >= 0 && !netAcks( net))
+		netDrop( net);
+
+	if (net->fd < 0 && (tmrReadTimer() - net->tryNs < NET_RETRY_MS * 1000000LL
+			|| netConnect( net) != errOk))
+	{	net->stats.dropped++;
+		return;
+	}
+
+	memset( &hdr, 0, sizeof( hdr));
+	hdr.magic = NET_MAGIC;
+	hdr.type = npFrame;
+	hdr.seq = net->seq;
+	hdr.size = count;
+	hdr.sum = netSum( mem, count);
+	hdr.sentNs = tmrReadTimer();
+	hdr.latNs = net->stats.latNs;
+
+	// code against the newest frame acknowledged, if it's still kept
+
+	coded = 0;
+	code = mem;
+	refSlot = net->ackSeq % NET_HIST;
+
+	if (net->acked && net->seq - net->ackSeq < NET_HIST
+			&& net->hist.ok[refSlot] && net->hist.seq[refSlot] == net->ackSeq)
+	{	coded = netCode( net, mem, count, net->hist.frame[refSlot], net->hist.size[refSlot]);
+		code = net->code;
+		hdr.ref = net->ackSeq;
+	}
+
+	if (coded == 0)
+	{	coded = count;
+		code = mem;
+		hdr.ref = 0;
+		hdr.flags |= NETF_RAW;
+		net->stats.rawFrames++;
+	}
+
+	if (!net->acked)
+		hdr.flags |= NETF_START;
+
+	hdr.coded = coded;
+
+	// keep it to code against
+
+	slot = net->seq % NET_HIST;
+	memcpy( net->hist.frame[slot], mem, count);
+	net->hist.size[slot] = count;
+	net->hist.seq[slot] = net->seq;
+	net->hist.ok[slot] = zTrue;
+	net->seq++;
+
+	// split into packets, over TCP sent all at once.  The packets are packed,
+	// so each header is copied in rather than written in place.
+
+	out = 0;
+	off = 0;
+
+	do
+	{	len = coded - off > NET_PAYLOAD_SZ ? NET_PAYLOAD_SZ : coded - off;
+		pkt = hdr;
+		pkt.offset = off;
+		pkt.len = len;
+		netOrder( &pkt, zTrue);
+		memcpy( net->out + out, &pkt, sizeof( pkt));
+		memcpy( net->out + out + sizeof( pkt), code + off, len);
+		off += len;
+		out += sizeof( pkt) + len;
+
+		if (net->udp)
+		{
+			if (!netWrite( net->fd, net->out, out, NULL, 0))
+			{	netDrop( net);
+				net->stats.dropped++;
+				return;
+			}
+
+			net->stats.wire += out;
+			out = 0;
+		}
+	} while (off < coded);
+
+	if (!net->udp)
+	{
+		if (!netWrite( net->fd, net->out, out, NULL, 0))
+		{	netDrop( net);						// a part sent, the stream can't be picked up again
+			net->stats.dropped++;
+			return;
+		}
+		net->stats.wire += out;
+	}
+
+	net->stats.frames++;
+	net->stats.bytes += count;
+}
+
+/*****************************************************************************
+* Return the counters of the current board's 'net' transport, all 0 if it
+* isn't using it.
+*****************************************************************************/
+void zvgNetGetStats( ZvgNetStats_s *stats)
+{
+	ZvgNet_s	*net;
+
+	net = ZvgIO.netP;
+
+	if (ZvgIO.trOps != &ZvgTrNet || net == NULL)
+		memset( stats, 0, sizeof( ZvgNetStats_s));
+
+	else
+		*stats = net->stats;
+}
+
+/*****************************************************************************
+* Open the 'net' transport.  The ZVG's replies are those of the 'null'
+* transport.
+*
+* Called with:
+*    portAdr = Not used.
+*    arg     = Receiver, "[udp:|tcp:]host[:port]".
+*
+* Returns:
+*    errOk, errNetAddr, errNetConnect or errMemory.
+*****************************************************************************/
+static uint netOpen( uint portAdr, const char *arg)
+{
+	ZvgNet_s	*net;
+	uint		err;
+
+	if (arg == NULL)
+		return (errNetAddr);
+
+	net = (ZvgNet_s *)calloc( 1, sizeof( ZvgNet_s));
+
+	if (net == NULL)
+		return (errMemory);
+
+	net->fd = -1;
+	err = netResolve( arg, zFalse, &net->udp, &net->addr, &net->addrLen);
+
+	if (!err)
+		err = netConnect( net);
+
+	if (!err)
+		err = ZvgTrNull.open( portAdr, NULL);
+
+	if (err)
+	{
+		if (net->fd >= 0)
+			close( net->fd);
+
+		free( net);
+		return (err);
+	}
+
+	ZvgIO.netP = net;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Close the 'net' transport, may be called more than once.
+*****************************************************************************/
+static void netClose( void)
+{
+	ZvgNet_s	*net;
+
+	net = ZvgIO.netP;
+
+	if (net != NULL)
+	{
+		if (net->fd >= 0)
+			close( net->fd);
+
+		free( net);
+		ZvgIO.netP = NULL;
+	}
+
+	ZvgTrNull.close();
+}
+
+/*****************************************************************************
+* Send a buffer as one or more frames.
+*****************************************************************************/
+static uint netEcpPutMem( uchar *mem, uint memSize)
+{
+	ZvgNet_s	*net;
+	uint		err, count;
+
+	net = ZvgIO.netP;
+	err = ZvgTrNull.ecpPutMem( mem, memSize);		// keeps the replies working
+
+	if (err || net == NULL)
+		return (err);
+
+	while (memSize > 0)
+	{	count = memSize > NET_FRAME_MAX ? NET_FRAME_MAX : memSize;
+		netFrame( net, mem, count);
+		mem += count;
+		memSize -= count;
+	}
+	return (errOk);
+}
+
+// The rest is done as the 'null' transport does it
+
+static void netReset( void)
+{
+	ZvgTrNull.reset();
+}
+
+static uint netSetEcpMode( void)
+{
+	return (ZvgTrNull.setEcpMode());
+}
+
+static void netSetSppMode( void)
+{
+	ZvgTrNull.setSppMode();
+}
+
+static uint netSppPutc( uchar cc)
+{
+	return (ZvgTrNull.sppPutc( cc));
+}
+
+static uint netGetMem( uchar *ss, uint bfrLen, uint *aReadLen)
+{
+	return (ZvgTrNull.getMem( ss, bfrLen, aReadLen));
+}
+
+static uint netGetDeviceID( uchar *ss, uint idLen, uint *aReadLen)
+{
+	return (ZvgTrNull.getDeviceID( ss, idLen, aReadLen));
+}
+
+static uint netIsDataAvail( uint aTime)
+{
+	return (ZvgTrNull.isDataAvail( aTime));
+}
+
+const ZvgTransport_s	ZvgTrNet =
+{	"net",
+	netOpen, netClose, netReset, netSetEcpMode, netSetSppMode,
+	netEcpPutMem, netSppPutc, netGetMem, netGetDeviceID, netIsDataAvail
+};
+
+/*****************************************************************************
+* Forget the frames received, for a new sender.
+*****************************************************************************/
+static void rxReset( ZvgNetRx_s *rx)
+{
+	rx->busy = zFalse;
+	rx->started = zFalse;
+	rx->pending = zFalse;
+	rx->rd.fill = 0;
+	memset( rx->hist.ok, 0, sizeof( rx->hist.ok));
+}
+
+/*****************************************************************************
+* Send an acknowledgement, or say a frame couldn't be decoded.
+*****************************************************************************/
+static void rxReply( ZvgNetRx_s *rx, uint type, const ZvgNetPkt_s *frm, long long int holdNs)
+{
+	ZvgNetPkt_s	pkt;
+
+	memset( &pkt, 0, sizeof( pkt));
+	pkt.magic = NET_MAGIC;
+	pkt.type = type;
+	pkt.seq = frm->seq;
+	pkt.sentNs = frm->sentNs;
+	pkt.latNs = holdNs;
+	netOrder( &pkt, zTrue);
+
+	if (rx->fd < 0)
+		return;
+
+	if (rx->udp)
+		netWrite( rx->fd, (uchar *)&pkt, sizeof( pkt), &rx->peer, rx->peerLen);
+
+	else
+		netWrite( rx->fd, (uchar *)&pkt, sizeof( pkt), NULL, 0);
+}
+
+/*****************************************************************************
+* Take a packet, and decode the frame once it has all of them.  'atNs' is
+* the time the packet arrived.
+*
+* Returns:
+*    The frame decoded, NULL if none yet.
+*****************************************************************************/
+static uchar *rxPacket( ZvgNetRx_s *rx, const ZvgNetPkt_s *pkt, long long int atNs)
+{
+	ZvgNetPkt_s	*cur;
+	uint		frags, bit, slot, refSlot;
+	int			size;
+
+	cur = &rx->cur;
+
+	if (pkt->type != npFrame)
+		return (NULL);
+
+	// a sender starting over
+
+	if ((pkt->flags & NETF_START) && !(rx->busy && pkt->seq == cur->seq))
+	{
+		if (rx->started && pkt->seq != rx->lastSeq)
+			rx->stats.resyncs++;
+
+		rx->started = zFalse;
+		rx->busy = zFalse;
+		memset( rx->hist.ok, 0, sizeof( rx->hist.ok));
+	}
+
+	if (rx->started && (int)(pkt->seq - rx->lastSeq) <= 0)
+		return (NULL);								// already had it
+
+	if (rx->busy && pkt->seq != cur->seq)
+	{
+		if ((int)(pkt->seq - cur->seq) < 0)
+			return (NULL);							// late
+
+		rx->busy = zFalse;							// a newer one has started, this one is lost
+	}
+
+	// the packet must fit the frame
+
+	if (pkt->coded > NET_CODE_SZ || pkt->size > NET_FRAME_MAX || pkt->offset % NET_PAYLOAD_SZ
+			|| pkt->offset > pkt->coded || pkt->len != (pkt->coded - pkt->offset > NET_PAYLOAD_SZ
+			? NET_PAYLOAD_SZ : pkt->coded - pkt->offset))
+		return (NULL);
+
+	if (!rx->busy)
+	{	rx->busy = zTrue;
+		rx->cur = *pkt;
+		rx->got = 0;
+		rx->gotCount = 0;
+		rx->startNs = atNs;
+	}
+
+	else if (pkt->coded != cur->coded || pkt->ref != cur->ref || pkt->sum != cur->sum)
+		return (NULL);
+
+	bit = pkt->offset / NET_PAYLOAD_SZ;
+
+	if (rx->got & (1ULL << bit))
+		return (NULL);								// a copy
+
+	memcpy( rx->code + pkt->offset, pkt + 1, pkt->len);
+	rx->got |= 1ULL << bit;
+	rx->gotCount++;
+
+	frags = cur->coded == 0 ? 1 : (cur->coded + NET_PAYLOAD_SZ - 1) / NET_PAYLOAD_SZ;
+
+	if (rx->gotCount < frags)
+		return (NULL);
+
+	// all there, decode it
+
+	rx->busy = zFalse;
+	slot = cur->seq % NET_HIST;
+	refSlot = cur->ref % NET_HIST;
+
+	if (cur->flags & NETF_RAW)
+	{	size = cur->coded;
+		memcpy( rx->hist.frame[slot], rx->code, size);
+	}
+
+	else if (cur->seq - cur->ref - 1 < NET_HIST - 1 && rx->hist.ok[refSlot] && rx->hist.seq[refSlot] == cur->ref)
+		size = netDecode( rx->code, cur->coded, rx->hist.frame[refSlot], rx->hist.size[refSlot],
+				rx->hist.frame[slot]);
+
+	else
+		size = -1;									// don't have its reference
+
+	if (size < 0 || (uint)size != cur->size || netSum( rx->hist.frame[slot], size) != cur->sum)
+	{	rx->stats.lost++;
+		rx->hist.ok[slot] = zFalse;
+		rxReply( rx, npNak, cur, 0);
+		return (NULL);
+	}
+
+	if (rx->started)
+		rx->stats.lost += cur->seq - rx->lastSeq - 1;
+
+	rx->started = zTrue;
+	rx->lastSeq = cur->seq;
+	rx->hist.seq[slot] = cur->seq;
+	rx->hist.size[slot] = size;
+	rx->hist.ok[slot] = zTrue;
+
+	rx->stats.frames++;
+	rx->stats.bytes += size;
+
+	if (cur->flags & NETF_RAW)
+		rx->stats.rawFrames++;
+
+	netLatency( &rx->stats, cur->latNs);
+
+	rx->pending = zTrue;
+	rx->pend = *cur;
+	rx->pendStartNs = rx->startNs;
+	return (rx->hist.frame[slot]);
+}
+
+/*****************************************************************************
+* Listen for a sender.
+*
+* Called with:
+*    rxP  = Set to the receiving end.
+*    addr = Address to listen on, "[udp:|tcp:][host:]port".
+*
+* Returns:
+*    errOk, errNetAddr, errNetConnect or errMemory.
+*****************************************************************************/
+uint zvgNetListen( ZvgNetRx_s **rxP, const char *addr)
+{
+	ZvgNetRx_s		*rx;
+	struct sockaddr_storage	sa;
+	socklen_t		saLen;
+	bool			udp;
+	uint			err;
+	int				fd, on;
+
+	*rxP = NULL;
+	err = netResolve( addr, zTrue, &udp, &sa, &saLen);
+
+	if (err)
+		return (err);
+
+	fd = socket( sa.ss_family, (udp ? SOCK_DGRAM : SOCK_STREAM) | SOCK_CLOEXEC, 0);
+
+	if (fd < 0)
+		return (errNetConnect);
+
+	on = 1;
+	setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on));
+	setsockopt( fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof( on));
+
+	if (bind( fd, (struct sockaddr *)&sa, saLen) < 0 || (!udp && listen( fd, 1) < 0))
+	{	close( fd);
+		return (errNetConnect);
+	}
+
+	rx = (ZvgNetRx_s *)calloc( 1, sizeof( ZvgNetRx_s));
+
+	if (rx == NULL)
+	{	close( fd);
+		return (errMemory);
+	}
+
+	rx->udp = udp;
+	rx->lsn = udp ? -1 : fd;
+	rx->fd = udp ? fd : -1;
+	*rxP = rx;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Stop listening, may be called with NULL.
+*****************************************************************************/
+void zvgNetClose( ZvgNetRx_s *rx)
+{
+	if (rx == NULL)
+		return;
+
+	if (rx->fd >= 0)
+		close( rx->fd);
+
+	if (rx->lsn >= 0)
+		close( rx->lsn);
+
+	free( rx);
+}
+
+/*****************************************************************************
+* Wait for the next frame.
+*
+* A new TCP connection replaces the one before it.  The frame returned
+* stays valid until the next call, and should be acknowledged by
+* 'zvgNetDone()' once it has been sent on.
+*
+* Called with:
+*    rx    = Receiving end.
+*    mem   = Set to the frame, NULL if none came in time.
+*    count = Set to its size.
+*    ms    = Longest time to wait, -1 to wait for ever.
+*
+* Returns:
+*    errOk.
+*****************************************************************************/
+uint zvgNetRecv( ZvgNetRx_s *rx, uchar **mem, uint *count, int ms)
+{
+	struct pollfd			pfd[2];
+	struct sockaddr_storage	from;
+	socklen_t				fromLen;
+	ZvgNetPkt_s				*pkt;
+	long long int			end, left, atNs;
+	uchar					*frame;
+	uint					nfds;
+	int						rc, fd;
+
+	*mem = NULL;
+	*count = 0;
+	pkt = &rx->rd.in.pkt;
+	end = tmrReadTimer() + ms * 1000000LL;
+
+	while (zTrue)
+	{
+		// take what has already come in
+
+		while (rx->fd >= 0 && (rc = netRead( rx->fd, rx->udp, &rx->rd, &from, &fromLen, &atNs)) != 0)
+		{
+			if (rc < 0 && rx->udp)
+				break;
+
+			if (rc < 0)
+			{	close( rx->fd);						// the sender went away
+				rx->fd = -1;
+				rxReset( rx);
+				break;
+			}
+
+			rx->stats.wire += sizeof( ZvgNetPkt_s) + pkt->len;
+
+			if (rx->udp)
+			{	rx->peer = from;
+				rx->peerLen = fromLen;
+			}
+
+			frame = rxPacket( rx, pkt, atNs);
+
+			if (frame != NULL)
+			{	*mem = frame;
+				*count = rx->pend.size;
+				return (errOk);
+			}
+		}
+
+		// wait for more
+
+		nfds = 0;
+
+		if (rx->lsn >= 0)
+		{	pfd[nfds].fd = rx->lsn;
+			pfd[nfds++].events = POLLIN;
+		}
+
+		if (rx->fd >= 0)
+		{	pfd[nfds].fd = rx->fd;
+			pfd[nfds++].events = POLLIN;
+		}
+
+		left = ms < 0 ? -1 : (end - tmrReadTimer() + 999999LL) / 1000000LL;
+
+		if (ms >= 0 && left <= 0)
+			return (errOk);
+
+		rc = poll( pfd, nfds, (int)left);
+
+		if (rc <= 0)
+		{
+			if (rc < 0 && errno != EINTR)
+				return (errOk);
+
+			continue;
+		}
+
+		if (rx->lsn >= 0 && (pfd[0].revents & POLLIN))
+		{	fd = accept4( rx->lsn, NULL, NULL, SOCK_CLOEXEC);
+
+			if (fd >= 0)
+			{
+				if (rx->fd >= 0)
+					close( rx->fd);
+
+				rc = 1;
+				setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &rc, sizeof( rc));
+				setsockopt( fd, SOL_SOCKET, SO_TIMESTAMPNS, &rc, sizeof( rc));
+				rx->fd = fd;
+				rxReset( rx);
+			}
+		}
+	}
+}
+
+/*****************************************************************************
+* Acknowledge the frame returned by 'zvgNetRecv()', once it has been sent
+* on.  The sender codes its frames against it from then on.
+*****************************************************************************/
+void zvgNetDone( ZvgNetRx_s *rx)
+{
+	if (!rx->pending)
+		return;
+
+	rx->pending = zFalse;
+	rx->stats.acks++;
+	rxReply( rx, npAck, &rx->pend, tmrReadTimer() - rx->pendStartNs);
+}
+
+/*****************************************************************************
+* Return the receiving end's counters.  The latencies are those the sender
+* measured.
+*****************************************************************************/
+void zvgNetRecvStats( ZvgNetRx_s *rx, ZvgNetStats_s *stats)
+{
+	*stats = rx->stats;
+}
@@ -6,6 +6,56 @@
 * Created: 11/06/02
 *
 * History:
+*    10/18/26
+*       Added the real-time sender thread, see 'zvgRt.c'. Frame buffers are
+*       sent by that thread when the 'R' or 'C' attributes are given in
+*       'ZVGPORT='. Send times and FIFO stalls are now measured.
+*
+*       The handshake waits now spin briefly and then sleep, see
+*       'waitForPort()'. Set by 'zvgSetWaitPolicy()' or the 'W' attribute.
+*
+*       The port operations now go through a transport, see 'zvgTrans.c'.
+*       Direct port I/O is the default, selected by 'zvgSetTransport()' or
+*       the 'T' attribute of 'ZVGPORT='.
+*
+*       Port I/O can be hooked through 'ZvgIO.ioHookP', used by the 'sim'
+*       transport to run this code against a simulated port and ZVG.
+*
+*       Frames sent by 'zvgDmaSendSwap()' can be captured to a file, see
+*       'zvgCap.c'. Started by 'zvgCapStart()' or the 'F' attribute.
+*
+*       The times the FIFO is found full are now counted.  The direct port
+*       I/O can write the FIFO in bursts, set by 'zvgSetBurst()'.
+*
+*       Sends, FIFO stalls, readbacks and mode changes are recorded when
+*       tracing, see 'zvgTrace.c'. Started by the 'E' attribute.
+*
+*       Frame counters can be published to shared memory for 'zvgTop', see
+*       'zvgShm.c'. Started by the 'S' attribute.
+*
+*       The 'N' attribute turns off the device info cache, see 'zvgCache.c'.
+*
+*       If no port address or transport is given, the port the ZVG is on is
+*       looked for, see 'zvgDetect.c'.  'ZVGPORT=' is no longer required.
+*
+*       A link lost while sending frames is recovered in the background,
+*       frames are dropped until it is back, see 'zvgLink.c'.  Turned off
+*       by the 'L0' attribute.
+*
+*       The ZVG can be read from between frames without stopping them, see
+*       'zvgReadback.c'.  The reply parsing was split out of
+*       'zvgReadMonitorInfo()' and 'zvgReadSpeedInfo()' to be shared.
+*
+*       Each buffer sent or dropped is reported through the eventfd and
+*       feedback in 'zvgRt.c', for programs built around 'poll()'.
+*
+*       'ZvgIO' is now the current board's, so one process can drive
+*       several ZVGs, see 'zvgBoard.c'.  Board N is setup from 'ZVGPORTN='.
+*
+*       The FIFO full and data available waits can sleep on the port's
+*       interrupt instead of polling, see 'zvgIrq.c'.  Set by WAIT_IRQ or
+*       'W3'.
+*
 *    07/01/03
 *       Added a bit to monitor type in 'ZVGPORT=' to indicate a B&W monitor
 *       is connected to the ZVG, to allow Color to B&W mix down.
@@ -31,21 +81,134 @@
 *****************************************************************************/
 #include	<sys/io.h>
 
+#include	<errno.h>
 #include	<stdlib.h>
 #include	<string.h>
 #include	<ctype.h>
 #include	<stdio.h>
+#include	<time.h>
 
 #include	"zstddef.h"
 #include	"zvgCmds.h"
 #include	"timer.h"
 #include	"zvgPort.h"
+#include	"zvgCap.h"
+#include	"zvgDetect.h"
+#include	"zvgLink.h"
+#include	"zvgReadback.h"
+#include	"zvgShm.h"
+#include	"zvgTrace.h"
 //#include	"zvgError.h"
 
-ZvgIO_s	ZvgIO;							// Structure used to communicate with ZVG
+ZvgIO_s	ZvgBoardIO[ZVG_BOARDS];			// Structure used to communicate with each ZVG
 
 static const uchar IrqLookup[] = { 0, 7, 9, 10, 11, 14, 15, 5};
 
+// Settings read from 'ZVGPORT=' by 'zvgEnv()'
+
+typedef struct ZVGENV_S
+{	uint	portAdr;					// 'P', port address
+	uint	monitor;					// 'M', MONF_xxx flags
+	int		rtPrio;						// 'R', real-time priority
+	int		rtCpu;						// 'C', sender CPU
+	uint	wait;						// 'W', wait policy
+	char	trSpec[TR_SPEC_SZ];			// 'T', transport
+	char	capName[CAP_NAME_SZ];		// 'F', capture file
+	char	traceName[TRACE_NAME_SZ];	// 'E', event trace file
+	char	shmName[SHM_NAME_SZ];		// 'S', stats segment
+	bool	noCache;					// 'N', no device info cache
+	bool	linkOff;					// 'L0', no link recovery
+} ZvgEnv_s;
+
+/*****************************************************************************
+* Wait for a port register to match (or not match) a given value.
+*
+* The register is polled flat out for 'ZvgIO.waitSpinNs', which covers the
+* usual handshake.  After that the routine sleeps between polls, starting
+* with a short sleep and doubling it up to 'ZvgIO.waitSleepNs', so a slow
+* ZVG doesn't keep a CPU busy.  If 'ZvgIO.waitSleepNs' is 0 it never sleeps.
+*
+* If the wait is one the port can interrupt for, and the interrupt is being
+* used, it only polls for WAIT_IRQ_SPIN and then sleeps on the interrupt
+* instead, see 'zvgIrq.c'.
+*
+* The timer is only read once every WAIT_POLLS reads of the register.
+*
+* Called with:
+*    port    = Address of register to poll.
+*    mask    = Bitmask used to mask register before comparison.
+*    testVal = Masked value to compare against.
+*    equal   = If set, wait for a match, else wait for a mismatch.
+*    ms      = Timeout in milliseconds.
+*    irq     = IRQ_FIFO or IRQ_DATA if the match raises that interrupt,
+*              otherwise IRQ_NONE.
+*
+* Returns the value read from the register, or ZVG_TIMEOUT (-1) if routine
+* timed out while waiting.
+*****************************************************************************/
+static uint waitForPort( uint port, uchar mask, uchar testVal, bool equal, ulong ms, uint irq)
+{
+	uchar			readVal;
+	uint			ii, irqVal;
+	long long int	now, spinEnd, timeout, sleepNs;
+	struct timespec	ts;
+
+	now = tmrReadTimer();
+	timeout = now + (long long int)ms * 1000000LL;
+
+	if (irq != IRQ_NONE && ZvgIO.irqStatus.on)
+		spinEnd = now + WAIT_IRQ_SPIN * 1000LL;	// the interrupt wakes us soon enough
+
+	else
+		spinEnd = now + ZvgIO.waitSpinNs;
+
+	sleepNs = WAIT_MIN_SLEEP;
+
+	// loop until match found, or timeout
+
+	while (1)
+	{
+		for (ii = 0; ii < WAIT_POLLS; ii++)
+		{
+			readVal = inportb( port);
+
+			if (((readVal & mask) == testVal) == equal)
+				return (readVal);
+		}
+
+		now = tmrReadTimer();
+
+		if (now >= timeout)
+			return (ZVG_TIMEOUT);					// match not found, return error
+
+		// done spinning?  Then sleep on the interrupt, or back off.  A sleep
+		// that timed out goes back to polling, until the wait itself times out.
+
+		if (irq != IRQ_NONE && ZvgIO.irqStatus.on && now >= spinEnd)
+		{
+			irqVal = zvgIrqWait( irq, port, mask, testVal, equal, timeout - now);
+
+			if (irqVal != ZVG_TIMEOUT)
+				return (irqVal);
+		}
+
+		else if (ZvgIO.waitSleepNs > 0 && now >= spinEnd)
+		{
+			if (sleepNs > timeout - now)
+				sleepNs = timeout - now;
+
+			ts.tv_sec = sleepNs / 1000000000LL;
+			ts.tv_nsec = sleepNs % 1000000000LL;
+			nanosleep( &ts, NULL);
+
+			sleepNs *= 2;
+
+			if (sleepNs > ZvgIO.waitSleepNs)
+				sleepNs = ZvgIO.waitSleepNs;
+		}
+	}
+}
+
 /*****************************************************************************
 * Wait for the DSR to equal the given value.
 *
@@ -59,26 +222,11 @@ static const uchar IrqLookup[] = { 0, 7, 9, 10, 11, 14, 15, 5};
 *****************************************************************************/
 static uint waitForDsrEQ( uchar mask, uchar bitVal, ulong ms)
 {
-	uchar		testVal;
-	uchar		readVal;
-	long long int	timer;
-	bool		foundF;
-
-	testVal = (bitVal ^ DSR_InvMask) & mask;
-	foundF = zFalse;
-	//tmrReadTimer(&timer);					// read timer value
-	timer = tmrReadTimer();
-	// loop until match found, or timeout
+	uint	readVal;
 
-	do
-	{
-		if (((readVal = inportb( ZvgIO.ecpDsr)) & mask) == testVal)
-		{	foundF = zTrue;				// indicate match was found
-			break;
-		}
-	} while (!tmrTestMillis( timer, ms));
+	readVal = waitForPort( ZvgIO.ecpDsr, mask, (bitVal ^ DSR_InvMask) & mask, zTrue, ms, IRQ_NONE);
 
-	if (!foundF)				
+	if (readVal == ZVG_TIMEOUT)				
 		return (ZVG_TIMEOUT);			// match not found, return error
 
 	return (readVal ^ DSR_InvMask);	// fix logic and return value
@@ -98,24 +246,11 @@ static uint waitForDsrEQ( uchar mask, uchar bitVal, ulong ms)
 *****************************************************************************/
 static uint	waitForDsrNE( uchar mask, uchar bitVal, ulong ms)
 {
-	uchar		testVal;
-	uchar		readVal;
-	long long int		timer;
-	bool		foundF;
-
-	testVal = ( bitVal ^ DSR_InvMask) & mask;
-	foundF = zFalse;
-	//tmrReadTimer(&timer);
-	timer = tmrReadTimer();
-	do
-	{
-		if (((readVal = inportb( ZvgIO.ecpDsr)) & mask) != testVal)
-		{	foundF = zTrue;
-			break;
-		}
-	} while (!tmrTestMillis( timer, ms));
+	uint	readVal;
+
+	readVal = waitForPort( ZvgIO.ecpDsr, mask, (bitVal ^ DSR_InvMask) & mask, zFalse, ms, IRQ_NONE);
 
-	if (!foundF)
+	if (readVal == ZVG_TIMEOUT)
 		return (ZVG_TIMEOUT);
 
 	return (readVal ^ DSR_InvMask);
@@ -128,33 +263,84 @@ static uint	waitForDsrNE( uchar mask, uchar bitVal, ulong ms)
 *    mask   = Bitmask used to mask DSR before comparison.
 *    bitVal = Bit values, that when matched, causes routine to return.
 *    ms     = Timeout in milliseconds.
+*    irq    = Interrupt raised by the match, see 'waitForPort()'.
 *
 * Returns all (unmasked bits) of ECR when a match is found, or returns
 * ZVG_TIMEOUT (-1) if routine timed out while waiting for match.
 *****************************************************************************/
-static uint waitForEcrEQ( uchar mask, uchar bitVal, ulong ms)
+static uint waitForEcrEQ( uchar mask, uchar bitVal, ulong ms, uint irq)
 {
-	uchar			testVal;
-	uchar			readVal;
-	long long int	timer;
-	bool			foundF;
-
-	testVal = bitVal & mask;
-	foundF = zFalse;
-	//tmrReadTimer(&timer);
-	timer = tmrReadTimer();
-	do
+	return (waitForPort( ZvgIO.ecpEcr, mask, bitVal & mask, zTrue, ms, irq));
+}
+
+/*****************************************************************************
+* Set the policy used while waiting on the ZVG.
+*
+* Called with:
+*    policy = WAIT_SPIN     - Never sleep. Lowest latency, but keeps a CPU
+*                             busy while the ZVG draws.
+*             WAIT_BALANCED - Spin a little, then sleep in short bursts.
+*             WAIT_POWER    - Spin briefly, then sleep for up to a ms.
+*             WAIT_IRQ      - Spin a little, then sleep on the port's
+*                             interrupt while the FIFO is full or the ZVG
+*                             has no data.  Balanced if it can't be used.
+*****************************************************************************/
+void zvgSetWaitPolicy( uint policy)
+{
+	ZvgIO.waitIrq = (policy == WAIT_IRQ);
+
+	switch (policy)
 	{
-		if (((readVal = inportb( ZvgIO.ecpEcr)) & mask) == testVal)
-		{	foundF = zTrue;
-			break;
-		}
-	} while (!tmrTestMillis( timer, ms));
+	case WAIT_SPIN:
+		zvgSetWaitTimes( 0, 0);
+		break;
 
-	if (!foundF)
-		return (ZVG_TIMEOUT);
+	case WAIT_POWER:
+		zvgSetWaitTimes( WAIT_POWER_SPIN, WAIT_POWER_SLEEP);
+		break;
+
+	default:
+		zvgSetWaitTimes( WAIT_BALANCED_SPIN, WAIT_BALANCED_SLEEP);
+		break;
+	}
+}
+
+/*****************************************************************************
+* Set custom wait times.
+*
+* Called with:
+*    spinUs  = Microseconds to poll before starting to sleep.
+*    sleepUs = Longest sleep between polls in microseconds, this bounds the
+*              extra latency added to a handshake.  If 0, never sleep.
+*****************************************************************************/
+void zvgSetWaitTimes( uint spinUs, uint sleepUs)
+{
+	ZvgIO.waitSpinNs = (long long int)spinUs * 1000LL;
+	ZvgIO.waitSleepNs = (long long int)sleepUs * 1000LL;
+
+	if (ZvgIO.waitSleepNs != 0 && ZvgIO.waitSleepNs < WAIT_MIN_SLEEP)
+		ZvgIO.waitSleepNs = WAIT_MIN_SLEEP;
+
+	ZvgIO.waitSet = zTrue;
+}
+
+/*****************************************************************************
+* Set the burst size used by the direct port I/O.
+*
+* With bursts, the ECR is read once and, if the FIFO is empty, up to 'size'
+* bytes are written to it without checking it again.  Only the direct port
+* I/O (and the simulator, which runs the same code) use bursts.
+*
+* Called with:
+*    size = Bytes written per burst, 0 turns bursts off.  Limited to
+*           ECP_FIFO_SZ, the smallest FIFO a port is expected to have.
+*****************************************************************************/
+void zvgSetBurst( uint size)
+{
+	if (size > ECP_FIFO_SZ)
+		size = ECP_FIFO_SZ;
 
-	return (readVal);
+	ZvgIO.ecpBurst = size;
 }
 
 /*****************************************************************************
@@ -217,6 +403,8 @@ static uchar rdsr( void)
 *****************************************************************************/
 static uint compatibility( void)
 {
+	zvgTraceMark( teCompat, 0);
+
 	ZvgIO.ecpFlags &= ~(ECPF_ECP | ECPF_NIBBLE);		// turn off MODE flags
 
 	// Set the status lines to compatibility mode:
@@ -432,16 +620,54 @@ static uint isDataAvail( void)
 }
 
 /*****************************************************************************
-* Look for the 'ZVGPORT=' environment variable and parse it.
+* Copy the name given to an attribute of 'ZVGPORT=', up to the next blank.
+*
+* Called with:
+*    envPP = Points to the name, left past it.
+*    name  = Filled in with the name.
+*    size  = Size of 'name'.
+*
+* Returns:
+*    Length of the name, 0 if none was given, or -1 if it's too long.
+*****************************************************************************/
+static int envName( char **envPP, char *name, uint size)
+{
+	char	*envP;
+	uint	ii;
+
+	envP = *envPP;
+
+	for (ii = 0; *envP != ' ' && *envP != '\0'; ii++, envP++)
+	{
+		if (ii >= size-1)
+			return (-1);
+
+		name[ii] = *envP;
+	}
+
+	name[ii] = '\0';
+	*envPP = envP;
+	return ((int)ii);
+}
+
+/*****************************************************************************
+* Look for the 'ZVGPORT=' environment variable and parse it, 'ZVGPORTN='
+* for board N.
+*
+* Values not given in 'ZVGPORT=' are left unchanged.
+*
+* Called with:
+*    set = Filled in with the values given.
 *
 * Returns:
 *    errCode
 *****************************************************************************/
-uint zvgEnv( uint *portAdr, uint *monitor)
+uint zvgEnv( ZvgEnv_s *set)
 {
 	char	*env, *envP, cmd;
+	int		len;
 
-	env = getenv("ZVGPORT");				// look for environment variable
+	env = zvgBoardEnv();					// look for the board's environment variable
 
 	if (env == NULL)
 		return (errNoEnv);					// no environment variable found
@@ -454,7 +680,11 @@ uint zvgEnv( uint *portAdr, uint *monitor)
 		while (*envP == ' ')					// skip leading blanks
 			envP++;
 
+		if (*envP == '\0')
+			break;								// only blanks were left
+
 		cmd = toupper( *envP);
+
 		envP++;									// skip command character
 
 		while (*envP == ' ')
@@ -468,14 +698,80 @@ uint zvgEnv( uint *portAdr, uint *monitor)
 			if (!isdigit( *envP))
 				return (errEnvPort);			// bad environment port value
 
-			*portAdr = strtoul( envP, &envP, 16);	// read port address
+			set->portAdr = strtoul( envP, &envP, 16);	// read port address
 			break;
 
 		case 'M':								// or check for 'M'onitor type
 			if (!isdigit( *envP))
 				return (errEnvMon);			// bad environment monitor value
 
-			*monitor = strtoul( envP, &envP, 10);		// read monitor type
+			set->monitor = strtoul( envP, &envP, 10);		// read monitor type
+			break;
+
+		case 'R':								// or check for 'R'eal-time priority
+			if (!isdigit( *envP))
+				return (errEnvRT);			// bad environment priority value
+
+			set->rtPrio = strtoul( envP, &envP, 10);
+
+			if (set->rtPrio > RT_PRIO_MAX)
+				return (errEnvRT);
+			break;
+
+		case 'C':								// or check for sender 'C'PU
+			if (!isdigit( *envP))
+				return (errEnvCPU);			// bad environment CPU value
+
+			set->rtCpu = strtoul( envP, &envP, 10);
+			break;
+
+		case 'W':								// or check for 'W'ait policy
+			if (!isdigit( *envP))
+				return (errEnvWait);			// bad environment wait value
+
+			set->wait = strtoul( envP, &envP, 10);
+
+			if (set->wait > WAIT_IRQ)
+				return (errEnvWait);
+			break;
+
+		case 'T':								// or check for 'T'ransport
+			if (envName( &envP, set->trSpec, TR_SPEC_SZ) <= 0)
+				return (errEnvTrans);			// none given, or too long
+			break;
+
+		case 'F':								// or check for capture 'F'ile
+			if (envName( &envP, set->capName, CAP_NAME_SZ) <= 0)
+				return (errCapOpen);			// none given, or too long
+			break;
+
+		case 'E':								// or check for 'E'vent trace file
+			if (envName( &envP, set->traceName, TRACE_NAME_SZ) <= 0)
+				return (errTraceOpen);			// none given, or too long
+			break;
+
+		case 'S':								// or check for 'S'hared memory stats
+			len = envName( &envP, set->shmName, SHM_NAME_SZ);
+
+			if (len < 0)
+				return (errShmOpen);			// name is too long
+
+			if (len == 0 && ZvgCurBoard == 0)
+				strcpy( set->shmName, SHM_DEF_NAME);	// no name given, use the default
+
+			else if (len == 0)						// the default, with the board's number
+				snprintf( set->shmName, SHM_NAME_SZ, SHM_DEF_NAME "%u", ZvgCurBoard);
+			break;
+
+		case 'N':								// or check for 'N'o device info cache
+			set->noCache = zTrue;
+			break;
+
+		case 'L':								// or check for 'L'ink recovery
+			if (!isdigit( *envP))
+				return (errEnvLink);			// bad environment link value
+
+			set->linkOff = strtoul( envP, &envP, 10) == 0;
 			break;
 		}
 	}
@@ -512,8 +808,9 @@ uint zvgDetectECP( uint portAdr)
 
 	ZvgIO.ecpFlags = 0;
 
-	// Claim port access
-	err = iopl(3);
+	// Claim port access, unless port I/O is hooked
+	if (ZvgIO.ioHookP == NULL)
+		err = iopl(3);
 	if (err)
 	{
 		return(1);
@@ -603,40 +900,113 @@ void zvgGetPortInfo( uint *aPORT, uint *aMON)
 uint zvgInit( void)
 {
 	uint				err, ii;
-	uint				envPort, envMode;
+	ZvgEnv_s			env;
 
-	envPort = (uint)-1;				// mark as non-existant
-	envMode = (uint)-1;				// mark as non-existant
+	memset( &env, 0, sizeof( env));		// the names are empty, not given
+	env.portAdr = (uint)-1;				// mark as non-existant
+	env.monitor = (uint)-1;				// mark as non-existant
+	env.rtPrio = -1;					// mark as non-existant
+	env.rtCpu = -1;						// mark as non-existant
+	env.wait = (uint)-1;				// mark as non-existant
+	env.noCache = ZvgIO.cacheOff;		// may have been set by the caller
+	env.linkOff = ZvgIO.linkOff;
 
-	ZvgIO.envMonitor = (uint)-1;			// mark as non-existant
+	if (!(ZvgIO.rtStatus.flags & RTF_REQUESTED))
+		zvgRtConfig( 0, RT_NO_CPU);			// no real-time mode, unless asked for
 
 	tmrInit();					// initialize timers
 	tmrSetFrameRate(60);				// set the frame rate
 
 	// read the 'ZVGPORT=' environment variable
 
-	err = zvgEnv( &envPort, &ZvgIO.envMonitor);
+	ZvgIO.cacheUsed = zFalse;
+	ZvgIO.linkArmed = zFalse;
+	ZvgIO.rtFeedOn = zFalse;
+	ZvgIO.linkDropped = 0;
 
-	if (err)
+	err = zvgEnv( &env);
+
+	ZvgIO.envMonitor = env.monitor;
+	ZvgIO.cacheOff = env.noCache;
+	ZvgIO.linkOff = env.linkOff;
+
+	if (err && err != errNoEnv)					// without 'ZVGPORT=', the port is looked for
 		return (err);
 
-	if (envPort == (uint)-1)
-		return (errNoPort);						// no port address given, can't continue
+	// start tracing first, so opening the port is traced as well
+
+	if (env.traceName[0] != '\0' && !ZvgIO.traceEnv)
+	{	err = zvgTraceStart( 0, env.traceName);
+
+		if (err)
+			return (err);
+
+		ZvgIO.traceEnv = zTrue;
+	}
+
+	// a transport in 'ZVGPORT=' overrides the caller's, default is direct I/O
+
+	if (env.trSpec[0] != '\0')
+	{	err = zvgSetTransport( env.trSpec);
+
+		if (err)
+			return (err);
+	}
+
+	else if (ZvgIO.trOps == NULL)
+		zvgSetTransport( ZvgTrDirect.name);
+
+	// a wait policy in 'ZVGPORT=' overrides the caller's, default is balanced
+
+	if (env.wait != (uint)-1)
+		zvgSetWaitPolicy( env.wait);
+
+	else if (!ZvgIO.waitSet)
+		zvgSetWaitPolicy( WAIT_BALANCED);
+
+	// real-time values given in 'ZVGPORT=' override those given by the caller
+
+	if (env.rtPrio != -1 || env.rtCpu != -1)
+	{
+		if (env.rtPrio == -1)
+			env.rtPrio = ZvgIO.rtStatus.prio;
+
+		if (env.rtCpu == -1)
+			env.rtCpu = ZvgIO.rtStatus.cpu;
+
+		zvgRtConfig( env.rtPrio, env.rtCpu);
+	}
+
+	// only direct port I/O needs a port address, if none was given look for the ZVG
+
+	if (ZvgIO.trOps == &ZvgTrDirect && env.portAdr == (uint)-1)
+	{	err = zvgDetect( env.trSpec, &env.portAdr);
+
+		if (err)
+			return (err);							// no ZVG found, can't continue
+
+		err = zvgSetTransport( env.trSpec);
+
+		if (err)
+			return (err);
+	}
 
 	// check for a monitor type, if not, set a default value
 
 	if (ZvgIO.envMonitor == (uint)-1)
 		ZvgIO.envMonitor = MONF_SPOTKILL;	// handle spotkiller by default
 
-	err = zvgDetectECP( envPort);				// validate ECP port, get chipset DMA and IRQ
+	ZvgIO.irqStatus.err = EOPNOTSUPP;		// until the direct port I/O sets up the interrupt
+
+	err = ZvgIO.trOps->open( env.portAdr, ZvgIO.trArg);	// validate ECP port, or open transport
 
 	if (err)
 		return (err);
 
-	// Allocate two buffers
+	// Allocate two buffers, prefaulted (and locked if in real-time mode)
 
-	ZvgIO.dmaBf1P = (uchar*)(malloc( MEM_BFR_SZ ));
-	ZvgIO.dmaBf2P = (uchar*)(malloc( MEM_BFR_SZ ));
+	ZvgIO.dmaBf1P = zvgRtAlloc( MEM_BFR_SZ);
+	ZvgIO.dmaBf2P = zvgRtAlloc( MEM_BFR_SZ);
 
 	if (ZvgIO.dmaBf1P == 0 || ZvgIO.dmaBf2P == 0)
 		return (errMemory);
@@ -657,6 +1027,27 @@ uint zvgInit( void)
 
 	err = zvgDmaSendSwap();
 
+	// start capturing frames if asked for, after the NOPs so that only real
+	// frames are captured
+
+	if (!err && env.capName[0] != '\0')
+		err = zvgCapStart( env.capName);
+
+	// publish frame counters to shared memory if asked for
+
+	if (!err && env.shmName[0] != '\0')
+		err = zvgShmStart( env.shmName);
+
+	// if all is well, start the sender thread if real-time mode was requested,
+	// from now on a lost link is recovered
+
+	if (!err)
+	{	zvgRtStart();
+		ZvgIO.linkArmed = zTrue;
+		ZvgIO.rtFeedOn = zTrue;
+		zvgBoardOpened( zTrue);
+	}
+
 	return (err);
 }
 
@@ -674,21 +1065,40 @@ uint zvgInit( void)
 *****************************************************************************/
 void zvgClose( void)
 {
+	// let the sender thread finish what it's doing
+
+	zvgBoardOpened( zFalse);						// the other boards stop waiting for it
+	zvgRtStop();
+	zvgRtCloseEvents();
+
+	// stop recovering the link, a link that is still down is left alone
+
+	zvgLinkStop();
+	zvgReadbackStop();
+
+	// finish any capture
+
+	zvgCapStop();
+
+	// remove the stats segment
+
+	zvgShmStop();
+
 	// release memory
 
 	if (ZvgIO.dmaBf1P != 0)
-	{	free( ZvgIO.dmaBf1P);
+	{	zvgRtFree( ZvgIO.dmaBf1P, MEM_BFR_SZ);
 		ZvgIO.dmaBf1P = 0;
 	}
 
 	if (ZvgIO.dmaBf2P != 0)
-	{	free( ZvgIO.dmaBf2P);
+	{	zvgRtFree( ZvgIO.dmaBf2P, MEM_BFR_SZ);
 		ZvgIO.dmaBf2P = 0;
 	}
 
 	// if we were in the ECP mode, send a center command
 
-	if (ZvgIO.ecpFlags & ECPF_ECP)
+	if ((ZvgIO.ecpFlags & ECPF_ECP) && !zvgLinkDown())
 	{
 		zvgEcpPutc( zcNOP);											// flush any possible half sent commands
 		zvgEcpPutc( zcNOP);
@@ -718,6 +1128,20 @@ void zvgClose( void)
 
 		zvgSetSppMode();											// go back to the compatibility mode
 	}
+
+	// release the transport
+
+	if (ZvgIO.trOps != NULL)
+		ZvgIO.trOps->close();
+
+	__atomic_store_n( &ZvgIO.linkDown, 0, __ATOMIC_RELEASE);
+
+	// write the trace, if 'ZVGPORT=' asked for one
+
+	if (ZvgIO.traceEnv)
+	{	zvgTraceStop();
+		ZvgIO.traceEnv = zFalse;
+	}
 }
 
 /*****************************************************************************
@@ -738,7 +1162,7 @@ void zvgClose( void)
 * Returns:
 *    'portErrCode'
 *****************************************************************************/
-uint zvgSppPutc( uchar cc)
+static uint dirSppPutc( uchar cc)
 {
 	// check for proper mode
 
@@ -821,7 +1245,7 @@ uint zvgSppPutMem( uchar *ss, uint len)
 * Returns:
 *    'portErrCode'
 *****************************************************************************/
-uint zvgGetMem( uchar *ss, uint bfrLen, uint *aReadLen)
+static uint dirGetMem( uchar *ss, uint bfrLen, uint *aReadLen)
 {
 	uint	err, readLen;
 
@@ -903,7 +1327,7 @@ uint zvgGetMem( uchar *ss, uint bfrLen, uint *aReadLen)
 * Returns:
 *    'portErrCode'
 *****************************************************************************/
-uint zvgGetDeviceID( uchar *ss, uint idLen, uint *aReadLen)
+static uint dirGetDeviceID( uchar *ss, uint idLen, uint *aReadLen)
 {
 	uint	err, count, readLen;
 	uchar	countMSB, countLSB=0;
@@ -982,7 +1406,7 @@ uint zvgGetDeviceID( uchar *ss, uint idLen, uint *aReadLen)
 *
 * If no errors occur, sets up port to ECP forward mode.
 *****************************************************************************/
-uint zvgSetEcpMode( void)
+static uint dirSetEcpMode( void)
 {
 	uint	err;
 
@@ -1029,7 +1453,7 @@ uint zvgSetEcpMode( void)
 *
 * Checks first to see if we are *not* already in SPP mode.
 *****************************************************************************/
-void zvgSetSppMode( void)
+static void dirSetSppMode( void)
 {
 	// if not in SPP mode, switch to it
 
@@ -1049,26 +1473,28 @@ void zvgSetSppMode( void)
 *
 *    Else, returns an ECP error code.
 *****************************************************************************/
-uint zvgIsDataAvail( uint aTime)
+static uint dirIsDataAvail( uint aTime)
 {
 	uint	dsr;
+	uchar	mask;
 
 	// must be in ECP mode
 
 	if (!(ZvgIO.ecpFlags & ECPF_ECP))
 		return (errEcpBadMode);
 
-	// wait for nPeriphRequest to go low
+	// wait for nPeriphRequest to go low, which raises the nFault interrupt
 
-	dsr = waitForDsrNE( DSR_PeriphClk|DSR_nPeriphRequest|DSR_XFlag,
-			DSR_PeriphClk|DSR_nPeriphRequest|DSR_XFlag, aTime);
+	mask = DSR_PeriphClk|DSR_nPeriphRequest|DSR_XFlag;
+	dsr = waitForPort( ZvgIO.ecpDsr, mask, (mask ^ DSR_InvMask) & mask, zFalse, aTime, IRQ_DATA);
 
 	if (dsr == ZVG_TIMEOUT)
 		return (errEcpTimeout);		// nothing wrong, just no data available
 
 	// check for a breach in the ECP protocol
 
-	else if ((dsr & (DSR_XFlag|DSR_PeriphClk)) != (DSR_XFlag | DSR_PeriphClk))
+	if (((dsr ^ DSR_InvMask) & (DSR_XFlag|DSR_PeriphClk)) != (DSR_XFlag | DSR_PeriphClk))
+
 	{	compatibility();				// if status incorrect, return to compatability mode
 		return (errEcpToSpp);		// indicate no longer in ECP mode
 	}
@@ -1087,9 +1513,10 @@ uint zvgIsDataAvail( uint aTime)
 *    errEcpTimeout - If no response.
 *    errEcpToSpp   - If DSR_XFlag line was dropped, also resets ECP to SPP mode.
 *****************************************************************************/
-uint zvgEcpPutc( uchar cc)
+static uint dirEcpPutc( uchar cc)
 {
-	uint	ii;
+	uint			ii, checks;
+	long long int	stall;
 
 	// for speed, check first if room in ECP buffer
 
@@ -1100,13 +1527,19 @@ uint zvgEcpPutc( uchar cc)
 
 	else
 	{
-		// wait for 1 second
+		ZvgIO.rtFulls++;
+		zvgTraceBegin( teStall, 0);
+		stall = tmrReadTimer();					// time the stall
+
+		// wait for 1 second, or less if a lost link will be recovered
+
+		checks = (ZvgIO.linkArmed && !ZvgIO.linkOff) ? LINK_STALL_MS / 100 : 10;
 
-		for (ii = 0; ii < 10; ii++)
+		for (ii = 0; ii < checks; ii++)
 		{
 			// check every 100ms for a breach in protocol
 
-			if (waitForEcrEQ( ECR_full, 0, 100) == ZVG_TIMEOUT)
+			if (waitForEcrEQ( ECR_full, 0, 100, IRQ_FIFO) == ZVG_TIMEOUT)
 			{
 				// if no response after 100ms, do a quick check of the status lines to
 				// see if XFlag or PeriphClk has dropped.
@@ -1119,6 +1552,7 @@ uint zvgEcpPutc( uchar cc)
 					// mode, so something unusual has happened, like a cable disconnect.
 
 					compatibility();				// go immediatly into SPP mode
+					zvgTraceEnd( teStall, errEcpToSpp);
 					return (errEcpToSpp);
 				}
 			}
@@ -1126,12 +1560,20 @@ uint zvgEcpPutc( uchar cc)
 				break;
 		}
 
-		if (ii == 10)
+		if (ii == checks)
+		{	zvgTraceEnd( teStall, errEcpTimeout);
 			return (errEcpTimeout);				// it's taken too long, something wrong
+		}
 
 		// if no timeout, send data, hardware takes care of handshaking
 
 		outportb( ZvgIO.ecpEcpDFifo, cc);
+
+		stall = tmrReadTimer() - stall;
+		zvgTraceEnd( teStall, errOk);
+
+		if (stall > ZvgIO.rtStallNs)
+			ZvgIO.rtStallNs = stall;				// keep the longest stall
 	}
 	return (errOk);
 }
@@ -1141,19 +1583,34 @@ uint zvgEcpPutc( uchar cc)
 *
 * ECP mode must have already been negotiated.
 *
+* If bursts are on, and the FIFO is empty, a whole burst is written at once,
+* otherwise each byte is written by 'dirEcpPutc()'.
+*
 * Called with:
 *    mem     = Pointer that points to memory block.
 *    memSize = Size of block of data to be sent.
 *****************************************************************************/
-uint zvgEcpPutMem( uchar *mem, uint memSize)
+static uint dirEcpPutMem( uchar *mem, uint memSize)
 {
-	uint	err;
+	uint	err, count;
 
 	err = errOk;
 
-	while (memSize-- > 0)
+	while (memSize > 0)
 	{
-		err = zvgEcpPutc( *mem);
+		if (ZvgIO.ecpBurst > 0 && (inportb( ZvgIO.ecpEcr) & ECR_empty))
+		{
+			count = memSize < ZvgIO.ecpBurst ? memSize : ZvgIO.ecpBurst;
+			memSize -= count;
+
+			while (count-- > 0)
+				outportb( ZvgIO.ecpEcpDFifo, *mem++);
+
+			continue;
+		}
+
+		memSize--;
+		err = dirEcpPutc( *mem);
 
 		if (err)
 			break;
@@ -1164,13 +1621,113 @@ uint zvgEcpPutMem( uchar *mem, uint memSize)
 	return (err);
 }
 
+/*****************************************************************************
+* Open the direct port I/O transport.
+*
+* Looks for an ECP port at 'portAdr', the argument is not used.  With the
+* WAIT_IRQ policy the port's interrupt is setup first.
+*****************************************************************************/
+static uint dirOpen( uint portAdr, const char *arg)
+{
+	(void)arg;								// not used
+
+	if (ZvgIO.waitIrq)
+		zvgIrqOpen( portAdr);
+
+	return (zvgDetectECP( portAdr));
+}
+
+/*****************************************************************************
+* Close the direct port I/O transport, releases the port's interrupt.
+*****************************************************************************/
+static void dirClose( void)
+{
+	zvgIrqClose();
+}
+
+/*****************************************************************************
+* Force the direct port I/O transport back to the compatibility mode.
+*****************************************************************************/
+static void dirReset( void)
+{
+	compatibility();
+}
+
+// Direct port I/O transport, used if no other transport is given
+
+const ZvgTransport_s	ZvgTrDirect =
+{	"direct",
+	dirOpen,
+	dirClose,
+	dirReset,
+	dirSetEcpMode,
+	dirSetSppMode,
+	dirEcpPutMem,
+	dirSppPutc,
+	dirGetMem,
+	dirGetDeviceID,
+	dirIsDataAvail
+};
+
+/*****************************************************************************
+* The routines below pass each port operation to the selected transport.
+* See the direct port I/O versions above for a description of each one.
+*****************************************************************************/
+uint zvgSppPutc( uchar cc)
+{
+	return (ZvgIO.trOps->sppPutc( cc));
+}
+
+uint zvgGetMem( uchar *ss, uint bfrLen, uint *aReadLen)
+{
+	return (ZvgIO.trOps->getMem( ss, bfrLen, aReadLen));
+}
+
+uint zvgGetDeviceID( uchar *ss, uint idLen, uint *aReadLen)
+{
+	return (ZvgIO.trOps->getDeviceID( ss, idLen, aReadLen));
+}
+
+uint zvgSetEcpMode( void)
+{
+	uint	err;
+
+	zvgTraceBegin( teEcpMode, 0);
+	err = ZvgIO.trOps->setEcpMode();
+	zvgTraceEnd( teEcpMode, err);
+	return (err);
+}
+
+void zvgSetSppMode( void)
+{
+	zvgTraceBegin( teSppMode, 0);
+	ZvgIO.trOps->setSppMode();
+	zvgTraceEnd( teSppMode, 0);
+}
+
+uint zvgIsDataAvail( uint aTime)
+{
+	return (ZvgIO.trOps->isDataAvail( aTime));
+}
+
+uint zvgEcpPutc( uchar cc)
+{
+	return (ZvgIO.trOps->ecpPutMem( &cc, 1));
+}
+
+uint zvgEcpPutMem( uchar *mem, uint memSize)
+{
+	return (ZvgIO.trOps->ecpPutMem( mem, memSize));
+}
+
 /*****************************************************************************
 * Start a DMA transfer to the ZVG.
 *
+* The buffer is sent from the calling thread through the selected transport,
+* and the time taken to send it is kept in 'ZvgIO.rtStats'.
+*
 * Called with:
-*    poffset = Protected mode offset.
-*    page    = 64k Page of buffer to transfer.
-*    offset	 = 16 bit offset of buffer to transfer.
+*    mem     = Pointer to buffer to transfer.
 *    count   = Count of bytes to transfer.
 *
 * Returns:
@@ -1179,9 +1736,16 @@ uint zvgEcpPutMem( uchar *mem, uint memSize)
 *
 *    Else, returns a ZVG error code.
 *****************************************************************************/
-static uint zvgDmaStart( uchar *mem, uint count)
+uint zvgDmaStart( uchar *mem, uint count)
 {
-	uint	err;
+	uint			err;
+	long long int	start;
+
+	zvgTraceBegin( teSend, count);
+
+	start = tmrReadTimer();
+	ZvgIO.rtStallNs = 0;
+	ZvgIO.rtFulls = 0;
 
 	// make sure we're in the ECP mode
 
@@ -1189,20 +1753,56 @@ static uint zvgDmaStart( uchar *mem, uint count)
 	{	err = zvgSetEcpMode();										// set to ECP mode
 
 		if (err)
+		{	zvgTraceEnd( teSend, err);
+			zvgRtDone( start, count, err);
 			return (err);												// if error, return
+		}
 	}
 
-	err = errOk;
+	// send the buffer to the ZVG
 
-	// loop through buffer sending bytes to the ZVG
+	err = zvgEcpPutMem( mem, count);
 
-	while (!err && count > 0)
-	{	err = zvgEcpPutc( *mem);
-		mem++;
-		count--;
-	}
 	if (err == errEcpTimeout)
-		compatibility();												// if timeout, force compatibility mode
+		ZvgIO.trOps->reset();										// if timeout, force compatibility mode
+
+	// keep track of how long it took
+
+	ZvgIO.rtStats.frames++;
+	ZvgIO.rtStats.lastSendNs = tmrReadTimer() - start;
+	ZvgIO.rtStats.lastStallNs = ZvgIO.rtStallNs;
+	ZvgIO.rtStats.lastFulls = ZvgIO.rtFulls;
+	ZvgIO.rtStats.fulls += ZvgIO.rtFulls;
+
+	if (ZvgIO.rtStats.lastSendNs > ZvgIO.rtStats.maxSendNs)
+		ZvgIO.rtStats.maxSendNs = ZvgIO.rtStats.lastSendNs;
+
+	if (ZvgIO.rtStallNs > ZvgIO.rtStats.maxStallNs)
+		ZvgIO.rtStats.maxStallNs = ZvgIO.rtStallNs;
+
+	zvgTraceEnd( teSend, err);
+	zvgRtDone( start, count, err);
+	return (err);
+}
+
+/*****************************************************************************
+* Wait for a DMA transfer to finish.
+*
+* Only has an effect in real-time mode, where the buffers are sent by the
+* sender thread.  Must be called before talking to the port directly, so
+* the sender thread and caller don't both use the port at once.
+*
+* Returns the error returned by the last transfer, if it hasn't already
+* been returned.
+*****************************************************************************/
+uint zvgDmaWait( void)
+{
+	uint	err;
+
+	err = zvgRtWait();
+
+	if (!err && zvgLinkDown())
+		err = errLinkDown;				// the port belongs to the recovery thread
 
 	return (err);
 }
@@ -1269,6 +1869,11 @@ void zvgDmaClearBfr( void)
 *****************************************************************************/
 uint zvgDmaSend( void)
 {
+	uint	err;
+
+	if ((err = zvgDmaWait()) != errOk)
+		return (err);
+
 	return (zvgDmaStart( ZvgIO.dmaCurP, ZvgIO.dmaCurCount));
 }
 
@@ -1280,12 +1885,63 @@ uint zvgDmaSend( void)
 * be made while the current DMA buffer is being sent.
 *
 * This allows the next frame to be built while the current one is being sent.
+*
+* In real-time mode the buffer is handed to the sender thread, and this
+* routine returns once the previous buffer has been sent.  An error sending
+* a buffer is returned by the next call.
+*
+* If the link to the ZVG is lost, it is recovered in the background, see
+* 'zvgLink.c'.  Until it is back buffers are dropped, and 'errOk' is
+* returned.
 *****************************************************************************/
 uint zvgDmaSendSwap( void)
 {
 	uint	err;
+	bool	sent;
+
+	// capture the buffer if a capture is running, a failed capture stops
+	// itself and doesn't stop the frame being sent
+
+	if (ZvgIO.capP != NULL)
+		zvgCapFrame( ZvgIO.dmaCurP, ZvgIO.dmaCurCount);
+
+	// drop the buffer while the link is down, the next one after it is
+	// back is sent as usual
+
+	if (zvgLinkDown())
+	{	zvgBoardWait();								// the rest of the group doesn't wait for it
+		ZvgIO.dmaDropped = zTrue;
+		ZvgIO.linkDropped++;
+		zvgRtDone( tmrReadTimer(), ZvgIO.dmaCurCount, errLinkDown);
+		ZvgIO.dmaCurCount = 0;
+		return (errOk);
+	}
+
+	ZvgIO.dmaDropped = zFalse;
+
+	// wait for the previous buffer, do any reads asked for between the two
+	// frames, then send this one
+
+	sent = zFalse;
+	err = zvgDmaWait();
+
+	if (!err && zvgReadbackActive())
+		err = zvgReadbackFrame();
+
+	// boards sent together wait for each other, see 'zvgBoardSync()'
 
-	err = zvgDmaStart( ZvgIO.dmaCurP, ZvgIO.dmaCurCount);
+	zvgBoardWait();
+
+	if (!err)
+	{	ZvgIO.rtPostNs = tmrReadTimer();					// frame's deadline starts here
+		sent = zTrue;
+
+		if (ZvgIO.rtP != NULL)
+			err = zvgRtPost( ZvgIO.dmaCurP, ZvgIO.dmaCurCount);
+
+		else
+			err = zvgDmaStart( ZvgIO.dmaCurP, ZvgIO.dmaCurCount);
+	}
 
 	if (!err)
 	{
@@ -1300,6 +1956,19 @@ uint zvgDmaSendSwap( void)
 		ZvgIO.dmaCurCount = 0;								// clear buffer
 	}
 
+	// a lost link is recovered, this buffer is dropped
+
+	else if (zvgLinkLost( err) == errOk)
+	{	ZvgIO.dmaDropped = zTrue;
+		ZvgIO.linkDropped++;
+		zvgReadbackCancel( errLinkDown);
+
+		if (!sent)											// a failed send has said so already
+			zvgRtDone( tmrReadTimer(), ZvgIO.dmaCurCount, errLinkDown);
+
+		err = errOk;
+	}
+
 	ZvgIO.dmaCurCount = 0;
 	return (err);
 }
@@ -1316,6 +1985,11 @@ uint zvgDmaSendSwap( void)
 *****************************************************************************/
 uint zvgDmaSendPrev(void)
 {
+	uint	err;
+
+	if ((err = zvgDmaWait()) != errOk)
+		return (err);
+
 	if (ZvgIO.dmaCurP == ZvgIO.dmaBf1P)
 		return (zvgDmaStart( ZvgIO.dmaBf2P, ZvgIO.dmaBf2Count));
 
@@ -1329,10 +2003,18 @@ uint zvgDmaSendPrev(void)
 * Upon exit this routine will leave the port in the ECP mode, regardless
 * of what the mode was when called.
 *****************************************************************************/
-uint zvgReadDeviceID( ZvgID_s *devID)
+static uint readDeviceID( ZvgID_s *devID)
 {
 	uint	idLen, err, ii, jj;
 
+	if ((err = zvgDmaWait()) != errOk)
+		return (err);
+
+	// a reply to a read sent with a frame comes first
+
+	if ((err = zvgReadbackDrain()) != errOk)
+		return (err);
+
 	err = zvgGetDeviceID( ZvgIO.mBfr, ZVG_MAX_BFRSZ, &idLen);
 
 	if (err)
@@ -1456,6 +2138,91 @@ uint zvgReadDeviceID( ZvgID_s *devID)
 	return (err);
 }
 
+/*****************************************************************************
+* Read the ZVG's ID, traced.  See 'readDeviceID()' above.
+*****************************************************************************/
+uint zvgReadDeviceID( ZvgID_s *devID)
+{
+	uint	err;
+
+	zvgTraceBegin( teReadID, 0);
+	err = readDeviceID( devID);
+	zvgTraceEnd( teReadID, err);
+	return (err);
+}
+
+/*****************************************************************************
+* Read the reply to a zcREAD_MON command, once the ZVG has said data is
+* available.  The port is left in the reverse nibble mode.
+*
+* Called with:
+*    mon = Pointer to a 'ZvgMon_s' structure used to hold ZVG data.
+*****************************************************************************/
+uint zvgGetMonitorReply( ZvgMon_s *mon)
+{
+	uint	readLen, err;
+
+	// read monitor information into a simple buffer
+
+	err = zvgGetMem( ZvgIO.mBfr, ZVG_MAX_BFRSZ, &readLen);
+
+	if (!err && (readLen != ZVG_MON_SIZE))
+		err = errEcpBadData;
+
+	if (!err)
+	{
+		// GCC does not pack its structure by default, so we need to move each value
+		// one byte at a time
+
+		mon->point_i = ZvgIO.mBfr[0];
+		mon->zShift = ZvgIO.mBfr[1];
+		mon->oShoot = ZvgIO.mBfr[2];
+		mon->jumpFactor = ZvgIO.mBfr[3];
+		mon->settle = ZvgIO.mBfr[4];
+		mon->min_i = ZvgIO.mBfr[5];
+		mon->max_i = ZvgIO.mBfr[6];
+		mon->scale = ZvgIO.mBfr[7];
+		mon->flags = ZvgIO.mBfr[8];
+
+		// for word data, LSB byte is first.
+
+		mon->cksum = ZvgIO.mBfr[9] + ((ushort)ZvgIO.mBfr[10] << 8);
+	}
+	return (err);
+}
+
+/*****************************************************************************
+* Read the reply to a zcREAD_SPD command, once the ZVG has said data is
+* available.  The port is left in the reverse nibble mode.
+*
+* Called with:
+*    speeds = A 4 byte buffer used to read the four different available
+*             ZVG speeds.
+*****************************************************************************/
+uint zvgGetSpeedReply( ZvgSpeeds_a speeds)
+{
+	uint	readLen, err;
+
+	// read 4 speed table bytes into buffer
+
+	err = zvgGetMem( ZvgIO.mBfr, 4, &readLen);
+
+	if (err)
+		return( err);
+
+	if (!err && (readLen != 4))
+		err = errEcpBadData;
+
+	// move the buffered speeds to the speed array
+
+	speeds[0] = (uint)ZvgIO.mBfr[0];
+	speeds[1] = (uint)ZvgIO.mBfr[1];
+	speeds[2] = (uint)ZvgIO.mBfr[2];
+	speeds[3] = (uint)ZvgIO.mBfr[3];
+
+	return (err);
+}
+
 /*****************************************************************************
 * Read current monitor information from the ZVG.
 *
@@ -1476,9 +2243,17 @@ uint zvgReadDeviceID( ZvgID_s *devID)
 * Called with:
 *    mon = Pointer to a 'ZvgMon_s' structure used to hold ZVG data.
 ******************************************************************************/
-uint zvgReadMonitorInfo( ZvgMon_s *mon)
+static uint readMonitorInfo( ZvgMon_s *mon)
 {
-	uint	readLen, ecpErr, err=0;
+	uint	ecpErr, err=0;
+
+	if ((err = zvgDmaWait()) != errOk)
+		return (err);
+
+	// a reply to a read sent with a frame comes first
+
+	if ((err = zvgReadbackDrain()) != errOk)
+		return (err);
 
 	if (!(ZvgIO.ecpFlags & ECPF_ECP))
 		err = zvgSetEcpMode();				// if not ECP mode, set to ECP mode
@@ -1510,32 +2285,7 @@ uint zvgReadMonitorInfo( ZvgMon_s *mon)
 	if (err)
 		return (err);
 
-	// read monitor information into a simple buffer
-
-	err = zvgGetMem( ZvgIO.mBfr, ZVG_MAX_BFRSZ, &readLen);
-
-	if (!err && (readLen != ZVG_MON_SIZE))
-		err = errEcpBadData;
-
-	if (!err)
-	{
-		// GCC does not pack its structure by default, so we need to move each value
-		// one byte at a time
-
-		mon->point_i = ZvgIO.mBfr[0];
-		mon->zShift = ZvgIO.mBfr[1];
-		mon->oShoot = ZvgIO.mBfr[2];
-		mon->jumpFactor = ZvgIO.mBfr[3];
-		mon->settle = ZvgIO.mBfr[4];
-		mon->min_i = ZvgIO.mBfr[5];
-		mon->max_i = ZvgIO.mBfr[6];
-		mon->scale = ZvgIO.mBfr[7];
-		mon->flags = ZvgIO.mBfr[8];
-
-		// for word data, LSB byte is first.
-
-		mon->cksum = ZvgIO.mBfr[9] + ((ushort)ZvgIO.mBfr[10] << 8);
-	}
+	err = zvgGetMonitorReply( mon);
 
 	// return to ECP mode
 
@@ -1547,6 +2297,19 @@ uint zvgReadMonitorInfo( ZvgMon_s *mon)
 	return (err);
 }
 
+/*****************************************************************************
+* Read the monitor settings, traced.  See 'readMonitorInfo()' above.
+*****************************************************************************/
+uint zvgReadMonitorInfo( ZvgMon_s *mon)
+{
+	uint	err;
+
+	zvgTraceBegin( teReadMon, 0);
+	err = readMonitorInfo( mon);
+	zvgTraceEnd( teReadMon, err);
+	return (err);
+}
+
 /*****************************************************************************
 * Read speed table information from the ZVG.
 *
@@ -1568,9 +2331,17 @@ uint zvgReadMonitorInfo( ZvgMon_s *mon)
 *    speeds = A 4 byte buffer used to read the four different available
 *             ZVG speeds.
 *****************************************************************************/
-uint zvgReadSpeedInfo( ZvgSpeeds_a speeds)
+static uint readSpeedInfo( ZvgSpeeds_a speeds)
 {
-	uint	readLen, ecpErr, err=0;
+	uint	ecpErr, err=0;
+
+	if ((err = zvgDmaWait()) != errOk)
+		return (err);
+
+	// a reply to a read sent with a frame comes first
+
+	if ((err = zvgReadbackDrain()) != errOk)
+		return (err);
 
 	if (!(ZvgIO.ecpFlags & ECPF_ECP))
 		err = zvgSetEcpMode();				// if not ECP mode, set to ECP mode
@@ -1602,22 +2373,7 @@ uint zvgReadSpeedInfo( ZvgSpeeds_a speeds)
 	if (err)
 		return (err);
 
-	// read 4 speed table bytes into buffer
-
-	err = zvgGetMem( ZvgIO.mBfr, 4, &readLen);
-
-	if (err)
-		return( err);
-
-	if (!err && (readLen != 4))
-		err = errEcpBadData;
-
-	// move the buffered speeds to the speed array
-
-	speeds[0] = (uint)ZvgIO.mBfr[0];
-	speeds[1] = (uint)ZvgIO.mBfr[1];
-	speeds[2] = (uint)ZvgIO.mBfr[2];
-	speeds[3] = (uint)ZvgIO.mBfr[3];
+	err = zvgGetSpeedReply( speeds);
 
 	// return to ECP mode
 
@@ -1628,3 +2384,16 @@ uint zvgReadSpeedInfo( ZvgSpeeds_a speeds)
 
 	return (err);
 }
+
+/*****************************************************************************
+* Read the speed table, traced.  See 'readSpeedInfo()' above.
+*****************************************************************************/
+uint zvgReadSpeedInfo( ZvgSpeeds_a speeds)
+{
+	uint	err;
+
+	zvgTraceBegin( teReadSpd, 0);
+	err = readSpeedInfo( speeds);
+	zvgTraceEnd( teReadSpd, err);
+	return (err);
+}
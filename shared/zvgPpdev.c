@@ -0,0 +1,399 @@
+/*****************************************************************************
+* ppdev transport for the ZVG.
+*
+* Reaches the ZVG through the Linux parport driver using '/dev/parportN',
+* rather than banging on the port registers directly.  This doesn't need
+* root, only read/write access to the device, and lets the kernel do the
+* IEEE-1284 negotiations.
+*
+* The kernel uses the ECP FIFO of the port if it has one, otherwise it falls
+* back to a software ECP handshake, which is slower but still works.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<errno.h>
+#include	<fcntl.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<time.h>
+#include	<unistd.h>
+#include	<sys/ioctl.h>
+#include	<sys/time.h>
+#include	<linux/parport.h>
+#include	<linux/ppdev.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgTrans.h"
+
+#define	PP_DEFAULT_DEV	"/dev/parport0"		// device used if none given
+
+// State of the ppdev transport
+
+typedef struct ZVGPPDEV_S
+{	int		fd;								// open parport device
+} ZvgPpdev_s;
+
+/*****************************************************************************
+* Negotiate the given IEEE-1284 mode, and have reads and writes use it.
+*
+* Returns:
+*    errOk        - Mode set.
+*    errEcpFailed - Peripheral refused the mode.
+*****************************************************************************/
+static uint ppMode( int fd, int mode)
+{
+	if (ioctl( fd, PPNEGOT, &mode) < 0)
+		return (errEcpFailed);
+
+	if (ioctl( fd, PPSETMODE, &mode) < 0)
+		return (errEcpFailed);
+
+	return (errOk);
+}
+
+/*****************************************************************************
+* Go back to the compatibility mode.
+*****************************************************************************/
+static void ppCompat( int fd)
+{
+	ppMode( fd, IEEE1284_MODE_COMPAT);
+	ZvgIO.ecpFlags &= ~(ECPF_ECP | ECPF_NIBBLE);
+}
+
+/*****************************************************************************
+* Open and claim the parport device.
+*
+* Called with:
+*    portAdr = Not used.
+*    arg     = Device to open, '/dev/parport0' if NULL.
+*****************************************************************************/
+static uint ppOpen( uint portAdr, const char *arg)
+{
+	ZvgPpdev_s		*pp;
+	struct timeval	tv;
+
+	(void)portAdr;							// not used
+
+	pp = (ZvgPpdev_s *)calloc( 1, sizeof( ZvgPpdev_s));
+
+	if (pp == NULL)
+		return (errMemory);
+
+	pp->fd = open( arg != NULL ? arg : PP_DEFAULT_DEV, O_RDWR);
+
+	if (pp->fd < 0)
+	{	free( pp);
+		return (errTransOpen);
+	}
+
+	ioctl( pp->fd, PPEXCL);					// nobody else should use the port
+
+	if (ioctl( pp->fd, PPCLAIM) < 0)
+	{	close( pp->fd);
+		free( pp);
+		return (errTransOpen);
+	}
+
+	// reads and writes time out after the same second the direct I/O allows
+
+	tv.tv_sec = PERIPH_WAIT / 1000;
+	tv.tv_usec = (PERIPH_WAIT % 1000) * 1000;
+	ioctl( pp->fd, PPSETTIME, &tv);
+
+	ZvgIO.ecpPort = 0;
+	ZvgIO.trData = pp;
+	ppCompat( pp->fd);
+	return (errOk);
+}
+
+/*****************************************************************************
+* Release and close the parport device, may be called more than once.
+*****************************************************************************/
+static void ppClose( void)
+{
+	ZvgPpdev_s	*pp;
+
+	pp = (ZvgPpdev_s *)ZvgIO.trData;
+
+	if (pp == NULL)
+		return;
+
+	ppCompat( pp->fd);
+	ioctl( pp->fd, PPRELEASE);
+	close( pp->fd);
+	free( pp);
+	ZvgIO.trData = NULL;
+}
+
+/*****************************************************************************
+* Force the port back to the compatibility mode.
+*****************************************************************************/
+static void ppReset( void)
+{
+	ZvgPpdev_s	*pp;
+
+	pp = (ZvgPpdev_s *)ZvgIO.trData;
+
+	if (pp != NULL)
+		ppCompat( pp->fd);
+}
+
+/*****************************************************************************
+* Set to ECP mode from compatibility mode.
+*****************************************************************************/
+static uint ppSetEcpMode( void)
+{
+	ZvgPpdev_s	*pp;
+	uint		err;
+
+	pp = (ZvgPpdev_s *)ZvgIO.trData;
+
+	if (ZvgIO.ecpFlags & ECPF_ECP)
+		return (errOk);					// already in ECP mode
+
+	if (ZvgIO.ecpFlags & ECPF_NIBBLE)
+		ppCompat( pp->fd);
+
+	err = ppMode( pp->fd, IEEE1284_MODE_ECP);
+
+	if (err)
+	{	ppCompat( pp->fd);
+		return (err);
+	}
+
+	ZvgIO.ecpFlags |= ECPF_ECP;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Return to SPP (compatibility) mode.
+*****************************************************************************/
+static void ppSetSppMode( void)
+{
+	if (ZvgIO.ecpFlags & (ECPF_ECP | ECPF_NIBBLE))
+		ppReset();
+}
+
+/*****************************************************************************
+* Write a block of memory to the ZVG, in whatever mode has been set.
+*
+* Returns:
+*    errEcpTimeout - If the ZVG stopped taking data.
+*    errEcpComm    - If the driver returned an error.
+*****************************************************************************/
+static uint ppWrite( uchar *mem, uint memSize)
+{
+	ZvgPpdev_s	*pp;
+	ssize_t		count;
+
+	pp = (ZvgPpdev_s *)ZvgIO.trData;
+
+	while (memSize > 0)
+	{
+		count = write( pp->fd, mem, memSize);
+
+		if (count < 0 && errno == EINTR)
+			continue;
+
+		if (count < 0)
+			return (errno == EAGAIN || errno == ETIMEDOUT ? errEcpTimeout : errEcpComm);
+
+		if (count == 0)
+			return (errEcpTimeout);		// driver timed out, nothing taken
+
+		mem += count;
+		memSize -= count;
+	}
+	return (errOk);
+}
+
+/*****************************************************************************
+* Write a block of memory to the ZVG using the ECP mode.
+*
+* ECP mode must have already been negotiated.
+*****************************************************************************/
+static uint ppEcpPutMem( uchar *mem, uint memSize)
+{
+	return (ppWrite( mem, memSize));
+}
+
+/*****************************************************************************
+* Write a character to the ZVG using the SPP mode.
+*****************************************************************************/
+static uint ppSppPutc( uchar cc)
+{
+	if (ZvgIO.ecpFlags & (ECPF_ECP | ECPF_NIBBLE))
+		return (errEcpBadMode);			// this routine only works for SPP modes
+
+	return (ppWrite( &cc, 1));
+}
+
+/*****************************************************************************
+* Read a block of memory from the ZVG using the reverse nibble mode.
+*
+* Leaves the port in the SPP mode.
+*****************************************************************************/
+static uint ppGetMem( uchar *ss, uint bfrLen, uint *aReadLen)
+{
+	ZvgPpdev_s	*pp;
+	ssize_t		count;
+	uint		err;
+
+	pp = (ZvgPpdev_s *)ZvgIO.trData;
+
+	if (ZvgIO.ecpFlags & ECPF_ECP)
+		ppCompat( pp->fd);
+
+	if (!(ZvgIO.ecpFlags & ECPF_NIBBLE))
+	{	err = ppMode( pp->fd, IEEE1284_MODE_NIBBLE);
+
+		if (err)
+		{	ppCompat( pp->fd);
+			return (err);
+		}
+		ZvgIO.ecpFlags |= ECPF_NIBBLE;
+	}
+
+	do
+		count = read( pp->fd, ss, bfrLen);
+	while (count < 0 && errno == EINTR);
+
+	ppCompat( pp->fd);
+
+	if (count <= 0)
+		return (errEcpNoData);
+
+	*aReadLen = count;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Get the IEEE-1284 device ID from the ZVG.
+*
+* The two byte count that starts the ID is removed, and the string is '\0'
+* terminated. Leaves the port in the SPP mode.
+*****************************************************************************/
+static uint ppGetDeviceID( uchar *ss, uint idLen, uint *aReadLen)
+{
+	ZvgPpdev_s	*pp;
+	uchar		bfr[ZVG_MAX_BFRSZ];
+	ssize_t		count;
+	uint		err, idCount;
+
+	pp = (ZvgPpdev_s *)ZvgIO.trData;
+
+	if (idLen < 2)
+		return (errEcpNoData);				// no room in buffer
+
+	if (ZvgIO.ecpFlags & (ECPF_ECP | ECPF_NIBBLE))
+		ppCompat( pp->fd);
+
+	err = ppMode( pp->fd, IEEE1284_MODE_NIBBLE | IEEE1284_DEVICEID);
+
+	if (err)
+	{	ppCompat( pp->fd);
+		return (err);
+	}
+
+	do
+		count = read( pp->fd, bfr, sizeof( bfr));
+	while (count < 0 && errno == EINTR);
+
+	ppCompat( pp->fd);
+
+	if (count <= 2)
+	{	*ss = '\0';
+		*aReadLen = 0;
+		return (errEcpNoData);				// no proper ID is given
+	}
+
+	idCount = ((bfr[0] << 8) + bfr[1]) - 2;
+
+	if (idCount > (uint)count - 2)
+		idCount = count - 2;
+
+	if (idCount > idLen - 1)
+		idCount = idLen - 1;
+
+	memcpy( ss, bfr + 2, idCount);
+	ss[idCount] = '\0';
+	*aReadLen = idCount;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Check to see if any data is available in the ECP mode.
+*
+* Polls the status lines the same way the direct transport does, sleeping
+* between polls as the wait policy allows.
+*
+* Returns:
+*    errOk         - if data is available.
+*    errEcpTimeout - if data was not available.
+*    errEcpToSpp   - if the ZVG dropped out of the ECP mode.
+*****************************************************************************/
+static uint ppIsDataAvail( uint aTime)
+{
+	ZvgPpdev_s		*pp;
+	uchar			dsr;
+	long long int	timer;
+	struct timespec	ts;
+
+	pp = (ZvgPpdev_s *)ZvgIO.trData;
+
+	if (!(ZvgIO.ecpFlags & ECPF_ECP))
+		return (errEcpBadMode);
+
+	ts.tv_sec = ZvgIO.waitSleepNs / 1000000000LL;
+	ts.tv_nsec = ZvgIO.waitSleepNs % 1000000000LL;
+	timer = tmrReadTimer();
+
+	// wait for nPeriphRequest to go low
+
+	while (1)
+	{
+		if (ioctl( pp->fd, PPRSTATUS, &dsr) < 0)
+			return (errEcpComm);
+
+		dsr ^= DSR_InvMask;
+
+		if ((dsr & (DSR_PeriphClk|DSR_nPeriphRequest|DSR_XFlag))
+				!= (DSR_PeriphClk|DSR_nPeriphRequest|DSR_XFlag))
+			break;
+
+		if (tmrTestMillis( timer, aTime))
+			return (errEcpTimeout);		// nothing wrong, just no data available
+
+		if (ZvgIO.waitSleepNs > 0)
+			nanosleep( &ts, NULL);
+	}
+
+	// check for a breach in the ECP protocol
+
+	if ((dsr & (DSR_XFlag|DSR_PeriphClk)) != (DSR_XFlag | DSR_PeriphClk))
+	{	ppCompat( pp->fd);
+		return (errEcpToSpp);			// indicate no longer in ECP mode
+	}
+	return (errOk);
+}
+
+// ppdev transport
+
+const ZvgTransport_s	ZvgTrPpdev =
+{	"ppdev",
+	ppOpen,
+	ppClose,
+	ppReset,
+	ppSetEcpMode,
+	ppSetSppMode,
+	ppEcpPutMem,
+	ppSppPutc,
+	ppGetMem,
+	ppGetDeviceID,
+	ppIsDataAvail
+};
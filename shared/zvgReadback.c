@@ -0,0 +1,377 @@
+/*****************************************************************************
+* Reading from the ZVG between frames.
+*
+* 'zvgReadMonitorInfo()' and 'zvgReadSpeedInfo()' stop sending, wait for
+* the ZVG to draw everything ahead of the request, then read the reply,
+* so the picture freezes while they run.  Here a zcREAD_MON or zcREAD_SPD
+* request is added to the end of the next frame sent instead, and the
+* reply is read when the frame after it is sent.  By then the ZVG has
+* normally finished drawing, and the reply is waiting, so nothing is held
+* up.  If it isn't, the frame waits up to RB_WAIT_MS for it, and the frames
+* after only look for it, for up to RB_LATE_MS.  While a reply is out no
+* other read is started, so a late reply is never taken for another one.
+*
+* The device ID, which holds the firmware and VTG error status bits, isn't
+* asked for with a command, it is read while the port is idle between two
+* frames.
+*
+* Reads are asked for with 'zvgReadbackStart()', or every so often with
+* 'zvgReadbackPeriod()'.  Finished reads are handed to the callback set by
+* 'zvgReadbackSetCallback()', and kept for 'zvgReadbackPoll()'.  All the
+* work is done by 'zvgReadbackFrame()', called by 'zvgDmaSendSwap()', on
+* the thread sending frames.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<pthread.h>
+#include	<string.h>
+
+#include	"zstddef.h"
+#include	"zvgCmds.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgLink.h"
+#include	"zvgReadback.h"
+#include	"zvgTrace.h"
+
+#define	RB_KINDS		3				// RB_ID, RB_MON and RB_SPD
+#define	RB_PAD			8				// NOPs that push a request through the look ahead
+
+// Reads of each board, one lock for all of them
+
+typedef struct RBBOARD_S
+{	ZvgReadback_s		last[RB_KINDS];		// last finished read of each kind
+	uint				fresh;				// RB_xxx finished, and not yet polled
+	long long int		askNs[RB_KINDS];	// time each kind was asked for
+	ZvgReadbackFunc_t	func;				// callback, NULL if none
+	void				*arg;
+	uint				periodWhat;			// RB_xxx read every 'ZvgIO.rbPeriodNs'
+	long long int		nextNs;				// time of the next periodic read
+	long long int		sentNs;				// time the request of 'ZvgIO.rbOut' was sent
+	long long int		waitNs;				// time frames were held waiting for its reply
+	bool				waited;				// a frame has been held for it
+} RbBoard_s;
+
+static pthread_mutex_t		RbLock = PTHREAD_MUTEX_INITIALIZER;
+static RbBoard_s			RbBoards[ZVG_BOARDS];
+
+#define	Rb		(RbBoards[ZvgCurBoard])		// the current board's
+
+/*****************************************************************************
+* Return the index of one kind of read.
+*****************************************************************************/
+static uint rbIndex( uint what)
+{
+	return (what == RB_ID ? 0 : what == RB_MON ? 1 : 2);
+}
+
+/*****************************************************************************
+* Keep a finished read, and hand it to the callback.
+*****************************************************************************/
+static void rbFinish( ZvgReadback_s *rb)
+{
+	ZvgReadbackFunc_t	func;
+	void				*arg;
+
+	rb->doneNs = tmrReadTimer();
+
+	pthread_mutex_lock( &RbLock);
+	rb->askNs = Rb.askNs[rbIndex( rb->what)];
+	Rb.last[rbIndex( rb->what)] = *rb;
+	Rb.fresh |= rb->what;
+	func = Rb.func;
+	arg = Rb.arg;
+	pthread_mutex_unlock( &RbLock);
+
+	if (func != NULL)
+		func( rb, arg);
+}
+
+/*****************************************************************************
+* Ask for reads from the ZVG.  Asking again for a read not yet finished
+* does nothing.
+*
+* Called with:
+*    what = RB_xxx bits.
+*****************************************************************************/
+void zvgReadbackStart( uint what)
+{
+	uint	want, ii;
+
+	what &= RB_ALL;
+
+	pthread_mutex_lock( &RbLock);
+	want = __atomic_load_n( &ZvgIO.rbWant, __ATOMIC_ACQUIRE) | ZvgIO.rbOut;
+
+	for (ii = 0; ii < RB_KINDS; ii++)
+	{
+		if ((what & (1 << ii)) && !(want & (1 << ii)))
+			Rb.askNs[ii] = tmrReadTimer();
+	}
+
+	__atomic_or_fetch( &ZvgIO.rbWant, what, __ATOMIC_RELEASE);
+	pthread_mutex_unlock( &RbLock);
+}
+
+/*****************************************************************************
+* Return a read that finished since the last poll.
+*
+* Called with:
+*    what = RB_xxx bits, reads to look for.  The ID is looked at first,
+*           then the monitor settings, then the speeds.
+*    rb   = Filled in with the read.
+*
+* Returns:
+*    errOk          - A read was returned, 'rb->err' says if it worked.
+*    errReadPending - None of them has finished.
+*****************************************************************************/
+uint zvgReadbackPoll( uint what, ZvgReadback_s *rb)
+{
+	uint	ii, err;
+
+	err = errReadPending;
+
+	pthread_mutex_lock( &RbLock);
+
+	for (ii = 0; ii < RB_KINDS; ii++)
+	{
+		if (what & Rb.fresh & (1 << ii))
+		{	*rb = Rb.last[ii];
+			Rb.fresh &= ~(1 << ii);
+			err = errOk;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock( &RbLock);
+	return (err);
+}
+
+/*****************************************************************************
+* Set the routine called with each finished read.  It is called from the
+* thread sending frames, and should return quickly.
+*
+* Called with:
+*    func = Callback, NULL for none.
+*    arg  = Passed to the callback.
+*****************************************************************************/
+void zvgReadbackSetCallback( ZvgReadbackFunc_t func, void *arg)
+{
+	pthread_mutex_lock( &RbLock);
+	Rb.func = func;
+	Rb.arg = arg;
+	pthread_mutex_unlock( &RbLock);
+}
+
+/*****************************************************************************
+* Read from the ZVG every so often, to keep an eye on its error status bits
+* ('RB_ID') or settings.
+*
+* Called with:
+*    what     = RB_xxx bits to read.
+*    periodMs = Time between reads, 0 to stop.
+*****************************************************************************/
+void zvgReadbackPeriod( uint what, uint periodMs)
+{
+	Rb.periodWhat = what & RB_ALL;
+	Rb.nextNs = 0;									// first read with the next frame
+	ZvgIO.rbPeriodNs = Rb.periodWhat ? periodMs * 1000000LL : 0;
+}
+
+/*****************************************************************************
+* Read the reply to the request sent with an earlier frame.
+*
+* A reply that isn't in yet is waited for, up to RB_WAIT_MS the first time.
+* After that it is only looked for, and the request stays out until the
+* reply comes or RB_LATE_MS have gone by since it was sent.
+*
+* Called with:
+*    drain = If set, wait for the rest of RB_LATE_MS instead.
+*
+* Returns:
+*    errOk, or an error that means the link to the ZVG was lost.
+*****************************************************************************/
+static uint rbCollect( bool drain)
+{
+	ZvgReadback_s	rb;
+	long long int	start, left;
+	uint			err, ecpErr, ms;
+
+	zvgTraceBegin( teReadback, ZvgIO.rbOut);
+
+	// the ZVG has normally drawn the frame by now, if not give it a little time
+
+	err = zvgIsDataAvail( 0);
+	start = tmrReadTimer();
+	left = Rb.sentNs + RB_LATE_MS * 1000000LL - start;
+
+	if (err == errEcpTimeout && left > 0 && (drain || !Rb.waited))
+	{	ms = drain ? (uint)(left / 1000000LL) + 1 : RB_WAIT_MS;
+		Rb.waited = zTrue;
+		err = zvgIsDataAvail( ms);
+		Rb.waitNs += tmrReadTimer() - start;
+		left = Rb.sentNs + RB_LATE_MS * 1000000LL - tmrReadTimer();
+	}
+
+	// not in yet, look again with the next frame
+
+	if (err == errEcpTimeout && left > 0)
+	{	zvgTraceEnd( teReadback, err);
+		return (errOk);
+	}
+
+	memset( &rb, 0, sizeof( rb));
+	rb.what = ZvgIO.rbOut;
+	rb.waitNs = Rb.waitNs;
+	ZvgIO.rbOut = 0;
+
+	if (err)
+	{	rb.err = err;
+		zvgTraceEnd( teReadback, err);
+		rbFinish( &rb);
+		return (err == errEcpTimeout ? errOk : err);
+	}
+
+	if (rb.what == RB_MON)
+		err = zvgGetMonitorReply( &rb.mon);
+
+	else
+		err = zvgGetSpeedReply( rb.speeds);
+
+	// return to ECP mode, an ECP error has higher priority
+
+	ecpErr = zvgSetEcpMode();
+	rb.err = ecpErr ? ecpErr : err;
+
+	zvgTraceEnd( teReadback, rb.err);
+	rbFinish( &rb);
+	return (ecpErr);
+}
+
+/*****************************************************************************
+* Do the reads asked for, between two frames.
+*
+* Called by 'zvgDmaSendSwap()' once the previous buffer has been sent, and
+* before the current one is.  The reply to a request sent with an earlier
+* frame is read, the ID is read if asked for, and a monitor or speed
+* request is added to the end of the current buffer.
+*
+* Returns:
+*    errOk, or an error that means the link to the ZVG was lost.  Other
+*    errors are returned in the reads.
+*****************************************************************************/
+uint zvgReadbackFrame( void)
+{
+	ZvgReadback_s	rb;
+	uchar			req[1 + RB_PAD];
+	long long int	now;
+	uint			want, err;
+
+	now = tmrReadTimer();
+
+	if (ZvgIO.rbPeriodNs != 0 && now >= Rb.nextNs)
+	{	zvgReadbackStart( Rb.periodWhat);
+		Rb.nextNs = now + ZvgIO.rbPeriodNs;
+	}
+
+	// read the reply to the request sent with an earlier frame, until it's
+	// in nothing else is read
+
+	if (ZvgIO.rbOut)
+	{	err = rbCollect( zFalse);
+
+		if (err || ZvgIO.rbOut)
+			return (err);
+	}
+
+	want = __atomic_load_n( &ZvgIO.rbWant, __ATOMIC_ACQUIRE);
+
+	// the port is idle, read the ID
+
+	if (want & RB_ID)
+	{	__atomic_and_fetch( &ZvgIO.rbWant, ~RB_ID, __ATOMIC_RELEASE);
+
+		memset( &rb, 0, sizeof( rb));
+		rb.what = RB_ID;
+		rb.err = zvgReadDeviceID( &rb.id);
+		rbFinish( &rb);
+
+		if (zvgLinkIsError( rb.err))
+			return (rb.err);
+	}
+
+	// ask for the monitor settings or speeds at the end of this frame, the
+	// NOPs make sure it is run
+
+	if ((want & (RB_MON | RB_SPD)) && ZvgIO.dmaCurCount + sizeof( req) <= MEM_BFR_SZ)
+	{
+		ZvgIO.rbOut = (want & RB_MON) ? RB_MON : RB_SPD;
+		__atomic_and_fetch( &ZvgIO.rbWant, ~ZvgIO.rbOut, __ATOMIC_RELEASE);
+
+		req[0] = ZvgIO.rbOut == RB_MON ? zcREAD_MON : zcREAD_SPD;
+		memset( req + 1, zcNOP, RB_PAD);
+		zvgDmaPutMem( req, sizeof( req));
+
+		Rb.sentNs = now;
+		Rb.waitNs = 0;
+		Rb.waited = zFalse;
+	}
+	return (errOk);
+}
+
+/*****************************************************************************
+* Read the reply to a request still out, so it isn't taken for the reply to
+* another read.  Called by 'zvgReadDeviceID()', 'zvgReadMonitorInfo()' and
+* 'zvgReadSpeedInfo()', with the port idle.  Waits for the rest of
+* RB_LATE_MS at most.
+*
+* Returns:
+*    errOk, or an error that means the link to the ZVG was lost.
+*****************************************************************************/
+uint zvgReadbackDrain( void)
+{
+	if (ZvgIO.rbOut == 0)
+		return (errOk);
+
+	return (rbCollect( zTrue));
+}
+
+/*****************************************************************************
+* Fail the reads asked for, and the one waiting on a reply.
+*
+* Called with:
+*    err = Error given to each read.
+*****************************************************************************/
+void zvgReadbackCancel( uint err)
+{
+	ZvgReadback_s	rb;
+	uint			what, ii;
+
+	what = __atomic_exchange_n( &ZvgIO.rbWant, 0, __ATOMIC_ACQ_REL) | ZvgIO.rbOut;
+	ZvgIO.rbOut = 0;
+
+	for (ii = 0; ii < RB_KINDS; ii++)
+	{
+		if (what & (1 << ii))
+		{	memset( &rb, 0, sizeof( rb));
+			rb.what = 1 << ii;
+			rb.err = err;
+			rbFinish( &rb);
+		}
+	}
+}
+
+/*****************************************************************************
+* Forget reads asked for, and stop the periodic reads.  Called by
+* 'zvgClose()'.  Reads already finished can still be polled.
+*****************************************************************************/
+void zvgReadbackStop( void)
+{
+	__atomic_store_n( &ZvgIO.rbWant, 0, __ATOMIC_RELEASE);
+	ZvgIO.rbOut = 0;
+	ZvgIO.rbPeriodNs = 0;
+	Rb.periodWhat = 0;
+}
@@ -0,0 +1,496 @@
+/*****************************************************************************
+* Real-time sender thread for the ZVG.
+*
+* Under DOS the frame buffers were sent by the DMA controller, so the
+* caller went on building the next frame while the last one was sent.
+* Under Linux the buffers are sent by polling the ECP FIFO, and if the
+* thread doing that is scheduled away in the middle of a frame, the ZVG
+* runs dry and the picture stutters.
+*
+* This module gives the polling loop its own thread, which can be run at a
+* SCHED_FIFO priority and pinned to a CPU.  The frame buffers are locked
+* into memory and prefaulted so the sender never takes a page fault.
+*
+* Real-time mode is opt-in, either through 'zvgRtConfig()' or the 'R' and
+* 'C' attributes of 'ZVGPORT='.  If any part of it can't be setup (usually
+* because of missing permissions) the driver carries on without it, and
+* the reason is kept in 'ZvgIO.rtStatus' for 'zvgBanner()' to report.
+*
+* Programs built around 'poll()' can learn when each buffer has been sent
+* from the eventfd returned by 'zvgRtEventFd()', rather than blocking in
+* 'zvgFrameSend()', and get its timing from 'zvgRtGetFeedback()'.  Both
+* work in either mode.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _GNU_SOURCE
+#define	_GNU_SOURCE							// for 'pthread_setaffinity_np()'
+#endif
+
+#include	<pthread.h>
+#include	<sched.h>
+#include	<errno.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<sys/eventfd.h>
+#include	<sys/mman.h>
+
+#include	"zstddef.h"
+#include	"zvgCmds.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgRt.h"
+#include	"zvgTrace.h"
+
+// States of the sender thread
+
+enum
+{	RTS_IDLE = 0,							// waiting for a buffer
+	RTS_POSTED,								// buffer posted, or being sent
+	RTS_QUIT								// thread has been asked to exit
+};
+
+typedef struct ZVGRT_S
+{	pthread_t		thread;
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;					// signalled on every state change
+	uint			state;					// RTS_xxx
+	uint			ready;					// set once thread has setup its scheduling
+	uchar			*sendP;					// buffer to be sent
+	uint			sendCount;				// number of bytes in buffer
+	uint			err;					// error returned by last send
+	uint			board;					// board it sends for, see 'zvgBoard.c'
+} ZvgRt_s;
+
+// Lock of 'ZvgIO.rtFeedback', written by whichever thread sent the buffer
+
+static pthread_mutex_t	RtFbLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*****************************************************************************
+* Set the scheduling policy and CPU affinity of the calling thread.
+*
+* Failures are not fatal, the 'errno' of each is saved in 'ZvgIO.rtStatus'.
+*****************************************************************************/
+static void rtSchedule( void)
+{
+	struct sched_param	sp;
+	cpu_set_t			cpus;
+	int					err;
+
+	if (ZvgIO.rtStatus.prio > 0)
+	{	memset( &sp, 0, sizeof( sp));
+		sp.sched_priority = ZvgIO.rtStatus.prio;
+
+		err = pthread_setschedparam( pthread_self(), SCHED_FIFO, &sp);
+
+		if (err)
+			ZvgIO.rtStatus.schedErr = err;
+
+		else
+			ZvgIO.rtStatus.flags |= RTF_FIFO;
+	}
+
+	if (ZvgIO.rtStatus.cpu >= CPU_SETSIZE)
+		ZvgIO.rtStatus.cpuErr = EINVAL;
+
+	else if (ZvgIO.rtStatus.cpu != RT_NO_CPU)
+	{	CPU_ZERO( &cpus);
+		CPU_SET( ZvgIO.rtStatus.cpu, &cpus);
+
+		err = pthread_setaffinity_np( pthread_self(), sizeof( cpus), &cpus);
+
+		if (err)
+			ZvgIO.rtStatus.cpuErr = err;
+
+		else
+			ZvgIO.rtStatus.flags |= RTF_PINNED;
+	}
+}
+
+/*****************************************************************************
+* The sender thread.
+*
+* Waits for a buffer to be posted by 'zvgRtPost()', sends it to the ZVG, and
+* goes back to waiting.
+*****************************************************************************/
+static void *rtThread( void *arg)
+{
+	ZvgRt_s	*rt;
+	uint	err;
+
+	rt = (ZvgRt_s *)arg;
+	ZvgCurBoard = rt->board;
+
+	zvgTraceName( "zvg sender");
+	rtSchedule();
+
+	pthread_mutex_lock( &rt->lock);
+	rt->ready = zTrue;
+	pthread_cond_broadcast( &rt->cond);
+
+	while (1)
+	{
+		while (rt->state == RTS_IDLE)
+			pthread_cond_wait( &rt->cond, &rt->lock);
+
+		if (rt->state == RTS_QUIT)
+			break;
+
+		pthread_mutex_unlock( &rt->lock);
+
+		err = zvgDmaStart( rt->sendP, rt->sendCount);
+
+		pthread_mutex_lock( &rt->lock);
+
+		if (rt->state == RTS_POSTED)
+			rt->state = RTS_IDLE;
+
+		rt->err = err;
+		pthread_cond_broadcast( &rt->cond);
+	}
+	pthread_mutex_unlock( &rt->lock);
+	return (NULL);
+}
+
+/*****************************************************************************
+* Setup the real-time mode.
+*
+* Must be called before 'zvgFrameOpen()' or 'zvgInit()'. The 'R' and 'C'
+* attributes of 'ZVGPORT=', if given, override these values.
+*
+* Called with:
+*    prio = SCHED_FIFO priority of the sender thread (1-99), 0 leaves the
+*           sender thread at the normal priority.
+*    cpu  = CPU to pin the sender thread to, or RT_NO_CPU.
+*
+* If both 'prio' is 0 and 'cpu' is RT_NO_CPU, real-time mode is disabled.
+*****************************************************************************/
+void zvgRtConfig( int prio, int cpu)
+{
+	if (prio < 0)
+		prio = 0;
+
+	if (prio > RT_PRIO_MAX)
+		prio = RT_PRIO_MAX;
+
+	memset( &ZvgIO.rtStatus, 0, sizeof( ZvgIO.rtStatus));
+	ZvgIO.rtStatus.prio = prio;
+	ZvgIO.rtStatus.cpu = cpu;
+
+	if (prio > 0 || cpu != RT_NO_CPU)
+		ZvgIO.rtStatus.flags = RTF_REQUESTED;
+}
+
+/*****************************************************************************
+* Allocate a frame buffer.
+*
+* The buffer is page aligned, and every page is touched so that it is
+* faulted in before the first frame is sent.  If real-time mode has been
+* requested, the buffer is also locked into memory.
+*****************************************************************************/
+uchar *zvgRtAlloc( uint size)
+{
+	void	*bfr;
+
+	if (posix_memalign( &bfr, sysconf( _SC_PAGESIZE), size) != 0)
+		return (NULL);
+
+	memset( bfr, zcNOP, size);						// prefault
+
+	if ((ZvgIO.rtStatus.flags & RTF_REQUESTED) && mlock( bfr, size) == 0)
+		ZvgIO.rtStatus.flags |= RTF_BFRLOCK;
+
+	return ((uchar *)bfr);
+}
+
+/*****************************************************************************
+* Release a buffer allocated by 'zvgRtAlloc()'.
+*****************************************************************************/
+void zvgRtFree( uchar *bfr, uint size)
+{
+	if (bfr == NULL)
+		return;
+
+	if (ZvgIO.rtStatus.flags & RTF_BFRLOCK)
+		munlock( bfr, size);
+
+	free( bfr);
+}
+
+/*****************************************************************************
+* Start real-time mode, if it has been requested.
+*
+* Locks all memory, and starts the sender thread.  Anything that can't be
+* done is noted in 'ZvgIO.rtStatus', and the driver falls back to sending
+* from the caller's thread.
+*****************************************************************************/
+void zvgRtStart( void)
+{
+	ZvgRt_s	*rt;
+
+	if (!(ZvgIO.rtStatus.flags & RTF_REQUESTED) || ZvgIO.rtP != NULL)
+		return;
+
+	// lock everything we have now, and everything we get later
+
+	if (mlockall( MCL_CURRENT | MCL_FUTURE) == 0)
+		ZvgIO.rtStatus.flags |= RTF_MLOCKALL;
+
+	else
+		ZvgIO.rtStatus.lockErr = errno;
+
+	rt = (ZvgRt_s *)calloc( 1, sizeof( ZvgRt_s));
+
+	if (rt == NULL)
+		return;
+
+	pthread_mutex_init( &rt->lock, NULL);
+	pthread_cond_init( &rt->cond, NULL);
+	rt->board = ZvgCurBoard;
+
+	if (pthread_create( &rt->thread, NULL, rtThread, rt) != 0)
+	{	pthread_cond_destroy( &rt->cond);
+		pthread_mutex_destroy( &rt->lock);
+		free( rt);
+		return;
+	}
+
+	// wait for the thread to set its priority, so the status is complete
+
+	pthread_mutex_lock( &rt->lock);
+
+	while (!rt->ready)
+		pthread_cond_wait( &rt->cond, &rt->lock);
+
+	pthread_mutex_unlock( &rt->lock);
+
+	ZvgIO.rtStatus.flags |= RTF_THREAD;
+	ZvgIO.rtP = rt;
+}
+
+/*****************************************************************************
+* Stop the sender thread, after it finishes any buffer it is sending.
+*****************************************************************************/
+void zvgRtStop( void)
+{
+	ZvgRt_s	*rt;
+	uint	board;
+
+	rt = ZvgIO.rtP;
+
+	if (rt == NULL)
+		return;
+
+	zvgRtWait();
+
+	pthread_mutex_lock( &rt->lock);
+	rt->state = RTS_QUIT;
+	pthread_cond_broadcast( &rt->cond);
+	pthread_mutex_unlock( &rt->lock);
+
+	pthread_join( rt->thread, NULL);
+	pthread_cond_destroy( &rt->cond);
+	pthread_mutex_destroy( &rt->lock);
+	free( rt);
+
+	ZvgIO.rtP = NULL;
+	ZvgIO.rtStatus.flags &= ~(RTF_THREAD | RTF_FIFO | RTF_PINNED);
+
+	// the lock is for the whole process, keep it while another board has one
+
+	if (ZvgIO.rtStatus.flags & RTF_MLOCKALL)
+	{	ZvgIO.rtStatus.flags &= ~RTF_MLOCKALL;
+
+		for (board = 0; board < ZVG_BOARDS; board++)
+		{
+			if (ZvgBoardIO[board].rtStatus.flags & RTF_MLOCKALL)
+				break;
+		}
+
+		if (board == ZVG_BOARDS)
+			munlockall();
+	}
+
+}
+
+/*****************************************************************************
+* Hand a buffer to the sender thread.
+*
+* The buffer must not be touched until 'zvgRtWait()' says it has been sent.
+*
+* Returns:
+*    errOk         - Buffer is being sent.
+*    errEcpBadMode - No sender thread is running.
+*****************************************************************************/
+uint zvgRtPost( uchar *mem, uint count)
+{
+	ZvgRt_s	*rt;
+
+	rt = ZvgIO.rtP;
+
+	if (rt == NULL)
+		return (errEcpBadMode);
+
+	pthread_mutex_lock( &rt->lock);
+
+	while (rt->state == RTS_POSTED)
+		pthread_cond_wait( &rt->cond, &rt->lock);
+
+	rt->sendP = mem;
+	rt->sendCount = count;
+	rt->state = RTS_POSTED;
+	pthread_cond_broadcast( &rt->cond);
+	pthread_mutex_unlock( &rt->lock);
+
+	return (errOk);
+}
+
+/*****************************************************************************
+* Wait for the sender thread to finish the posted buffer.
+*
+* Returns the error returned when the buffer was sent.  The error is only
+* returned once.
+*****************************************************************************/
+uint zvgRtWait( void)
+{
+	ZvgRt_s	*rt;
+	uint	err;
+
+	rt = ZvgIO.rtP;
+
+	if (rt == NULL)
+		return (errOk);
+
+	pthread_mutex_lock( &rt->lock);
+
+	while (rt->state == RTS_POSTED)
+		pthread_cond_wait( &rt->cond, &rt->lock);
+
+	err = rt->err;
+	rt->err = errOk;
+	pthread_mutex_unlock( &rt->lock);
+
+	return (err);
+}
+
+/*****************************************************************************
+* Return the state of the real-time mode.
+*****************************************************************************/
+void zvgRtGetStatus( ZvgRtStatus_s *status)
+{
+	*status = ZvgIO.rtStatus;
+}
+
+/*****************************************************************************
+* Return the send timing statistics.
+*
+* If a buffer is being sent, the values may be from the buffer before it.
+*****************************************************************************/
+void zvgRtGetStats( ZvgRtStats_s *stats)
+{
+	*stats = ZvgIO.rtStats;
+}
+
+/*****************************************************************************
+* Return a file descriptor that becomes readable each time a buffer
+* finishes sending, or is dropped while the link is down.
+*
+* It is an eventfd, reading it returns the number of buffers finished since
+* it was last read, as a 64 bit count.  It is opened the first time this is
+* called, and closed by 'zvgClose()'.  In real-time mode the next
+* 'zvgFrameSend()' won't block once it is readable.
+*
+* Returns:
+*    The descriptor, or -1 if one couldn't be opened ('errno' says why).
+*****************************************************************************/
+int zvgRtEventFd( void)
+{
+	if (!ZvgIO.rtEventOpen)
+	{	ZvgIO.rtEventFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+		if (ZvgIO.rtEventFd < 0)
+			return (-1);
+
+		ZvgIO.rtEventOpen = zTrue;
+	}
+	return (ZvgIO.rtEventFd);
+}
+
+/*****************************************************************************
+* Return what happened to the last buffer finished.
+*
+* A program that reads the count from 'zvgRtEventFd()' can tell from 'seq'
+* if it missed any.
+*
+* Returns:
+*    errOk, or errReadPending if no buffer has finished yet.
+*****************************************************************************/
+uint zvgRtGetFeedback( ZvgFeedback_s *fb)
+{
+	pthread_mutex_lock( &RtFbLock);
+	*fb = ZvgIO.rtFeedback;
+	pthread_mutex_unlock( &RtFbLock);
+
+	return (fb->seq == 0 ? errReadPending : errOk);
+}
+
+/*****************************************************************************
+* Note that a buffer has finished, and signal 'zvgRtEventFd()'.  Called by
+* 'zvgDmaStart()' from the thread sending, and by 'zvgDmaSendSwap()' for a
+* buffer it drops.  The NOPs sent while opening the ZVG aren't counted, so
+* the first frame is 'seq' 1.
+*
+* Called with:
+*    startNs = Time sending started.
+*    bytes   = Bytes in the buffer.
+*    err     = Error sending it.
+*****************************************************************************/
+void zvgRtDone( long long int startNs, uint bytes, uint err)
+{
+	static const uint64_t	one = 1;
+	long long int			postNs, endNs;
+
+	endNs = tmrReadTimer();
+	postNs = ZvgIO.rtPostNs != 0 ? ZvgIO.rtPostNs : startNs;
+	ZvgIO.rtPostNs = 0;
+
+	if (!ZvgIO.rtFeedOn)
+		return;
+
+	pthread_mutex_lock( &RtFbLock);
+	ZvgIO.rtFeedback.seq++;
+	ZvgIO.rtFeedback.postNs = postNs;
+	ZvgIO.rtFeedback.startNs = startNs;
+	ZvgIO.rtFeedback.endNs = endNs;
+	ZvgIO.rtFeedback.deadlineNs = postNs + tmrGetTicksInFrame();
+	ZvgIO.rtFeedback.bytes = bytes;
+	ZvgIO.rtFeedback.err = err;
+	ZvgIO.rtFeedback.missed = endNs > ZvgIO.rtFeedback.deadlineNs;
+	pthread_mutex_unlock( &RtFbLock);
+
+	// a count that would overflow (EAGAIN) leaves the descriptor readable
+	// anyway, any other error means it was closed under us
+
+	if (ZvgIO.rtEventOpen && write( ZvgIO.rtEventFd, &one, sizeof( one)) < 0 && errno != EAGAIN)
+		ZvgIO.rtEventOpen = zFalse;
+}
+
+/*****************************************************************************
+* Close the descriptor returned by 'zvgRtEventFd()', and forget the last
+* buffer's feedback.  Called by 'zvgClose()'.
+*****************************************************************************/
+void zvgRtCloseEvents( void)
+{
+	if (ZvgIO.rtEventOpen)
+	{	close( ZvgIO.rtEventFd);
+		ZvgIO.rtEventOpen = zFalse;
+	}
+
+	pthread_mutex_lock( &RtFbLock);
+	memset( &ZvgIO.rtFeedback, 0, sizeof( ZvgIO.rtFeedback));
+	pthread_mutex_unlock( &RtFbLock);
+}
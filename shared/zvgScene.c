@@ -0,0 +1,513 @@
+/*****************************************************************************
+* A retained tree of objects drawn each frame.
+*
+* A program used to transform every vector itself each frame, scaling and
+* offsetting its tables, and then leave the encoder to throw away the
+* vectors off the screen one at a time.  Here an object, a node, holds its
+* vectors in its own coordinates, and a transform to its parent's, in the
+* same 16.16 fixed point as layers, see 'zvgLayer.h'.  Moving a node moves
+* everything under it.
+*
+* Each node keeps its vectors transformed to the screen, and the bounds of
+* them, and of its whole subtree.  Only a node whose transform or vectors
+* changed, or one under it, is transformed again, and a subtree with
+* nothing changed isn't visited.  Drawing skips a subtree whose bounds are
+* outside the cull window without looking at its nodes, and vectors of a
+* node inside are still clipped by the encoder as usual.
+*
+* 'zvgSceneDraw()' gives the vectors to 'zvgFrameVector()', so a scene may
+* be drawn into a layer.  Its cull window is then in the layer's
+* coordinates.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdlib.h>
+#include	<string.h>
+
+#include	"zstddef.h"
+#include	"zvgFrame.h"
+#include	"zvgScene.h"
+
+// Fixed point 'aa * bb + cc * dd'
+
+#define	FIX( aa, bb, cc, dd) \
+	((int)(((long long)(aa) * (bb) + (long long)(cc) * (dd) + LAYER_ONE / 2) >> 16))
+
+// Bits of 'ZvgNode_s.dirty'
+
+#define	NODE_XFORM		0x01			// transform changed, the node and those under it move
+#define	NODE_GEOM		0x02			// vectors changed
+#define	NODE_BELOW		0x04			// a node under this one changed
+
+// A node
+
+struct ZVGNODE_S
+{	ZvgNode_s		*parent;				// NULL for a root
+	ZvgNode_s		*child;					// first child, NULL if none
+	ZvgNode_s		*next;					// next child of the parent
+	ZvgLayerXform_s	local;					// to the parent's coordinates
+	ZvgLayerXform_s	world;					// to the screen's, as of the last update
+	int				*vectors;				// xStart, yStart, xEnd, yEnd in the node's coordinates
+	int				*screen;				// the same on the screen, as of the last update
+	uint			count;					// vectors
+	uint			color;					// SCENE_INHERIT for the parent's
+	bool			show;					// drawn, with those under it
+	uint			dirty;					// NODE_xxx
+	ZvgSceneBox_s	own;					// bounds of the node's vectors on the screen
+	ZvgSceneBox_s	bounds;					// bounds of the subtree
+	uint			subNodes;				// nodes in the subtree, this one included
+	uint			subVectors;				// vectors in the subtree
+	ZvgSceneBox_s	cull;					// cull window, when drawn from this node
+};
+
+/*****************************************************************************
+* Mark a node changed, and the nodes above it as having a changed node
+* under them.
+*****************************************************************************/
+static void sceneDirty( ZvgNode_s *node, uint bits)
+{
+	node->dirty |= bits;
+
+	for (node = node->parent; node != NULL && !(node->dirty & NODE_BELOW); node = node->parent)
+		node->dirty |= NODE_BELOW;
+}
+
+/*****************************************************************************
+* Grow a box to hold another.
+*****************************************************************************/
+static void boxAdd( ZvgSceneBox_s *box, const ZvgSceneBox_s *add)
+{
+	if (add->xMin > add->xMax)
+		return;
+
+	if (box->xMin > box->xMax)
+	{	*box = *add;
+		return;
+	}
+
+	if (add->xMin < box->xMin)
+		box->xMin = add->xMin;
+
+	if (add->yMin < box->yMin)
+		box->yMin = add->yMin;
+
+	if (add->xMax > box->xMax)
+		box->xMax = add->xMax;
+
+	if (add->yMax > box->yMax)
+		box->yMax = add->yMax;
+}
+
+/*****************************************************************************
+* Return zTrue if a box is empty, or has nothing inside a window.
+*****************************************************************************/
+static bool boxOutside( const ZvgSceneBox_s *box, const ZvgSceneBox_s *win)
+{
+	return (box->xMin > box->xMax || box->xMax < win->xMin || box->xMin > win->xMax
+			|| box->yMax < win->yMin || box->yMin > win->yMax);
+}
+
+/*****************************************************************************
+* Return zTrue if a box is all inside a window.
+*****************************************************************************/
+static bool boxInside( const ZvgSceneBox_s *box, const ZvgSceneBox_s *win)
+{
+	return (box->xMin >= win->xMin && box->xMax <= win->xMax
+			&& box->yMin >= win->yMin && box->yMax <= win->yMax);
+}
+
+/*****************************************************************************
+* Transform a node's vectors to the screen, and find their bounds.
+*****************************************************************************/
+static void sceneTransform( ZvgNode_s *node)
+{
+	const ZvgLayerXform_s	*xf;
+	const int				*src;
+	int						*dst;
+	uint					ii;
+
+	xf = &node->world;
+	src = node->vectors;
+	dst = node->screen;
+
+	node->own.xMin = 1;
+	node->own.xMax = 0;
+
+	for (ii = 0; ii < node->count * 2; ii++, src += 2, dst += 2)
+	{	dst[0] = FIX( xf->xx, src[0], xf->xy, src[1]) + xf->dx;
+		dst[1] = FIX( xf->yx, src[0], xf->yy, src[1]) + xf->dy;
+
+		if (ii == 0)
+		{	node->own.xMin = node->own.xMax = dst[0];
+			node->own.yMin = node->own.yMax = dst[1];
+			continue;
+		}
+
+		if (dst[0] < node->own.xMin)
+			node->own.xMin = dst[0];
+
+		else if (dst[0] > node->own.xMax)
+			node->own.xMax = dst[0];
+
+		if (dst[1] < node->own.yMin)
+			node->own.yMin = dst[1];
+
+		else if (dst[1] > node->own.yMax)
+			node->own.yMax = dst[1];
+	}
+}
+
+/*****************************************************************************
+* Bring a subtree up to date.
+*
+* Called with:
+*    node  = Top of the subtree.
+*    moved = zTrue if the node's parent moved since the last update.
+*    stats = Counters to add to.
+*****************************************************************************/
+static void sceneUpdate( ZvgNode_s *node, bool moved, ZvgSceneStats_s *stats)
+{
+	const ZvgLayerXform_s	*pp, *ll;
+	ZvgNode_s				*child;
+
+	if (!moved && node->dirty == 0)
+		return;
+
+	// the transform to the screen is the parent's, then the node's own
+
+	if (moved || (node->dirty & NODE_XFORM))
+	{	ll = &node->local;
+
+		if (node->parent == NULL)
+			node->world = *ll;
+
+		else
+		{	pp = &node->parent->world;
+			node->world.xx = FIX( pp->xx, ll->xx, pp->xy, ll->yx);
+			node->world.xy = FIX( pp->xx, ll->xy, pp->xy, ll->yy);
+			node->world.dx = FIX( pp->xx, ll->dx, pp->xy, ll->dy) + pp->dx;
+			node->world.yx = FIX( pp->yx, ll->xx, pp->yy, ll->yx);
+			node->world.yy = FIX( pp->yx, ll->xy, pp->yy, ll->yy);
+			node->world.dy = FIX( pp->yx, ll->dx, pp->yy, ll->dy) + pp->dy;
+		}
+
+		moved = zTrue;
+		stats->updated++;
+	}
+
+	if (moved || (node->dirty & NODE_GEOM))
+	{	sceneTransform( node);
+		stats->transformed += node->count;
+	}
+
+	// the subtree's bounds and sizes
+
+	node->bounds = node->own;
+	node->subNodes = 1;
+	node->subVectors = node->count;
+
+	for (child = node->child; child != NULL; child = child->next)
+	{	sceneUpdate( child, moved, stats);
+		boxAdd( &node->bounds, &child->bounds);
+		node->subNodes += child->subNodes;
+		node->subVectors += child->subVectors;
+	}
+
+	node->dirty = 0;
+}
+
+/*****************************************************************************
+* Draw a subtree, see 'zvgSceneDraw()'.
+*
+* Called with:
+*    node   = Top of the subtree.
+*    win    = Cull window.
+*    color  = Color of the node's parent.
+*    inside = zTrue if the subtree is known to be inside the window.
+*    stats  = Counters to add to.
+*
+* Returns:
+*    errOk, or the first error from 'zvgFrameVector()'.
+*****************************************************************************/
+static uint sceneDraw( const ZvgNode_s *node, const ZvgSceneBox_s *win, uint color, bool inside,
+		ZvgSceneStats_s *stats)
+{
+	const ZvgNode_s	*child;
+	const int		*vec;
+	uint			err, ii;
+
+	if (!node->show)
+		return (errOk);
+
+	stats->nodes++;
+
+	// a subtree off the window isn't looked at
+
+	if (!inside)
+	{
+		if (boxOutside( &node->bounds, win))
+		{	stats->culled += node->subNodes;
+			stats->culledVectors += node->subVectors;
+			return (errOk);
+		}
+
+		inside = boxInside( &node->bounds, win);
+	}
+
+	if (node->color != SCENE_INHERIT)
+		color = node->color;
+
+	if (node->count > 0)
+	{
+		if (!inside && boxOutside( &node->own, win))
+			stats->culledVectors += node->count;
+
+		else
+		{	zvgFrameSetColor( color);
+			vec = node->screen;
+
+			for (ii = 0; ii < node->count; ii++, vec += 4)
+			{	err = zvgFrameVector( vec[0], vec[1], vec[2], vec[3]);
+
+				if (err)
+					return (err);
+			}
+
+			stats->vectors += node->count;
+		}
+	}
+
+	for (child = node->child; child != NULL; child = child->next)
+	{	err = sceneDraw( child, win, color, inside, stats);
+
+		if (err)
+			return (err);
+	}
+	return (errOk);
+}
+
+/*****************************************************************************
+* Add a node to a scene.
+*
+* The node starts with no vectors, no transform, its parent's color, and
+* shown.  Its cull window, used if it is drawn as the top of a scene, is
+* the edges of the overscan.
+*
+* Called with:
+*    nodeP  = Set to the node.
+*    parent = Node to add it under, after those already there, or NULL to
+*             start a scene.
+*
+* Returns:
+*    errOk, or errMemory.
+*****************************************************************************/
+uint zvgSceneAdd( ZvgNode_s **nodeP, ZvgNode_s *parent)
+{
+	ZvgNode_s	*node, **link;
+
+	*nodeP = NULL;
+	node = (ZvgNode_s *)calloc( 1, sizeof( ZvgNode_s));
+
+	if (node == NULL)
+		return (errMemory);
+
+	node->local.xx = LAYER_ONE;
+	node->local.yy = LAYER_ONE;
+	node->color = SCENE_INHERIT;
+	node->show = zTrue;
+	node->own.xMin = 1;
+	node->own.xMax = 0;
+	node->bounds = node->own;
+	zvgSceneSetCullWin( node, X_MIN_O, Y_MIN_O, X_MAX_O, Y_MAX_O);
+
+	if (parent != NULL)
+	{	for (link = &parent->child; *link != NULL; link = &(*link)->next)
+			;
+
+		*link = node;
+		node->parent = parent;
+	}
+
+	sceneDirty( node, NODE_XFORM | NODE_GEOM);
+	*nodeP = node;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Remove a node and everything under it from its scene, and free them.
+*****************************************************************************/
+void zvgSceneRemove( ZvgNode_s *node)
+{
+	ZvgNode_s	**link;
+
+	if (node == NULL)
+		return;
+
+	while (node->child != NULL)
+		zvgSceneRemove( node->child);
+
+	if (node->parent != NULL)
+	{	for (link = &node->parent->child; *link != node; link = &(*link)->next)
+			;
+
+		*link = node->next;
+		sceneDirty( node->parent, NODE_BELOW);
+	}
+
+	free( node->vectors);
+	free( node->screen);
+	free( node);
+}
+
+/*****************************************************************************
+* Set a node's vectors, in its own coordinates.  The table is copied.
+*
+* Called with:
+*    node    = Node to set.
+*    vectors = 'count' vectors, each xStart, yStart, xEnd, yEnd.
+*    count   = Vectors in the table, may be 0.
+*
+* Returns:
+*    errOk, or errMemory, the node then has no vectors.
+*****************************************************************************/
+uint zvgSceneSetVectors( ZvgNode_s *node, const int *vectors, uint count)
+{
+	free( node->vectors);
+	free( node->screen);
+	node->vectors = NULL;
+	node->screen = NULL;
+	node->count = 0;
+	sceneDirty( node, NODE_GEOM);
+
+	if (count == 0)
+		return (errOk);
+
+	node->vectors = (int *)malloc( count * 4 * sizeof( int));
+	node->screen = (int *)malloc( count * 4 * sizeof( int));
+
+	if (node->vectors == NULL || node->screen == NULL)
+	{	free( node->vectors);
+		free( node->screen);
+		node->vectors = NULL;
+		node->screen = NULL;
+		return (errMemory);
+	}
+
+	memcpy( node->vectors, vectors, count * 4 * sizeof( int));
+	node->count = count;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Set a node's transform to its parent's coordinates, NULL for none.
+*****************************************************************************/
+void zvgSceneSetXform( ZvgNode_s *node, const ZvgLayerXform_s *xform)
+{
+	if (xform == NULL)
+	{	memset( &node->local, 0, sizeof( node->local));
+		node->local.xx = LAYER_ONE;
+		node->local.yy = LAYER_ONE;
+	}
+	else
+		node->local = *xform;
+
+	sceneDirty( node, NODE_XFORM);
+}
+
+/*****************************************************************************
+* Move a node, setting only the offset of its transform.
+*****************************************************************************/
+void zvgSceneSetPos( ZvgNode_s *node, int xx, int yy)
+{
+	if (node->local.dx == xx && node->local.dy == yy)
+		return;
+
+	node->local.dx = xx;
+	node->local.dy = yy;
+	sceneDirty( node, NODE_XFORM);
+}
+
+/*****************************************************************************
+* Set a node's color, used by those under it that inherit it.  SCENE_INHERIT
+* draws with the parent's, the top of a scene's is the frame's color when
+* it is drawn.
+*****************************************************************************/
+void zvgSceneSetColor( ZvgNode_s *node, uint color)
+{
+	node->color = color;
+}
+
+/*****************************************************************************
+* Show or hide a node, and those under it.
+*****************************************************************************/
+void zvgSceneShow( ZvgNode_s *node, bool show)
+{
+	node->show = show;
+}
+
+/*****************************************************************************
+* Set the cull window used when the scene is drawn from this node.  Nodes
+* with nothing inside it are skipped.
+*****************************************************************************/
+void zvgSceneSetCullWin( ZvgNode_s *node, int xMin, int yMin, int xMax, int yMax)
+{
+	node->cull.xMin = xMin;
+	node->cull.yMin = yMin;
+	node->cull.xMax = xMax;
+	node->cull.yMax = yMax;
+}
+
+/*****************************************************************************
+* Transform the nodes changed since the last update.  'zvgSceneDraw()' does
+* this itself, call it to get bounds without drawing.
+*****************************************************************************/
+void zvgSceneUpdate( ZvgNode_s *root)
+{
+	ZvgSceneStats_s	stats;
+
+	memset( &stats, 0, sizeof( stats));
+	sceneUpdate( root, zFalse, &stats);
+}
+
+/*****************************************************************************
+* Return the bounds on the screen of a node and those under it, as of the
+* last update.  Empty, 'xMin' larger than 'xMax', if there are no vectors.
+*****************************************************************************/
+void zvgSceneGetBounds( ZvgNode_s *node, ZvgSceneBox_s *box)
+{
+	*box = node->bounds;
+}
+
+/*****************************************************************************
+* Update a scene, and draw it with 'zvgFrameVector()'.
+*
+* Subtrees outside the cull window of 'root' are skipped.  The frame's
+* color is the same after as before.
+*
+* Called with:
+*    root  = Node to draw, with those under it.
+*    stats = Filled in with the counters of this draw, may be NULL.
+*
+* Returns:
+*    errOk, or the first error from 'zvgFrameVector()'.
+*****************************************************************************/
+uint zvgSceneDraw( ZvgNode_s *root, ZvgSceneStats_s *stats)
+{
+	ZvgSceneStats_s	count;
+	uint			color, err;
+
+	memset( &count, 0, sizeof( count));
+	sceneUpdate( root, zFalse, &count);
+
+	color = ZvgENC.encColor;
+	err = sceneDraw( root, &root->cull, color, zFalse, &count);
+	zvgFrameSetColor( color);
+
+	if (stats != NULL)
+		*stats = count;
+
+	return (err);
+}
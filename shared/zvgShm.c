@@ -0,0 +1,379 @@
+/*****************************************************************************
+* Shared memory stats segment.
+*
+* While a segment is open, the frame counters of 'zvgFrameGetStats()' are
+* copied into a small POSIX shared memory segment each time a frame is
+* sent, along with a history of the last SHM_HISTORY frames.  Programs such
+* as 'zvgTop' map the segment read only, so a running game can be watched
+* without stopping it or changing it.
+*
+* The segment has a single writer, the program driving the ZVG, and is
+* guarded by a sequence lock, so the writer never waits on a reader.  A
+* reader copies the segment, and tries again if the writer was in the
+* middle of an update.
+*
+* A segment is opened by 'zvgShmStart()' or the 'S' attribute of
+* 'ZVGPORT=', and removed when the ZVG is closed.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _GNU_SOURCE
+#define	_GNU_SOURCE							// for 'program_invocation_short_name'
+#endif
+
+#include	<errno.h>
+#include	<fcntl.h>
+#include	<sched.h>
+#include	<signal.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<sys/mman.h>
+#include	<sys/stat.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgShm.h"
+#include	"zvgLink.h"
+
+#define	SHM_FPS_NS		1000000000LL	// frames per second are counted over this long
+
+// State of a segment being published
+
+typedef struct ZVGSHMPUB_S
+{	ZvgShm_s		*shm;				// the segment, mapped
+	char			name[SHM_NAME_SZ+1];	// name it was created with
+	long long int	winNs;				// start of the frames per second window
+	ulong			winFrames;			// total frames at the start of the window
+} ZvgShmPub_s;
+
+/*****************************************************************************
+* Make a segment name, which must start with a '/'.
+*
+* Returns:
+*    errOk      - Name made.
+*    errShmOpen - Name is empty or too long.
+*****************************************************************************/
+static uint shmName( char *full, const char *name)
+{
+	if (name == NULL || name[0] == '\0')
+		name = SHM_DEF_NAME;
+
+	if (strlen( name) >= SHM_NAME_SZ)
+		return (errShmOpen);
+
+	full[0] = '/';
+	strcpy( name[0] == '/' ? full : full + 1, name);
+	return (errOk);
+}
+
+/*****************************************************************************
+* Remove a segment found with the name about to be created, if the program
+* that wrote it has exited.
+*
+* Called with:
+*    full = Name of segment, from 'shmName()'.
+*
+* Returns:
+*    errOk       - Segment removed, or already gone.
+*    errShmBad   - Segment is not a stats segment, or of another version,
+*                  so its writer isn't known.  It's left alone.
+*    errShmInUse - The program that wrote the segment is still running.
+*****************************************************************************/
+static uint shmRemoveStale( const char *full)
+{
+	const ZvgShm_s	*shm;
+	uint			err;
+	int				pid;
+
+	err = zvgShmAttach( full, &shm);
+
+	if (err == errShmOpen)
+		return (errOk);
+
+	if (err)
+		return (err);
+
+	pid = shm->pid;
+	zvgShmDetach( shm);
+
+	// EPERM means the process is there, but owned by another user
+
+	if (kill( pid, 0) == 0 || errno != ESRCH)
+		return (errShmInUse);
+
+	shm_unlink( full);
+	return (errOk);
+}
+
+/*****************************************************************************
+* Create the stats segment, and start publishing to it.
+*
+* A segment left behind by an earlier run with the same name is removed
+* and made again, but not one whose writer is still running.
+*
+* Called with:
+*    name = Name of segment, NULL for SHM_DEF_NAME.
+*
+* Returns:
+*    errOk       - Segment created.
+*    errShmOpen  - Segment could not be created.
+*    errShmBad   - A segment of that name exists, and isn't a stats segment
+*                  of this version.
+*    errShmInUse - A segment of that name is being written by a program
+*                  that is running.
+*    errMemory   - Out of memory.
+*****************************************************************************/
+uint zvgShmStart( const char *name)
+{
+	ZvgShmPub_s	*pub;
+	ZvgShm_s	*shm;
+	uint		err;
+	int			fd;
+
+	zvgShmStop();
+
+	pub = (ZvgShmPub_s *)calloc( 1, sizeof( ZvgShmPub_s));
+
+	if (pub == NULL)
+		return (errMemory);
+
+	if (shmName( pub->name, name))
+	{	free( pub);
+		return (errShmOpen);
+	}
+
+	fd = shm_open( pub->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+	if (fd < 0 && errno == EEXIST)
+	{	err = shmRemoveStale( pub->name);
+
+		if (err)
+		{	free( pub);
+			return (err);
+		}
+
+		fd = shm_open( pub->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	}
+
+	if (fd < 0)
+	{	free( pub);
+		return (errShmOpen);
+	}
+
+	if (ftruncate( fd, sizeof( ZvgShm_s)) != 0)
+	{	close( fd);
+		shm_unlink( pub->name);
+		free( pub);
+		return (errShmOpen);
+	}
+
+	shm = (ZvgShm_s *)mmap( NULL, sizeof( ZvgShm_s), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close( fd);
+
+	if (shm == MAP_FAILED)
+	{	shm_unlink( pub->name);
+		free( pub);
+		return (errShmOpen);
+	}
+
+	// readers ignore the segment until the magic number is written
+
+	__atomic_store_n( &shm->magic, 0, __ATOMIC_RELAXED);
+	memset( (uchar *)shm + sizeof( shm->magic), 0, sizeof( ZvgShm_s) - sizeof( shm->magic));
+
+	shm->version = SHM_VERSION;
+	shm->size = sizeof( ZvgShm_s);
+	shm->pid = getpid();
+	strncpy( shm->prog, program_invocation_short_name, SHM_PROG_SZ - 1);
+	strcpy( shm->trSpec, ZvgIO.trSpec);
+	shm->envMonitor = ZvgIO.envMonitor;
+	shm->frameNs = tmrGetTicksInFrame();
+
+	__atomic_store_n( &shm->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+	pub->shm = shm;
+	ZvgIO.shmP = pub;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Stop publishing, and remove the segment.  May be called when no segment
+* is open.
+*****************************************************************************/
+void zvgShmStop( void)
+{
+	ZvgShmPub_s	*pub;
+
+	pub = ZvgIO.shmP;
+
+	if (pub == NULL)
+		return;
+
+	ZvgIO.shmP = NULL;
+	munmap( pub->shm, sizeof( ZvgShm_s));
+	shm_unlink( pub->name);
+	free( pub);
+}
+
+/*****************************************************************************
+* Publish the counters of the frame just sent.  Called by 'zvgFrameSend()'.
+*
+* Called with:
+*    last  = Counters of the frame just sent.
+*    total = Totals, including that frame.
+*****************************************************************************/
+void zvgShmPublish( const ZvgFrameStats_s *last, const ZvgFrameStats_s *total)
+{
+	ZvgShmPub_s		*pub;
+	ZvgShm_s		*shm;
+	ZvgShmFrame_s	*fr;
+	long long int	now;
+	uint			seq;
+
+	pub = ZvgIO.shmP;
+
+	if (pub == NULL)
+		return;
+
+	shm = pub->shm;
+	now = tmrReadTimer();
+
+	// start the update, readers retry until 'seq' is even again
+
+	seq = shm->seq;
+	__atomic_store_n( &shm->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence( __ATOMIC_RELEASE);
+
+	// frames per second, counted over about a second
+
+	if (pub->winNs == 0 || total->frames < pub->winFrames)
+	{	pub->winNs = now;
+		pub->winFrames = total->frames;
+	}
+
+	else if (now - pub->winNs >= SHM_FPS_NS)
+	{	shm->fps100 = (uint)((total->frames - pub->winFrames) * 100 * SHM_FPS_NS / (now - pub->winNs));
+		pub->winNs = now;
+		pub->winFrames = total->frames;
+	}
+
+	shm->updateNs = now;
+	shm->frameNs = tmrGetTicksInFrame();
+	shm->linkDown = zvgLinkDown();
+	shm->last = *last;
+	shm->total = *total;
+
+	fr = shm->hist + (shm->head % SHM_HISTORY);
+	fr->sentNs = now;
+	fr->bytes = (uint)last->bytes;
+	fr->vectors = (uint)last->vectors;
+	fr->drawUs = (uint)(last->drawNs / 1000);
+	fr->encodeUs = (uint)(last->encodeNs / 1000);
+	fr->sendUs = (uint)(last->sendNs / 1000);
+	fr->stallUs = (uint)(last->maxStallNs / 1000);
+	fr->fulls = (uint)last->fulls;
+	fr->missed = (uint)last->missed;
+	shm->head++;
+
+	__atomic_store_n( &shm->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/*****************************************************************************
+* Map a stats segment, read only.
+*
+* Called with:
+*    name = Name of segment, NULL for SHM_DEF_NAME.
+*    shmP = Set to the mapped segment, to be passed to 'zvgShmRead()'.
+*
+* Returns:
+*    errOk      - Segment mapped.
+*    errShmOpen - No segment of that name.
+*    errShmBad  - Segment is not a stats segment, or of another version.
+*****************************************************************************/
+uint zvgShmAttach( const char *name, const ZvgShm_s **shmP)
+{
+	char		full[SHM_NAME_SZ+1];
+	struct stat	st;
+	ZvgShm_s	*shm;
+	int			fd;
+
+	if (shmName( full, name))
+		return (errShmOpen);
+
+	fd = shm_open( full, O_RDONLY, 0);
+
+	if (fd < 0)
+		return (errShmOpen);
+
+	if (fstat( fd, &st) != 0 || st.st_size < (off_t)sizeof( ZvgShm_s))
+	{	close( fd);
+		return (errShmBad);
+	}
+
+	shm = (ZvgShm_s *)mmap( NULL, sizeof( ZvgShm_s), PROT_READ, MAP_SHARED, fd, 0);
+	close( fd);
+
+	if (shm == MAP_FAILED)
+		return (errShmOpen);
+
+	if (__atomic_load_n( &shm->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC
+			|| shm->version != SHM_VERSION || shm->size != sizeof( ZvgShm_s))
+	{	munmap( shm, sizeof( ZvgShm_s));
+		return (errShmBad);
+	}
+
+	*shmP = shm;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Unmap a segment mapped by 'zvgShmAttach()'.
+*****************************************************************************/
+void zvgShmDetach( const ZvgShm_s *shm)
+{
+	munmap( (void *)shm, sizeof( ZvgShm_s));
+}
+
+/*****************************************************************************
+* Take a consistent copy of a segment.
+*
+* Called with:
+*    shm  = Segment, from 'zvgShmAttach()'.
+*    copy = Filled in with the copy.
+*
+* Returns:
+*    errOk      - Copy made.
+*    errShmBad  - Segment was removed or replaced by another version.
+*    errShmBusy - The writer didn't finish an update in SHM_TRIES tries.
+*****************************************************************************/
+uint zvgShmRead( const ZvgShm_s *shm, ZvgShm_s *copy)
+{
+	uint	ii, seq;
+
+	for (ii = 0; ii < SHM_TRIES; ii++)
+	{
+		seq = __atomic_load_n( &shm->seq, __ATOMIC_ACQUIRE);
+
+		if (seq & 1)
+		{	sched_yield();						// writer is updating
+			continue;
+		}
+
+		memcpy( copy, shm, sizeof( ZvgShm_s));
+		__atomic_thread_fence( __ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n( &shm->seq, __ATOMIC_RELAXED) == seq)
+		{
+			if (copy->magic != SHM_MAGIC || copy->version != SHM_VERSION)
+				return (errShmBad);
+
+			return (errOk);
+		}
+	}
+	return (errShmBusy);
+}
@@ -0,0 +1,698 @@
+/*****************************************************************************
+* ECP port and ZVG simulator.
+*
+* Simulates the registers of a Super I/O ECP port (data, DSR, DCR, ECR,
+* cnfgA/B and the FIFO), and the ZVG on the other end of the cable, well
+* enough for the direct port I/O code in 'zvgPort.c' to run against it
+* unchanged.  The simulator hooks 'inportb()' / 'outportb()' through
+* 'ZvgIO.ioHookP', everything above that is the real code.
+*
+* The ZVG side follows the IEEE-1284 peripheral events for negotiation,
+* termination, the reverse nibble mode (with the device ID) and the ECP
+* forward mode, and answers READ_MON and READ_SPD with the default replies
+* used by the sink transports.
+*
+* The FIFO drains at a set rate, and stalls, XFlag drops, cable pulls and
+* slow nibble replies can be injected, so throughput and the timeout paths
+* can be tested without a ZVG.  The port raises the service and nFault
+* interrupts armed in its ECR, for the WAIT_IRQ policy.
+*
+* The simulator is chosen as the 'sim' transport, "sim:rate" sets the drain
+* rate in bytes per second.  Other settings are made by 'zvgSimConfig()'.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdlib.h>
+#include	<string.h>
+#include	<time.h>
+
+#include	"zstddef.h"
+#include	"zvgCmds.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgTrans.h"
+#include	"zvgSim.h"
+
+#define	SIM_HIST		9					// size of the ZVG's look ahead buffer
+#define	SIM_COMPAT		(DSR_nAck | DSR_Select | DSR_nFault)	// idle status lines
+#define	SIM_IRQ_NS		20000LL				// how often the interrupt lines are looked at
+
+// States of the simulated ZVG
+
+enum
+{	SIM_IDLE = 0,						// compatibility mode
+	SIM_NEG,							// negotiating, waiting for HostClk
+	SIM_ECP_SETUP,						// ECP mode accepted, waiting for HostAck
+	SIM_ECP,							// ECP forward mode
+	SIM_NIBBLE,							// reverse nibble mode
+	SIM_TERM							// terminating, waiting for HostBusy
+};
+
+// State of the simulator
+
+typedef struct ZVGSIM_S
+{	uint			base;				// port address
+	uchar			data;				// data register
+	uchar			dcr;				// DCR, as written
+	uchar			ecr;				// ECR, as written
+	uchar			cnfgA;
+	uchar			cnfgB;
+	uchar			lines;				// status lines driven by ZVG, before inversion
+
+	uchar			fifo[SIM_FIFO_SZ];
+	uint			fifoHead;			// index of next byte out
+	uint			fifoCount;
+	long long int	drainTime;			// FIFO has been drained up to this time
+
+	uint			state;				// SIM_xxx
+	uint			nbPhase;			// phase of the nibble byte being sent
+	uchar			hist[SIM_HIST];		// last bytes taken from the FIFO
+	uchar			reply[ZVG_MAX_BFRSZ+2];	// data waiting to be sent back
+	uint			replyLen;
+	uint			replyIdx;
+
+	bool			pending;			// set if a reply to the host is delayed
+	uchar			pendLines;			// status lines to set after the delay
+	long long int	pendAt;				// time to set them
+
+	uint			faults;				// faults in effect
+	ZvgSimCfg_s		cfg;
+	ZvgSimStats_s	stats;
+} ZvgSim_s;
+
+// Settings used when the simulator is opened
+
+static ZvgSimCfg_s	SimCfg;
+
+/*****************************************************************************
+* Put the status lines for a nibble on the wire.
+*****************************************************************************/
+static uchar simNibble( uchar lines, uint nib)
+{
+	lines &= ~(DSR_nFault | DSR_Select | DSR_PError | DSR_Busy | DSR_nAck);
+
+	if (nib & 0x01)
+		lines |= DSR_nFault;
+
+	if (nib & 0x02)
+		lines |= DSR_Select;
+
+	if (nib & 0x04)
+		lines |= DSR_PError;
+
+	if (nib & 0x08)
+		lines |= DSR_Busy;
+
+	return (lines);								// PtrClk low, nibble is valid
+}
+
+/*****************************************************************************
+* Set the nibble mode status lines to show if there is data to send.
+*****************************************************************************/
+static uchar simNibbleIdle( ZvgSim_s *sim)
+{
+	uchar	lines;
+
+	lines = DSR_PtrClk;							// XFlag low, not busy
+
+	if (sim->replyIdx >= sim->replyLen)
+		lines |= DSR_nDataAvail | DSR_AckDataReq;	// nothing to send
+
+	return (lines);
+}
+
+/*****************************************************************************
+* Answer the host, after the nibble delay if in the nibble mode.
+*****************************************************************************/
+static void simRespond( ZvgSim_s *sim, uchar lines, long long int now)
+{
+	if (sim->state == SIM_NIBBLE && sim->cfg.nibbleDelayUs > 0)
+	{	sim->pending = zTrue;
+		sim->pendLines = lines;
+		sim->pendAt = now + (long long int)sim->cfg.nibbleDelayUs * 1000LL;
+	}
+	else
+		sim->lines = lines;
+}
+
+/*****************************************************************************
+* Queue data to be sent back to the host.
+*****************************************************************************/
+static void simReply( ZvgSim_s *sim, const uchar *data, uint len)
+{
+	memcpy( sim->reply, data, len);
+	sim->replyLen = len;
+	sim->replyIdx = 0;
+}
+
+/*****************************************************************************
+* The ZVG takes a byte from the FIFO.
+*
+* Watches for READ_MON or READ_SPD followed by enough NOPs to execute, and
+* the count at which injected faults start.
+*****************************************************************************/
+static void simTake( ZvgSim_s *sim, uchar cc)
+{
+	uint	ii;
+
+	sim->stats.bytes++;
+	memmove( sim->hist, sim->hist + 1, SIM_HIST - 1);
+	sim->hist[SIM_HIST-1] = cc;
+
+	if (sim->cfg.faults && sim->stats.bytes >= sim->cfg.faultAfter)
+		zvgSimFault( sim->cfg.faults);
+
+	for (ii = 1; ii < SIM_HIST; ii++)
+		if (sim->hist[ii] != zcNOP)
+			return;
+
+	if (sim->hist[0] == zcREAD_MON)
+		simReply( sim, TrDefaultMon, ZVG_MON_SIZE);
+
+	else if (sim->hist[0] == zcREAD_SPD)
+		simReply( sim, TrDefaultSpd, 4);
+
+	else
+		return;
+
+	sim->hist[0] = zcNOP;						// only answer once
+	sim->lines &= ~DSR_nPeriphRequest;			// tell host data is waiting
+}
+
+/*****************************************************************************
+* Catch the simulation up to the current time.
+*
+* Sets any delayed status lines, and drains the FIFO at the set rate.
+*****************************************************************************/
+static void simUpdate( ZvgSim_s *sim, long long int now)
+{
+	long long int	count;
+
+	if (sim->pending && now >= sim->pendAt)
+	{	sim->lines = sim->pendLines;
+		sim->pending = zFalse;
+	}
+
+	if (sim->fifoCount == 0 || sim->state != SIM_ECP || sim->faults)
+	{	sim->drainTime = now;
+		return;
+	}
+
+	// work out how many bytes the ZVG could have taken by now
+
+	if (sim->cfg.drainRate == 0)
+		count = sim->fifoCount;
+
+	else
+	{	count = (now - sim->drainTime) * sim->cfg.drainRate / 1000000000LL;
+
+		if (count > sim->fifoCount)
+			count = sim->fifoCount;
+	}
+
+	if (count == 0)
+		return;
+
+	if (sim->cfg.drainRate != 0)
+		sim->drainTime += count * 1000000000LL / sim->cfg.drainRate;
+
+	while (count-- > 0)
+	{	simTake( sim, sim->fifo[sim->fifoHead]);
+		sim->fifoHead = (sim->fifoHead + 1) % SIM_FIFO_SZ;
+		sim->fifoCount--;
+	}
+
+	if (sim->fifoCount == 0)
+		sim->drainTime = now;
+}
+
+/*****************************************************************************
+* The host has written the DCR, act on any handshake line that changed.
+*
+* 'od' and 'nd' are the old and new DCR lines, after inversion.
+*****************************************************************************/
+static void simControl( ZvgSim_s *sim, uchar od, uchar nd, long long int now)
+{
+	uchar	rise, fall;
+	uint	nib;
+
+	rise = ~od & nd;
+	fall = od & ~nd;
+
+	// a cable pull stops the ZVG from seeing anything
+
+	if (sim->faults & SIMF_CABLE)
+		return;
+
+	// 1284_Active going high starts a negotiation from any state (event 1)
+
+	if (rise & DCR_1284_Active)
+	{	sim->stats.negotiations++;
+		sim->pending = zFalse;
+		sim->state = SIM_NEG;
+		sim->lines = DSR_AckDataReq | DSR_nDataAvail | DSR_XFlag;	// event 2
+		return;
+	}
+
+	// 1284_Active going low ends any 1284 mode (event 22)
+
+	if (fall & DCR_1284_Active)
+	{	sim->pending = zFalse;
+		sim->state = SIM_TERM;
+		sim->lines = SIM_COMPAT & ~DSR_PtrClk;	// event 23
+		return;
+	}
+
+	switch (sim->state)
+	{
+	case SIM_NEG:
+		// HostClk high with HostBusy high, answer the mode request (event 6)
+
+		if (!(rise & DCR_HostClk) || !(nd & DCR_HostBusy))
+			break;
+
+		if ((sim->data & ~EMODE_REQID_NIBBLE) == EMODE_ECP)
+		{
+			if (sim->faults & SIMF_XFLAG)
+				sim->lines = DSR_PtrClk | DSR_nDataAvail;	// ECP refused
+			else
+			{	sim->lines = DSR_PtrClk | DSR_XFlag | DSR_nDataAvail;
+				sim->state = SIM_ECP_SETUP;
+			}
+			break;
+		}
+
+		// everything else is answered in the nibble mode
+
+		if (sim->data == EMODE_REQID_NIBBLE)
+		{	uint	len;
+
+			len = strlen( TrDefaultID);
+			sim->reply[0] = HI( len + 2);
+			sim->reply[1] = LO( len + 2);
+			memcpy( sim->reply + 2, TrDefaultID, len);
+			sim->replyLen = len + 2;
+			sim->replyIdx = 0;
+		}
+
+		sim->state = SIM_NIBBLE;
+		sim->nbPhase = 0;
+		sim->lines = simNibbleIdle( sim);
+		break;
+
+	case SIM_ECP_SETUP:
+		// HostAck low, finish ECP setup (event 31)
+
+		if (fall & DCR_HostAck)
+		{	sim->lines = DSR_PeriphClk | DSR_nAckReverse | DSR_XFlag;
+
+			if (sim->replyIdx >= sim->replyLen)
+				sim->lines |= DSR_nPeriphRequest;
+
+			sim->state = SIM_ECP;
+			sim->drainTime = now;
+		}
+		break;
+
+	case SIM_NIBBLE:
+		// each byte takes four HostBusy edges, low nibble then high nibble
+
+		if (sim->nbPhase == 0 && (fall & DCR_HostBusy) && sim->replyIdx < sim->replyLen)
+		{	nib = sim->reply[sim->replyIdx] & 0x0F;
+			simRespond( sim, simNibble( sim->lines, nib), now);
+			sim->nbPhase = 1;
+		}
+
+		else if (sim->nbPhase == 1 && (rise & DCR_HostBusy))
+		{	simRespond( sim, sim->lines | DSR_PtrClk, now);
+			sim->nbPhase = 2;
+		}
+
+		else if (sim->nbPhase == 2 && (fall & DCR_HostBusy))
+		{	nib = sim->reply[sim->replyIdx] >> 4;
+			simRespond( sim, simNibble( sim->lines, nib), now);
+			sim->nbPhase = 3;
+		}
+
+		else if (sim->nbPhase == 3 && (rise & DCR_HostBusy))
+		{	sim->replyIdx++;
+			sim->stats.nibbleBytes++;
+
+			if (sim->replyIdx >= sim->replyLen)
+				sim->replyLen = sim->replyIdx = 0;
+
+			simRespond( sim, simNibbleIdle( sim), now);
+			sim->nbPhase = 0;
+		}
+		break;
+
+	case SIM_TERM:
+		// HostBusy low, back to compatibility mode (event 27)
+
+		if (fall & DCR_HostBusy)
+		{	sim->lines = SIM_COMPAT;
+			sim->state = SIM_IDLE;
+		}
+		/* fall through */					// a strobe is also allowed here
+
+	case SIM_IDLE:
+		// compatibility mode strobe, Busy is held while strobe is low
+
+		if (fall & DCR_nStrobe)
+		{	sim->stats.sppBytes++;
+			sim->lines |= DSR_Busy;
+		}
+
+		else if (rise & DCR_nStrobe)
+			sim->lines &= ~DSR_Busy;
+		break;
+	}
+}
+
+/*****************************************************************************
+* Read a port register.
+*****************************************************************************/
+static uchar simIn( uint port)
+{
+	ZvgSim_s		*sim;
+	uchar			val;
+
+	sim = (ZvgSim_s *)ZvgIO.trData;
+	simUpdate( sim, tmrReadTimer());
+
+	switch (port - sim->base)
+	{
+	case ECP_data:
+		return (sim->data);
+
+	case ECP_dsr:
+		val = (sim->faults & SIMF_CABLE) ? 0 : sim->lines;
+		return (val ^ DSR_InvMask);
+
+	case ECP_dcr:
+		return (sim->dcr);
+
+	case ECP_cnfgA:
+		return (sim->cnfgA);
+
+	case ECP_cnfgB:
+		return (sim->cnfgB);
+
+	case ECP_ecr:
+		val = sim->ecr & ~(ECR_full | ECR_empty);
+
+		if (sim->fifoCount == 0)
+			val |= ECR_empty;
+
+		else if (sim->fifoCount == SIM_FIFO_SZ)
+		{	val |= ECR_full;
+			sim->stats.fullReads++;
+		}
+		return (val);
+	}
+	return (0xFF);									// nothing there
+}
+
+/*****************************************************************************
+* Write a port register.
+*****************************************************************************/
+static void simOut( uint port, uchar data)
+{
+	ZvgSim_s		*sim;
+	long long int	now;
+	uchar			od;
+
+	sim = (ZvgSim_s *)ZvgIO.trData;
+	now = tmrReadTimer();
+	simUpdate( sim, now);
+
+	switch (port - sim->base)
+	{
+	case ECP_data:
+		sim->data = data;
+		break;
+
+	case ECP_dcr:
+		od = sim->dcr ^ DCR_InvMask;
+		sim->dcr = data;
+		simControl( sim, od, data ^ DCR_InvMask, now);
+		break;
+
+	case ECP_ecpDFifo:								// also cnfgA
+		if ((sim->ecr & ECR_Cnfg_mode) == ECR_Cnfg_mode)
+			sim->cnfgA = data;
+
+		else if ((sim->ecr & ECR_Cnfg_mode) != ECR_ECP_mode || sim->fifoCount == SIM_FIFO_SZ)
+			sim->stats.lost++;						// FIFO overrun, or not in ECP mode
+
+		else
+		{	sim->fifo[(sim->fifoHead + sim->fifoCount) % SIM_FIFO_SZ] = data;
+			sim->fifoCount++;
+			simUpdate( sim, now);					// drains at once if no rate given
+		}
+		break;
+
+	case ECP_cnfgB:
+		if ((sim->ecr & ECR_Cnfg_mode) == ECR_Cnfg_mode)
+			sim->cnfgB = data;
+		break;
+
+	case ECP_ecr:
+		// leaving the ECP mode resets the FIFO
+
+		if ((sim->ecr & ECR_Cnfg_mode) == ECR_ECP_mode && (data & ECR_Cnfg_mode) != ECR_ECP_mode)
+		{	sim->stats.lost += sim->fifoCount;
+			sim->fifoCount = 0;
+		}
+		sim->ecr = data & ~(ECR_full | ECR_empty);
+		break;
+	}
+}
+
+/*****************************************************************************
+* Sleep until the port raises an interrupt armed in the ECR, or 'ns' has
+* passed.
+*
+* The service interrupt is raised once the FIFO is down to half full, and
+* masks itself by setting ECR_serviceIntr, as on the hardware.  The nFault
+* interrupt is raised while the ZVG has data waiting, taken as a level
+* rather than an edge.
+*
+* Returns:
+*    zTrue if an interrupt was raised.
+*****************************************************************************/
+static bool simIrq( long long int ns)
+{
+	ZvgSim_s		*sim;
+	long long int	now, end, sleepNs;
+	struct timespec	ts;
+	bool			fifo, fault;
+
+	sim = (ZvgSim_s *)ZvgIO.trData;
+	now = tmrReadTimer();
+	end = now + ns;
+
+	while (1)
+	{
+		simUpdate( sim, now);
+
+		fifo = !(sim->ecr & (ECR_serviceIntr | ECR_dmaEn))
+				&& (sim->ecr & ECR_Cnfg_mode) == ECR_ECP_mode && sim->fifoCount <= SIM_FIFO_SZ / 2;
+
+		fault = !(sim->ecr & ECR_nErrIntrEn) && !(sim->lines & DSR_nPeriphRequest);
+
+		if (fifo || fault)
+		{
+			if (fifo)
+				sim->ecr |= ECR_serviceIntr;
+
+			sim->stats.irqs++;
+			return (zTrue);
+		}
+
+		if (now >= end)
+			return (zFalse);
+
+		sleepNs = end - now < SIM_IRQ_NS ? end - now : SIM_IRQ_NS;
+		ts.tv_sec = 0;
+		ts.tv_nsec = sleepNs;
+		nanosleep( &ts, NULL);
+		now = tmrReadTimer();
+	}
+}
+
+// Hook used to route port I/O to the simulator
+
+static const ZvgIoHook_s	SimHook = { simIn, simOut, simIrq };
+
+/*****************************************************************************
+* Setup the simulator.
+*
+* May be called before the simulator is opened, or while it is running.
+*****************************************************************************/
+void zvgSimConfig( ZvgSimCfg_s *cfg)
+{
+	ZvgSim_s	*sim;
+
+	SimCfg = *cfg;
+
+	if (ZvgIO.trOps == &ZvgTrSim && ZvgIO.trData != NULL)
+	{	sim = (ZvgSim_s *)ZvgIO.trData;
+		sim->cfg = *cfg;
+	}
+}
+
+/*****************************************************************************
+* Inject faults now, or clear them.
+*
+* Called with:
+*    faults = SIMF_xxx faults, 0 to clear all faults.
+*****************************************************************************/
+void zvgSimFault( uint faults)
+{
+	ZvgSim_s	*sim;
+
+	if (ZvgIO.trOps != &ZvgTrSim || ZvgIO.trData == NULL)
+		return;
+
+	sim = (ZvgSim_s *)ZvgIO.trData;
+	sim->faults = faults;
+
+	if (faults == 0)
+		sim->cfg.faults = 0;					// don't start them again
+
+	// an XFlag drop is seen at once in the ECP mode
+
+	if (sim->state == SIM_ECP)
+	{
+		if (faults & SIMF_XFLAG)
+			sim->lines &= ~DSR_XFlag;
+
+		else
+			sim->lines |= DSR_XFlag;
+	}
+}
+
+/*****************************************************************************
+* Return the simulator counters.
+*****************************************************************************/
+void zvgSimGetStats( ZvgSimStats_s *stats)
+{
+	ZvgSim_s	*sim;
+
+	sim = (ZvgSim_s *)ZvgIO.trData;
+
+	if (ZvgIO.trOps != &ZvgTrSim || sim == NULL)
+		memset( stats, 0, sizeof( ZvgSimStats_s));
+
+	else
+		*stats = sim->stats;
+}
+
+/*****************************************************************************
+* Open the simulator, and hook the port I/O.
+*
+* Called with:
+*    portAdr = Address of the simulated port, SIM_PORT if none given.
+*    arg     = FIFO drain rate in bytes per second, overrides 'zvgSimConfig()'.
+*****************************************************************************/
+static uint simOpen( uint portAdr, const char *arg)
+{
+	ZvgSim_s	*sim;
+
+	sim = (ZvgSim_s *)calloc( 1, sizeof( ZvgSim_s));
+
+	if (sim == NULL)
+		return (errMemory);
+
+	sim->base = portAdr != (uint)-1 ? portAdr : SIM_PORT;
+	sim->cfg = SimCfg;
+
+	if (arg != NULL)
+		sim->cfg.drainRate = strtoul( arg, NULL, 10);
+
+	sim->cnfgA = 0x10;						// 8 bit implementation
+	sim->dcr = DCR_InvMask;					// all lines low
+	sim->lines = SIM_COMPAT;
+	sim->state = SIM_IDLE;
+
+	ZvgIO.trData = sim;
+	ZvgIO.ioHookP = &SimHook;
+
+	return (ZvgTrDirect.open( sim->base, NULL));
+}
+
+/*****************************************************************************
+* Close the simulator, and unhook the port I/O. May be called more than once.
+*****************************************************************************/
+static void simClose( void)
+{
+	if (ZvgIO.trData == NULL)
+		return;
+
+	ZvgTrDirect.close();
+	ZvgIO.ioHookP = NULL;
+	free( ZvgIO.trData);
+	ZvgIO.trData = NULL;
+}
+
+// Everything else is the direct port I/O code, running against the hook
+
+static void simReset( void)
+{
+	ZvgTrDirect.reset();
+}
+
+static uint simSetEcpMode( void)
+{
+	return (ZvgTrDirect.setEcpMode());
+}
+
+static void simSetSppMode( void)
+{
+	ZvgTrDirect.setSppMode();
+}
+
+static uint simEcpPutMem( uchar *mem, uint memSize)
+{
+	return (ZvgTrDirect.ecpPutMem( mem, memSize));
+}
+
+static uint simSppPutc( uchar cc)
+{
+	return (ZvgTrDirect.sppPutc( cc));
+}
+
+static uint simGetMem( uchar *ss, uint bfrLen, uint *aReadLen)
+{
+	return (ZvgTrDirect.getMem( ss, bfrLen, aReadLen));
+}
+
+static uint simGetDeviceID( uchar *ss, uint idLen, uint *aReadLen)
+{
+	return (ZvgTrDirect.getDeviceID( ss, idLen, aReadLen));
+}
+
+static uint simIsDataAvail( uint aTime)
+{
+	return (ZvgTrDirect.isDataAvail( aTime));
+}
+
+// Simulator transport
+
+const ZvgTransport_s	ZvgTrSim =
+{	"sim",
+	simOpen,
+	simClose,
+	simReset,
+	simSetEcpMode,
+	simSetSppMode,
+	simEcpPutMem,
+	simSppPutc,
+	simGetMem,
+	simGetDeviceID,
+	simIsDataAvail
+};
@@ -0,0 +1,306 @@
+/*****************************************************************************
+* Trace event recorder.
+*
+* While tracing is on, begin and end events of the driver's main steps
+* (encoding a frame, sending it, FIFO stalls, frame waits, readbacks and
+* port mode changes) are recorded, with the time they happened, into a ring
+* buffer kept by each thread.  A thread only ever writes its own ring, so no
+* locks are taken when an event is recorded.  A ring is set up the first
+* time a thread records an event, and once full, the oldest events are
+* overwritten.
+*
+* The rings are written out by 'zvgTraceDump()' in the Chrome trace JSON
+* format, which can be loaded by chrome://tracing or Perfetto.
+*
+* Tracing is started by 'zvgTraceStart()' or the 'E' attribute of
+* 'ZVGPORT='.  While it is off, each event costs one test of a flag, and if
+* the drivers are built with ZVG_NO_TRACE, nothing at all.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<pthread.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<sys/syscall.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgTrace.h"
+
+// Events recorded by one thread
+
+typedef struct TRACERING_S
+{	struct TRACERING_S	*next;
+	ulong				head;			// events written, the next one goes at 'head & mask'
+	ulong				mask;			// size of 'ev[]' - 1, a power of two
+	int					tid;			// thread ID
+	char				name[TRACE_THREAD_SZ];
+	ZvgTraceEv_s		ev[1];			// events, allocated with the ring
+} TraceRing_s;
+
+// Names of the events, and of their arguments, for the trace file
+
+typedef struct TRACENAME_S
+{	const char	*name;
+	const char	*beginArg;				// argument of the begin event, NULL if none
+	const char	*endArg;				// argument of the end event, NULL if none
+} TraceName_s;
+
+static const TraceName_s	TraceNames[TRACE_EVENTS] =
+{	{ "encode",			NULL,		"vectors" },
+	{ "zvgFrameSend",	NULL,		"err" },
+	{ "send",			"bytes",	"err" },
+	{ "FIFO stall",		NULL,		"err" },
+	{ "tmrWaitForFrame",NULL,		"frames" },
+	{ "zvgReadDeviceID",NULL,		"err" },
+	{ "zvgReadMonitorInfo", NULL,	"err" },
+	{ "zvgReadSpeedInfo", NULL,		"err" },
+	{ "zvgSetEcpMode",	NULL,		"err" },
+	{ "zvgSetSppMode",	NULL,		NULL },
+	{ "compatibility",	NULL,		NULL },
+	{ "link lost",		"err",		NULL },
+	{ "link recovery",	"try",		"err" },
+	{ "readback",		"what",		"err" },
+	{ "irq sleep",		"irq",		"woken" }
+};
+
+int							ZvgTraceOn;		// set while events are being recorded
+
+static pthread_mutex_t		TraceLock = PTHREAD_MUTEX_INITIALIZER;
+static TraceRing_s			*TraceRings;	// rings of all threads
+static uint					TraceGen;		// bumped each time tracing is started
+static ulong				TraceSize;		// events per ring
+static long long int		TraceStartNs;	// time tracing was started
+static char					TraceFile[TRACE_NAME_SZ];	// written when stopped, if given
+
+static __thread TraceRing_s	*MyRing;		// this thread's ring
+static __thread uint		MyGen;			// trace 'MyRing' belongs to
+static __thread char		MyName[TRACE_THREAD_SZ];	// name given by 'zvgTraceName()'
+
+/*****************************************************************************
+* Set up a ring for the calling thread.  Returns NULL if out of memory.
+*****************************************************************************/
+static TraceRing_s *traceNewRing( void)
+{
+	TraceRing_s	*ring;
+
+	ring = (TraceRing_s *)calloc( 1, sizeof( TraceRing_s) + (TraceSize - 1) * sizeof( ZvgTraceEv_s));
+
+	if (ring == NULL)
+		return (NULL);
+
+	ring->mask = TraceSize - 1;
+	ring->tid = (int)syscall( SYS_gettid);
+	strcpy( ring->name, MyName);
+
+	pthread_mutex_lock( &TraceLock);
+	ring->next = TraceRings;
+	TraceRings = ring;
+	pthread_mutex_unlock( &TraceLock);
+
+	MyRing = ring;
+	MyGen = TraceGen;
+	return (ring);
+}
+
+/*****************************************************************************
+* Record an event.  Use the 'zvgTraceBegin()', 'zvgTraceEnd()' and
+* 'zvgTraceMark()' macros, rather than calling this directly.
+*
+* Called with:
+*    event = teXXX event.
+*    phase = TRACE_BEGIN, TRACE_END or TRACE_MARK.
+*    arg   = Argument of the event, see 'TraceNames[]'.
+*****************************************************************************/
+void zvgTraceEvent( uint event, uint phase, uint arg)
+{
+	TraceRing_s		*ring;
+	ZvgTraceEv_s	*ev;
+	ulong			head;
+
+	ring = MyRing;
+
+	if (ring == NULL || MyGen != TraceGen)
+	{	ring = traceNewRing();
+
+		if (ring == NULL)
+			return;							// out of memory, event is lost
+	}
+
+	head = ring->head;
+	ev = ring->ev + (head & ring->mask);
+	ev->ns = tmrReadTimer();
+	ev->arg = arg;
+	ev->event = (uchar)event;
+	ev->phase = (uchar)phase;
+
+	// publish the event, for 'zvgTraceDump()' running on another thread
+
+	__atomic_store_n( &ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*****************************************************************************
+* Name the calling thread in the trace.  May be called before tracing starts.
+*****************************************************************************/
+void zvgTraceName( const char *name)
+{
+	strncpy( MyName, name, TRACE_THREAD_SZ - 1);
+
+	if (MyRing != NULL && MyGen == TraceGen)
+		strcpy( MyRing->name, MyName);
+}
+
+/*****************************************************************************
+* Start recording events.
+*
+* Events from an earlier trace are thrown away.  Must not be called while
+* other threads may be recording events from an earlier trace.
+*
+* Called with:
+*    events = Events kept per thread, rounded up to a power of two.  If 0,
+*             TRACE_DEF_EVENTS.
+*    name   = File the trace is written to by 'zvgTraceStop()', NULL if the
+*             caller will use 'zvgTraceDump()'.
+*
+* Returns:
+*    errOk        - Tracing started, or was already running.
+*    errTraceOpen - File name is too long.
+*****************************************************************************/
+uint zvgTraceStart( uint events, const char *name)
+{
+	TraceRing_s	*ring;
+
+	if (ZvgTraceOn)
+		return (errOk);
+
+	if (name != NULL && strlen( name) >= TRACE_NAME_SZ)
+		return (errTraceOpen);
+
+	// free the rings of the last trace
+
+	pthread_mutex_lock( &TraceLock);
+
+	while (TraceRings != NULL)
+	{	ring = TraceRings;
+		TraceRings = ring->next;
+		free( ring);
+	}
+	pthread_mutex_unlock( &TraceLock);
+
+	if (events == 0)
+		events = TRACE_DEF_EVENTS;
+
+	for (TraceSize = 1; TraceSize < events; TraceSize <<= 1)
+		;
+
+	strcpy( TraceFile, name != NULL ? name : "");
+
+	tmrInit();
+	TraceStartNs = tmrReadTimer();
+	TraceGen++;								// threads set up new rings
+	ZvgTraceOn = zTrue;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Stop recording events.  If a file was given to 'zvgTraceStart()' the
+* trace is written to it.
+*****************************************************************************/
+void zvgTraceStop( void)
+{
+	if (!ZvgTraceOn)
+		return;
+
+	ZvgTraceOn = zFalse;
+
+	if (TraceFile[0] != '\0')
+	{
+		if (zvgTraceDump( TraceFile))
+			zvgError( errTraceOpen);
+	}
+}
+
+/*****************************************************************************
+* Write one event in the Chrome trace format.
+*****************************************************************************/
+static void traceWriteEv( FILE *fp, TraceRing_s *ring, ZvgTraceEv_s *ev, int pid)
+{
+	const TraceName_s	*tn;
+	const char			*argName;
+
+	if (ev->event >= TRACE_EVENTS)
+		return;
+
+	tn = TraceNames + ev->event;
+
+	fprintf( fp, ",\n{\"name\":\"%s\",\"cat\":\"zvg\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+			tn->name, ev->phase, (ev->ns - TraceStartNs) / 1000.0, pid, ring->tid);
+
+	if (ev->phase == TRACE_MARK)
+		fputs( ",\"s\":\"t\"", fp);			// mark is shown on its thread
+
+	argName = ev->phase == TRACE_END ? tn->endArg : tn->beginArg;
+
+	if (argName != NULL)
+		fprintf( fp, ",\"args\":{\"%s\":%u}", argName, ev->arg);
+
+	fputc( '}', fp);
+}
+
+/*****************************************************************************
+* Write the events recorded so far to a file, in the Chrome trace JSON
+* format.  Events being recorded by other threads while the file is written
+* may be left out.
+*
+* Returns:
+*    errOk        - Trace written.
+*    errTraceOpen - File could not be written.
+*****************************************************************************/
+uint zvgTraceDump( const char *name)
+{
+	FILE			*fp;
+	TraceRing_s		*ring;
+	ulong			head, ii;
+	int				pid;
+
+	fp = fopen( name, "w");
+
+	if (fp == NULL)
+		return (errTraceOpen);
+
+	pid = getpid();
+
+	fprintf( fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf( fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"zvg\"}}", pid);
+
+	pthread_mutex_lock( &TraceLock);
+
+	for (ring = TraceRings; ring != NULL; ring = ring->next)
+	{
+		if (ring->name[0] != '\0')
+			fprintf( fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+					pid, ring->tid, ring->name);
+
+		// oldest event kept, to the last one published
+
+		head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE);
+		ii = head > ring->mask + 1 ? head - (ring->mask + 1) : 0;
+
+		for (; ii < head; ii++)
+			traceWriteEv( fp, ring, ring->ev + (ii & ring->mask), pid);
+	}
+	pthread_mutex_unlock( &TraceLock);
+
+	fputs( "\n]}\n", fp);
+
+	if (fclose( fp) != 0)
+		return (errTraceOpen);
+
+	return (errOk);
+}
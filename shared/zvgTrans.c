@@ -0,0 +1,525 @@
+/*****************************************************************************
+* Transports used to reach the ZVG.
+*
+* The port layer in 'zvgPort.c' passes each port operation (change mode,
+* send ECP data, read nibble data, ...) to a transport.  The transports are:
+*
+*    direct - Direct port I/O, needs root.  This is the default.
+*    ppdev  - The Linux ppdev driver, '/dev/parport0' unless another device
+*             is given.  Needs access to the device, but not root.
+*    null   - Throws away everything sent.
+*    mem    - Captures everything sent into memory, see 'zvgTrGetMem()'.
+*    file   - Writes everything sent to the file given.
+*    sim    - Direct port I/O, run against the simulator in 'zvgSim.c'.
+*    emu    - Runs everything sent through the emulator in 'zvgEmu.c', see
+*             'zvgTrGetEmu()'.  If a file name is given, the last frame
+*             drawn is saved to it as a PPM image on close.
+*    net    - Streams each buffer to 'zvgRecv' on another machine, see
+*             'zvgNet.c'.  The address is given as "[udp:]host[:port]".
+*
+* The null, mem, file and emu transports (the sinks) need no ZVG at all, so the
+* whole frame pipeline can be run headless at full speed.  They answer the
+* device ID, READ_MON and READ_SPD requests with the defaults below so that
+* 'zvgFrameOpen()' succeeds.
+*
+* A transport is chosen with 'zvgSetTransport()' or the 'T' attribute of
+* 'ZVGPORT=', using the form "name" or "name:arg".
+*
+* Created: 10/18/26
+*
+* History:
+*
+* 10/18/26 Added the 'sim' transport, the default replies are now shared
+*          with the simulator.
+* 10/18/26 Added the 'emu' transport.
+* 10/18/26 Added the 'net' transport.
+*
+*****************************************************************************/
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+
+#include	"zstddef.h"
+#include	"zvgCmds.h"
+#include	"zvgPort.h"
+#include	"zvgTrans.h"
+#include	"zvgEmu.h"
+
+#define	SINK_HIST		9						// size of the ZVG's look ahead buffer
+
+// State of a sink transport
+
+typedef struct ZVGSINK_S
+{	FILE	*fp;								// file being written, 'file' only
+	uchar	*memP;								// capture buffer, 'mem' only
+	uint	memCount;							// bytes captured
+	uint	memSize;							// size of capture buffer
+	ZvgEmu_s	*emuP;							// emulator, 'emu' only
+	char	*ppmName;							// image saved on close, 'emu' only
+	uchar	hist[SINK_HIST];					// last bytes sent
+	uchar	reply[ZVG_MAX_BFRSZ];				// data waiting to be read back
+	uint	replyLen;
+} ZvgSink_s;
+
+// Transports that can be chosen
+
+static const ZvgTransport_s	*Transports[] =
+{	&ZvgTrDirect,
+	&ZvgTrPpdev,
+	&ZvgTrNull,
+	&ZvgTrMem,
+	&ZvgTrFile,
+	&ZvgTrSim,
+	&ZvgTrEmu,
+	&ZvgTrNet,
+	NULL
+};
+
+// Default replies of the sinks and the simulator.  The ID parses as a ZVG
+// with version 1.0 firmware, the monitor settings are the factory settings.
+
+const char	TrDefaultID[] =
+	"MFG:Zektor;\r\n"
+	"CMD:ZVG;\r\n"
+	"MDL:ZVG Sink;\r\n"
+	"VER:0800,0800,0800;\r\n"
+	"SWS:00;\r\n"
+	"ESB:0000,0000;\r\n";
+
+const uchar	TrDefaultMon[ZVG_MON_SIZE] = { 80, 0, 47, 37, 6, 100, 215, 80, 0, 0, 0 };
+const uchar	TrDefaultSpd[4] = { 10, 15, 20, 25 };
+
+/*****************************************************************************
+* Choose the transport used to reach the ZVG.
+*
+* Must be called before 'zvgFrameOpen()' or 'zvgInit()'. The 'T' attribute
+* of 'ZVGPORT=', if given, overrides this.
+*
+* Called with:
+*    spec = Name of transport, optionally followed by ':' and an argument,
+*           e.g. "ppdev:/dev/parport1" or "file:/tmp/zvg.bin".
+*
+* Returns:
+*    errOk       - Transport chosen.
+*    errEnvTrans - Unknown transport, or missing argument.
+*****************************************************************************/
+uint zvgSetTransport( const char *spec)
+{
+	char	name[TR_SPEC_SZ], *argP;
+	uint	ii;
+
+	if (strlen( spec) >= TR_SPEC_SZ)
+		return (errEnvTrans);
+
+	strcpy( name, spec);
+	argP = strchr( name, ':');
+
+	if (argP != NULL)
+		*argP++ = '\0';						// split off argument
+
+	for (ii = 0; Transports[ii] != NULL; ii++)
+	{
+		if (strcmp( name, Transports[ii]->name) != 0)
+			continue;
+
+		// the file transport needs a file name, and the net transport an address
+
+		if ((Transports[ii] == &ZvgTrFile || Transports[ii] == &ZvgTrNet) && (argP == NULL || *argP == '\0'))
+			return (errEnvTrans);
+
+		strcpy( ZvgIO.trSpec, spec);
+		ZvgIO.trArg = NULL;
+
+		if (argP != NULL && *argP != '\0')
+			ZvgIO.trArg = ZvgIO.trSpec + (argP - name);
+
+		ZvgIO.trOps = Transports[ii];
+		return (errOk);
+	}
+	return (errEnvTrans);
+}
+
+/*****************************************************************************
+* Return the data captured by the 'mem' transport.
+*
+* Capture stops once TR_MEM_MAX bytes are held, see 'zvgTrClearMem()'.
+*
+* Called with:
+*    bfr   = Pointer set to the captured data, NULL if none.
+*    count = Pointer set to the number of bytes captured.
+*****************************************************************************/
+void zvgTrGetMem( uchar **bfr, uint *count)
+{
+	ZvgSink_s	*sink;
+
+	sink = (ZvgSink_s *)ZvgIO.trData;
+
+	if (ZvgIO.trOps != &ZvgTrMem || sink == NULL)
+	{	*bfr = NULL;
+		*count = 0;
+		return;
+	}
+	*bfr = sink->memP;
+	*count = sink->memCount;
+}
+
+/*****************************************************************************
+* Throw away the data captured by the 'mem' transport.
+*****************************************************************************/
+void zvgTrClearMem( void)
+{
+	ZvgSink_s	*sink;
+
+	sink = (ZvgSink_s *)ZvgIO.trData;
+
+	if (ZvgIO.trOps == &ZvgTrMem && sink != NULL)
+		sink->memCount = 0;
+}
+
+/*****************************************************************************
+* Return the emulator used by the 'emu' transport.
+*
+* Returns:
+*    The emulator, NULL if the 'emu' transport is not open.
+*****************************************************************************/
+ZvgEmu_s *zvgTrGetEmu( void)
+{
+	ZvgSink_s	*sink;
+
+	sink = (ZvgSink_s *)ZvgIO.trData;
+
+	if (ZvgIO.trOps != &ZvgTrEmu || sink == NULL)
+		return (NULL);
+
+	return (sink->emuP);
+}
+
+/*****************************************************************************
+* Open a sink.
+*
+* Called with:
+*    portAdr = Not used.
+*    arg     = File name for the 'file' sink, image name for the 'emu'
+*              sink, not used by the others.
+*****************************************************************************/
+static uint sinkOpen( uint portAdr, const char *arg)
+{
+	ZvgSink_s	*sink;
+	uint		err;
+
+	(void)portAdr;							// not used
+
+	sink = (ZvgSink_s *)calloc( 1, sizeof( ZvgSink_s));
+
+	if (sink == NULL)
+		return (errMemory);
+
+	if (ZvgIO.trOps == &ZvgTrFile)
+	{	sink->fp = fopen( arg, "wb");
+
+		if (sink->fp == NULL)
+		{	free( sink);
+			return (errTransOpen);
+		}
+	}
+
+	else if (ZvgIO.trOps == &ZvgTrMem)
+	{	sink->memP = (uchar *)malloc( TR_MEM_INIT);
+
+		if (sink->memP == NULL)
+		{	free( sink);
+			return (errMemory);
+		}
+		sink->memSize = TR_MEM_INIT;
+	}
+
+	else if (ZvgIO.trOps == &ZvgTrEmu)
+	{	sink->emuP = (ZvgEmu_s *)malloc( sizeof( ZvgEmu_s));
+
+		if (sink->emuP == NULL)
+		{	free( sink);
+			return (errMemory);
+		}
+
+		err = zvgEmuOpen( sink->emuP, NULL);
+
+		if (err == errOk && arg != NULL)
+		{	sink->ppmName = strdup( arg);
+
+			if (sink->ppmName == NULL)
+				err = errMemory;
+		}
+
+		if (err)
+		{	zvgEmuClose( sink->emuP);
+			free( sink->emuP);
+			free( sink);
+			return (err);
+		}
+	}
+
+	ZvgIO.ecpPort = 0;
+	ZvgIO.ecpFlags = 0;
+	ZvgIO.trData = sink;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Close a sink, may be called more than once.
+*****************************************************************************/
+static void sinkClose( void)
+{
+	ZvgSink_s	*sink;
+
+	sink = (ZvgSink_s *)ZvgIO.trData;
+
+	if (sink == NULL)
+		return;
+
+	if (sink->fp != NULL)
+		fclose( sink->fp);
+
+	if (sink->emuP != NULL)
+	{
+		if (sink->ppmName != NULL)
+			zvgEmuSavePPM( sink->emuP, sink->ppmName);
+
+		zvgEmuClose( sink->emuP);
+		free( sink->emuP);
+		free( sink->ppmName);
+	}
+
+	free( sink->memP);
+	free( sink);
+	ZvgIO.trData = NULL;
+}
+
+/*****************************************************************************
+* Drop a sink back to the compatibility mode.
+*****************************************************************************/
+static void sinkReset( void)
+{
+	ZvgIO.ecpFlags &= ~(ECPF_ECP | ECPF_NIBBLE);
+}
+
+/*****************************************************************************
+* Set a sink to the ECP mode, always works.
+*****************************************************************************/
+static uint sinkSetEcpMode( void)
+{
+	ZvgIO.ecpFlags &= ~ECPF_NIBBLE;
+	ZvgIO.ecpFlags |= ECPF_ECP;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Set a sink to the SPP mode.
+*****************************************************************************/
+static void sinkSetSppMode( void)
+{
+	ZvgIO.ecpFlags &= ~(ECPF_ECP | ECPF_NIBBLE);
+}
+
+/*****************************************************************************
+* Send a block of ECP data to a sink.
+*
+* The last few bytes are kept, so that a READ_MON or READ_SPD request can
+* be answered.
+*****************************************************************************/
+static uint sinkEcpPutMem( uchar *mem, uint memSize)
+{
+	ZvgSink_s	*sink;
+	uchar		*newP;
+	uint		newSize;
+
+	sink = (ZvgSink_s *)ZvgIO.trData;
+
+	if (sink == NULL)
+		return (errEcpBadMode);
+
+	// keep the last SINK_HIST bytes sent
+
+	if (memSize >= SINK_HIST)
+		memcpy( sink->hist, mem + memSize - SINK_HIST, SINK_HIST);
+
+	else
+	{	memmove( sink->hist, sink->hist + memSize, SINK_HIST - memSize);
+		memcpy( sink->hist + SINK_HIST - memSize, mem, memSize);
+	}
+
+	if (sink->emuP != NULL)
+		zvgEmuFeed( sink->emuP, mem, memSize);
+
+	if (sink->fp != NULL)
+	{
+		if (fwrite( mem, 1, memSize, sink->fp) != memSize)
+			return (errEcpComm);
+	}
+
+	else if (sink->memP != NULL && sink->memCount + memSize <= TR_MEM_MAX)
+	{
+		// grow the buffer if needed
+
+		if (sink->memCount + memSize > sink->memSize)
+		{	newSize = sink->memSize;
+
+			while (newSize < sink->memCount + memSize)
+				newSize *= 2;
+
+			if (newSize > TR_MEM_MAX)
+				newSize = TR_MEM_MAX;
+
+			newP = (uchar *)realloc( sink->memP, newSize);
+
+			if (newP == NULL)
+				return (errMemory);
+
+			sink->memP = newP;
+			sink->memSize = newSize;
+		}
+		memcpy( sink->memP + sink->memCount, mem, memSize);
+		sink->memCount += memSize;
+	}
+	return (errOk);
+}
+
+/*****************************************************************************
+* Send a byte to a sink using the SPP mode.  Only used for commands, so
+* the byte is thrown away.
+*****************************************************************************/
+static uint sinkSppPutc( uchar cc)
+{
+	(void)cc;								// thrown away
+
+	if (ZvgIO.ecpFlags & (ECPF_ECP | ECPF_NIBBLE))
+		return (errEcpBadMode);
+
+	return (errOk);
+}
+
+/*****************************************************************************
+* Read back the reply set up by 'sinkIsDataAvail()'.
+*
+* Leaves the sink in the SPP mode, as the direct transport does.
+*****************************************************************************/
+static uint sinkGetMem( uchar *ss, uint bfrLen, uint *aReadLen)
+{
+	ZvgSink_s	*sink;
+
+	sink = (ZvgSink_s *)ZvgIO.trData;
+	ZvgIO.ecpFlags &= ~(ECPF_ECP | ECPF_NIBBLE);
+
+	if (sink == NULL || sink->replyLen == 0)
+		return (errEcpNoData);
+
+	if (bfrLen > sink->replyLen)
+		bfrLen = sink->replyLen;
+
+	memcpy( ss, sink->reply, bfrLen);
+	*aReadLen = bfrLen;
+	sink->replyLen = 0;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Return the default device ID.
+*****************************************************************************/
+static uint sinkGetDeviceID( uchar *ss, uint idLen, uint *aReadLen)
+{
+	uint	count;
+
+	ZvgIO.ecpFlags &= ~(ECPF_ECP | ECPF_NIBBLE);
+
+	if (idLen < 2)
+		return (errEcpNoData);
+
+	count = strlen( TrDefaultID);
+
+	if (count > idLen - 1)
+		count = idLen - 1;
+
+	memcpy( ss, TrDefaultID, count);
+	ss[count] = '\0';
+	*aReadLen = count;
+	return (errOk);
+}
+
+/*****************************************************************************
+* Check for a READ_MON or READ_SPD request followed by enough NOPs to be
+* executed, and if found, set up the reply.  Never waits.
+*
+* The 'emu' sink answers with the emulator's reply instead, so changes to
+* the monitor settings are read back.
+*****************************************************************************/
+static uint sinkIsDataAvail( uint aTime)
+{
+	ZvgSink_s	*sink;
+	uint		ii;
+
+	(void)aTime;							// never waits
+
+	sink = (ZvgSink_s *)ZvgIO.trData;
+
+	if (!(ZvgIO.ecpFlags & ECPF_ECP) || sink == NULL)
+		return (errEcpBadMode);
+
+	if (sink->replyLen > 0)
+		return (errOk);
+
+	if (sink->emuP != NULL)
+	{
+		if (sink->emuP->replyLen == 0)
+			return (errEcpTimeout);
+
+		memcpy( sink->reply, sink->emuP->reply, sink->emuP->replyLen);
+		sink->replyLen = sink->emuP->replyLen;
+		sink->emuP->replyLen = 0;
+		return (errOk);
+	}
+
+	for (ii = 1; ii < SINK_HIST; ii++)
+		if (sink->hist[ii] != zcNOP)
+			return (errEcpTimeout);
+
+	if (sink->hist[0] == zcREAD_MON)
+	{	memcpy( sink->reply, TrDefaultMon, ZVG_MON_SIZE);
+		sink->replyLen = ZVG_MON_SIZE;
+	}
+
+	else if (sink->hist[0] == zcREAD_SPD)
+	{	memcpy( sink->reply, TrDefaultSpd, 4);
+		sink->replyLen = 4;
+	}
+
+	else
+		return (errEcpTimeout);
+
+	memset( sink->hist, zcNOP, SINK_HIST);	// only answer once
+	return (errOk);
+}
+
+// The sinks differ only in what 'sinkOpen()' sets up
+
+const ZvgTransport_s	ZvgTrNull =
+{	"null",
+	sinkOpen, sinkClose, sinkReset, sinkSetEcpMode, sinkSetSppMode,
+	sinkEcpPutMem, sinkSppPutc, sinkGetMem, sinkGetDeviceID, sinkIsDataAvail
+};
+
+const ZvgTransport_s	ZvgTrMem =
+{	"mem",
+	sinkOpen, sinkClose, sinkReset, sinkSetEcpMode, sinkSetSppMode,
+	sinkEcpPutMem, sinkSppPutc, sinkGetMem, sinkGetDeviceID, sinkIsDataAvail
+};
+
+const ZvgTransport_s	ZvgTrFile =
+{	"file",
+	sinkOpen, sinkClose, sinkReset, sinkSetEcpMode, sinkSetSppMode,
+	sinkEcpPutMem, sinkSppPutc, sinkGetMem, sinkGetDeviceID, sinkIsDataAvail
+};
+
+const ZvgTransport_s	ZvgTrEmu =
+{	"emu",
+	sinkOpen, sinkClose, sinkReset, sinkSetEcpMode, sinkSetSppMode,
+	sinkEcpPutMem, sinkSppPutc, sinkGetMem, sinkGetDeviceID, sinkIsDataAvail
+};
@@ -0,0 +1,645 @@
+/*****************************************************************************
+* Encoder benchmark.
+*
+* Times 'zvgEnc()' alone, and 'zvgFrameVector()' with the frame pipeline
+* sending to the 'null' transport, over a set of synthetic scenes:
+*
+*    diag   - Random long diagonals across the screen.
+*    grid   - Axis aligned grid lines.
+*    poly   - Dense polylines of short segments.
+*    points - A cloud of points.
+*    clip   - Geometry mostly outside the screen, clipped or rejected.
+*    color  - Short vectors, each in a new color.
+*
+* Scenes are made by a fixed random number generator, so every run, on
+* every machine, encodes the same vectors and the byte counts can be
+* compared exactly.  Each scene is timed several times and the best time
+* is kept.
+*
+* Usage: zvgBench [options]
+*
+*    -n count  = Vectors per scene (default 200000).
+*    -r runs   = Timed runs per scene (default 5).
+*    -m mode   = 'enc', 'frame' or 'both' (default both).
+*    -S scene  = Only run the scene given.
+*    -c        = Print results as CSV.
+*    -s file   = Save results to 'file' as a baseline.
+*    -b file   = Compare results with the baseline in 'file'.
+*    -x pct    = Time change, in percent, counted as a regression (default 5).
+*
+* Exits with 2 if a baseline was given and a scene got slower by more than
+* the '-x' limit, or now uses more bytes per vector.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgEnc.h"
+#include	"zvgTrans.h"
+#include	"zvgFrame.h"
+
+#define	DEF_VECTORS		200000			// vectors per scene
+#define	DEF_RUNS		5				// timed runs per scene
+#define	DEF_LIMIT		5.0				// percent slower counted as a regression
+#define	FRAME_VECS		500				// vectors per frame
+#define	MAX_RESULTS		32
+#define	LINE_SZ			256
+
+// Modes
+
+#define	MODE_ENC		0x01			// time 'zvgEnc()'
+#define	MODE_FRAME		0x02			// time 'zvgFrameVector()'
+
+// A vector of a scene
+
+typedef struct BENCHVEC_S
+{	int		xStart, yStart, xEnd, yEnd;
+	uint	color;
+} BenchVec_s;
+
+// A scene
+
+typedef struct SCENE_S
+{	const char	*name;
+	void		(*make)( BenchVec_s *vecs, uint count);
+} Scene_s;
+
+// Results of one scene in one mode
+
+typedef struct RESULT_S
+{	char	scene[16];
+	char	mode[8];
+	uint	vectors;
+	double	nsPerVec;
+	double	vecPerSec;
+	double	bytesPerVec;
+	double	clipPct;
+	double	rejectPct;
+} Result_s;
+
+static uint		RandSeed;
+static uchar	*EncBfr;				// buffer 'zvgEnc()' encodes into
+
+/*****************************************************************************
+* Fixed random number generator, the same on every system.
+*****************************************************************************/
+static uint benchRand( void)
+{
+	RandSeed = RandSeed * 1103515245 + 12345;
+	return ((RandSeed >> 8) & 0xFFFFFF);
+}
+
+/*****************************************************************************
+* Random value from 'lo' to 'hi'.
+*****************************************************************************/
+static int randRange( int lo, int hi)
+{
+	return (lo + (int)(benchRand() % (uint)(hi - lo + 1)));
+}
+
+/*****************************************************************************
+* Keep a value on the overscanned screen.
+*****************************************************************************/
+static int limit( int vv, int lo, int hi)
+{
+	return (vv < lo ? lo : vv > hi ? hi : vv);
+}
+
+/*****************************************************************************
+* Random long diagonals, at least half a screen long.
+*****************************************************************************/
+static void makeDiag( BenchVec_s *vecs, uint count)
+{
+	uint	ii;
+
+	for (ii = 0; ii < count; ii++)
+	{	vecs[ii].xStart = randRange( X_MIN, X_MIN / 2);
+		vecs[ii].xEnd = randRange( X_MAX / 2, X_MAX);
+
+		if (benchRand() & 1)
+		{	vecs[ii].yStart = randRange( Y_MIN, Y_MIN / 2);
+			vecs[ii].yEnd = randRange( Y_MAX / 2, Y_MAX);
+		}
+		else
+		{	vecs[ii].yStart = randRange( Y_MAX / 2, Y_MAX);
+			vecs[ii].yEnd = randRange( Y_MIN, Y_MIN / 2);
+		}
+		vecs[ii].color = 0xFFFF;
+	}
+}
+
+/*****************************************************************************
+* Axis aligned grid, alternating horizontal and vertical lines.
+*****************************************************************************/
+static void makeGrid( BenchVec_s *vecs, uint count)
+{
+	uint	ii, step;
+
+	for (ii = 0; ii < count; ii++)
+	{	step = (ii / 2) % 33;
+
+		if (ii & 1)
+		{	vecs[ii].xStart = X_MIN + step * 32;
+			vecs[ii].xEnd = vecs[ii].xStart;
+			vecs[ii].yStart = Y_MIN;
+			vecs[ii].yEnd = Y_MAX;
+		}
+		else
+		{	vecs[ii].yStart = Y_MIN + (step % 25) * 32;
+			vecs[ii].yEnd = vecs[ii].yStart;
+			vecs[ii].xStart = X_MIN;
+			vecs[ii].xEnd = X_MAX;
+		}
+		vecs[ii].color = 0xFFFF;
+	}
+}
+
+/*****************************************************************************
+* Dense polylines, each segment starts where the last one ended.
+*****************************************************************************/
+static void makePoly( BenchVec_s *vecs, uint count)
+{
+	uint	ii;
+	int		xx, yy;
+
+	xx = 0;
+	yy = 0;
+
+	for (ii = 0; ii < count; ii++)
+	{
+		// start a new polyline every 50 segments
+
+		if (ii % 50 == 0)
+		{	xx = randRange( X_MIN, X_MAX);
+			yy = randRange( Y_MIN, Y_MAX);
+		}
+
+		vecs[ii].xStart = xx;
+		vecs[ii].yStart = yy;
+
+		do
+		{	xx = limit( vecs[ii].xStart + randRange( -8, 8), X_MIN, X_MAX);
+			yy = limit( vecs[ii].yStart + randRange( -8, 8), Y_MIN, Y_MAX);
+		} while (xx == vecs[ii].xStart && yy == vecs[ii].yStart);
+
+		vecs[ii].xEnd = xx;
+		vecs[ii].yEnd = yy;
+		vecs[ii].color = 0xFFFF;
+	}
+}
+
+/*****************************************************************************
+* Cloud of points.
+*****************************************************************************/
+static void makePoints( BenchVec_s *vecs, uint count)
+{
+	uint	ii;
+
+	for (ii = 0; ii < count; ii++)
+	{	vecs[ii].xStart = randRange( X_MIN, X_MAX);
+		vecs[ii].yStart = randRange( Y_MIN, Y_MAX);
+		vecs[ii].xEnd = vecs[ii].xStart;
+		vecs[ii].yEnd = vecs[ii].yStart;
+		vecs[ii].color = 0xFFFF;
+	}
+}
+
+/*****************************************************************************
+* Geometry spread over four times the screen, most of it is clipped or
+* rejected.
+*****************************************************************************/
+static void makeClip( BenchVec_s *vecs, uint count)
+{
+	uint	ii;
+
+	for (ii = 0; ii < count; ii++)
+	{	vecs[ii].xStart = randRange( X_MIN_O * 4, X_MAX_O * 4);
+		vecs[ii].yStart = randRange( Y_MIN_O * 4, Y_MAX_O * 4);
+		vecs[ii].xEnd = randRange( X_MIN_O * 4, X_MAX_O * 4);
+		vecs[ii].yEnd = randRange( Y_MIN_O * 4, Y_MAX_O * 4);
+		vecs[ii].color = 0xFFFF;
+	}
+}
+
+/*****************************************************************************
+* Short vectors, each in a new color.
+*****************************************************************************/
+static void makeColor( BenchVec_s *vecs, uint count)
+{
+	uint	ii;
+
+	for (ii = 0; ii < count; ii++)
+	{	vecs[ii].xStart = randRange( X_MIN, X_MAX - 64);
+		vecs[ii].yStart = randRange( Y_MIN, Y_MAX - 64);
+		vecs[ii].xEnd = vecs[ii].xStart + randRange( 1, 64);
+		vecs[ii].yEnd = vecs[ii].yStart + randRange( 0, 64);
+		vecs[ii].color = (ii & 1) ? 0xF800 | (benchRand() & 0x07FF) : 0x07E0 | (benchRand() & 0xF81F);
+	}
+}
+
+static const Scene_s	Scenes[] =
+{	{ "diag", makeDiag },
+	{ "grid", makeGrid },
+	{ "poly", makePoly },
+	{ "points", makePoints },
+	{ "clip", makeClip },
+	{ "color", makeColor },
+	{ NULL, NULL }
+};
+
+/*****************************************************************************
+* Encode a scene with 'zvgEnc()', in frames of FRAME_VECS vectors.
+*****************************************************************************/
+static void runEnc( BenchVec_s *vecs, uint count)
+{
+	uint	ii;
+
+	zvgEncReset();
+	zvgEncSetPtr( EncBfr);
+
+	for (ii = 0; ii < count; ii++)
+	{
+		if (vecs[ii].color != ZvgENC.encColor)
+			zvgEncSetColor( vecs[ii].color);
+
+		zvgEnc( vecs[ii].xStart, vecs[ii].yStart, vecs[ii].xEnd, vecs[ii].yEnd);
+
+		if ((ii + 1) % FRAME_VECS == 0 || ii + 1 == count)
+		{	zvgEncEOF();
+			zvgEncClearBfr();
+		}
+	}
+}
+
+/*****************************************************************************
+* Send a scene through 'zvgFrameVector()', in frames of FRAME_VECS vectors.
+*****************************************************************************/
+static uint runFrame( BenchVec_s *vecs, uint count)
+{
+	uint	ii, err;
+
+	err = errOk;
+
+	for (ii = 0; ii < count && !err; ii++)
+	{
+		if (vecs[ii].color != ZvgENC.encColor)
+			zvgFrameSetColor( vecs[ii].color);
+
+		err = zvgFrameVector( vecs[ii].xStart, vecs[ii].yStart, vecs[ii].xEnd, vecs[ii].yEnd);
+
+		if (!err && ((ii + 1) % FRAME_VECS == 0 || ii + 1 == count))
+			err = zvgFrameSend();
+	}
+	return (err);
+}
+
+/*****************************************************************************
+* Count the bytes, clipped and rejected vectors of a scene, untimed.
+*
+* A vector is counted as rejected if nothing is encoded for it, and as
+* clipped if an end is outside the clip window but something is encoded.
+* The bytes counted don't include the end of frame commands.
+*****************************************************************************/
+static void countScene( BenchVec_s *vecs, uint count, Result_s *res)
+{
+	uint	ii, clipped, rejected;
+	ulong	bytes;
+	bool	outside;
+
+	clipped = 0;
+	rejected = 0;
+	bytes = 0;
+	zvgEncReset();
+	zvgEncSetPtr( EncBfr);
+
+	for (ii = 0; ii < count; ii++)
+	{
+		if (vecs[ii].color != ZvgENC.encColor)
+			zvgEncSetColor( vecs[ii].color);
+
+		zvgEncClearBfr();
+		zvgEnc( vecs[ii].xStart, vecs[ii].yStart, vecs[ii].xEnd, vecs[ii].yEnd);
+		bytes += zvgEncSize();
+
+		outside = vecs[ii].xStart < ZvgENC.xMinClip || vecs[ii].xStart > ZvgENC.xMaxClip
+				|| vecs[ii].xEnd < ZvgENC.xMinClip || vecs[ii].xEnd > ZvgENC.xMaxClip
+				|| vecs[ii].yStart < ZvgENC.yMinClip || vecs[ii].yStart > ZvgENC.yMaxClip
+				|| vecs[ii].yEnd < ZvgENC.yMinClip || vecs[ii].yEnd > ZvgENC.yMaxClip;
+
+		if (zvgEncSize() == 0)
+			rejected++;
+
+		else if (outside)
+			clipped++;
+	}
+	zvgEncClearBfr();
+
+	res->vectors = count;
+	res->bytesPerVec = (double)bytes / count;
+	res->clipPct = 100.0 * clipped / count;
+	res->rejectPct = 100.0 * rejected / count;
+}
+
+/*****************************************************************************
+* Time a scene in one mode, keeping the best of 'runs' runs.
+*****************************************************************************/
+static uint timeScene( BenchVec_s *vecs, uint count, uint mode, uint runs, Result_s *res)
+{
+	long long int	start, best, tt;
+	uint			rr, err;
+
+	best = 0;
+	err = errOk;
+
+	for (rr = 0; rr < runs && !err; rr++)
+	{	start = tmrReadTimer();
+
+		if (mode == MODE_ENC)
+			runEnc( vecs, count);
+
+		else
+			err = runFrame( vecs, count);
+
+		tt = tmrReadTimer() - start;
+
+		if (rr == 0 || tt < best)
+			best = tt;
+	}
+
+	res->nsPerVec = (double)best / count;
+	res->vecPerSec = best > 0 ? count * 1e9 / best : 0;
+	return (err);
+}
+
+/*****************************************************************************
+* Print the results.
+*****************************************************************************/
+static void printResults( FILE *fp, Result_s *res, uint count, bool csv)
+{
+	uint	ii;
+
+	if (csv)
+		fputs( "scene,mode,vectors,ns_per_vec,vec_per_sec,bytes_per_vec,clip_pct,reject_pct\n", fp);
+
+	else
+		fprintf( fp, "%-8s %-6s %9s %10s %12s %10s %7s %7s\n",
+				"scene", "mode", "vectors", "ns/vec", "vec/s", "bytes/vec", "clip%", "rej%");
+
+	for (ii = 0; ii < count; ii++, res++)
+	{
+		if (csv)
+			fprintf( fp, "%s,%s,%u,%.2f,%.0f,%.4f,%.2f,%.2f\n", res->scene, res->mode,
+					res->vectors, res->nsPerVec, res->vecPerSec, res->bytesPerVec,
+					res->clipPct, res->rejectPct);
+
+		else
+			fprintf( fp, "%-8s %-6s %9u %10.2f %12.0f %10.3f %7.2f %7.2f\n", res->scene,
+					res->mode, res->vectors, res->nsPerVec, res->vecPerSec, res->bytesPerVec,
+					res->clipPct, res->rejectPct);
+	}
+}
+
+/*****************************************************************************
+* Compare the results with a saved baseline.
+*
+* Returns:
+*    zTrue if any scene regressed.
+*****************************************************************************/
+static bool compareBaseline( const char *name, Result_s *res, uint count, double limitPct)
+{
+	FILE		*fp;
+	char		line[LINE_SZ];
+	Result_s	base;
+	uint		ii;
+	double		dTime, dBytes;
+	bool		worse, regressed;
+
+	fp = fopen( name, "r");
+
+	if (fp == NULL)
+	{	fprintf( stderr, "Can't open baseline '%s'.\n", name);
+		return (zTrue);
+	}
+
+	regressed = zFalse;
+	printf( "\n%-8s %-6s %12s %12s %8s %10s %10s %8s\n", "scene", "mode", "base ns/vec",
+			"ns/vec", "change", "base b/vec", "bytes/vec", "change");
+
+	while (fgets( line, sizeof( line), fp) != NULL)
+	{
+		if (sscanf( line, "%15[^,],%7[^,],%u,%lf,%lf,%lf,%lf,%lf", base.scene, base.mode,
+				&base.vectors, &base.nsPerVec, &base.vecPerSec, &base.bytesPerVec,
+				&base.clipPct, &base.rejectPct) != 8)
+			continue;							// header or junk
+
+		for (ii = 0; ii < count; ii++)
+			if (strcmp( res[ii].scene, base.scene) == 0 && strcmp( res[ii].mode, base.mode) == 0)
+				break;
+
+		if (ii == count)
+			continue;							// scene not run this time
+
+		dTime = base.nsPerVec > 0 ? 100.0 * (res[ii].nsPerVec - base.nsPerVec) / base.nsPerVec : 0;
+		dBytes = base.bytesPerVec > 0 ? 100.0 * (res[ii].bytesPerVec - base.bytesPerVec) / base.bytesPerVec : 0;
+		worse = dTime > limitPct || res[ii].bytesPerVec > base.bytesPerVec + 0.0001;
+
+		if (worse)
+			regressed = zTrue;
+
+		printf( "%-8s %-6s %12.2f %12.2f %+7.1f%% %10.3f %10.3f %+7.2f%%%s\n", base.scene,
+				base.mode, base.nsPerVec, res[ii].nsPerVec, dTime, base.bytesPerVec,
+				res[ii].bytesPerVec, dBytes, worse ? "  REGRESSED" : "");
+	}
+	fclose( fp);
+	return (regressed);
+}
+
+/*****************************************************************************
+* Print usage and exit.
+*****************************************************************************/
+static void usage( void)
+{
+	fputs( "Usage: zvgBench [-n count] [-r runs] [-m enc|frame|both] [-S scene] [-c]\n"
+			"                [-s file] [-b file] [-x pct]\n", stderr);
+	exit( 1);
+}
+
+/*****************************************************************************
+* MAIN
+*****************************************************************************/
+int main( int argc, char *argv[])
+{
+	BenchVec_s		*vecs;
+	Result_s		results[MAX_RESULTS];
+	ZvgEnc_s		frameEnc;
+	const Scene_s	*scP;
+	const char		*only, *saveName, *baseName;
+	uint			count, runs, modes, nResults, err;
+	double			limitPct;
+	bool			csv, regressed;
+	FILE			*fp;
+	int				opt;
+
+	count = DEF_VECTORS;
+	runs = DEF_RUNS;
+	modes = MODE_ENC | MODE_FRAME;
+	only = NULL;
+	saveName = NULL;
+	baseName = NULL;
+	limitPct = DEF_LIMIT;
+	csv = zFalse;
+
+	while ((opt = getopt( argc, argv, "n:r:m:S:cs:b:x:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			count = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'r':
+			runs = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'm':
+			if (strcmp( optarg, "enc") == 0)
+				modes = MODE_ENC;
+
+			else if (strcmp( optarg, "frame") == 0)
+				modes = MODE_FRAME;
+
+			else if (strcmp( optarg, "both") == 0)
+				modes = MODE_ENC | MODE_FRAME;
+
+			else
+				usage();
+			break;
+
+		case 'S':
+			only = optarg;
+			break;
+
+		case 'c':
+			csv = zTrue;
+			break;
+
+		case 's':
+			saveName = optarg;
+			break;
+
+		case 'b':
+			baseName = optarg;
+			break;
+
+		case 'x':
+			limitPct = strtod( optarg, NULL);
+			break;
+
+		default:
+			usage();
+		}
+	}
+
+	if (count == 0 || runs == 0)
+		usage();
+
+	vecs = (BenchVec_s *)malloc( count * sizeof( BenchVec_s));
+	EncBfr = (uchar *)malloc( (FRAME_VECS + 1) * zENC_CMD_SIZE * 2);
+
+	if (vecs == NULL || EncBfr == NULL)
+	{	zvgError( errMemory);
+		exit( 1);
+	}
+
+	// the frame pipeline runs headless, with no monitor flags, unless told
+	// otherwise by 'ZVGPORT='
+
+	if (modes & MODE_FRAME)
+	{	setenv( "ZVGPORT", "M0", 0);
+		zvgSetTransport( ZvgTrNull.name);
+		err = zvgFrameOpen();
+
+		if (err)
+		{	zvgError( err);
+			exit( 1);
+		}
+	}
+	else
+		tmrInit();
+
+	nResults = 0;
+	err = errOk;
+
+	for (scP = Scenes; scP->name != NULL && !err; scP++)
+	{
+		if (only != NULL && strcmp( only, scP->name) != 0)
+			continue;
+
+		RandSeed = 1;
+		scP->make( vecs, count);
+
+		// the encoder is used directly below, so keep the frame pipeline's
+		// encoder state to put back afterwards
+
+		frameEnc = ZvgENC;
+
+		if ((modes & MODE_ENC) && nResults < MAX_RESULTS)
+		{	strcpy( results[nResults].scene, scP->name);
+			strcpy( results[nResults].mode, "enc");
+			countScene( vecs, count, results + nResults);
+			timeScene( vecs, count, MODE_ENC, runs, results + nResults);
+			nResults++;
+		}
+
+		if ((modes & MODE_FRAME) && nResults < MAX_RESULTS)
+			countScene( vecs, count, results + nResults);
+
+		ZvgENC = frameEnc;
+
+		if ((modes & MODE_FRAME) && nResults < MAX_RESULTS)
+		{	strcpy( results[nResults].scene, scP->name);
+			strcpy( results[nResults].mode, "frame");
+			err = timeScene( vecs, count, MODE_FRAME, runs, results + nResults);
+			nResults++;
+		}
+	}
+
+	if (modes & MODE_FRAME)
+		zvgFrameClose();
+
+	if (err)
+	{	zvgError( err);
+		exit( 1);
+	}
+
+	printResults( stdout, results, nResults, csv);
+
+	if (saveName != NULL)
+	{	fp = fopen( saveName, "w");
+
+		if (fp == NULL)
+		{	fprintf( stderr, "Can't create baseline '%s'.\n", saveName);
+			exit( 1);
+		}
+		printResults( fp, results, nResults, zTrue);
+		fclose( fp);
+	}
+
+	regressed = zFalse;
+
+	if (baseName != NULL)
+		regressed = compareBaseline( baseName, results, nResults, limitPct);
+
+	free( vecs);
+	free( EncBfr);
+	return (regressed ? 2 : 0);
+}
@@ -0,0 +1,713 @@
+/*****************************************************************************
+* Frame server, owns the ZVGs and draws the frames of its clients.
+*
+* Only one process can own a ZVG's port, and the direct port I/O needs
+* root.  'zvgd' opens the boards and keeps them refreshed at the frame
+* rate, and other programs draw through it with 'zvgClientOpen()' (see
+* 'zvgClient.c'), without root and without ever touching the port.
+*
+* Each client gets a ring of ZVGD_SLOTS frame buffers, a memfd sealed so it
+* can't be shrunk under the server.  The client encodes its frames into the
+* ring, and hands them over by slot number on a SOCK_SEQPACKET socket, so a
+* frame is never copied through the socket.
+*
+* At each frame the oldest frame each client has handed over is taken.  A
+* board draws the frame of its front client, the one with the highest
+* priority (the newest of equal ones), then the frames of its overlay
+* clients over it.  A client's last frame is drawn again until it sends
+* another.  When the front client goes away, the next one takes over at
+* the next frame and is told so, with no clients left nothing is drawn.
+*
+* Frames are sent as the clients encoded them, commands that write the
+* EEPROM included, so only programs trusted with the display should be
+* given access to the socket.  By default it can only be used by root and
+* the ZVGD_GROUP group.
+*
+* Usage: zvgd [options]
+*
+*    -s path   = Socket to listen on (default 'ZVGD_SOCKET=', or
+*                /run/zvgd.sock).
+*    -b boards = Boards to open, 1 to ZVG_BOARDS (default 1).  Board N is
+*                setup from 'ZVGPORTN='.
+*    -p mode   = Permissions of the socket, in octal (default 660).
+*    -g group  = Group owning the socket (default ZVGD_GROUP, if there is
+*                one).
+*    -v        = Print the clients as they come and go.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#ifndef _GNU_SOURCE
+#define	_GNU_SOURCE							// for 'memfd_create()'
+#endif
+
+#include	<errno.h>
+#include	<fcntl.h>
+#include	<grp.h>
+#include	<poll.h>
+#include	<signal.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<sys/mman.h>
+#include	<sys/socket.h>
+#include	<sys/stat.h>
+#include	<sys/timerfd.h>
+#include	<sys/un.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgFrame.h"
+#include	"zvgBoard.h"
+#include	"zvgd.h"
+
+#define	SERVER_SPARE	256					// room kept for the end of frame and control commands
+#define	RING_SZ			(ZVGD_RING_HDR + ZVGD_SLOTS * ZVGD_SLOT_SZ)
+
+// A client
+
+typedef struct CLIENT_S
+{	int			fd;						// connection, -1 if the entry is free
+	bool		hello;					// zmHello seen, the ring has been given
+	uchar		*ring;					// ring mapped, NULL until 'hello'
+	uint		board;
+	uint		prio;
+	uint		flags;					// ZVGDF_xxx
+	uint		serial;					// order of connection, the newest wins a tie
+	pid_t		pid;
+	uint		pend[ZVGD_SLOTS];		// slots handed over, oldest first
+	uint		bytes[ZVGD_SLOTS];		// bytes in each slot handed over
+	uint		pendCount;
+	int			shown;					// slot being drawn, -1 if none
+	bool		focus;					// being drawn
+	ulong		frames;					// frames taken
+	ulong		skipped;				// overlay frames that didn't fit
+} Client_s;
+
+static Client_s			Clients[ZVGD_CLIENTS];
+static uint				Boards = 1;
+static uint				Serial;
+static bool				Verbose;
+static volatile sig_atomic_t	Quit;
+
+/*****************************************************************************
+* Print usage and exit.
+*****************************************************************************/
+static void usage( void)
+{
+	fputs( "Usage: zvgd [-s socket] [-b boards] [-p mode] [-g group] [-v]\n", stderr);
+	exit( 1);
+}
+
+/*****************************************************************************
+* Stop on SIGINT or SIGTERM.
+*****************************************************************************/
+static void onSignal( int sig)
+{
+	Quit = sig;
+}
+
+/*****************************************************************************
+* Send a message to a client, a client that can't take it is dropped by
+* the caller.
+*
+* Returns:
+*    zTrue if sent.
+*****************************************************************************/
+static bool clientSend( Client_s *cl, uint type, uint slot)
+{
+	ZvgdMsg_s	msg;
+
+	memset( &msg, 0, sizeof( msg));
+	msg.type = type;
+	msg.slot = slot;
+	msg.focus = cl->focus;
+
+	return (send( cl->fd, &msg, sizeof( msg), MSG_DONTWAIT | MSG_NOSIGNAL) == sizeof( msg));
+}
+
+/*****************************************************************************
+* Return the front client of a board, NULL if it has none.
+*****************************************************************************/
+static Client_s *boardFront( uint board)
+{
+	Client_s	*cl, *front;
+
+	front = NULL;
+
+	for (cl = Clients; cl < Clients + ZVGD_CLIENTS; cl++)
+	{
+		if (cl->fd < 0 || !cl->hello || cl->board != board || (cl->flags & ZVGDF_OVERLAY))
+			continue;
+
+		if (front == NULL || cl->prio > front->prio
+				|| (cl->prio == front->prio && cl->serial > front->serial))
+			front = cl;
+	}
+	return (front);
+}
+
+static void clientDrop( Client_s *cl);
+
+/*****************************************************************************
+* Work out which clients are drawn, after one has come or gone, and tell
+* those that changed.
+*****************************************************************************/
+static void serverFocus( void)
+{
+	Client_s	*cl;
+	bool		focus;
+
+	for (cl = Clients; cl < Clients + ZVGD_CLIENTS; cl++)
+	{
+		if (cl->fd < 0 || !cl->hello)
+			continue;
+
+		focus = (cl->flags & ZVGDF_OVERLAY) || boardFront( cl->board) == cl;
+
+		if (focus == cl->focus)
+			continue;
+
+		cl->focus = focus;
+
+		if (Verbose)
+			printf( "zvgd: client %d (pid %d) %s\n", (int)(cl - Clients), cl->pid,
+					focus ? "brought to the front" : "sent to the back");
+
+		if (!clientSend( cl, zmFocus, 0))
+			clientDrop( cl);
+	}
+}
+
+/*****************************************************************************
+* Drop a client, and hand its place to the next one.
+*****************************************************************************/
+static void clientDrop( Client_s *cl)
+{
+	if (cl->fd < 0)
+		return;
+
+	if (Verbose)
+		printf( "zvgd: client %d (pid %d) left, %lu frames\n", (int)(cl - Clients), cl->pid, cl->frames);
+
+	close( cl->fd);
+	cl->fd = -1;
+
+	if (cl->ring != NULL)
+	{	munmap( cl->ring, RING_SZ);
+		cl->ring = NULL;
+	}
+
+	if (cl->hello)
+	{	cl->hello = zFalse;
+		serverFocus();
+	}
+}
+
+/*****************************************************************************
+* Give a new client its ring.
+*
+* The ring is sealed so the client can't shrink it while it is mapped
+* here.  The client encodes for the board's monitor, without the spotkill
+* dots, which the server adds to the whole frame.
+*****************************************************************************/
+static void clientHello( Client_s *cl, const ZvgdMsg_s *hello)
+{
+	ZvgdMsg_s		rep;
+	ZvgdRing_s		*hdr;
+	struct msghdr	mh;
+	struct iovec	iov;
+	struct cmsghdr	*cm;
+	int				memFd;
+
+	union
+	{	struct cmsghdr	align;
+		char			buf[CMSG_SPACE( sizeof( int))];
+	} ctl;
+
+	memset( &rep, 0, sizeof( rep));
+	rep.type = zmWelcome;
+	rep.version = ZVGD_VERSION;
+	memFd = -1;
+
+	if (hello->type != zmHello || hello->version != ZVGD_VERSION || hello->board >= Boards)
+		rep.err = errServRefused;
+
+	else
+	{	memFd = memfd_create( "zvgd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+		if (memFd < 0 || ftruncate( memFd, RING_SZ) < 0
+				|| fcntl( memFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+			rep.err = errServRefused;
+
+		else
+		{	cl->ring = (uchar *)mmap( NULL, RING_SZ, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+
+			if (cl->ring == MAP_FAILED)
+			{	cl->ring = NULL;
+				rep.err = errServRefused;
+			}
+		}
+	}
+
+	if (rep.err)
+	{	send( cl->fd, &rep, sizeof( rep), MSG_DONTWAIT | MSG_NOSIGNAL);
+
+		if (memFd >= 0)
+			close( memFd);
+
+		clientDrop( cl);
+		return;
+	}
+
+	hdr = (ZvgdRing_s *)cl->ring;
+	hdr->magic = ZVGD_RING_MAGIC;
+	hdr->version = ZVGD_VERSION;
+	hdr->slots = ZVGD_SLOTS;
+	hdr->slotSize = ZVGD_SLOT_SZ;
+
+	cl->hello = zTrue;
+	cl->board = hello->board;
+	cl->prio = hello->prio;
+	cl->flags = hello->flags & ZVGDF_OVERLAY;
+	cl->serial = ++Serial;
+	cl->focus = (cl->flags & ZVGDF_OVERLAY) || boardFront( cl->board) == cl;
+
+	zvgBoardSelect( cl->board);
+	rep.flags = ZvgENC.encFlags & ~ENCF_SPOTKILL;
+	rep.bytes = ZVGD_SLOT_SZ;
+	rep.slots = ZVGD_SLOTS;
+	rep.focus = cl->focus;
+
+	// the ring goes with the welcome
+
+	memset( &mh, 0, sizeof( mh));
+	memset( &ctl, 0, sizeof( ctl));
+	iov.iov_base = &rep;
+	iov.iov_len = sizeof( rep);
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = ctl.buf;
+	mh.msg_controllen = sizeof( ctl.buf);
+
+	cm = CMSG_FIRSTHDR( &mh);
+	cm->cmsg_level = SOL_SOCKET;
+	cm->cmsg_type = SCM_RIGHTS;
+	cm->cmsg_len = CMSG_LEN( sizeof( int));
+	memcpy( CMSG_DATA( cm), &memFd, sizeof( int));
+
+	if (sendmsg( cl->fd, &mh, MSG_DONTWAIT | MSG_NOSIGNAL) != sizeof( rep))
+	{	close( memFd);
+		clientDrop( cl);
+		return;
+	}
+
+	close( memFd);
+
+	if (Verbose)
+		printf( "zvgd: client %d (pid %d) on board %u, priority %u%s\n", (int)(cl - Clients),
+				cl->pid, cl->board, cl->prio, (cl->flags & ZVGDF_OVERLAY) ? ", overlay" : "");
+
+	serverFocus();								// the others may have lost the front
+}
+
+/*****************************************************************************
+* Read a message from a client.  A client breaking the protocol is dropped.
+*****************************************************************************/
+static void clientRead( Client_s *cl)
+{
+	ZvgdMsg_s	msg;
+	ssize_t		len;
+	uint		ii;
+
+	len = recv( cl->fd, &msg, sizeof( msg), MSG_DONTWAIT);
+
+	if (len < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+
+	if (len != sizeof( msg))
+	{	clientDrop( cl);
+		return;
+	}
+
+	if (!cl->hello)
+	{	clientHello( cl, &msg);
+		return;
+	}
+
+	// a slot handed over must be the client's, and not too full
+
+	if (msg.type != zmSubmit || msg.slot >= ZVGD_SLOTS || msg.bytes > ZVGD_SLOT_SZ
+			|| (int)msg.slot == cl->shown || cl->pendCount >= ZVGD_SLOTS)
+	{	clientDrop( cl);
+		return;
+	}
+
+	for (ii = 0; ii < cl->pendCount; ii++)
+	{
+		if (cl->pend[ii] == msg.slot)
+		{	clientDrop( cl);
+			return;
+		}
+	}
+
+	cl->pend[cl->pendCount++] = msg.slot;
+	cl->bytes[msg.slot] = msg.bytes;
+}
+
+/*****************************************************************************
+* Take a new client.
+*****************************************************************************/
+static void serverAccept( int lsn)
+{
+	Client_s		*cl;
+	struct ucred	cred;
+	socklen_t		len;
+	int				fd;
+
+	fd = accept4( lsn, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+
+	if (fd < 0)
+		return;
+
+	for (cl = Clients; cl < Clients + ZVGD_CLIENTS; cl++)
+	{
+		if (cl->fd < 0)
+			break;
+	}
+
+	if (cl == Clients + ZVGD_CLIENTS)
+	{	close( fd);								// too many, it sees the connection closed
+		return;
+	}
+
+	memset( cl, 0, sizeof( *cl));
+	cl->fd = fd;
+	cl->shown = -1;
+
+	len = sizeof( cred);
+
+	if (getsockopt( fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0)
+		cl->pid = cred.pid;
+}
+
+/*****************************************************************************
+* Add the frame a client is showing to the board's DMA buffer, unless it
+* doesn't fit.
+*****************************************************************************/
+static void serverPut( Client_s *cl)
+{
+	uint	bytes;
+
+	if (cl->shown < 0)
+		return;
+
+	bytes = cl->bytes[cl->shown];
+
+	if (ZvgIO.dmaCurCount + bytes + SERVER_SPARE > MEM_BFR_SZ)
+	{	cl->skipped++;
+		return;
+	}
+
+	zvgDmaPutMem( cl->ring + ZVGD_RING_HDR + cl->shown * ZVGD_SLOT_SZ, bytes);
+}
+
+/*****************************************************************************
+* Draw a frame on each board.
+*
+* The oldest frame each client has handed over is taken first, and the
+* slot it replaces is given back.
+*****************************************************************************/
+static uint serverFrame( void)
+{
+	Client_s	*cl;
+	uint		board, slot, ii;
+
+	for (cl = Clients; cl < Clients + ZVGD_CLIENTS; cl++)
+	{
+		if (cl->fd < 0 || !cl->hello || cl->pendCount == 0)
+			continue;
+
+		slot = cl->pend[0];
+		cl->pendCount--;
+
+		for (ii = 0; ii < cl->pendCount; ii++)
+			cl->pend[ii] = cl->pend[ii + 1];
+
+		if (cl->shown >= 0 && !clientSend( cl, zmFree, cl->shown))
+		{	clientDrop( cl);
+			continue;
+		}
+
+		cl->shown = slot;
+		cl->frames++;
+
+		if (!clientSend( cl, zmTaken, slot))
+			clientDrop( cl);
+	}
+
+	// the front client, then the overlays over it
+
+	for (board = 0; board < Boards; board++)
+	{	zvgBoardSelect( board);
+		cl = boardFront( board);
+
+		if (cl != NULL)
+			serverPut( cl);
+
+		for (cl = Clients; cl < Clients + ZVGD_CLIENTS; cl++)
+		{
+			if (cl->fd >= 0 && cl->hello && cl->board == board && (cl->flags & ZVGDF_OVERLAY))
+				serverPut( cl);
+		}
+	}
+
+	return (zvgBoardSendAll( (1 << Boards) - 1));
+}
+
+/*****************************************************************************
+* Listen on the socket, unless another server already is.
+*
+* Returns:
+*    The socket, or -1.
+*****************************************************************************/
+static int serverListen( const char *path, mode_t mode, gid_t gid)
+{
+	struct sockaddr_un	sa;
+	int					fd;
+
+	if (strlen( path) >= sizeof( sa.sun_path))
+	{	fprintf( stderr, "zvgd: socket path too long: %s\n", path);
+		return (-1);
+	}
+
+	memset( &sa, 0, sizeof( sa));
+	sa.sun_family = AF_UNIX;
+	strcpy( sa.sun_path, path);
+
+	fd = socket( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+	if (fd < 0)
+		return (-1);
+
+	// a socket nobody answers on was left by a server that died
+
+	if (connect( fd, (struct sockaddr *)&sa, sizeof( sa)) == 0)
+	{	fprintf( stderr, "zvgd: already running on %s\n", path);
+		close( fd);
+		return (-1);
+	}
+
+	unlink( path);
+
+	if (bind( fd, (struct sockaddr *)&sa, sizeof( sa)) < 0 || chown( path, (uid_t)-1, gid) < 0
+			|| chmod( path, mode) < 0 || listen( fd, ZVGD_CLIENTS) < 0)
+	{	fprintf( stderr, "zvgd: can't listen on %s: %s\n", path, strerror( errno));
+		close( fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+/*****************************************************************************
+* Close the boards opened.
+*****************************************************************************/
+static void serverClose( uint boards)
+{
+	uint	board;
+
+	for (board = 0; board < boards; board++)
+	{	zvgBoardSelect( board);
+		zvgFrameClose();
+	}
+}
+
+/*****************************************************************************
+* MAIN
+*****************************************************************************/
+int main( int argc, char *argv[])
+{
+	struct pollfd		pfd[2 + ZVGD_CLIENTS];
+	struct itimerspec	its;
+	struct sigaction	sa;
+	struct group		*gr;
+	Client_s			*cl;
+	const char			*path, *group;
+	unsigned long long	ticks;
+	mode_t				mode;
+	gid_t				gid;
+	uint				err, board, ii, nfds;
+	int					opt, lsn, tfd;
+
+	path = getenv( "ZVGD_SOCKET");
+
+	if (path == NULL || path[0] == '\0')
+		path = ZVGD_SOCKET;
+
+	mode = 0660;
+	group = NULL;
+
+	while ((opt = getopt( argc, argv, "s:b:p:g:v")) != -1)
+	{
+		switch (opt)
+		{
+		case 's':
+			path = optarg;
+			break;
+
+		case 'b':
+			Boards = strtoul( optarg, NULL, 10);
+
+			if (Boards < 1 || Boards > ZVG_BOARDS)
+				usage();
+			break;
+
+		case 'p':
+			mode = strtoul( optarg, NULL, 8);
+			break;
+
+		case 'g':
+			group = optarg;
+			break;
+
+		case 'v':
+			Verbose = zTrue;
+			break;
+
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc)
+		usage();
+
+	// the socket's group, without the default one only root can connect
+
+	gr = getgrnam( group != NULL ? group : ZVGD_GROUP);
+	gid = gr != NULL ? gr->gr_gid : (gid_t)-1;
+
+	if (gr == NULL && group != NULL)
+	{	fprintf( stderr, "zvgd: no group %s\n", group);
+		exit( 1);
+	}
+
+	if (gr == NULL && (mode & 0070))
+		fprintf( stderr, "zvgd: no group %s, the socket is left in root's group\n", ZVGD_GROUP);
+
+	for (ii = 0; ii < ZVGD_CLIENTS; ii++)
+		Clients[ii].fd = -1;
+
+	// open the boards
+
+	for (board = 0; board < Boards; board++)
+	{	zvgBoardSelect( board);
+		err = zvgFrameOpen();
+
+		if (err)
+		{	zvgError( err);
+			serverClose( board);
+			exit( 1);
+		}
+	}
+
+	lsn = serverListen( path, mode, gid);
+
+	if (lsn < 0)
+	{	serverClose( Boards);
+		exit( 1);
+	}
+
+	// a frame every frame period
+
+	tfd = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+	if (tfd < 0)
+	{	perror( "zvgd: timerfd");
+		serverClose( Boards);
+		exit( 1);
+	}
+
+	its.it_interval.tv_sec = tmrGetTicksInFrame() / 1000000000LL;
+	its.it_interval.tv_nsec = tmrGetTicksInFrame() % 1000000000LL;
+	its.it_value = its.it_interval;
+	timerfd_settime( tfd, 0, &its, NULL);
+
+	memset( &sa, 0, sizeof( sa));
+	sa.sa_handler = onSignal;
+	sigaction( SIGINT, &sa, NULL);
+	sigaction( SIGTERM, &sa, NULL);
+	signal( SIGPIPE, SIG_IGN);
+
+	if (Verbose)
+		printf( "zvgd: %u board%s, listening on %s\n", Boards, Boards > 1 ? "s" : "", path);
+
+	while (!Quit)
+	{
+		pfd[0].fd = lsn;
+		pfd[0].events = POLLIN;
+		pfd[1].fd = tfd;
+		pfd[1].events = POLLIN;
+		nfds = 2;
+
+		for (cl = Clients; cl < Clients + ZVGD_CLIENTS; cl++)
+		{
+			if (cl->fd < 0)
+				continue;
+
+			pfd[nfds].fd = cl->fd;
+			pfd[nfds].events = POLLIN;
+			nfds++;
+		}
+
+		if (poll( pfd, nfds, -1) < 0)
+			continue;								// a signal, 'Quit' may be set
+
+		// clients first, so frames handed over in time are taken
+
+		for (ii = 2; ii < nfds; ii++)
+		{
+			if (!pfd[ii].revents)
+				continue;
+
+			for (cl = Clients; cl < Clients + ZVGD_CLIENTS; cl++)
+			{
+				if (cl->fd == pfd[ii].fd)
+					break;
+			}
+
+			if (cl == Clients + ZVGD_CLIENTS)
+				continue;
+
+			if (pfd[ii].revents & POLLIN)
+				clientRead( cl);
+
+			else
+				clientDrop( cl);						// hung up
+		}
+
+		if (pfd[0].revents & POLLIN)
+			serverAccept( lsn);
+
+		if ((pfd[1].revents & POLLIN) && read( tfd, &ticks, sizeof( ticks)) == sizeof( ticks))
+		{	err = serverFrame();
+
+			if (err && Verbose)
+				zvgError( err);
+		}
+	}
+
+	// the clients see the connection closed
+
+	for (cl = Clients; cl < Clients + ZVGD_CLIENTS; cl++)
+		clientDrop( cl);
+
+	close( lsn);
+	unlink( path);
+	serverClose( Boards);
+	return (0);
+}
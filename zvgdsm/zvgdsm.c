@@ -0,0 +1,202 @@
+/*****************************************************************************
+* Program to disassemble ZVG command streams.
+*
+* Lists the commands in a capture file, made with the 'F' attribute of
+* 'ZVGPORT=' or 'zvgCapStart()', or in a raw file of bytes sent to the ZVG,
+* and prints where the bytes go: by class of command, on positions and
+* colors, and the distance moved with the beam off.
+*
+* Usage: zvgDsm [options] file
+*
+*    -f first  = First frame of a capture (default 0).
+*    -l last   = Last frame of a capture (default the last frame captured).
+*    -r        = File is a raw command stream, not a capture.
+*    -s        = Only print the cost breakdown, no listing.
+*    -p        = Print a cost line per frame of a capture, no listing.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+
+#include	"zstddef.h"
+#include	"zvgPort.h"
+#include	"zvgCap.h"
+#include	"zvgDsm.h"
+
+/*****************************************************************************
+* Print usage and exit.
+*****************************************************************************/
+static void usage( void)
+{
+	fputs( "Usage: zvgDsm [-f first] [-l last] [-r] [-s] [-p] file\n", stderr);
+	exit( 1);
+}
+
+/*****************************************************************************
+* Disassemble a raw command stream.
+*****************************************************************************/
+static void runRaw( ZvgDsm_s *dsm, const char *name, FILE *list)
+{
+	FILE		*fp;
+	uchar		bfr[4096];
+	size_t		len;
+
+	fp = fopen( name, "rb");
+
+	if (fp == NULL)
+	{	perror( name);
+		exit( 1);
+	}
+
+	while ((len = fread( bfr, 1, sizeof( bfr), fp)) > 0)
+		zvgDsmRun( dsm, bfr, (uint)len, list);
+
+	fclose( fp);
+}
+
+/*****************************************************************************
+* Print the header of the per frame cost lines.
+*****************************************************************************/
+static void frameHeader( void)
+{
+	printf( "%8s %8s %8s %8s %8s %8s %8s %10s %10s\n", "frame", "bytes", "vectors", "cmds",
+			"absBytes", "colBytes", "jumps", "jumpUnits", "drawUnits");
+}
+
+/*****************************************************************************
+* Print the cost line of a frame.
+*****************************************************************************/
+static void frameLine( const ZvgCapFrame_s *frm, const ZvgDsmCost_s *cost)
+{
+	ulong	cmds;
+	uint	ii;
+
+	cmds = 0;
+
+	for (ii = 0; ii < DSM_CLASSES; ii++)
+		cmds += cost->cmds[ii];
+
+	printf( "%8u %8lu %8u %8lu %8lu %8lu %8lu %10lu %10lu\n", frm->frame, cost->bytes,
+			frm->vectors, cmds, cost->absBytes, cost->colorBytes, cost->jumps, cost->jumpUnits,
+			cost->drawUnits);
+}
+
+/*****************************************************************************
+* MAIN
+*****************************************************************************/
+int main( int argc, char *argv[])
+{
+	ZvgCapFile_s	cf;
+	ZvgCapFrame_s	frm;
+	ZvgDsm_s		dsm;
+	ZvgDsmCost_s	total;
+	FILE			*list;
+	uint			err, ii, first, last;
+	bool			raw, summary, perFrame;
+	int				opt;
+
+	first = 0;
+	last = (uint)-1;
+	raw = zFalse;
+	summary = zFalse;
+	perFrame = zFalse;
+
+	while ((opt = getopt( argc, argv, "f:l:rsp")) != -1)
+	{
+		switch (opt)
+		{
+		case 'f':
+			first = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'l':
+			last = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'r':
+			raw = zTrue;
+			break;
+
+		case 's':
+			summary = zTrue;
+			break;
+
+		case 'p':
+			perFrame = zTrue;
+			break;
+
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc - 1)
+		usage();
+
+	list = summary || perFrame ? NULL : stdout;
+	zvgDsmReset( &dsm);
+
+	if (raw)
+	{	runRaw( &dsm, argv[optind], list);
+
+		if (list != NULL)
+			putchar( '\n');
+
+		zvgDsmPrintCost( &dsm.cost, stdout);
+		exit( 0);
+	}
+
+	err = zvgCapOpen( &cf, argv[optind]);
+
+	if (err)
+	{	zvgError( err);
+		exit( 1);
+	}
+
+	if (cf.frames == 0)
+	{	fputs( "No frames in capture.\n", stderr);
+		exit( 1);
+	}
+
+	if (last >= cf.frames)
+		last = cf.frames - 1;
+
+	if (first > last)
+	{	zvgError( errCapRange);
+		exit( 1);
+	}
+
+	if (perFrame)
+		frameHeader();
+
+	// each frame is costed on its own, and added to the total; the beam
+	// position carries over, as it does on the ZVG
+
+	memset( &total, 0, sizeof( total));
+
+	for (ii = first; ii <= last; ii++)
+	{	zvgCapGetFrame( &cf, ii, &frm);
+
+		if (list != NULL)
+			printf( "; frame %u, %u bytes, %u vectors\n", frm.frame, frm.count, frm.vectors);
+
+		memset( &dsm.cost, 0, sizeof( dsm.cost));
+		zvgDsmRun( &dsm, frm.mem, frm.count, list);
+		zvgDsmAddCost( &total, &dsm.cost);
+
+		if (perFrame)
+			frameLine( &frm, &dsm.cost);
+	}
+
+	zvgCapClose( &cf);
+
+	putchar( '\n');
+	zvgDsmPrintCost( &total, stdout);
+	return (0);
+}
@@ -0,0 +1,613 @@
+/*****************************************************************************
+* Port path benchmark.
+*
+* Measures the wire side of the drivers, from the DMA buffers to the last
+* byte taken by the transport, through each of the ways data is sent:
+*
+*    putc   - One 'zvgEcpPutc()' per byte.
+*    putmem - 'zvgEcpPutMem()' in blocks of BLOCK_SZ bytes.
+*    swap   - 'zvgDmaPutMem()' and 'zvgDmaSendSwap()' of BLOCK_SZ buffers.
+*    frame  - Frames of vectors through 'zvgFrameVector()', timed from the
+*             start of 'zvgFrameSend()' until the last byte is taken.
+*
+* Each transport given is run in turn and the results are printed side by
+* side.  A transport spec ending in "+burst" is run with 'zvgSetBurst()',
+* so the direct port I/O (or the simulator) can be compared with and
+* without bursts.  The default columns are the 'null' transport, and the
+* simulator draining at the rate of a typical ECP port, with and without
+* bursts.
+*
+* Only NOP commands are sent by the putc, putmem and swap tests, so they
+* can be run against a real ZVG.  Note that a 'T' attribute in 'ZVGPORT='
+* overrides the transports given here.
+*
+* Usage: zvgPortBench [options]
+*
+*    -t spec   = Transport to run, as in the 'T' attribute of 'ZVGPORT=',
+*                may be given up to MAX_COLS times.
+*    -n bytes  = Bytes sent by each of putc, putmem and swap (default 262144).
+*    -f frames = Frames sent by the frame test (default 500).
+*    -v count  = Vectors per frame (default 200).
+*    -m tests  = Tests to run, a list of 'putc', 'putmem', 'swap' and
+*                'frame' separated by commas (default all).
+*    -c        = Print results as CSV.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+
+#include	"zstddef.h"
+#include	"zvgCmds.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgTrans.h"
+#include	"zvgFrame.h"
+
+#define	DEF_BYTES		262144			// bytes sent by each throughput test
+#define	DEF_FRAMES		500				// frames sent by the latency test
+#define	DEF_VECS		200				// vectors per frame
+#define	BLOCK_SZ		4096			// bytes per 'zvgEcpPutMem()' or buffer sent
+#define	MAX_COLS		8
+#define	HIST_SZ			16				// latency buckets, doubling from 1us
+#define	BURST_TAG		"+burst"
+
+// Tests
+
+enum
+{	TEST_PUTC = 0,
+	TEST_PUTMEM,
+	TEST_SWAP,
+	TEST_FRAME,
+	TESTS
+};
+
+static const char	*TestNames[TESTS] = { "putc", "putmem", "swap", "frame" };
+
+// Results of one test
+
+typedef struct RESULT_S
+{	bool				ran;
+	unsigned long long	bytes;			// bytes sent
+	long long int		ns;				// time taken
+	ulong				fulls;			// times the FIFO was found full
+	long long int		maxStallNs;		// longest FIFO full stall
+} Result_s;
+
+// A transport being compared, and its results
+
+typedef struct COLUMN_S
+{	char			spec[TR_SPEC_SZ];	// transport spec, without BURST_TAG
+	char			label[TR_SPEC_SZ + 8];
+	bool			burst;
+	uint			err;				// error that stopped the tests
+	Result_s		res[TESTS];
+	long long int	*lat;				// latency of each frame
+	uint			nLat;
+	uint			hist[HIST_SZ];
+} Column_s;
+
+static uchar	Block[BLOCK_SZ];		// NOPs sent by the throughput tests
+
+/*****************************************************************************
+* Start counting FIFO full stalls for a test.
+*****************************************************************************/
+static void startCount( Result_s *res, long long int *start)
+{
+	memset( res, 0, sizeof( Result_s));
+	res->ran = zTrue;
+	ZvgIO.rtFulls = 0;
+	ZvgIO.rtStallNs = 0;
+	*start = tmrReadTimer();
+}
+
+/*****************************************************************************
+* Time sending 'count' bytes, one 'zvgEcpPutc()' at a time.
+*****************************************************************************/
+static uint runPutc( Result_s *res, uint count)
+{
+	long long int	start;
+	uint			ii, err;
+
+	err = zvgSetEcpMode();
+	startCount( res, &start);
+
+	for (ii = 0; ii < count && !err; ii++)
+		err = zvgEcpPutc( zcNOP);
+
+	res->ns = tmrReadTimer() - start;
+	res->bytes = ii;
+	res->fulls = ZvgIO.rtFulls;
+	res->maxStallNs = ZvgIO.rtStallNs;
+	return (err);
+}
+
+/*****************************************************************************
+* Time sending 'count' bytes, a block at a time, by 'zvgEcpPutMem()'.
+*****************************************************************************/
+static uint runPutMem( Result_s *res, uint count)
+{
+	long long int	start;
+	uint			size, err;
+
+	err = zvgSetEcpMode();
+	startCount( res, &start);
+
+	while (res->bytes < count && !err)
+	{	size = count - res->bytes < BLOCK_SZ ? count - res->bytes : BLOCK_SZ;
+		err = zvgEcpPutMem( Block, size);
+		res->bytes += size;
+	}
+
+	res->ns = tmrReadTimer() - start;
+	res->fulls = ZvgIO.rtFulls;
+	res->maxStallNs = ZvgIO.rtStallNs;
+	return (err);
+}
+
+/*****************************************************************************
+* Time sending 'count' bytes, a buffer at a time, by 'zvgDmaSendSwap()'.
+*
+* Waits for the last buffer, so the real-time sender's time is counted.
+*****************************************************************************/
+static uint runSwap( Result_s *res, uint count)
+{
+	long long int	start;
+	ulong			fulls;
+	uint			size, err;
+
+	err = zvgDmaWait();
+	fulls = ZvgIO.rtStats.fulls;
+	ZvgIO.rtStats.maxStallNs = 0;
+	startCount( res, &start);
+
+	while (res->bytes < count && !err)
+	{	size = count - res->bytes < BLOCK_SZ ? count - res->bytes : BLOCK_SZ;
+		zvgDmaClearBfr();
+		err = zvgDmaPutMem( Block, size);
+
+		if (!err)
+			err = zvgDmaSendSwap();
+
+		res->bytes += size;
+	}
+
+	if (!err)
+		err = zvgDmaWait();
+
+	res->ns = tmrReadTimer() - start;
+	res->fulls = ZvgIO.rtStats.fulls - fulls;
+	res->maxStallNs = ZvgIO.rtStats.maxStallNs;
+	zvgDmaClearBfr();
+	return (err);
+}
+
+/*****************************************************************************
+* Draw frame 'nn' of the latency test, a grid that moves a little each frame.
+*****************************************************************************/
+static uint drawFrame( uint nn, uint vecs)
+{
+	uint	ii, err;
+	int		pos;
+
+	err = errOk;
+
+	for (ii = 0; ii < vecs && !err; ii++)
+	{	pos = -480 + (int)((ii * 37 + nn * 3) % 960);
+
+		if (ii & 1)
+			err = zvgFrameVector( pos, -360, pos, 360);
+
+		else
+			err = zvgFrameVector( -480, pos * 3 / 4, 480, pos * 3 / 4);
+	}
+	return (err);
+}
+
+/*****************************************************************************
+* Time 'frames' frames, from the start of 'zvgFrameSend()' until the last
+* byte has been taken.  The time taken to draw each frame isn't counted.
+*****************************************************************************/
+static uint runFrame( Column_s *col, uint frames, uint vecs)
+{
+	Result_s		*res;
+	long long int	start, lat;
+	ulong			fulls;
+	uint			ii, bb, err;
+
+	res = col->res + TEST_FRAME;
+	memset( res, 0, sizeof( Result_s));
+	res->ran = zTrue;
+
+	err = zvgDmaWait();
+	fulls = ZvgIO.rtStats.fulls;
+	ZvgIO.rtStats.maxStallNs = 0;
+
+	for (ii = 0; ii < frames && !err; ii++)
+	{
+		err = drawFrame( ii, vecs);
+
+		if (err)
+			break;
+
+		start = tmrReadTimer();
+		err = zvgFrameSend();
+
+		if (!err)
+			err = zvgDmaWait();
+
+		lat = tmrReadTimer() - start;
+
+		// count the buffer just sent, the one not being filled
+
+		res->bytes += ZvgIO.dmaCurP == ZvgIO.dmaBf1P ? ZvgIO.dmaBf2Count : ZvgIO.dmaBf1Count;
+		res->ns += lat;
+		col->lat[col->nLat++] = lat;
+
+		for (bb = 0; bb < HIST_SZ - 1 && lat >= (1000LL << bb); bb++)
+			;
+
+		col->hist[bb]++;
+	}
+
+	res->fulls = ZvgIO.rtStats.fulls - fulls;
+	res->maxStallNs = ZvgIO.rtStats.maxStallNs;
+	return (err);
+}
+
+/*****************************************************************************
+* Open a transport and run the tests asked for.
+*****************************************************************************/
+static void runColumn( Column_s *col, uint tests, uint count, uint frames, uint vecs)
+{
+	uint	err;
+
+	err = zvgSetTransport( col->spec);
+
+	if (err)
+	{	col->err = err;
+		return;
+	}
+
+	zvgSetBurst( col->burst ? ECP_FIFO_SZ : 0);
+	err = zvgFrameOpen();
+
+	if (err)
+	{	col->err = err;
+		return;
+	}
+
+	// 'ZVGPORT=' may have chosen some other transport
+
+	if (strcmp( ZvgIO.trSpec, col->spec) != 0)
+		snprintf( col->label, sizeof( col->label), "%s%s", ZvgIO.trSpec, col->burst ? BURST_TAG : "");
+
+	if (!err && (tests & (1 << TEST_PUTC)))
+		err = runPutc( col->res + TEST_PUTC, count);
+
+	if (!err && (tests & (1 << TEST_PUTMEM)))
+		err = runPutMem( col->res + TEST_PUTMEM, count);
+
+	if (!err && (tests & (1 << TEST_SWAP)))
+		err = runSwap( col->res + TEST_SWAP, count);
+
+	if (!err && (tests & (1 << TEST_FRAME)))
+		err = runFrame( col, frames, vecs);
+
+	col->err = err;
+	zvgFrameClose();
+	zvgSetBurst( 0);
+}
+
+/*****************************************************************************
+* Sort compare for latencies.
+*****************************************************************************/
+static int cmpLat( const void *aa, const void *bb)
+{
+	long long int	la, lb;
+
+	la = *(const long long int *)aa;
+	lb = *(const long long int *)bb;
+	return (la < lb ? -1 : la > lb);
+}
+
+/*****************************************************************************
+* Return the latency, in us, at 'pct' percent of the sorted latencies.
+*****************************************************************************/
+static double percentile( Column_s *col, uint pct)
+{
+	uint	idx;
+
+	if (col->nLat == 0)
+		return (0.0);
+
+	idx = (col->nLat - 1) * pct / 100;
+	return (col->lat[idx] / 1000.0);
+}
+
+/*****************************************************************************
+* Print one row of the side by side table.
+*****************************************************************************/
+static void printRow( Column_s *cols, uint nCols, uint test, const char *what)
+{
+	Result_s	*res;
+	uint		cc;
+	double		val;
+
+	printf( "%-8s %-14s", TestNames[test], what);
+
+	for (cc = 0; cc < nCols; cc++)
+	{	res = cols[cc].res + test;
+
+		if (!res->ran || res->bytes == 0 || res->ns <= 0)
+		{	printf( " %14s", "-");
+			continue;
+		}
+
+		if (strcmp( what, "KB/s") == 0)
+			val = res->bytes * 1e9 / 1024 / res->ns;
+
+		else if (strcmp( what, "ns/byte") == 0)
+			val = (double)res->ns / res->bytes;
+
+		else if (strcmp( what, "FIFO full") == 0)
+			val = res->fulls;
+
+		else if (strcmp( what, "full/KB") == 0)
+			val = res->fulls * 1024.0 / res->bytes;
+
+		else
+			val = res->maxStallNs / 1000.0;
+
+		printf( " %14.*f", strcmp( what, "FIFO full") == 0 ? 0 : 2, val);
+	}
+	putchar( '\n');
+}
+
+/*****************************************************************************
+* Print the results side by side.
+*****************************************************************************/
+static void printTable( Column_s *cols, uint nCols, uint tests)
+{
+	static const char	*rows[] = { "KB/s", "ns/byte", "FIFO full", "full/KB", "max stall us", NULL };
+	uint				cc, tt, rr, bb;
+
+	printf( "%-23s", "");
+
+	for (cc = 0; cc < nCols; cc++)
+		printf( " %14s", cols[cc].label);
+
+	putchar( '\n');
+
+	for (tt = 0; tt < TESTS; tt++)
+	{
+		if (!(tests & (1 << tt)))
+			continue;
+
+		for (rr = 0; rows[rr] != NULL; rr++)
+			printRow( cols, nCols, tt, rows[rr]);
+	}
+
+	// frame latency, percentiles then the histogram
+
+	if (!(tests & (1 << TEST_FRAME)))
+		return;
+
+	printf( "\nLatency, start of zvgFrameSend() to last byte taken (us):\n");
+
+	printf( "%-23s", "p50");
+
+	for (cc = 0; cc < nCols; cc++)
+		printf( " %14.1f", percentile( cols + cc, 50));
+
+	printf( "\n%-23s", "p99");
+
+	for (cc = 0; cc < nCols; cc++)
+		printf( " %14.1f", percentile( cols + cc, 99));
+
+	printf( "\n%-23s", "max");
+
+	for (cc = 0; cc < nCols; cc++)
+		printf( " %14.1f", percentile( cols + cc, 100));
+
+	putchar( '\n');
+
+	for (bb = 0; bb < HIST_SZ; bb++)
+	{
+		if (bb == HIST_SZ - 1)
+			printf( ">= %-20u", 1u << (bb - 1));
+
+		else
+			printf( "<  %-20u", 1u << bb);
+
+		for (cc = 0; cc < nCols; cc++)
+			printf( " %14u", cols[cc].hist[bb]);
+
+		putchar( '\n');
+	}
+}
+
+/*****************************************************************************
+* Print the results as CSV, one line per transport and test.
+*****************************************************************************/
+static void printCsv( Column_s *cols, uint nCols)
+{
+	Result_s	*res;
+	uint		cc, tt;
+
+	printf( "transport,test,bytes,ns,kb_per_sec,ns_per_byte,fifo_full,max_stall_ns,p50_us,p99_us,max_us\n");
+
+	for (cc = 0; cc < nCols; cc++)
+	{
+		for (tt = 0; tt < TESTS; tt++)
+		{	res = cols[cc].res + tt;
+
+			if (!res->ran || res->bytes == 0 || res->ns <= 0)
+				continue;
+
+			printf( "%s,%s,%llu,%lld,%.2f,%.3f,%lu,%lld", cols[cc].label, TestNames[tt],
+					res->bytes, res->ns, res->bytes * 1e9 / 1024 / res->ns,
+					(double)res->ns / res->bytes, res->fulls, res->maxStallNs);
+
+			if (tt == TEST_FRAME)
+				printf( ",%.1f,%.1f,%.1f\n", percentile( cols + cc, 50),
+						percentile( cols + cc, 99), percentile( cols + cc, 100));
+
+			else
+				printf( ",,,\n");
+		}
+	}
+}
+
+/*****************************************************************************
+* Add a transport to compare.
+*****************************************************************************/
+static bool addColumn( Column_s *col, const char *spec)
+{
+	uint	len, tag;
+
+	len = strlen( spec);
+	tag = strlen( BURST_TAG);
+
+	if (len >= TR_SPEC_SZ)
+		return (zFalse);
+
+	memset( col, 0, sizeof( Column_s));
+	strcpy( col->label, spec);
+	strcpy( col->spec, spec);
+
+	if (len > tag && strcmp( spec + len - tag, BURST_TAG) == 0)
+	{	col->spec[len - tag] = '\0';
+		col->burst = zTrue;
+	}
+	return (zTrue);
+}
+
+/*****************************************************************************
+* Print usage and exit.
+*****************************************************************************/
+static void usage( void)
+{
+	fputs( "Usage: zvgPortBench [-t transport[+burst]]... [-n bytes] [-f frames] [-v count]\n"
+			"                    [-m putc,putmem,swap,frame] [-c]\n", stderr);
+	exit( 1);
+}
+
+/*****************************************************************************
+* MAIN
+*****************************************************************************/
+int main( int argc, char *argv[])
+{
+	Column_s	cols[MAX_COLS];
+	uint		nCols, count, frames, vecs, tests, cc, tt;
+	bool		csv, failed;
+	char		*tok;
+	int			opt;
+
+	nCols = 0;
+	count = DEF_BYTES;
+	frames = DEF_FRAMES;
+	vecs = DEF_VECS;
+	tests = (1 << TESTS) - 1;
+	csv = zFalse;
+
+	while ((opt = getopt( argc, argv, "t:n:f:v:m:c")) != -1)
+	{
+		switch (opt)
+		{
+		case 't':
+			if (nCols >= MAX_COLS || !addColumn( cols + nCols, optarg))
+				usage();
+
+			nCols++;
+			break;
+
+		case 'n':
+			count = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'f':
+			frames = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'v':
+			vecs = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'm':
+			tests = 0;
+
+			for (tok = strtok( optarg, ","); tok != NULL; tok = strtok( NULL, ","))
+			{
+				for (tt = 0; tt < TESTS && strcmp( tok, TestNames[tt]) != 0; tt++)
+					;
+
+				if (tt == TESTS)
+					usage();
+
+				tests |= 1 << tt;
+			}
+			break;
+
+		case 'c':
+			csv = zTrue;
+			break;
+
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc || tests == 0)
+		usage();
+
+	// default is a sink, and the simulator at about the rate of a real port
+
+	if (nCols == 0)
+	{	addColumn( cols + nCols++, "null");
+		addColumn( cols + nCols++, "sim:2000000");
+		addColumn( cols + nCols++, "sim:2000000" BURST_TAG);
+	}
+
+	// runs headless, with no monitor flags, unless told otherwise
+
+	setenv( "ZVGPORT", "M0", 0);
+	memset( Block, zcNOP, sizeof( Block));
+	failed = zFalse;
+
+	for (cc = 0; cc < nCols; cc++)
+	{
+		cols[cc].lat = (long long int *)malloc( (frames + 1) * sizeof( long long int));
+
+		if (cols[cc].lat == NULL)
+		{	zvgError( errMemory);
+			exit( 1);
+		}
+
+		runColumn( cols + cc, tests, count, frames, vecs);
+
+		if (cols[cc].err)
+		{	fprintf( stderr, "%s: ", cols[cc].label);
+			zvgError( cols[cc].err);
+			failed = zTrue;
+		}
+
+		qsort( cols[cc].lat, cols[cc].nLat, sizeof( long long int), cmpLat);
+	}
+
+	if (csv)
+		printCsv( cols, nCols);
+
+	else
+		printTable( cols, nCols, tests);
+
+	for (cc = 0; cc < nCols; cc++)
+		free( cols[cc].lat);
+
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,222 @@
+/*****************************************************************************
+* Program to draw frames streamed from another machine.
+*
+* Run at the cabinet.  Takes the frames sent by a program using the 'net'
+* transport ('Tnet:host:port' in its 'ZVGPORT='), and sends each one to the
+* local ZVG as it comes in, see 'zvgNet.c'.  The local ZVG is setup by
+* 'ZVGPORT=' as usual, and should have the same monitor type as the sender.
+*
+* Prints the frame rate, compression ratio, bandwidth and end to end
+* latency as it goes, and the totals when it stops.
+*
+* Usage: zvgRecv [options]
+*
+*    -l addr   = Address to listen on, "[udp:][host:]port" (default TCP on
+*                port 7430, any host).
+*    -t spec   = Transport to use, as in the 'T' attribute of 'ZVGPORT='.
+*    -d ms     = Time between reports (default 1000), 0 for none.
+*    -n count  = Stop after 'count' frames.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<signal.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgTrans.h"
+#include	"zvgFrame.h"
+#include	"zvgNet.h"
+
+#define	DEF_DELAY_MS	1000			// time between reports
+#define	WAIT_MS			100				// longest wait for a frame, so reports and signals aren't held up
+
+static volatile sig_atomic_t	Quit;
+
+/*****************************************************************************
+* Print usage and exit.
+*****************************************************************************/
+static void usage( void)
+{
+	fputs( "Usage: zvgRecv [-l address] [-t transport] [-d ms] [-n count]\n", stderr);
+	exit( 1);
+}
+
+/*****************************************************************************
+* Stop on SIGINT or SIGTERM.
+*****************************************************************************/
+static void onSignal( int sig)
+{
+	Quit = sig;
+}
+
+/*****************************************************************************
+* Print the counters since the last report.
+*****************************************************************************/
+static void report( const ZvgNetStats_s *now, const ZvgNetStats_s *last, long long int ns)
+{
+	unsigned long long	wire, bytes;
+
+	wire = now->wire - last->wire;
+	bytes = now->bytes - last->bytes;
+
+	printf( "%6.1f fps  %6.1f KB/s  ratio %5.1f:1  latency %6.2f ms (max %6.2f)  lost %lu  resyncs %lu\n",
+			(now->frames - last->frames) * 1e9 / ns, wire * 1e9 / 1024 / ns,
+			wire ? (double)bytes / wire : 0.0, now->latNs / 1e6, now->maxLatNs / 1e6,
+			now->lost, now->resyncs);
+	fflush( stdout);
+}
+
+/*****************************************************************************
+* MAIN
+*****************************************************************************/
+int main( int argc, char *argv[])
+{
+	ZvgNetRx_s			*rx;
+	ZvgNetStats_s		stats, last;
+	struct sigaction	sa;
+	const char			*addr, *trSpec;
+	long long int		start, lastNs, now;
+	unsigned long		maxFrames;
+	uchar				*mem;
+	uint				err, count, delay;
+	int					opt;
+	char				port[16];
+
+	snprintf( port, sizeof( port), "%u", NET_PORT);
+	addr = port;
+	trSpec = NULL;
+	delay = DEF_DELAY_MS;
+	maxFrames = 0;
+
+	while ((opt = getopt( argc, argv, "l:t:d:n:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'l':
+			addr = optarg;
+			break;
+
+		case 't':
+			trSpec = optarg;
+			break;
+
+		case 'd':
+			delay = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'n':
+			maxFrames = strtoul( optarg, NULL, 10);
+			break;
+
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc)
+		usage();
+
+	// a transport given here doesn't need 'ZVGPORT=' to be set
+
+	if (trSpec != NULL)
+	{	setenv( "ZVGPORT", "", 0);
+		err = zvgSetTransport( trSpec);
+
+		if (err)
+		{	zvgError( err);
+			exit( 1);
+		}
+	}
+
+	err = zvgFrameOpen();
+
+	if (err)
+	{	zvgError( err);
+		exit( 1);
+	}
+
+	err = zvgNetListen( &rx, addr);
+
+	if (err)
+	{	zvgError( err);
+		zvgFrameClose();
+		exit( 1);
+	}
+
+	memset( &sa, 0, sizeof( sa));
+	sa.sa_handler = onSignal;
+	sigaction( SIGINT, &sa, NULL);
+	sigaction( SIGTERM, &sa, NULL);
+
+	memset( &last, 0, sizeof( last));
+	start = tmrReadTimer();
+	lastNs = start;
+
+	// send on each frame as it comes in
+
+	while (!Quit)
+	{	zvgNetRecv( rx, &mem, &count, WAIT_MS);
+
+		if (mem != NULL)
+		{	err = zvgDmaPutMem( mem, count);
+
+			if (!err)
+				err = zvgDmaSendSwap();
+
+			zvgNetDone( rx);
+
+			if (err)
+				break;
+		}
+
+		zvgNetRecvStats( rx, &stats);
+		now = tmrReadTimer();
+
+		if (delay && now - lastNs >= delay * 1000000LL)
+		{	report( &stats, &last, now - lastNs);
+			last = stats;
+			lastNs = now;
+		}
+
+		if (maxFrames && stats.frames >= maxFrames)
+			break;
+	}
+
+	if (!err)
+		err = zvgDmaWait();
+
+	now = tmrReadTimer();
+	zvgNetRecvStats( rx, &stats);
+	zvgNetClose( rx);
+	zvgFrameClose();
+
+	if (err)
+		zvgError( err);
+
+	// totals
+
+	printf( "Frames:          %lu (%lu sent as is)\n", stats.frames, stats.rawFrames);
+	printf( "Frame bytes:     %llu\n", stats.bytes);
+	printf( "Bytes received:  %llu\n", stats.wire);
+
+	if (stats.wire > 0)
+		printf( "Compression:     %.1f:1\n", (double)stats.bytes / stats.wire);
+
+	printf( "Lost:            %lu\n", stats.lost);
+	printf( "Resyncs:         %lu\n", stats.resyncs);
+
+	if (stats.latCount > 0)
+		printf( "Latency:         %.2f ms mean, %.2f ms max\n",
+				stats.sumLatNs / 1e6 / stats.latCount, stats.maxLatNs / 1e6);
+
+	printf( "Elapsed:         %.3f s\n", (now - start) / 1e9);
+	return (err ? 1 : 0);
+}
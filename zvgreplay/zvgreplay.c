@@ -0,0 +1,240 @@
+/*****************************************************************************
+* Program to replay frames captured from the ZVG drivers.
+*
+* Plays any range of frames from a capture file, made with the 'F' attribute
+* of 'ZVGPORT=' or 'zvgCapStart()', back through any transport.  Frames are
+* sent with their original timing, or as fast as the transport takes them.
+*
+* Usage: zvgReplay [options] capture
+*
+*    -f first  = First frame to play (default 0).
+*    -l last   = Last frame to play (default the last frame captured).
+*    -t spec   = Transport to use, as in the 'T' attribute of 'ZVGPORT='.
+*    -m        = Play at maximum speed, rather than the original timing.
+*    -r count  = Play the range 'count' times (default 1).
+*    -i        = Only list the frames in the range, don't play them.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<time.h>
+#include	<unistd.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgTrans.h"
+#include	"zvgFrame.h"
+#include	"zvgCap.h"
+
+/*****************************************************************************
+* Print usage and exit.
+*****************************************************************************/
+static void usage( void)
+{
+	fputs( "Usage: zvgReplay [-f first] [-l last] [-t transport] [-m] [-r count] [-i] capture\n", stderr);
+	exit( 1);
+}
+
+/*****************************************************************************
+* Sleep until the monotonic clock reaches 'when', in nanoseconds.
+*****************************************************************************/
+static void sleepUntil( long long int when)
+{
+	struct timespec	ts;
+
+	ts.tv_sec = when / 1000000000LL;
+	ts.tv_nsec = when % 1000000000LL;
+
+	while (clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+		;
+}
+
+/*****************************************************************************
+* List the frames in a range.
+*****************************************************************************/
+static void listFrames( ZvgCapFile_s *cf, uint first, uint last)
+{
+	ZvgCapFrame_s	frm;
+	uint			ii;
+
+	printf( "%8s %14s %8s %8s\n", "frame", "time (us)", "bytes", "vectors");
+
+	for (ii = first; ii <= last; ii++)
+	{	zvgCapGetFrame( cf, ii, &frm);
+		printf( "%8u %14lld %8u %8u\n", frm.frame, frm.timeNs / 1000, frm.count, frm.vectors);
+	}
+}
+
+/*****************************************************************************
+* MAIN
+*****************************************************************************/
+int main( int argc, char *argv[])
+{
+	ZvgCapFile_s	cf;
+	ZvgCapFrame_s	frm;
+	uint			err, ii, first, last, repeat, rr;
+	bool			maxSpeed, listOnly;
+	const char		*trSpec;
+	long long int	start, base, late, maxLate, elapsed;
+	unsigned long long	bytes, sent;
+	int				opt;
+
+	first = 0;
+	last = (uint)-1;
+	repeat = 1;
+	maxSpeed = zFalse;
+	listOnly = zFalse;
+	trSpec = NULL;
+
+	while ((opt = getopt( argc, argv, "f:l:t:mr:i")) != -1)
+	{
+		switch (opt)
+		{
+		case 'f':
+			first = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'l':
+			last = strtoul( optarg, NULL, 10);
+			break;
+
+		case 't':
+			trSpec = optarg;
+			break;
+
+		case 'm':
+			maxSpeed = zTrue;
+			break;
+
+		case 'r':
+			repeat = strtoul( optarg, NULL, 10);
+			break;
+
+		case 'i':
+			listOnly = zTrue;
+			break;
+
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc - 1)
+		usage();
+
+	err = zvgCapOpen( &cf, argv[optind]);
+
+	if (err)
+	{	zvgError( err);
+		exit( 1);
+	}
+
+	if (cf.frames == 0)
+	{	fputs( "No frames in capture.\n", stderr);
+		exit( 1);
+	}
+
+	if (last >= cf.frames)
+		last = cf.frames - 1;
+
+	if (first > last)
+	{	zvgError( errCapRange);
+		exit( 1);
+	}
+
+	if (listOnly)
+	{	listFrames( &cf, first, last);
+		zvgCapClose( &cf);
+		exit( 0);
+	}
+
+	// a transport given here doesn't need 'ZVGPORT=' to be set
+
+	if (trSpec != NULL)
+	{	setenv( "ZVGPORT", "", 0);
+		err = zvgSetTransport( trSpec);
+
+		if (err)
+		{	zvgError( err);
+			exit( 1);
+		}
+	}
+
+	err = zvgFrameOpen();
+
+	if (err)
+	{	zvgError( err);
+		exit( 1);
+	}
+
+	// play the range
+
+	bytes = 0;
+	sent = 0;
+	maxLate = 0;
+	start = tmrReadTimer();
+
+	for (rr = 0; rr < repeat && !err; rr++)
+	{
+		zvgCapGetFrame( &cf, first, &frm);
+		base = tmrReadTimer() - frm.timeNs;
+
+		for (ii = first; ii <= last && !err; ii++)
+		{	zvgCapGetFrame( &cf, ii, &frm);
+
+			// wait until the frame's original send time
+
+			if (!maxSpeed)
+			{	late = tmrReadTimer() - (base + frm.timeNs);
+
+				if (late < 0)
+					sleepUntil( base + frm.timeNs);
+
+				else if (late > maxLate)
+					maxLate = late;
+			}
+
+			err = zvgDmaPutMem( frm.mem, frm.count);
+
+			if (!err)
+				err = zvgDmaSendSwap();
+
+			bytes += frm.count;
+			sent++;
+		}
+	}
+
+	if (!err)
+		err = zvgDmaWait();
+
+	elapsed = tmrReadTimer() - start;
+	zvgFrameClose();
+	zvgCapClose( &cf);
+
+	if (err)
+		zvgError( err);
+
+	// report
+
+	printf( "Frames sent:     %llu\n", sent);
+	printf( "Bytes sent:      %llu\n", bytes);
+	printf( "Elapsed:         %.3f s\n", elapsed / 1e9);
+
+	if (elapsed > 0)
+	{	printf( "Frame rate:      %.1f fps\n", sent * 1e9 / elapsed);
+		printf( "Throughput:      %.1f KB/s\n", bytes * 1e9 / 1024 / elapsed);
+	}
+
+	printf( "Worst send time: %lld us\n", ZvgIO.rtStats.maxSendNs / 1000);
+	printf( "Worst stall:     %lld us\n", ZvgIO.rtStats.maxStallNs / 1000);
+
+	if (!maxSpeed)
+		printf( "Worst lateness:  %lld us\n", maxLate / 1000);
+
+	return (err ? 1 : 0);
+}
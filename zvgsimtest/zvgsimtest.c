@@ -0,0 +1,229 @@
+/*****************************************************************************
+* Checks the timeout and fault paths of the direct port I/O code, against
+* the ECP port and ZVG simulator (see 'zvgSim.c').  Run by 'ctest'.
+*
+* The ZVG is opened on the 'sim' transport, with link recovery off so the
+* errors reach the caller, and frames are sent until the fault injected
+* after FAULT_AFTER bytes stops one.  The first frame must go through, the
+* one that meets the fault must fail with the error expected for it, and a
+* stalled ZVG must not lose any bytes.
+*
+* 'ctlfull' checks a frame with no room left for the control commands
+* waiting: the frame must still go out, and the commands with the next.
+*
+* Usage: zvgSimTest test [policy]
+*
+*    test   = 'clean' (no fault, every frame must go), 'stall' (the ZVG
+*             stops taking data, errEcpTimeout), 'xflag' (the ZVG drops
+*             out of ECP mode, errEcpToSpp), 'cable' (the cable is
+*             pulled, errEcpToSpp) or 'ctlfull' (no fault, a frame too
+*             full for a register change).
+*    policy = Wait policy, as the 'W' of 'ZVGPORT=' (default 1).
+*
+* Exits with 0 if the test passed, 1 if it failed, 2 on a usage error.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+
+#include	"zstddef.h"
+#include	"zvgPort.h"
+#include	"zvgFrame.h"
+#include	"zvgCtl.h"
+#include	"zvgCmds.h"
+#include	"zvgSim.h"
+
+#define	FAULT_AFTER		3000			// bytes taken before the fault starts
+#define	FRAME_VECS		200				// vectors per frame, a bit over 1000 bytes
+#define	MAX_FRAMES		8				// frames sent before giving up on the fault
+#define	ENV_SZ			64
+
+// The tests
+
+typedef struct SIMTEST_S
+{	const char	*name;
+	uint		faults;					// SIMF_xxx injected
+	uint		err;					// error expected once the fault starts
+	bool		(*run)( const struct SIMTEST_S *test);
+} SimTest_s;
+
+static bool runFault( const SimTest_s *test);
+static bool runCtlFull( const SimTest_s *test);
+
+static const SimTest_s	Tests[] =
+{	{ "clean",		0,				errOk,			runFault },
+	{ "stall",		SIMF_STALL,		errEcpTimeout,	runFault },
+	{ "xflag",		SIMF_XFLAG,		errEcpToSpp,	runFault },
+	{ "cable",		SIMF_CABLE,		errEcpToSpp,	runFault },
+	{ "ctlfull",	0,				errOk,			runCtlFull }
+};
+
+#define	TESTS	(sizeof( Tests) / sizeof( *Tests))
+
+/*****************************************************************************
+* Print usage and exit.
+*****************************************************************************/
+static void usage( void)
+{
+	fputs( "Usage: zvgSimTest clean|stall|xflag|cable|ctlfull [policy]\n", stderr);
+	exit( 2);
+}
+
+/*****************************************************************************
+* Draw a frame of FRAME_VECS vectors, and send it.
+*
+* Returns:
+*    errCode
+*****************************************************************************/
+static uint sendFrame( void)
+{
+	uint	ii;
+
+	for (ii = 0; ii < FRAME_VECS; ii++)
+		zvgFrameVector( -300 + ii, -200, 300 - ii, 200 + (ii & 7));
+
+	return (zvgFrameSend());
+}
+
+/*****************************************************************************
+* Send frames until the injected fault stops one.
+*
+* Returns:
+*    zTrue if the test passed.
+*****************************************************************************/
+static bool runFault( const SimTest_s *test)
+{
+	ZvgSimStats_s	stats;
+	uint			err, frame;
+	bool			pass;
+
+	err = errOk;
+
+	for (frame = 0; frame < MAX_FRAMES; frame++)
+	{	err = sendFrame();
+
+		if (err)
+			break;
+	}
+
+	zvgSimGetStats( &stats);
+
+	printf( "zvgSimTest: %s: %u frames sent, error %u, %u bytes taken, %u lost\n",
+			test->name, frame, err, stats.bytes, stats.lost);
+
+	pass = err == test->err;
+
+	if (test->faults == 0)
+		pass = pass && frame == MAX_FRAMES;
+
+	else
+		pass = pass && frame > 0 && frame < MAX_FRAMES;
+
+	// a stalled ZVG leaves the bytes in the FIFO, nothing is written over them
+
+	if (test->faults == SIMF_STALL && stats.lost != 0)
+		pass = zFalse;
+
+	if (!pass)
+		printf( "zvgSimTest: %s: FAILED, expected error %u\n", test->name, test->err);
+
+	return (pass);
+}
+
+/*****************************************************************************
+* Change a register in a frame filled up to its end of frame, then send
+* two more frames.  The full frame and those after it must go, the change
+* must wait for the second, and 'ZvgMon' must only follow once it's sent.
+*
+* Returns:
+*    zTrue if the test passed.
+*****************************************************************************/
+static bool runCtlFull( const SimTest_s *test)
+{
+	ZvgCtlStats_s	stats;
+	uint			err[3], zShift, was;
+	bool			pass;
+
+	was = ZvgMon.zShift;
+	zShift = was == 5 ? 6 : 5;
+
+	// fill the frame, leaving room for the end of frame but not the change
+
+	zvgCtlSet( crZShift, zShift);
+
+	while (ZvgIO.dmaCurCount < MEM_BFR_SZ - zENC_EOF_SIZE)
+		zvgDmaPutc( zcNOP);
+
+	err[0] = zvgFrameSend();
+	pass = ZvgMon.zShift == was;
+
+	err[1] = sendFrame();
+	err[2] = sendFrame();
+	zvgCtlGetStats( &stats);
+
+	printf( "zvgSimTest: %s: errors %u %u %u, %lu sent, %lu deferred, Z-shift %u (was %u)\n",
+			test->name, err[0], err[1], err[2], stats.sent, stats.deferred, ZvgMon.zShift, was);
+
+	pass = pass && err[0] == errOk && err[1] == errOk && err[2] == errOk
+			&& stats.deferred == 1 && stats.sent == 1 && ZvgMon.zShift == zShift;
+
+	if (!pass)
+		printf( "zvgSimTest: %s: FAILED\n", test->name);
+
+	return (pass);
+}
+
+/*****************************************************************************
+* MAIN
+*****************************************************************************/
+int main( int argc, char *argv[])
+{
+	const SimTest_s	*test;
+	ZvgSimCfg_s		cfg;
+	char			env[ENV_SZ];
+	uint			err, ii;
+	bool			pass;
+
+	if (argc < 2 || argc > 3)
+		usage();
+
+	test = NULL;
+
+	for (ii = 0; ii < TESTS; ii++)
+	{
+		if (strcmp( argv[1], Tests[ii].name) == 0)
+			test = &Tests[ii];
+	}
+
+	if (test == NULL || (argc == 3 && strspn( argv[2], "0123") != strlen( argv[2])))
+		usage();
+
+	// the simulator, link recovery off, and no device info cache written
+
+	snprintf( env, sizeof( env), "Tsim M0 N L0 W%s", argc == 3 ? argv[2] : "1");
+	setenv( "ZVGPORT", env, 1);
+
+	memset( &cfg, 0, sizeof( cfg));
+	cfg.faults = test->faults;
+	cfg.faultAfter = FAULT_AFTER;
+	zvgSimConfig( &cfg);
+
+	err = zvgFrameOpen();
+
+	if (err)
+	{	zvgError( err);
+		printf( "\nzvgSimTest: %s: open failed\n", test->name);
+		return (1);
+	}
+
+	printf( "zvgSimTest: %s (%s)\n", test->name, env);
+	pass = test->run( test);
+	zvgFrameClose();
+
+	return (pass ? 0 : 1);
+}
@@ -0,0 +1,492 @@
+/*****************************************************************************
+* Live monitor for a running ZVG program.
+*
+* Attaches to the shared memory stats segment published by a program run
+* with the 'S' attribute of 'ZVGPORT=' (or 'zvgShmStart()'), and shows its
+* frame rate, frame size, vectors, estimated draw time, send times, FIFO
+* stalls, late and dropped frames, with a graph of the recent frames, and
+* whether the link to the ZVG is down.  Nothing in the watched program is
+* stopped or changed, so a cabinet can be looked at while the game runs.
+*
+* If the program exits, or hasn't started yet, 'zvgTop' waits for a
+* segment of the same name to show up again.
+*
+* Usage: zvgTop [options]
+*
+*    -n name   = Segment to watch, as given by 'S' (default /zvg).
+*    -d ms     = Time between updates (default 250).
+*    -1        = Print the counters once, as text, and exit.
+*
+* Keys:
+*
+*    g, Tab    = Show the next graph.
+*    p         = Pause or resume updates.
+*    q         = Quit.
+*
+* Created: 10/18/26
+*
+* History:
+*
+*****************************************************************************/
+#include	<errno.h>
+#include	<signal.h>
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<curses.h>
+
+#include	"zstddef.h"
+#include	"timer.h"
+#include	"zvgPort.h"
+#include	"zvgFrame.h"
+#include	"zvgShm.h"
+
+#define	DEF_DELAY_MS	250				// time between updates
+#define	STALE_NS		2000000000LL	// no update for this long, program is stalled
+#define	LABEL_W			8				// width of the graph's scale
+#define	TABLE_ROW		4				// first row of the table
+#define	GRAPH_ROW		16				// first row of the graph
+
+#define	TITLE_PAIR		1
+#define	BAR_PAIR		2
+#define	LIMIT_PAIR		3
+#define	WARN_PAIR		4
+
+// Graphs, and the counters shown in the table
+
+enum graph
+{	gDraw,								// estimated draw time
+	gBytes,								// bytes sent
+	gVectors,							// vectors
+	gEncode,							// time encoding
+	gSend,								// time sending
+	gStall,								// longest FIFO stall
+	gFulls,								// FIFO found full
+	GRAPHS
+};
+
+typedef struct GRAPHDEF_S
+{	const char	*name;					// shown in the table and graph title
+	const char	*unit;
+	uint		scale;					// value is divided by this for the table
+} GraphDef_s;
+
+static const GraphDef_s	Graphs[GRAPHS] =
+{	{ "draw time (est)",	"ms",	1000 },
+	{ "bytes",				"",		1 },
+	{ "vectors",			"",		1 },
+	{ "encode",				"us",	1 },
+	{ "send",				"us",	1 },
+	{ "FIFO stall",			"us",	1 },
+	{ "FIFO full",			"",		1 }
+};
+
+// Summary of the frames in the history
+
+typedef struct SUMMARY_S
+{	uint	frames;						// frames in the history
+	double	avg[GRAPHS];
+	uint	max[GRAPHS];
+	uint	missed;						// late frames in the history
+} Summary_s;
+
+/*****************************************************************************
+* Print usage and exit.
+*****************************************************************************/
+static void usage( void)
+{
+	fputs( "Usage: zvgTop [-n name] [-d ms] [-1]\n", stderr);
+	exit( 1);
+}
+
+/*****************************************************************************
+* Return one counter of a frame in the history.
+*****************************************************************************/
+static uint frameValue( const ZvgShmFrame_s *fr, uint graph)
+{
+	switch (graph)
+	{
+	case gDraw:		return (fr->drawUs);
+	case gBytes:	return (fr->bytes);
+	case gVectors:	return (fr->vectors);
+	case gEncode:	return (fr->encodeUs);
+	case gSend:		return (fr->sendUs);
+	case gStall:	return (fr->stallUs);
+	case gFulls:	return (fr->fulls);
+	}
+	return (0);
+}
+
+/*****************************************************************************
+* Return a frame in the history, 0 being the oldest kept.
+*****************************************************************************/
+static const ZvgShmFrame_s *histFrame( const ZvgShm_s *shm, uint frames, uint idx)
+{
+	return (shm->hist + ((shm->head - frames + idx) % SHM_HISTORY));
+}
+
+/*****************************************************************************
+* Average and peak of each counter over the history.
+*****************************************************************************/
+static void summarize( const ZvgShm_s *shm, Summary_s *sum)
+{
+	const ZvgShmFrame_s	*fr;
+	uint				ii, gg, vv;
+
+	memset( sum, 0, sizeof( Summary_s));
+	sum->frames = shm->head < SHM_HISTORY ? (uint)shm->head : SHM_HISTORY;
+
+	for (ii = 0; ii < sum->frames; ii++)
+	{	fr = histFrame( shm, sum->frames, ii);
+
+		for (gg = 0; gg < GRAPHS; gg++)
+		{	vv = frameValue( fr, gg);
+			sum->avg[gg] += vv;
+
+			if (vv > sum->max[gg])
+				sum->max[gg] = vv;
+		}
+		sum->missed += fr->missed;
+	}
+
+	if (sum->frames > 0)
+	{
+		for (gg = 0; gg < GRAPHS; gg++)
+			sum->avg[gg] /= sum->frames;
+	}
+}
+
+/*****************************************************************************
+* Return the state of the watched program, as text.
+*****************************************************************************/
+static const char *progState( const ZvgShm_s *shm, bool *gone)
+{
+	*gone = zFalse;
+
+	if (kill( shm->pid, 0) != 0 && errno == ESRCH)
+	{	*gone = zTrue;
+		return ("exited");
+	}
+
+	if (shm->updateNs == 0)
+		return ("no frames yet");
+
+	if (tmrReadTimer() - shm->updateNs > STALE_NS)
+		return ("not sending frames");
+
+	if (shm->linkDown)
+		return ("link down");
+
+	return ("running");
+}
+
+/*****************************************************************************
+* Print the counters once, as text.
+*****************************************************************************/
+static void printOnce( const ZvgShm_s *shm)
+{
+	Summary_s	sum;
+	bool		gone;
+	uint		gg;
+
+	summarize( shm, &sum);
+
+	printf( "%s (pid %d), transport %s, %s\n", shm->prog, shm->pid,
+			shm->trSpec[0] != '\0' ? shm->trSpec : "direct", progState( shm, &gone));
+	printf( "%.2f fps, frame period %.2f ms, %lu frames, %lu late, %lu dropped\n\n",
+			shm->fps100 / 100.0, shm->frameNs / 1e6, shm->total.frames, shm->total.missed,
+			shm->total.dropped);
+
+	printf( "%-20s %10s %10s %10s\n", "", "last", "avg", "max");
+
+	for (gg = 0; gg < GRAPHS; gg++)
+	{
+		printf( "%-16s %-3s %10.2f %10.2f %10.2f\n", Graphs[gg].name, Graphs[gg].unit,
+				(double)frameValue( histFrame( shm, 1, 0), gg) / Graphs[gg].scale,
+				sum.avg[gg] / Graphs[gg].scale, (double)sum.max[gg] / Graphs[gg].scale);
+	}
+	printf( "\nover the last %u frames, %u late\n", sum.frames, sum.missed);
+}
+
+/*****************************************************************************
+* Draw the graph of one counter, one column per group of frames, newest on
+* the right.  Each column shows the largest value in its group.
+*****************************************************************************/
+static void drawGraph( const ZvgShm_s *shm, uint graph, int row, int height)
+{
+	uint	frames, group, cols, cc, ii, vv, top, limit, colMax;
+	int		width, rr, level, limitRow;
+	char	label[16];
+
+	width = COLS - LABEL_W;
+	frames = shm->head < SHM_HISTORY ? (uint)shm->head : SHM_HISTORY;
+
+	if (width < 1 || height < 2 || frames == 0)
+		return;
+
+	group = (frames + width - 1) / width;
+	cols = (frames + group - 1) / group;
+
+	// scale to the peak, and for the draw time, to the frame period as well
+
+	limit = graph == gDraw ? (uint)(shm->frameNs / 1000) : 0;
+	top = limit;
+
+	for (ii = 0; ii < frames; ii++)
+	{	vv = frameValue( histFrame( shm, frames, ii), graph);
+
+		if (vv > top)
+			top = vv;
+	}
+
+	if (top == 0)
+		top = 1;
+
+	limitRow = limit != 0 ? row + height - 1 - (int)((unsigned long long)limit * (height - 1) / top) : -1;
+
+	snprintf( label, sizeof( label), "%7.1f", (double)top / Graphs[graph].scale);
+	mvaddstr( row, 0, label);
+	mvaddstr( row + height - 1, 0, "      0");
+
+	for (cc = 0; cc < cols; cc++)
+	{
+		// largest value of the frames in this column
+
+		colMax = 0;
+
+		for (ii = cc * group; ii < (cc + 1) * group && ii < frames; ii++)
+		{	vv = frameValue( histFrame( shm, frames, ii), graph);
+
+			if (vv > colMax)
+				colMax = vv;
+		}
+
+		level = (int)((unsigned long long)colMax * (height - 1) / top);
+
+		for (rr = 0; rr < height; rr++)
+		{	move( row + height - 1 - rr, LABEL_W + width - cols + cc);
+
+			if (rr <= level && (colMax > 0 || rr == 0))
+			{	attrset( COLOR_PAIR( colMax > limit && limit != 0 ? WARN_PAIR : BAR_PAIR));
+				addch( rr == 0 && colMax == 0 ? '_' : '#');
+			}
+
+			else if (row + height - 1 - rr == limitRow)
+			{	attrset( COLOR_PAIR( LIMIT_PAIR));
+				addch( '-');
+			}
+		}
+	}
+	attrset( A_NORMAL);
+}
+
+/*****************************************************************************
+* Draw the whole screen.
+*****************************************************************************/
+static void drawScreen( const ZvgShm_s *shm, const char *name, uint graph, bool paused)
+{
+	Summary_s	sum;
+	bool		gone;
+	uint		gg;
+	int			row;
+
+	summarize( shm, &sum);
+	erase();
+
+	attrset( COLOR_PAIR( TITLE_PAIR) | A_BOLD);
+	mvprintw( 0, 0, "zvgTop  %s  %s (pid %d)  transport %s", name, shm->prog, shm->pid,
+			shm->trSpec[0] != '\0' ? shm->trSpec : "direct");
+	attrset( A_NORMAL);
+
+	mvprintw( 1, 0, "%-20s %7.2f fps   frame %.2f ms   %lu frames   %lu late   %lu dropped",
+			progState( shm, &gone), shm->fps100 / 100.0, shm->frameNs / 1e6,
+			shm->total.frames, shm->total.missed, shm->total.dropped);
+
+	if (paused)
+		mvaddstr( 1, COLS - 8, "[paused]");
+
+	mvprintw( 3, 0, "%-20s %10s %10s %10s   last %u frames, %u late", "", "last", "avg", "max",
+			sum.frames, sum.missed);
+
+	for (gg = 0; gg < GRAPHS; gg++)
+	{	row = TABLE_ROW + gg;
+
+		if (gg == graph)
+			attrset( A_REVERSE);
+
+		mvprintw( row, 0, "%-16s %-3s %10.2f %10.2f %10.2f", Graphs[gg].name, Graphs[gg].unit,
+				(double)frameValue( histFrame( shm, 1, 0), gg) / Graphs[gg].scale,
+				sum.avg[gg] / Graphs[gg].scale, (double)sum.max[gg] / Graphs[gg].scale);
+		attrset( A_NORMAL);
+	}
+
+	mvprintw( TABLE_ROW + GRAPHS + 1, 0, "vectors %lu drawn, %lu points, %lu clipped, %lu rejected",
+			shm->last.drawn, shm->last.points, shm->last.clipped, shm->last.rejected);
+
+	mvprintw( GRAPH_ROW - 1, 0, "%s %s%s%s", Graphs[graph].name,
+			Graphs[graph].unit[0] != '\0' ? "(" : "", Graphs[graph].unit,
+			Graphs[graph].unit[0] != '\0' ? ")" : "");
+	mvaddstr( GRAPH_ROW - 1, COLS - 34 > 0 ? COLS - 34 : 0, "g: next graph  p: pause  q: quit");
+
+	drawGraph( shm, graph, GRAPH_ROW, LINES - GRAPH_ROW);
+	refresh();
+}
+
+/*****************************************************************************
+* Draw the screen shown while there is no segment to watch.
+*****************************************************************************/
+static void drawWaiting( const char *name, uint err)
+{
+	erase();
+	attrset( COLOR_PAIR( TITLE_PAIR) | A_BOLD);
+	mvprintw( 0, 0, "zvgTop  %s", name);
+	attrset( A_NORMAL);
+
+	if (err == errShmBad)
+		mvprintw( 1, 0, "Segment is not a ZVG stats segment, or of another version.");
+
+	else
+		mvprintw( 1, 0, "Waiting for a program run with 'S%s' in ZVGPORT=...", name);
+
+	mvaddstr( 3, 0, "q: quit");
+	refresh();
+}
+
+/*****************************************************************************
+* MAIN
+*****************************************************************************/
+int main( int argc, char *argv[])
+{
+	const ZvgShm_s	*shm;
+	ZvgShm_s		*copy;
+	const char		*name;
+	uint			err, delay, graph;
+	bool			once, paused, gone;
+	int				opt, cc;
+
+	name = SHM_DEF_NAME;
+	delay = DEF_DELAY_MS;
+	once = zFalse;
+
+	while ((opt = getopt( argc, argv, "n:d:1")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			name = optarg;
+			break;
+
+		case 'd':
+			delay = strtoul( optarg, NULL, 10);
+			break;
+
+		case '1':
+			once = zTrue;
+			break;
+
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc)
+		usage();
+
+	if (delay == 0)
+		delay = 1;
+
+	copy = (ZvgShm_s *)malloc( sizeof( ZvgShm_s));
+
+	if (copy == NULL)
+	{	zvgError( errMemory);
+		exit( 1);
+	}
+
+	tmrInit();
+	shm = NULL;
+	err = zvgShmAttach( name, &shm);
+
+	if (once)
+	{
+		if (!err)
+			err = zvgShmRead( shm, copy);
+
+		if (err)
+		{	zvgError( err);
+			exit( 1);
+		}
+
+		printOnce( copy);
+		zvgShmDetach( shm);
+		exit( 0);
+	}
+
+	initscr();
+	start_color();
+	cbreak();
+	noecho();
+	curs_set( 0);
+	keypad( stdscr, TRUE);
+	timeout( (int)delay);
+
+	init_pair( TITLE_PAIR, COLOR_CYAN, COLOR_BLACK);
+	init_pair( BAR_PAIR, COLOR_GREEN, COLOR_BLACK);
+	init_pair( LIMIT_PAIR, COLOR_YELLOW, COLOR_BLACK);
+	init_pair( WARN_PAIR, COLOR_RED, COLOR_BLACK);
+
+	graph = gDraw;
+	paused = zFalse;
+
+	for (;;)
+	{
+		// attach, or attach again if the program went away
+
+		if (shm == NULL)
+			err = zvgShmAttach( name, &shm);
+
+		if (shm != NULL && !paused)
+		{	err = zvgShmRead( shm, copy);
+
+			if (!err)
+			{	progState( copy, &gone);
+
+				if (gone)
+				{
+					// a new run may have made a new segment by now
+
+					zvgShmDetach( shm);
+					shm = NULL;
+
+					if (zvgShmAttach( name, &shm) == errOk)
+						zvgShmRead( shm, copy);
+				}
+			}
+		}
+
+		if (shm != NULL && !err)
+			drawScreen( copy, name, graph, paused);
+
+		else
+			drawWaiting( name, err);
+
+		cc = getch();
+
+		if (cc == 'q' || cc == 'Q')
+			break;
+
+		else if (cc == 'g' || cc == 'G' || cc == '\t')
+			graph = (graph + 1) % GRAPHS;
+
+		else if (cc == 'p' || cc == 'P')
+			paused = !paused;
+	}
+
+	endwin();
+
+	if (shm != NULL)
+		zvgShmDetach( shm);
+
+	free( copy);
+	return (0);
+}
@@ -9,6 +9,17 @@
 * Created:      11/06/02
 *
 * History:
+*    10/18/26
+*       Added the calibration sweep, 'C' key.  Finds the fastest jump and
+*       settle settings that still look clean on a set of test patterns,
+*       measuring the draw time of each through the FIFO backpressure.
+*
+*       The monitor settings are always read from the ZVG, not the device
+*       info cache, and the cache is cleared on exit, see 'zvgCache.c'.
+*
+*       Settings and EEPROM commands go through the control queue, so only
+*       the last change to each setting in a frame is sent, see 'zvgCtl.c'.
+*
 *    07/30/03
 *       Move the generation of the logo to ZVGTWEAK.C.  Removed MAKELOGO.C.
 *
@@ -41,7 +52,9 @@
 #endif // OS
 
 #include	"zvgFrame.h"
+#include	"zvgCache.h"
 #include	"zvgCmds.h"
+#include	"zvgCtl.h"
 
 // For DEBUG_WITHOUT_ZEKTOR_DRIVER to work, also need to exclude the zekShr
 // library from the link. 
@@ -79,6 +92,11 @@
 
 #define	FRAMERATE	60								// frames per second
 
+// Calibration sweep
+
+#define	CAL_WARMUP	4								// frames sent before timing starts
+#define	CAL_FRAMES	16								// frames timed for each pattern
+
 #ifdef DEBUG_WITHOUT_ZEKTOR_DRIVER
 	// Define macros and function prototypes to support testing of this code
 	// without having a real Zektor card atteched to the parallel port.
@@ -92,7 +110,9 @@
 	#define zvgReadMonitorInfo		yReadMonitorInfo
 	#define zvgEncSetColor			yEncSetColor
 	#define zvgEncSetRGB15			yEncSetRGB15
-	#define zvgDmaPutc				yDmaPutc
+	#define zvgCtlSet				yCtlSet
+	#define zvgCtlCmd				yCtlCmd
+	#define zvgCtlSync				yCtlSync
 	#define zvgError				yError
 	#define zvgFrameVector			yFrameVector
 	#define tmrSetFrameRate			ytmrSetFrameRate
@@ -106,7 +126,9 @@
 	static uint yReadMonitorInfo( ZvgMon_s *mon);
 	static void yEncSetColor( uint newcolor);
 	static void yEncSetRGB15(unsigned int, unsigned int, unsigned int);
-	static uint yDmaPutc( uchar cc);
+	static uint yCtlSet( uint reg, uint value);
+	static uint yCtlCmd( uint cmd);
+	static void yCtlSync( void);
 	static void	yError( uint err);
 	static uint yFrameVector( int xStart, int yStart, int xEnd, int yEnd);
 	static void	ytmrSetFrameRate( int fps);
@@ -119,11 +141,8 @@
 
 #endif // DEBUG_WITHOUT_ZEKTOR_DRIVER
 
-// Structure used to hold data read from the ZVG
-
-extern ZvgID_s		ZvgID;
-extern ZvgSpeeds_a	ZvgSpeeds;
-extern ZvgMon_s		ZvgMon;
+// Data read from the ZVG is kept in 'ZvgID', 'ZvgSpeeds' and 'ZvgMon', see
+// 'zvgFrame.h'
 
 // Structure to hold local data, includes row and column address of
 // where parameter is to be printed on the screen.
@@ -409,62 +428,100 @@ int drawDisplay( void)
 }
 
 /*****************************************************************************
-* Syncronize the ZVG with the local variables.
-*
-* The 'ZvgMon' structure is used to keep track of the ZVG's internal state.
-* This routine compares the 'Param[]' array values with the 'ZvgMon'
-* variables, and if a difference is found, sends the new 'Param[].value' to
-* the ZVG and updates the ZvgMon structure.
+* Calibration pattern: short dashes on a grid.  Every dash needs a short
+* jump, so this pattern is limited by the settling time.
 *****************************************************************************/
-void paramSync( void)
+int drawGrid( void)
 {
-	if (Param[ZSHIFT].value != ZvgMon.zShift)
-	{	ZvgMon.zShift = Param[ZSHIFT].value;
-		zvgDmaPutc( zcZSHIFT);
-		zvgDmaPutc( ZvgMon.zShift);
-	}
+	int	xx, yy;
 
-	if (Param[ZOSHOOT].value != ZvgMon.oShoot)
-	{	ZvgMon.oShoot = Param[ZOSHOOT].value;
-		zvgDmaPutc( zcOSHOOT);
-		zvgDmaPutc( ZvgMon.oShoot);
-	}
+	zvgFrameSetRGB15( 31, 31, 31);
 
-	if (Param[ZJUMP].value != ZvgMon.jumpFactor)
-	{	ZvgMon.jumpFactor = Param[ZJUMP].value;
-		zvgDmaPutc( zcJUMP);
-		zvgDmaPutc( ZvgMon.jumpFactor);
+	for (yy = -360; yy <= 360; yy += 48)
+	{
+		for (xx = -480; xx <= 480; xx += 48)
+			zvgFrameVector( xx, yy, xx + 16, yy);
 	}
+	return (errOk);
+}
 
-	if (Param[ZSETTLE].value != ZvgMon.settle)
-	{	ZvgMon.settle = Param[ZSETTLE].value;
-		zvgDmaPutc( zcSETTLE);
-		zvgDmaPutc( ZvgMon.settle);
-	}
+/*****************************************************************************
+* Calibration pattern: short dashes on opposite edges of the screen, drawn
+* in turn.  Every dash needs a jump across the screen, so this pattern is
+* limited by the jump speed.
+*****************************************************************************/
+int drawStar( void)
+{
+	int	ii, xx;
 
-	if (Param[ZMAXINT].value != ZvgMon.max_i)
-	{	ZvgMon.max_i = Param[ZMAXINT].value;
-		zvgDmaPutc( zcMAX_I);
-		zvgDmaPutc( ZvgMon.max_i);
-	}
+	zvgFrameSetRGB15( 31, 31, 31);
 
-	if (Param[ZMININT].value != ZvgMon.min_i)
-	{	ZvgMon.min_i = Param[ZMININT].value;
-		zvgDmaPutc( zcMIN_I);
-		zvgDmaPutc( ZvgMon.min_i);
-	}
+	for (ii = 0; ii < 40; ii++)
+	{	xx = -480 + ii * 24;
+
+		if (ii & 1)
+			zvgFrameVector( xx, -360, xx, -344);
 
-	if (Param[ZPOINT].value != ZvgMon.point_i)
-	{	ZvgMon.point_i = Param[ZPOINT].value;
-		zvgDmaPutc( zcPOINT_I);
-		zvgDmaPutc( ZvgMon.point_i);
+		else
+			zvgFrameVector( -xx, 344, -xx, 360);
 	}
+	return (errOk);
+}
 
-	if (Param[ZSIZE].value != ZvgMon.scale)
-	{	ZvgMon.scale = Param[ZSIZE].value;
-		zvgDmaPutc( zcSCALE);
-		zvgDmaPutc( ZvgMon.scale);
+/*****************************************************************************
+* Calibration pattern: a field of points.  A point is a jump followed by the
+* point intensity, so this shows both tails and missing dots.
+*****************************************************************************/
+int drawDots( void)
+{
+	int	xx, yy;
+
+	zvgFrameSetRGB15( 31, 31, 31);
+
+	for (yy = -360; yy <= 360; yy += 60)
+	{
+		for (xx = -480; xx <= 480; xx += 60)
+			zvgFrameVector( xx, yy, xx, yy);
 	}
+	return (errOk);
+}
+
+// Test patterns used by the calibration sweep
+
+typedef struct CALPAT_S
+{	char	*name;
+	int		(*draw)( void);
+	long	drawUs;						// last measured draw time, us per frame
+	long	baseUs;						// draw time with the settings the sweep started with
+	uint	fulls;						// times the FIFO was found full, per frame
+} CalPat_s;
+
+CalPat_s	CalPat[] =
+{	{ .name = "Logo",	.draw = drawDisplay },
+	{ .name = "Grid",	.draw = drawGrid },
+	{ .name = "Jumps",	.draw = drawStar },
+	{ .name = "Dots",	.draw = drawDots }
+};
+
+#define	CAL_PATS	(sizeof( CalPat) / sizeof( *CalPat))
+
+/*****************************************************************************
+* Syncronize the ZVG with the local variables.
+*
+* Each 'Param[].value' is handed to the control queue, which sends the
+* ones that differ from the ZVG's, kept in 'ZvgMon', with the next frame.
+* See 'zvgCtl.c'.
+*****************************************************************************/
+void paramSync( void)
+{
+	zvgCtlSet( crZShift, Param[ZSHIFT].value);
+	zvgCtlSet( crOShoot, Param[ZOSHOOT].value);
+	zvgCtlSet( crJump, Param[ZJUMP].value);
+	zvgCtlSet( crSettle, Param[ZSETTLE].value);
+	zvgCtlSet( crMaxI, Param[ZMAXINT].value);
+	zvgCtlSet( crMinI, Param[ZMININT].value);
+	zvgCtlSet( crPointI, Param[ZPOINT].value);
+	zvgCtlSet( crScale, Param[ZSIZE].value);
 }
 
 /*****************************************************************************
@@ -525,7 +582,7 @@ void pParamAll( int sel)
 
 	for (ii = 0; ii < sizeof( Param) / sizeof( *Param); ii++)
 	{
-		if (sel == ii)
+		if (sel == (int)ii)
 			pParam( Param + ii, ATTR_SEL, ' ', ' ');
 
 		else
@@ -613,6 +670,7 @@ void displayMenu( void)
 					 "X-Exit to DOS (or use ESC).");
 	mvaddstr( 18, 3, "L-Load values from EEPROM.             "
 					 "S-Save values to EEPROM.");
+	mvaddstr( 19, 3, "C-Calibrate jump and settle.");
 
 #else // DOS
 
@@ -621,6 +679,7 @@ void displayMenu( void)
 	cputs( " Up/Down-Select a parameter.            Left/Right-Update a parameter.\r\n");
 	cputs( " I-Initialize ZVG to factory settings.  X-Exit to DOS (or use ESC).\r\n");
 	cputs( " L-Load values from EEPROM.             S-Save values to EEPROM.\r\n");
+	cputs( " C-Calibrate jump and settle.\r\n");
 //	cputs( " R-Read values from a config file.      W-Write values to a config file.\r\n");
 
 #endif // OS
@@ -628,6 +687,333 @@ void displayMenu( void)
 	pCenter( 21, "(c) Copyright 2003, Zektor, LLC.  All rights reserved.");
 }
 
+/*****************************************************************************
+* Read a key, without waiting for one.
+*
+* Returns:
+*    Key pressed, or -1 if none.
+*****************************************************************************/
+int readKey( void)
+{
+#if defined(WIN32)
+
+	return (-1);
+
+#elif defined(linux)
+
+	int	cc;
+
+	cc = getch();							// in the nodelay state, returns at once
+	return (cc != ERR ? cc : -1);
+
+#else // DOS
+
+	if (kbhit())
+		return (getkey());
+
+	return (-1);
+
+#endif // OS
+}
+
+/*****************************************************************************
+* Clear rows of the screen.
+*
+* Called with:
+*    first = First row to clear.
+*    last  = Last row to clear.
+*****************************************************************************/
+void clearRows( int first, int last)
+{
+	int	row;
+
+	for (row = first; row <= last; row++)
+	{	gotoxy( 1, row);
+		clreol();
+	}
+}
+
+/*****************************************************************************
+* Measure the draw time of each calibration pattern with the current
+* settings.
+*
+* Each pattern is sent back to back, without waiting for the frame timer,
+* so the ZVG's FIFO fills and frames are only taken as fast as the ZVG
+* draws them.  The time per frame is then the ZVG's draw time.
+*
+* Returns:
+*    errCode
+*****************************************************************************/
+uint calMeasure( void)
+{
+	ZvgFrameStats_s	total;
+	long long int	start;
+	ulong			fulls;
+	uint			ii, ff, err;
+
+	pMsg( " Measuring draw times... ");
+
+#if defined(WIN32)
+#elif defined(linux)
+	refresh();
+#else // DOS
+#endif // OS
+
+	start = 0;
+	fulls = 0;
+
+	for (ii = 0; ii < CAL_PATS; ii++)
+	{
+		for (ff = 0; ff < CAL_WARMUP + CAL_FRAMES; ff++)
+		{
+			// once the FIFO is backed up, start timing
+
+			if (ff == CAL_WARMUP)
+			{	err = zvgDmaWait();
+
+				if (err)
+					return (err);
+
+				zvgFrameGetStats( NULL, &total);
+				fulls = total.fulls;
+				start = tmrReadTimer();
+			}
+
+			CalPat[ii].draw();
+			err = zvgFrameSend();
+
+			if (err)
+				return (err);
+		}
+
+		err = zvgDmaWait();
+
+		if (err)
+			return (err);
+
+		CalPat[ii].drawUs = (long)((tmrReadTimer() - start) / 1000 / CAL_FRAMES);
+
+		zvgFrameGetStats( NULL, &total);
+		CalPat[ii].fulls = (uint)((total.fulls - fulls) / CAL_FRAMES);
+	}
+
+	gotoxy( 1, 20);
+	clreol();
+	return (errOk);
+}
+
+/*****************************************************************************
+* Print the measured draw times of the calibration patterns.
+*
+* Called with:
+*    pat = Index of the pattern being shown.
+*****************************************************************************/
+void calTable( uint pat)
+{
+	char	line[81];
+	uint	ii;
+
+	gotoxy( 1, 6);
+	cputs( "   Pattern      Draw time     FIFO full   At start");
+
+	for (ii = 0; ii < CAL_PATS; ii++)
+	{	sprintf( line, "%c%u %-8s %8.2f ms %9u %8.2f ms", ii == pat ? '>' : ' ', ii + 1,
+				CalPat[ii].name, CalPat[ii].drawUs / 1000.0, CalPat[ii].fulls,
+				CalPat[ii].baseUs / 1000.0);
+
+		gotoxy( 1, 7 + ii);
+		clreol();
+
+		if (ii == pat)
+			textattr( ATTR_SEL);
+
+		cputs( line);
+		textattr( ATTR_DEF);
+	}
+}
+
+/*****************************************************************************
+* Show a calibration pattern, frame after frame, until one of the given keys
+* is pressed.  Keys 1 to CAL_PATS choose the pattern shown.
+*
+* Called with:
+*    pat  = Index of the pattern to show, changed by the number keys.
+*    keys = Upper case keys to wait for, ESC always ends the wait.
+*    err  = Set to the error, if sending a frame fails.
+*
+* Returns:
+*    Upper case key pressed, ESC if an error occurred.
+*****************************************************************************/
+int calWait( uint *pat, char *keys, uint *err)
+{
+	int	cc;
+
+	for (;;)
+	{	CalPat[*pat].draw();
+		tmrWaitForFrame();
+		*err = zvgFrameSend();
+
+		if (*err)
+			return (0x1B);
+
+		cc = readKey();
+
+		if (cc == -1)
+			continue;
+
+		if (cc >= 'a' && cc <= 'z')
+			cc -= 'a' - 'A';
+
+		if (cc == 0x1B || (cc != 0 && strchr( keys, cc) != NULL))
+			return (cc);
+
+		if (cc >= '1' && cc < '1' + (int)CAL_PATS)
+		{	*pat = cc - '1';
+			calTable( *pat);
+		}
+	}
+}
+
+/*****************************************************************************
+* Calibration sweep.
+*
+* Finds the fastest jump speed, then the fastest settling time, the operator
+* still finds clean.  Each is found by halving the range between the
+* fastest value confirmed clean (starting with the current value) and the
+* slowest value seen to give artifacts.  For each value tried, the draw
+* times of all the patterns are measured, and the operator looks over the
+* patterns and answers clean or not.
+*
+* At the end, the new settings can be saved to the EEPROM, kept for now,
+* or thrown away.
+*
+* Returns:
+*    errCode
+*****************************************************************************/
+uint calibrate( void)
+{
+	static int	tune[] = { ZJUMP, ZSETTLE };
+	int			orig[2], good, bad, trying, cc;
+	uint		tt, ii, pat, err;
+	char		line[81];
+
+	for (tt = 0; tt < 2; tt++)
+		orig[tt] = Param[tune[tt]].value;
+
+	clearRows( 1, 24);
+	pCenter( 1, "ZVGTWEAK CALIBRATION");
+
+	pat = 0;
+	err = calMeasure();
+
+	for (ii = 0; ii < CAL_PATS; ii++)
+		CalPat[ii].baseUs = CalPat[ii].drawUs;
+
+	cc = 0;
+
+	for (tt = 0; tt < 2 && !err && cc != 0x1B; tt++)
+	{	good = Param[tune[tt]].value;
+		bad = -1;
+
+		while (good - bad > 1)
+		{	trying = bad + 1 + (good - bad - 1) / 2;
+			Param[tune[tt]].value = trying;
+			paramSync();
+
+			err = calMeasure();
+
+			if (err)
+				break;
+
+			if (bad < 0)
+				sprintf( line, "Tuning %s trying %d, clean at %d.", Param[tune[tt]].title, trying, good);
+
+			else
+				sprintf( line, "Tuning %s trying %d, clean at %d, artifacts at %d.",
+						Param[tune[tt]].title, trying, good, bad);
+
+			clearRows( 3, 4);
+			gotoxy( 1, 3);
+			cputs( line);
+			calTable( pat);
+
+			gotoxy( 1, 13);
+			cputs( "Look over each pattern (keys 1-4) for tails, hooks or missing dots.");
+			gotoxy( 1, 15);
+			cputs( " Y-Looks clean, go faster.   N-Artifacts, back off.   ESC-Stop, restore.");
+
+			cc = calWait( &pat, "YN", &err);
+
+			if (cc == 'Y')
+				good = trying;
+
+			else if (cc == 'N')
+				bad = trying;
+
+			else
+				break;
+		}
+
+		Param[tune[tt]].value = good;
+		paramSync();
+	}
+
+	// stopped, put back what we started with
+
+	if (err || cc == 0x1B)
+	{
+		for (tt = 0; tt < 2; tt++)
+			Param[tune[tt]].value = orig[tt];
+
+		paramSync();
+		clearRows( 1, 24);
+
+		if (!err)
+			pMsg( " Calibration stopped, settings restored. ");
+
+		return (err);
+	}
+
+	// show the result, and let the operator decide what to do with it
+
+	err = calMeasure();
+
+	if (err)
+		return (err);
+
+	clearRows( 3, 15);
+	sprintf( line, "Fastest clean settings: %s %d (was %d), %s %d (was %d).",
+			Param[ZJUMP].title, Param[ZJUMP].value, orig[0],
+			Param[ZSETTLE].title, Param[ZSETTLE].value, orig[1]);
+	gotoxy( 1, 3);
+	cputs( line);
+	calTable( pat);
+
+	gotoxy( 1, 15);
+	cputs( " S-Save to EEPROM.   K-Keep without saving.   ESC-Restore the old settings.");
+
+	cc = calWait( &pat, "SK", &err);
+	clearRows( 1, 24);
+
+	if (err)
+		return (err);
+
+	if (cc == 'S')
+	{	zvgCtlCmd( zcSAVE_EE);
+		pMsg( " Calibrated values saved to EEPROM. ");
+	}
+
+	else if (cc == 0x1B)
+	{
+		for (tt = 0; tt < 2; tt++)
+			Param[tune[tt]].value = orig[tt];
+
+		paramSync();
+		pMsg( " Calibration thrown away, settings restored. ");
+	}
+	return (errOk);
+}
+
 /*****************************************************************************
 * MAIN
 *****************************************************************************/
@@ -639,8 +1025,10 @@ int main( int argc, char *argv[])
 	int	pIdx, o_pIdx, clearCount;
 
 	// Setup the ZVG subsytem, this routine initializes the timers and calibrates any timing
-	// needed by the the zvgPort routines.
+	// needed by the the zvgPort routines.  The settings are what we're here to change, so
+	// read them from the ZVG, not from the cache.
 
+	ZvgIO.cacheOff = zTrue;
 	err = zvgFrameOpen();
 
 	if (err)
@@ -780,7 +1168,7 @@ int main( int argc, char *argv[])
 
 			case 'S':
 			case 's':
-				zvgDmaPutc( zcSAVE_EE);
+				zvgCtlCmd( zcSAVE_EE);
 				pMsg( " Current values saved to EEPROM. ");
 				clearCount = FRAMERATE * 4;				// display for 4 seconds
 				break;
@@ -790,7 +1178,7 @@ int main( int argc, char *argv[])
 
 			case 'L':
 			case 'l':
-				zvgDmaPutc( zcLOAD_EE);
+				zvgCtlCmd( zcLOAD_EE);
 				pMsg( " Monitor values re-loaded from EEPROM. ");
 				textattr( ATTR_DEF);
 				clearCount = FRAMERATE * 4;				// display for 4 seconds
@@ -804,13 +1192,32 @@ int main( int argc, char *argv[])
 
 			case 'I':
 			case 'i':
-				zvgDmaPutc( zcRESET_MON);
+				zvgCtlCmd( zcRESET_MON);
 				pMsg( " Monitor values initialized to factory defaults. ");
 				clearCount = FRAMERATE * 4;				// display for 4 seconds
 				paramsChanged = zTrue;						// indicate parameters need reading
 				break;
+
+				// Find the fastest jump and settle settings that still draw
+				// cleanly, see 'calibrate()'.
+
+			case 'C':
+			case 'c':
+				err = calibrate();
+
+				if (err)
+					break;
+
+				displayMenu();
+				pParamAll( pIdx);
+				o_pIdx = -1;
+				clearCount = FRAMERATE * 4;				// display for 4 seconds
+				break;
 			}
 
+			if (err)
+				break;
+
 			if (cc == 0x1B || cc == 'X' || cc == 'x')
 				break;							// if ESC pressed, leave loop
 		} // End of check for keyboard input
@@ -825,14 +1232,16 @@ int main( int argc, char *argv[])
 
 		if (paramsChanged)
 		{	zvgReadMonitorInfo( &ZvgMon);	// read info from ZVG
+			zvgCtlSync();						// 'ZvgMon' matches the ZVG again
 			paramRead();						// update our local database
 			pParamAll( pIdx);					// reprint local variables
 			paramsChanged = zFalse;
 		}
 	} // End of while loop
 
-	// restore ZVG stuff
+	// restore ZVG stuff, the settings may have changed so the next open reads them again
 
+	zvgCacheClear();
 	zvgFrameClose();
 
 	// set back to original video values, clear screen, turn the cursor back on
@@ -877,7 +1286,9 @@ static uint yGetABufferThreaded( void)			{ return errOk; }
 static void yEncSetColor( uint newcolor)		{ return; }
 static void yEncSetRGB15(unsigned int, unsigned int, unsigned int)
 												{ return; }
-static uint yDmaPutc( uchar cc)					{ return errOk; }
+static uint yCtlSet( uint reg, uint value)		{ return errOk; }
+static uint yCtlCmd( uint cmd)					{ return errOk; }
+static void yCtlSync( void)						{ return; }
 static void	yError( uint err)					{ return; }
 static uint yFrameVector( int xStart, int yStart, int xEnd, int yEnd)
 												{ return errOk; }
@@ -902,4 +1313,3 @@ static uint yReadMonitorInfo( ZvgMon_s *mon)
 }
 
 #endif // DEBUG_WITHOUT_ZEKTOR_DRIVER
-